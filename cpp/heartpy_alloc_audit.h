@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// Opt-in heap allocation audit (build with HEARTPY_ALLOC_AUDIT=1, e.g.
+// -DHEARTPY_ALLOC_AUDIT=ON in CMake). The audit build replaces the global
+// operator new/delete with counting versions and attributes allocation
+// count/bytes to the public entry points (AllocSite) and to the analysis
+// stages (StageTimings::Stage). Attribution is inclusive: a poll's
+// allocations also count towards ANALYZE_SIGNAL and WELCH_PSD when those
+// run inside it. In regular builds every function here is a stub that
+// returns zeros and AllocScope compiles to nothing.
+#if !defined(HEARTPY_ALLOC_AUDIT)
+#define HEARTPY_ALLOC_AUDIT 0
+#endif
+
+namespace heartpy {
+
+enum class AllocSite {
+    ANALYZE_SIGNAL = 0,
+    ANALYZE_SEGMENTWISE,
+    ANALYZE_RR,
+    WELCH_PSD,          // every Welch estimate (RR spectrum, SNR, welchPowerSpectrum)
+    RT_PUSH,
+    RT_POLL,
+    COUNT
+};
+
+struct AllocCounters {
+    uint64_t calls = 0;   // scope entries (sites) or stage marks (stages)
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;   // requested bytes
+};
+
+namespace alloc_audit {
+
+constexpr bool kEnabled = HEARTPY_ALLOC_AUDIT != 0;
+
+// Cumulative counters of the calling thread (calls unused)
+AllocCounters threadCounters();
+// Process-wide totals since start/reset (calls unused)
+AllocCounters processTotals();
+AllocCounters site(AllocSite s);
+AllocCounters stage(int stage);        // StageTimings::Stage
+void reset();                          // sites, stages and process totals
+const char* siteName(AllocSite s);
+
+// Internal hooks used by AllocScope / the stage clocks
+void addSite(AllocSite s, const AllocCounters& since);
+void addStage(int stage, const AllocCounters& delta);
+
+} // namespace alloc_audit
+
+// Attributes the allocations made by this thread during the scope to a site
+class AllocScope {
+public:
+#if HEARTPY_ALLOC_AUDIT
+    explicit AllocScope(AllocSite s) : site_(s), start_(alloc_audit::threadCounters()) {}
+    ~AllocScope() { alloc_audit::addSite(site_, start_); }
+#else
+    explicit AllocScope(AllocSite) {}
+#endif
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+#if HEARTPY_ALLOC_AUDIT
+private:
+    AllocSite site_;
+    AllocCounters start_;
+#endif
+};
+
+} // namespace heartpy
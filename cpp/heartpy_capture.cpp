@@ -0,0 +1,481 @@
+#include "heartpy_capture.h"
+#include "heartpy_stream.h"
+#include "heartpy_trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace heartpy {
+
+namespace {
+
+constexpr char kCaptureMagic[4] = {'H', 'P', 'C', 'P'};
+constexpr uint16_t kCaptureVersion = 2; // v2: stateVersion in the header
+constexpr uint16_t kCaptureByteOrder = 0x0102;
+
+static_assert(sizeof(CaptureHeader) % 8 == 0, "blocks stay 8-byte aligned");
+static_assert(sizeof(CaptureBlockHeader) % 8 == 0, "blocks stay 8-byte aligned");
+static_assert(std::is_trivially_copyable<Options>::value, "Options is captured as raw bytes");
+
+// Worst-case encoded bytes per sample: float plus a 10-byte timestamp varint
+constexpr size_t kMaxVarintBytes = 10;
+
+uint64_t fnv1a(const uint8_t* p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+size_t padded(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+uint64_t bitsOf(double v) { uint64_t b; std::memcpy(&b, &v, sizeof(b)); return b; }
+double fromBits(uint64_t b) { double v; std::memcpy(&v, &b, sizeof(v)); return v; }
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) { out.push_back(static_cast<uint8_t>(v | 0x80)); v >>= 7; }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Zig-zag over wrapping differences keeps the round trip exact for any bits
+uint64_t zigzag(uint64_t d) { return (d << 1) ^ (0 - (d >> 63)); }
+uint64_t unzigzag(uint64_t z) { return (z >> 1) ^ (0 - (z & 1)); }
+
+} // namespace
+
+// ------------------------------------------------------------------
+// CaptureRecorder
+// ------------------------------------------------------------------
+
+CaptureRecorder::CaptureRecorder(const std::string& path, double fs, const Options& opt, size_t ringBytes) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("CaptureRecorder: cannot create " + path);
+    size_t cap = 4096;
+    while (cap < ringBytes) cap <<= 1;
+    ring_.resize(cap);
+    mask_ = cap - 1;
+    block_.reserve(4096);
+
+    CaptureHeader hdr {};
+    std::memcpy(hdr.magic, kCaptureMagic, sizeof(hdr.magic));
+    hdr.version = kCaptureVersion;
+    hdr.byteOrder = kCaptureByteOrder;
+    hdr.optionsSize = static_cast<uint32_t>(sizeof(Options));
+    hdr.headerSize = static_cast<uint32_t>(sizeof(CaptureHeader) + padded(sizeof(Options)));
+    hdr.stateVersion = RealtimeAnalyzer::stateFormatVersion();
+    hdr.fs = fs;
+    std::vector<uint8_t> optBytes(padded(sizeof(Options)), 0);
+    std::memcpy(optBytes.data(), &opt, sizeof(Options));
+    hdr.checksum = fnv1a(optBytes.data(), sizeof(Options));
+    if (std::fwrite(&hdr, sizeof(hdr), 1, file_) != 1 ||
+        std::fwrite(optBytes.data(), 1, optBytes.size(), file_) != optBytes.size()) {
+        std::fclose(file_);
+        file_ = nullptr;
+        throw std::runtime_error("CaptureRecorder: cannot write " + path);
+    }
+    bytes_.store(hdr.headerSize, std::memory_order_relaxed);
+    writer_ = std::thread([this] { writerLoop(); });
+}
+
+CaptureRecorder::~CaptureRecorder() { stop(); }
+
+void CaptureRecorder::stop() {
+    if (stopping_.exchange(true, std::memory_order_acq_rel)) return;
+    wakeWriter();
+    if (writer_.joinable()) writer_.join();
+    if (file_) {
+        if (std::fclose(file_) != 0) writeErrors_.fetch_add(1, std::memory_order_relaxed);
+        file_ = nullptr;
+    }
+}
+
+CaptureRecorder::Stats CaptureRecorder::stats() const {
+    Stats s;
+    s.blocks = blocks_.load(std::memory_order_relaxed);
+    s.samples = samples_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.droppedBlocks = droppedBlocks_.load(std::memory_order_relaxed);
+    s.droppedSamples = droppedSamples_.load(std::memory_order_relaxed);
+    s.writeErrors = writeErrors_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void CaptureRecorder::beginBlock(CaptureBlock kind, uint32_t count) {
+    block_.resize(sizeof(CaptureBlockHeader));
+    CaptureBlockHeader h {};
+    h.kind = static_cast<uint32_t>(kind);
+    h.count = count;
+    std::memcpy(block_.data(), &h, sizeof(h));
+}
+
+// Seals the block in block_ and copies it into the ring, or drops it when
+// the writer has fallen a ring behind
+void CaptureRecorder::commitBlock() {
+    const size_t payload = block_.size() - sizeof(CaptureBlockHeader);
+    CaptureBlockHeader h;
+    std::memcpy(&h, block_.data(), sizeof(h));
+    h.payloadSize = static_cast<uint32_t>(payload);
+    h.checksum = fnv1a(block_.data() + sizeof(h), payload);
+    std::memcpy(block_.data(), &h, sizeof(h));
+    block_.resize(padded(block_.size()), 0);
+
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const size_t n = block_.size();
+    if (stopping_.load(std::memory_order_relaxed) || n > ring_.size() - static_cast<size_t>(head - tail)) {
+        droppedSamples_.fetch_add(h.count, std::memory_order_relaxed);
+        droppedBlocks_.fetch_add(1, std::memory_order_release);
+        wakeWriter();
+        return;
+    }
+    const size_t at = static_cast<size_t>(head) & mask_;
+    const size_t first = std::min(n, ring_.size() - at);
+    std::memcpy(ring_.data() + at, block_.data(), first);
+    if (first < n) std::memcpy(ring_.data(), block_.data() + first, n - first);
+    head_.store(head + n, std::memory_order_release);
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    samples_.fetch_add(h.count, std::memory_order_relaxed);
+    wakeWriter();
+}
+
+// Taking wakeMutex_ orders the producer's update before or after the
+// writer's check, so a wakeup cannot fall between its check and its wait
+void CaptureRecorder::wakeWriter() {
+    { std::lock_guard<std::mutex> lock(wakeMutex_); }
+    wake_.notify_one();
+}
+
+void CaptureRecorder::recordState(const uint8_t* blob, size_t size) {
+    beginBlock(CaptureBlock::STATE, 0);
+    block_.insert(block_.end(), blob, blob + size);
+    commitBlock();
+}
+
+template <class T>
+void CaptureRecorder::encodePush(SampleView<T> samples, SampleView<double> timestamps) {
+    const bool timed = !timestamps.empty();
+    const size_t n = timed ? std::min(samples.size(), timestamps.size()) : samples.size();
+    if (n == 0) return;
+    // A block larger than the ring could never be queued. Split the push so
+    // each piece takes at most a quarter of the ring in the worst case and
+    // the writer can drain earlier pieces while later ones are queued.
+    const size_t perSample = sizeof(float) + (timed ? kMaxVarintBytes : 0);
+    const size_t room = ring_.size() / 4 - sizeof(CaptureBlockHeader) - 2 * sizeof(uint64_t);
+    const size_t piece = std::max<size_t>(1, room / perSample);
+    if (n > piece) {
+        for (size_t off = 0; off < n; off += piece) {
+            const size_t len = std::min(piece, n - off);
+            encodePush(samples.subview(off, len), timed ? timestamps.subview(off, len) : SampleView<double>());
+        }
+        return;
+    }
+    beginBlock(timed ? CaptureBlock::SAMPLES_TS : CaptureBlock::SAMPLES, static_cast<uint32_t>(n));
+    const size_t at = block_.size();
+    block_.resize(at + n * sizeof(float));
+    uint8_t* dst = block_.data() + at;
+    for (size_t i = 0; i < n; ++i) {
+        // The value the analyzer stores for this sample
+        const float f = static_cast<float>(samples[i]);
+        std::memcpy(dst + i * sizeof(float), &f, sizeof(f));
+    }
+    if (timed) {
+        block_.resize(padded(block_.size()), 0);
+        uint64_t prev = bitsOf(timestamps[0]);
+        const size_t t0 = block_.size();
+        block_.resize(t0 + sizeof(uint64_t));
+        std::memcpy(block_.data() + t0, &prev, sizeof(prev));
+        uint64_t prevDelta = 0;
+        for (size_t i = 1; i < n; ++i) {
+            const uint64_t bits = bitsOf(timestamps[i]);
+            const uint64_t delta = bits - prev;
+            putVarint(block_, zigzag(delta - prevDelta));
+            prevDelta = delta;
+            prev = bits;
+        }
+    }
+    commitBlock();
+}
+
+void CaptureRecorder::recordPush(SampleView<float> samples, SampleView<double> timestamps) {
+    encodePush(samples, timestamps);
+}
+
+void CaptureRecorder::recordPush(SampleView<double> samples, SampleView<double> timestamps) {
+    encodePush(samples, timestamps);
+}
+
+void CaptureRecorder::recordPoll() {
+    beginBlock(CaptureBlock::POLL, 0);
+    commitBlock();
+}
+
+void CaptureRecorder::recordSetting(CaptureSetting id, double value) {
+    beginBlock(CaptureBlock::SETTING, 0);
+    const uint32_t words[2] = {static_cast<uint32_t>(id), 0};
+    const uint8_t* w = reinterpret_cast<const uint8_t*>(words);
+    block_.insert(block_.end(), w, w + sizeof(words));
+    const uint8_t* v = reinterpret_cast<const uint8_t*>(&value);
+    block_.insert(block_.end(), v, v + sizeof(value));
+    commitBlock();
+}
+
+// fwrite that counts failed or short writes; returns the bytes written
+size_t CaptureRecorder::write(const void* data, size_t size) {
+    const size_t n = std::fwrite(data, 1, size, file_);
+    if (n != size) writeErrors_.fetch_add(1, std::memory_order_relaxed);
+    return n;
+}
+
+// Writes everything queued so far; returns the bytes written
+size_t CaptureRecorder::drain() {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t n = static_cast<size_t>(head - tail);
+    if (n == 0) return 0;
+    const size_t at = static_cast<size_t>(tail) & mask_;
+    const size_t first = std::min(n, ring_.size() - at);
+    size_t written = write(ring_.data() + at, first);
+    if (first < n) written += write(ring_.data(), n - first);
+    // Consumed either way: a failed write is counted, not retried
+    tail_.store(head, std::memory_order_release);
+    return written;
+}
+
+void CaptureRecorder::writerLoop() {
+    for (;;) {
+        const bool last = stopping_.load(std::memory_order_acquire);
+        size_t written = drain();
+        // Losses are reported after the blocks queued before them
+        const uint64_t droppedBlocks = droppedBlocks_.load(std::memory_order_acquire);
+        if (droppedBlocks != reportedDroppedBlocks_) {
+            const uint64_t dropped = droppedSamples_.load(std::memory_order_relaxed);
+            CaptureBlockHeader h {};
+            h.kind = static_cast<uint32_t>(CaptureBlock::DROPPED);
+            const uint64_t lost = dropped - reportedDropped_;
+            h.payloadSize = sizeof(lost);
+            h.checksum = fnv1a(reinterpret_cast<const uint8_t*>(&lost), sizeof(lost));
+            written += write(&h, sizeof(h));
+            written += write(&lost, sizeof(lost));
+            reportedDropped_ = dropped;
+            reportedDroppedBlocks_ = droppedBlocks;
+        }
+        bytes_.fetch_add(written, std::memory_order_relaxed);
+        if (last) break;
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait(lock, [this] {
+            return stopping_.load(std::memory_order_acquire) ||
+                   head_.load(std::memory_order_acquire) != tail_.load(std::memory_order_relaxed) ||
+                   droppedBlocks_.load(std::memory_order_acquire) != reportedDroppedBlocks_;
+        });
+    }
+    if (std::fflush(file_) != 0) writeErrors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------------
+// CaptureReader
+// ------------------------------------------------------------------
+
+CaptureReader::CaptureReader(const std::string& path) {
+#if defined(_WIN32)
+    (void)path;
+    throw std::runtime_error("CaptureReader: memory-mapped files are not supported on this platform");
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("CaptureReader: cannot open " + path);
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CaptureHeader))) {
+        ::close(fd);
+        throw std::runtime_error("CaptureReader: not a capture: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    base_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base_ == MAP_FAILED) { base_ = nullptr; throw std::runtime_error("CaptureReader: mmap failed: " + path); }
+    madvise(base_, size_, MADV_SEQUENTIAL);
+    const uint8_t* p = static_cast<const uint8_t*>(base_);
+    CaptureHeader hdr;
+    std::memcpy(&hdr, p, sizeof(hdr));
+    const char* error = nullptr;
+    if (std::memcmp(hdr.magic, kCaptureMagic, sizeof(hdr.magic)) != 0) error = "not a capture";
+    else if (hdr.version != kCaptureVersion || hdr.byteOrder != kCaptureByteOrder) error = "unsupported capture version or byte order";
+    else if (hdr.optionsSize != sizeof(Options) || hdr.stateVersion != RealtimeAnalyzer::stateFormatVersion() ||
+             hdr.headerSize > size_) error = "Options layout differs from this build";
+    else if (fnv1a(p + sizeof(hdr), sizeof(Options)) != hdr.checksum) error = "header checksum mismatch";
+    if (error) {
+        munmap(base_, size_);
+        base_ = nullptr;
+        throw std::runtime_error(std::string("CaptureReader: ") + error + ": " + path);
+    }
+    std::memcpy(&opt_, p + sizeof(hdr), sizeof(Options));
+    fs_ = hdr.fs;
+    first_ = pos_ = hdr.headerSize;
+#endif
+}
+
+CaptureReader::~CaptureReader() {
+#if !defined(_WIN32)
+    if (base_) munmap(base_, size_);
+#endif
+}
+
+void CaptureReader::rewind() {
+    pos_ = first_;
+    truncated_ = false;
+}
+
+bool CaptureReader::next(Block& b) {
+    if (pos_ >= size_) return false;
+    const uint8_t* p = static_cast<const uint8_t*>(base_);
+    CaptureBlockHeader h;
+    if (size_ - pos_ < sizeof(h)) { truncated_ = true; return false; }
+    std::memcpy(&h, p + pos_, sizeof(h));
+    const size_t body = padded(h.payloadSize);
+    if (size_ - pos_ - sizeof(h) < h.payloadSize) { truncated_ = true; return false; }
+    b.kind = static_cast<CaptureBlock>(h.kind);
+    b.count = h.count;
+    b.payload = p + pos_ + sizeof(h);
+    b.payloadSize = h.payloadSize;
+    b.checksumOk = fnv1a(b.payload, b.payloadSize) == h.checksum;
+    pos_ = std::min(size_, pos_ + sizeof(h) + body);
+    return true;
+}
+
+SampleView<float> CaptureReader::samples(const Block& b) {
+    if (b.payloadSize < static_cast<size_t>(b.count) * sizeof(float)) return {};
+    return SampleView<float>(reinterpret_cast<const float*>(b.payload), b.count);
+}
+
+bool CaptureReader::timestamps(const Block& b, std::vector<double>& out) {
+    out.clear();
+    if (b.count == 0) return true;
+    const size_t at = padded(static_cast<size_t>(b.count) * sizeof(float));
+    if (b.payloadSize < at + sizeof(uint64_t)) return false;
+    const uint8_t* p = b.payload + at;
+    const uint8_t* end = b.payload + b.payloadSize;
+    uint64_t prev;
+    std::memcpy(&prev, p, sizeof(prev));
+    p += sizeof(prev);
+    out.reserve(b.count);
+    out.push_back(fromBits(prev));
+    uint64_t prevDelta = 0;
+    for (uint32_t i = 1; i < b.count; ++i) {
+        uint64_t z;
+        if (!getVarint(p, end, z)) return false;
+        const uint64_t delta = prevDelta + unzigzag(z);
+        prev += delta;
+        prevDelta = delta;
+        out.push_back(fromBits(prev));
+    }
+    return true;
+}
+
+void CaptureReader::setting(const Block& b, CaptureSetting& id, double& value) {
+    uint32_t word = 0;
+    value = 0.0;
+    if (b.payloadSize >= sizeof(uint32_t) * 2 + sizeof(double)) {
+        std::memcpy(&word, b.payload, sizeof(word));
+        std::memcpy(&value, b.payload + 2 * sizeof(uint32_t), sizeof(value));
+    }
+    id = static_cast<CaptureSetting>(word);
+}
+
+uint64_t CaptureReader::dropped(const Block& b) {
+    uint64_t n = 0;
+    if (b.payloadSize >= sizeof(n)) std::memcpy(&n, b.payload, sizeof(n));
+    return n;
+}
+
+// ------------------------------------------------------------------
+// Replay
+// ------------------------------------------------------------------
+
+ReplayStats replayCapture(const std::string& path, const ReplayOptions& ropt) {
+    CaptureReader reader(path);
+    RealtimeAnalyzer analyzer(reader.fs(), reader.options());
+    return replayCapture(reader, analyzer, ropt);
+}
+
+ReplayStats replayCapture(CaptureReader& reader, RealtimeAnalyzer& analyzer, const ReplayOptions& ropt) {
+    trace::Span span("replayCapture");
+    using Clock = std::chrono::steady_clock;
+    ReplayStats st;
+    HeartMetrics out;
+    std::vector<double> ts;
+    const bool paced = ropt.speed > 0.0;
+    Clock::time_point wall0 {};
+    double stream0 = 0.0;
+    bool started = false;
+
+    CaptureReader::Block b;
+    while (reader.next(b)) {
+        ++st.blocks;
+        if (!b.checksumOk) { ++st.corruptBlocks; continue; }
+        switch (b.kind) {
+            case CaptureBlock::STATE:
+                st.stateRestored = analyzer.restoreState(b.payload, b.payloadSize) || st.stateRestored;
+                break;
+            case CaptureBlock::SAMPLES:
+            case CaptureBlock::SAMPLES_TS: {
+                const SampleView<float> x = CaptureReader::samples(b);
+                if (b.kind == CaptureBlock::SAMPLES) {
+                    analyzer.push(x);
+                } else {
+                    if (!CaptureReader::timestamps(b, ts)) { ++st.corruptBlocks; break; }
+                    analyzer.push(x, SampleView<double>(ts));
+                }
+                st.samples += x.size();
+                if (paced) {
+                    const double t = analyzer.streamTime();
+                    if (!started) { wall0 = Clock::now(); stream0 = t; started = true; }
+                    const auto due = wall0 + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>((t - stream0) / ropt.speed));
+                    std::this_thread::sleep_until(due);
+                }
+                break;
+            }
+            case CaptureBlock::POLL:
+                ++st.polls;
+                if (analyzer.poll(out)) {
+                    ++st.results;
+                    if (ropt.onResult) ropt.onResult(out);
+                }
+                break;
+            case CaptureBlock::SETTING: {
+                CaptureSetting id;
+                double value;
+                CaptureReader::setting(b, id, value);
+                switch (id) {
+                    case CaptureSetting::WINDOW_SEC: analyzer.setWindowSeconds(value); break;
+                    case CaptureSetting::UPDATE_INTERVAL_SEC: analyzer.setUpdateIntervalSeconds(value); break;
+                    case CaptureSetting::PSD_UPDATE_SEC: analyzer.setPsdUpdateSeconds(value); break;
+                    case CaptureSetting::DISPLAY_HZ: analyzer.setDisplayHz(value); break;
+                }
+                break;
+            }
+            case CaptureBlock::DROPPED:
+                st.droppedSamples += CaptureReader::dropped(b);
+                break;
+        }
+    }
+    st.truncated = reader.truncated();
+    return st;
+}
+
+} // namespace heartpy
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "heartpy_core.h"
+
+// Binary session capture for offline replay and regression. A capture is a
+// header (fs, Options) followed by checksummed blocks: a checkpoint of the
+// analyzer state when capture started, then every push, emitting poll and
+// setting change in the order the analyzer saw them. Samples are stored as
+// the float values the analyzer ingests. Timestamps are stored losslessly as
+// zig-zag varints of the second difference of their bit patterns, about one
+// byte per sample at a steady frame rate. Replaying a capture through an
+// analyzer built from the same sources therefore feeds it bit-identical
+// inputs in the same order relative to polls and setting changes.
+//
+// Options are stored as raw bytes, like the Options inside the checkpoint,
+// and the header records the checkpoint format version
+// (RealtimeAnalyzer::stateFormatVersion()) that governs their layout, so a
+// reader rejects captures whose Options it would misread.
+//
+// Layout (native-endian, every block 8-byte aligned):
+//   CaptureHeader, Options bytes (padded to 8)
+//   repeated: CaptureBlockHeader, payload (padded to 8)
+//     STATE       RealtimeAnalyzer::saveState() blob
+//     SAMPLES     count floats
+//     SAMPLES_TS  count floats (padded to 8), first timestamp (double),
+//                 then count - 1 varints
+//     POLL        empty: an emitting poll() happened here
+//     SETTING     uint32 id, uint32 0, double value
+//     DROPPED     uint64 samples lost because the recorder buffer was full
+
+namespace heartpy {
+
+class RealtimeAnalyzer;
+
+enum class CaptureBlock : uint32_t { STATE = 1, SAMPLES = 2, SAMPLES_TS = 3, POLL = 4, SETTING = 5, DROPPED = 6 };
+enum class CaptureSetting : uint32_t { WINDOW_SEC = 1, UPDATE_INTERVAL_SEC = 2, PSD_UPDATE_SEC = 3, DISPLAY_HZ = 4 };
+
+struct CaptureHeader {
+    char magic[4];      // "HPCP"
+    uint16_t version;
+    uint16_t byteOrder; // 0x0102 as written by the recorder
+    uint32_t optionsSize;
+    uint32_t headerSize;   // this header plus the padded Options bytes
+    uint32_t stateVersion; // RealtimeAnalyzer::stateFormatVersion() of the writer
+    uint32_t reserved;
+    double fs;
+    uint64_t checksum;   // FNV-1a over the Options bytes
+};
+
+struct CaptureBlockHeader {
+    uint32_t kind;        // CaptureBlock
+    uint32_t count;       // samples in SAMPLES/SAMPLES_TS, else 0
+    uint32_t payloadSize; // without padding
+    uint32_t reserved;
+    uint64_t checksum;    // FNV-1a over the payload
+};
+
+// Writes a capture from the thread that pushes to the analyzer. Blocks are
+// encoded on the calling thread into a lock-free single-producer ring, and a
+// writer thread drains the ring to the file, so recording never waits on
+// I/O. Pushes whose block could take more than a quarter of the ring are
+// split into several SAMPLES blocks. When the ring is full a block is
+// dropped (never blocking the caller) and a DROPPED block records the loss.
+// Failed file writes are counted in Stats::writeErrors. The record* calls
+// must not run concurrently with each other. RealtimeAnalyzer makes them
+// under its lock.
+class CaptureRecorder {
+public:
+    struct Stats {
+        uint64_t blocks {0};         // blocks queued
+        uint64_t samples {0};        // samples queued
+        uint64_t bytes {0};          // bytes written to the file
+        uint64_t droppedBlocks {0};  // blocks lost to a full ring
+        uint64_t droppedSamples {0};
+        uint64_t writeErrors {0};    // failed or short writes; the file is incomplete
+    };
+
+    // Creates path and writes the header; throws std::runtime_error if the
+    // file cannot be created. ringBytes is rounded up to a power of two.
+    CaptureRecorder(const std::string& path, double fs, const Options& opt, size_t ringBytes = 1u << 20);
+    CaptureRecorder(const CaptureRecorder&) = delete;
+    CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+    ~CaptureRecorder();
+
+    void recordState(const uint8_t* blob, size_t size);
+    void recordPush(SampleView<float> samples, SampleView<double> timestamps = {});
+    void recordPush(SampleView<double> samples, SampleView<double> timestamps = {});
+    void recordPoll();
+    void recordSetting(CaptureSetting id, double value);
+
+    // Drains the ring, closes the file and joins the writer (idempotent)
+    void stop();
+    Stats stats() const;
+
+private:
+    template <class T> void encodePush(SampleView<T> samples, SampleView<double> timestamps);
+    void beginBlock(CaptureBlock kind, uint32_t count);
+    void commitBlock();
+    void wakeWriter();
+    void writerLoop();
+    size_t drain();
+    size_t write(const void* data, size_t size);
+
+    std::FILE* file_ {nullptr};
+    std::vector<uint8_t> ring_;
+    size_t mask_ {0};
+    std::atomic<uint64_t> head_ {0}; // producer position
+    std::atomic<uint64_t> tail_ {0}; // writer position
+    std::atomic<bool> stopping_ {false};
+    std::vector<uint8_t> block_;     // producer-side encoding scratch
+    std::atomic<uint64_t> blocks_ {0}, samples_ {0}, bytes_ {0}, droppedBlocks_ {0}, droppedSamples_ {0}, writeErrors_ {0};
+    uint64_t reportedDropped_ {0}, reportedDroppedBlocks_ {0}; // writer side
+    // The writer sleeps on wake_ until a block is committed or dropped, or
+    // stop() runs; wakeMutex_ is held only around that check, never over I/O
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::thread writer_;
+};
+
+// Memory-mapped capture reader. Blocks are returned in file order and their
+// payloads point into the mapping.
+class CaptureReader {
+public:
+    struct Block {
+        CaptureBlock kind {CaptureBlock::POLL};
+        uint32_t count {0};
+        const uint8_t* payload {nullptr};
+        size_t payloadSize {0};
+        bool checksumOk {true};
+    };
+
+    // Throws std::runtime_error if the file cannot be mapped or its header is
+    // not a capture from a build with this byte order and Options layout
+    explicit CaptureReader(const std::string& path);
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+    ~CaptureReader();
+
+    double fs() const { return fs_; }
+    const Options& options() const { return opt_; }
+    // False at the end of the file, or at a truncated block (see truncated())
+    bool next(Block& b);
+    bool truncated() const { return truncated_; }
+    void rewind();
+
+    // Payload decoders (the block kind is not checked)
+    static SampleView<float> samples(const Block& b); // SAMPLES/SAMPLES_TS, in place
+    static bool timestamps(const Block& b, std::vector<double>& out);
+    static void setting(const Block& b, CaptureSetting& id, double& value);
+    static uint64_t dropped(const Block& b);
+
+private:
+    void* base_ {nullptr};
+    size_t size_ {0};
+    size_t first_ {0};
+    size_t pos_ {0};
+    bool truncated_ {false};
+    double fs_ {0.0};
+    Options opt_ {};
+};
+
+struct ReplayOptions {
+    double speed = 0.0; // 0: as fast as possible; otherwise N x real time (stream time)
+    // Called with each emitted result
+    std::function<void(const HeartMetrics&)> onResult;
+};
+
+struct ReplayStats {
+    uint64_t blocks = 0;
+    uint64_t samples = 0;
+    uint64_t polls = 0;          // POLL blocks replayed
+    uint64_t results = 0;        // of those, polls that emitted (equal to polls for a faithful replay)
+    uint64_t corruptBlocks = 0;  // checksum mismatches (skipped)
+    uint64_t droppedSamples = 0; // lost at capture time (DROPPED blocks)
+    bool stateRestored = false;
+    bool truncated = false;
+};
+
+// Replays into a new analyzer built from the capture's fs and Options
+ReplayStats replayCapture(const std::string& path, const ReplayOptions& ropt = {});
+ReplayStats replayCapture(CaptureReader& reader, RealtimeAnalyzer& analyzer, const ReplayOptions& ropt = {});
+
+} // namespace heartpy
@@ -0,0 +1,220 @@
+#include "heartpy_columnar.h"
+
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "heartpy_columnar writes native little-endian buffers"
+#endif
+
+namespace heartpy {
+
+using namespace columnar;
+
+namespace {
+
+static_assert(sizeof(ResultBinaryHeader) == kScalarsOffset, "header must end where the scalars start");
+static_assert(sizeof(ResultColumnEntry) == 16, "directory entries are 16 bytes");
+
+constexpr size_t pad8(size_t n) { return (n + 7) & ~size_t(7); }
+
+size_t elementSize(ColumnType t) {
+    switch (t) {
+        case F64: return 8;
+        case F32: case I32: return 4;
+        case U8: return 1;
+    }
+    return 0;
+}
+
+// Column types and element counts of r, in ResultColumn order
+struct Layout {
+    ColumnType type[COLUMN_COUNT];
+    size_t count[COLUMN_COUNT];
+    size_t total;
+
+    explicit Layout(const HeartMetrics& r) {
+        auto set = [&](ResultColumn c, ColumnType t, size_t n) { type[c] = t; count[c] = n; };
+        set(IBI_MS, F64, r.ibiMs.size());
+        set(RR_LIST, F64, r.rrList.size());
+        set(PEAK_LIST, I32, r.peakList.size());
+        set(PEAK_TIMESTAMPS, F64, r.peakTimestamps.size());
+        set(PEAK_LIST_RAW, I32, r.peakListRaw.size());
+        set(BINARY_PEAK_MASK, I32, r.binaryPeakMask.size());
+        set(WAVEFORM_VALUES, F32, r.waveform_values.size());
+        set(WAVEFORM_TIMESTAMPS, F32, r.waveform_timestamps.size());
+        set(BINARY_SEGMENTS, I32, r.binarySegments.size() * 6);
+        set(TIMINGS_US, F64, r.timings.valid ? static_cast<size_t>(StageTimings::COUNT) : 0);
+        set(QUALITY_WARNING, U8, r.quality.qualityWarning.size());
+        set(STAGE_ALLOCS, F64, r.timings.allocsValid ? static_cast<size_t>(StageTimings::COUNT) : 0);
+        total = kDataOffset;
+        for (uint32_t c = 0; c < COLUMN_COUNT; ++c) total += pad8(count[c] * elementSize(type[c]));
+    }
+};
+
+template <class T>
+void put(uint8_t* p, T v) { std::memcpy(p, &v, sizeof(T)); }
+
+template <class T>
+T get(const uint8_t* p) { T v; std::memcpy(&v, p, sizeof(T)); return v; }
+
+} // namespace
+
+size_t encodedMetricsSize(const HeartMetrics& r) { return Layout(r).total; }
+
+size_t encodeMetrics(const HeartMetrics& r, uint8_t* out, size_t cap) {
+    const Layout lay(r);
+    if (!out || cap < lay.total || lay.total > UINT32_MAX) return 0;
+
+    ResultBinaryHeader h {};
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.totalSize = static_cast<uint32_t>(lay.total);
+    h.columnCount = COLUMN_COUNT;
+    std::memcpy(out, &h, sizeof(h));
+
+    const QualityInfo& q = r.quality;
+    const double t0 = r.waveform_timestamps.empty() ? 0.0 : r.waveform_timestamps[0];
+    const double scalars[SCALAR_COUNT] = {
+        r.bpm, r.sdnn, r.rmssd, r.sdsd, r.pnn20, r.pnn50, r.nn20, r.nn50, r.mad,
+        r.sd1, r.sd2, r.sd1sd2Ratio, r.ellipseArea,
+        r.vlf, r.lf, r.hf, r.lfhf, r.totalPower, r.lfNorm, r.hfNorm, r.breathingRate,
+        q.rejectionRate, q.snrDb, q.confidence, q.f0Hz, q.maPercActive, q.snrSampleCount,
+        q.refractoryMsActive, q.minRRBoundMs, q.pairFrac, q.rrShortFrac, q.rrLongMs, q.pHalfOverFund,
+        q.provisionalBpm, q.provisionalConfidence,
+        t0,
+    };
+    std::memcpy(out + kScalarsOffset, scalars, sizeof(scalars));
+    const int32_t ints[INT_COUNT] = {
+        q.totalBeats, q.rejectedBeats, q.goodQuality ? 1 : 0, q.doublingFlag, q.softDoublingFlag, q.doublingHintFlag,
+        q.hardFallbackActive, q.rrFallbackModeActive, q.snrWarmupActive, q.provisionalActive,
+    };
+    std::memset(out + kIntsOffset, 0, kDirectoryOffset - kIntsOffset);
+    std::memcpy(out + kIntsOffset, ints, sizeof(ints));
+
+    size_t off = kDataOffset;
+    for (uint32_t c = 0; c < COLUMN_COUNT; ++c) {
+        const ResultColumnEntry e {lay.type[c], static_cast<uint32_t>(lay.count[c]), static_cast<uint32_t>(off), 0};
+        std::memcpy(out + kDirectoryOffset + c * sizeof(e), &e, sizeof(e));
+        uint8_t* p = out + off;
+        const size_t bytes = lay.count[c] * elementSize(lay.type[c]);
+        switch (static_cast<ResultColumn>(c)) {
+            case IBI_MS: std::memcpy(p, r.ibiMs.data(), bytes); break;
+            case RR_LIST: std::memcpy(p, r.rrList.data(), bytes); break;
+            case PEAK_LIST: std::memcpy(p, r.peakList.data(), bytes); break;
+            case PEAK_TIMESTAMPS: std::memcpy(p, r.peakTimestamps.data(), bytes); break;
+            case PEAK_LIST_RAW: std::memcpy(p, r.peakListRaw.data(), bytes); break;
+            case BINARY_PEAK_MASK: std::memcpy(p, r.binaryPeakMask.data(), bytes); break;
+            case WAVEFORM_VALUES: {
+                const double* v = r.waveform_values.data();
+                for (size_t i = 0; i < lay.count[c]; ++i) put(p + 4 * i, static_cast<float>(v[i]));
+                break;
+            }
+            case WAVEFORM_TIMESTAMPS: {
+                const double* t = r.waveform_timestamps.data();
+                for (size_t i = 0; i < lay.count[c]; ++i) put(p + 4 * i, static_cast<float>(t[i] - t0));
+                break;
+            }
+            case BINARY_SEGMENTS:
+                for (size_t i = 0; i < r.binarySegments.size(); ++i) {
+                    const auto& bs = r.binarySegments[i];
+                    const int32_t row[6] = {bs.index, bs.startBeat, bs.endBeat, bs.totalBeats, bs.rejectedBeats, bs.accepted ? 1 : 0};
+                    std::memcpy(p + i * sizeof(row), row, sizeof(row));
+                }
+                break;
+            case TIMINGS_US: std::memcpy(p, r.timings.us, bytes); break;
+            case QUALITY_WARNING: std::memcpy(p, q.qualityWarning.data(), bytes); break;
+            case STAGE_ALLOCS:
+                // Counts stay exact as doubles up to 2^53
+                for (size_t i = 0; i < lay.count[c]; ++i) put(p + 8 * i, static_cast<double>(r.timings.allocs[i]));
+                break;
+            case COLUMN_COUNT: break;
+        }
+        std::memset(p + bytes, 0, pad8(bytes) - bytes);
+        off += pad8(bytes);
+    }
+    return lay.total;
+}
+
+void encodeMetrics(const HeartMetrics& r, std::vector<uint8_t>& out) {
+    out.resize(encodedMetricsSize(r));
+    encodeMetrics(r, out.data(), out.size());
+}
+
+bool decodeMetrics(const uint8_t* data, size_t size, HeartMetrics& out) {
+    if (!data || size < kDataOffset) return false;
+    const ResultBinaryHeader h = get<ResultBinaryHeader>(data);
+    if (h.magic != kMagic || h.version != kVersion || h.totalSize > size || h.columnCount < COLUMN_COUNT) return false;
+
+    ResultColumnEntry cols[COLUMN_COUNT];
+    for (uint32_t c = 0; c < COLUMN_COUNT; ++c) {
+        cols[c] = get<ResultColumnEntry>(data + kDirectoryOffset + c * sizeof(ResultColumnEntry));
+        const size_t es = elementSize(static_cast<ColumnType>(cols[c].type));
+        if (!es || cols[c].offset > h.totalSize || cols[c].count > (h.totalSize - cols[c].offset) / es) return false;
+    }
+
+    HeartMetrics r;
+    double s[SCALAR_COUNT];
+    std::memcpy(s, data + kScalarsOffset, sizeof(s));
+    int32_t in[INT_COUNT];
+    std::memcpy(in, data + kIntsOffset, sizeof(in));
+    r.bpm = s[BPM]; r.sdnn = s[SDNN]; r.rmssd = s[RMSSD]; r.sdsd = s[SDSD];
+    r.pnn20 = s[PNN20]; r.pnn50 = s[PNN50]; r.nn20 = s[NN20]; r.nn50 = s[NN50]; r.mad = s[MAD];
+    r.sd1 = s[SD1]; r.sd2 = s[SD2]; r.sd1sd2Ratio = s[SD1SD2_RATIO]; r.ellipseArea = s[ELLIPSE_AREA];
+    r.vlf = s[VLF]; r.lf = s[LF]; r.hf = s[HF]; r.lfhf = s[LFHF]; r.totalPower = s[TOTAL_POWER];
+    r.lfNorm = s[LF_NORM]; r.hfNorm = s[HF_NORM]; r.breathingRate = s[BREATHING_RATE];
+    QualityInfo& q = r.quality;
+    q.rejectionRate = s[REJECTION_RATE]; q.snrDb = s[SNR_DB]; q.confidence = s[CONFIDENCE]; q.f0Hz = s[F0_HZ];
+    q.maPercActive = s[MA_PERC_ACTIVE]; q.snrSampleCount = s[SNR_SAMPLE_COUNT];
+    q.refractoryMsActive = s[REFRACTORY_MS_ACTIVE]; q.minRRBoundMs = s[MIN_RR_BOUND_MS]; q.pairFrac = s[PAIR_FRAC];
+    q.rrShortFrac = s[RR_SHORT_FRAC]; q.rrLongMs = s[RR_LONG_MS]; q.pHalfOverFund = s[P_HALF_OVER_FUND];
+    q.provisionalBpm = s[PROVISIONAL_BPM]; q.provisionalConfidence = s[PROVISIONAL_CONFIDENCE];
+    q.totalBeats = in[TOTAL_BEATS]; q.rejectedBeats = in[REJECTED_BEATS]; q.goodQuality = in[GOOD_QUALITY] != 0;
+    q.doublingFlag = in[DOUBLING_FLAG]; q.softDoublingFlag = in[SOFT_DOUBLING_FLAG]; q.doublingHintFlag = in[DOUBLING_HINT_FLAG];
+    q.hardFallbackActive = in[HARD_FALLBACK_ACTIVE]; q.rrFallbackModeActive = in[RR_FALLBACK_MODE_ACTIVE];
+    q.snrWarmupActive = in[SNR_WARMUP_ACTIVE]; q.provisionalActive = in[PROVISIONAL_ACTIVE];
+
+    auto column = [&](ResultColumn c, ColumnType t) -> size_t { return cols[c].type == t ? cols[c].count : 0; };
+    auto f64 = [&](ResultColumn c, std::vector<double>& v) {
+        v.resize(column(c, F64));
+        std::memcpy(v.data(), data + cols[c].offset, v.size() * 8);
+    };
+    auto i32 = [&](ResultColumn c, std::vector<int>& v) {
+        v.resize(column(c, I32));
+        std::memcpy(v.data(), data + cols[c].offset, v.size() * 4);
+    };
+    f64(IBI_MS, r.ibiMs); f64(RR_LIST, r.rrList); i32(PEAK_LIST, r.peakList); f64(PEAK_TIMESTAMPS, r.peakTimestamps);
+    i32(PEAK_LIST_RAW, r.peakListRaw); i32(BINARY_PEAK_MASK, r.binaryPeakMask);
+    {
+        std::vector<double> v(column(WAVEFORM_VALUES, F32));
+        for (size_t i = 0; i < v.size(); ++i) v[i] = get<float>(data + cols[WAVEFORM_VALUES].offset + 4 * i);
+        r.waveform_values = std::move(v);
+        std::vector<double> t(column(WAVEFORM_TIMESTAMPS, F32));
+        for (size_t i = 0; i < t.size(); ++i) t[i] = s[WAVEFORM_T0] + get<float>(data + cols[WAVEFORM_TIMESTAMPS].offset + 4 * i);
+        r.waveform_timestamps = std::move(t);
+    }
+    {
+        std::vector<int> rows;
+        i32(BINARY_SEGMENTS, rows);
+        for (size_t i = 0; i + 6 <= rows.size(); i += 6) {
+            HeartMetrics::BinarySegment bs;
+            bs.index = rows[i]; bs.startBeat = rows[i + 1]; bs.endBeat = rows[i + 2];
+            bs.totalBeats = rows[i + 3]; bs.rejectedBeats = rows[i + 4]; bs.accepted = rows[i + 5] != 0;
+            r.binarySegments.push_back(bs);
+        }
+    }
+    if (column(TIMINGS_US, F64) == static_cast<size_t>(StageTimings::COUNT)) {
+        std::memcpy(r.timings.us, data + cols[TIMINGS_US].offset, sizeof(r.timings.us));
+        r.timings.valid = true;
+    }
+    if (column(STAGE_ALLOCS, F64) == static_cast<size_t>(StageTimings::COUNT)) {
+        for (int i = 0; i < StageTimings::COUNT; ++i) {
+            r.timings.allocs[i] = static_cast<uint64_t>(get<double>(data + cols[STAGE_ALLOCS].offset + 8 * i));
+        }
+        r.timings.allocsValid = true;
+    }
+    q.qualityWarning.assign(reinterpret_cast<const char*>(data + cols[QUALITY_WARNING].offset), column(QUALITY_WARNING, U8));
+    out = std::move(r);
+    return true;
+}
+
+} // namespace heartpy
@@ -1,4 +1,8 @@
 #include "heartpy_core.h"
+#include "heartpy_dsp.h"
+#include "heartpy_alloc_audit.h"
+#include "heartpy_trace.h"
+#include "heartpy_metrics.h"
 
 #include <algorithm>
 #include <cmath>
@@ -10,8 +14,11 @@
 #include <atomic>
 #include <cstdio>
 #include <cstdarg>
+#include <cstring>
 #include <mutex>
 #include <unordered_map>
+#include <chrono>
+#include <type_traits>
 #if defined(__ANDROID__)
 #include <android/log.h>
 #endif
@@ -30,118 +37,251 @@
 
 namespace heartpy {
 
-static bool s_deterministic = false;
+static constexpr const char* kTagWelch = "HeartPySNR][welchPSD";
+static constexpr const char* kTagAnalyze = "HeartPyAnalyze";
+
+// One immutable FFT plan per nfft; destroyed when the last reference drops
+struct FftPlanCache::Plan {
+    int nfft = 0;
+#if defined(USE_ACCELERATE_FFT)
+    FFTSetupD setup = nullptr;
+    explicit Plan(int n) : nfft(n), setup(vDSP_create_fftsetupD(static_cast<vDSP_Length>(std::log2(n)), kFFTRadix2)) {}
+    ~Plan() { if (setup) vDSP_destroy_fftsetupD(setup); }
+#elif defined(USE_KISSFFT)
+    // kiss_fftr split into its read-only parts: the nfft/2 complex plan and
+    // the real-input twiddles. kiss_fftr_cfg also embeds the work buffer
+    // kiss_fftr() writes, so the caller passes that in instead and one plan
+    // serves every thread.
+    kiss_fft_cfg sub = nullptr;
+    std::vector<kiss_fft_cpx> superTwiddles;
+    explicit Plan(int n) : nfft(n), sub(kiss_fft_alloc(n / 2, 0, nullptr, nullptr)) {
+        const int ncfft = n / 2;
+        superTwiddles.resize(static_cast<size_t>(ncfft / 2));
+        for (int i = 0; i < ncfft / 2; ++i) {
+            const double phase = -3.14159265358979323846264338327 * (static_cast<double>(i + 1) / ncfft + .5);
+            superTwiddles[i].r = static_cast<kiss_fft_scalar>(std::cos(phase));
+            superTwiddles[i].i = static_cast<kiss_fft_scalar>(std::sin(phase));
+        }
+    }
+    ~Plan() { if (sub) kiss_fft_free(sub); }
+    // Same arithmetic as kiss_fftr(); work holds nfft/2 complex values
+    void forward(const kiss_fft_scalar* in, kiss_fft_cpx* work, kiss_fft_cpx* out) const {
+        const int ncfft = nfft / 2;
+        kiss_fft(sub, reinterpret_cast<const kiss_fft_cpx*>(in), work);
+        const kiss_fft_cpx tdc = work[0];
+        out[0].r = tdc.r + tdc.i;
+        out[ncfft].r = tdc.r - tdc.i;
+        out[ncfft].i = out[0].i = 0;
+        for (int k = 1; k <= ncfft / 2; ++k) {
+            const kiss_fft_cpx fpk = work[k];
+            const kiss_fft_cpx fpnk{work[ncfft - k].r, -work[ncfft - k].i};
+            const kiss_fft_cpx f1k{fpk.r + fpnk.r, fpk.i + fpnk.i};
+            const kiss_fft_cpx f2k{fpk.r - fpnk.r, fpk.i - fpnk.i};
+            const kiss_fft_cpx& st = superTwiddles[k - 1];
+            const kiss_fft_cpx tw{f2k.r * st.r - f2k.i * st.i, f2k.r * st.i + f2k.i * st.r};
+            out[k].r = (f1k.r + tw.r) * static_cast<kiss_fft_scalar>(.5);
+            out[k].i = (f1k.i + tw.i) * static_cast<kiss_fft_scalar>(.5);
+            out[ncfft - k].r = (f1k.r - tw.r) * static_cast<kiss_fft_scalar>(.5);
+            out[ncfft - k].i = (tw.i - f1k.i) * static_cast<kiss_fft_scalar>(.5);
+        }
+    }
+#else
+    explicit Plan(int n) : nfft(n) {} // internal radix-2 FFT needs no precomputed state
+#endif
+    Plan(const Plan&) = delete;
+    Plan& operator=(const Plan&) = delete;
+};
+
+// Published plan set; never mutated after publication (sorted by nfft)
+struct FftPlanCache::Snapshot {
+    std::vector<std::pair<int, std::shared_ptr<const Plan>>> plans;
+    const Plan* find(int nfft) const {
+        for (const auto& e : plans) if (e.first == nfft) return e.second.get();
+        return nullptr;
+    }
+    std::shared_ptr<const Plan> findShared(int nfft) const {
+        for (const auto& e : plans) if (e.first == nfft) return e.second;
+        return nullptr;
+    }
+};
+
+namespace {
+// Per-thread front cache: a handful of (cache id, nfft) slots holding strong
+// references to published plans, replaced round-robin. A hit touches only
+// thread-local memory and the cache's generation, which evict()/clear() bump
+// so that stale slots miss and drop their reference.
+struct PlanSlot {
+    uint64_t cacheId = 0;
+    uint64_t generation = 0;
+    int nfft = 0;
+    std::shared_ptr<const FftPlanCache::Plan> plan;
+};
+constexpr size_t kPlanSlotsPerThread = 4;
+thread_local PlanSlot t_planSlots[kPlanSlotsPerThread];
+thread_local size_t t_planSlotNext = 0;
+std::atomic<uint64_t> g_planCacheIds{1};
+} // namespace
+
+FftPlanCache::FftPlanCache()
+    : id_(g_planCacheIds.fetch_add(1, std::memory_order_relaxed)),
+      snapshot_(std::make_shared<const Snapshot>()) {}
+
+FftPlanCache::~FftPlanCache() = default;
+
+std::shared_ptr<const FftPlanCache::Snapshot> FftPlanCache::loadSnapshot() const {
+    return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+}
+
+const FftPlanCache::Plan* FftPlanCache::acquire(int nfft, const ExecutionContext& ctx) {
+    const uint64_t gen = generation_.load(std::memory_order_acquire);
+    for (auto& slot : t_planSlots) {
+        if (slot.cacheId != id_) continue;
+        if (slot.generation != gen) {
+            slot = PlanSlot{}; // evicted or cleared since it was filled
+        } else if (slot.nfft == nfft) {
+            return slot.plan.get();
+        }
+    }
+    std::shared_ptr<const Plan> plan = loadSnapshot()->findShared(nfft);
+    if (!plan) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::shared_ptr<const Snapshot> cur = loadSnapshot();
+        plan = cur->findShared(nfft);
+        if (!plan) {
+            plan = std::make_shared<const Plan>(nfft);
+            auto next = std::make_shared<Snapshot>(*cur);
+            auto pos = std::lower_bound(next->plans.begin(), next->plans.end(), nfft,
+                                        [](const auto& e, int n) { return e.first < n; });
+            next->plans.insert(pos, {nfft, plan});
+            std::atomic_store_explicit(&snapshot_, std::shared_ptr<const Snapshot>(std::move(next)), std::memory_order_release);
+            ctx.log(kTagWelch, "Created FFT plan cache entry (nfft=%d)", nfft);
+        }
+    }
+    PlanSlot& slot = t_planSlots[t_planSlotNext];
+    t_planSlotNext = (t_planSlotNext + 1) % kPlanSlotsPerThread;
+    slot.cacheId = id_;
+    slot.generation = gen;
+    slot.nfft = nfft;
+    slot.plan = std::move(plan);
+    return slot.plan.get();
+}
+
+void FftPlanCache::evict(int nfft) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::shared_ptr<const Snapshot> cur = loadSnapshot();
+    if (!cur->find(nfft)) return;
+    auto next = std::make_shared<Snapshot>();
+    for (const auto& e : cur->plans) if (e.first != nfft) next->plans.push_back(e);
+    std::atomic_store_explicit(&snapshot_, std::shared_ptr<const Snapshot>(std::move(next)), std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+void FftPlanCache::clear() {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::atomic_store_explicit(&snapshot_, std::make_shared<const Snapshot>(), std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+size_t FftPlanCache::size() const { return loadSnapshot()->plans.size(); }
+
+std::shared_ptr<FftPlanCache> makeFftPlanCache() { return std::make_shared<FftPlanCache>(); }
 
 namespace {
 
 static constexpr double PI = 3.141592653589793238462643383279502884;
 
-static std::atomic<unsigned long long> g_welchGuardFallbackCount{0};
-static std::atomic<unsigned long long> g_welchGuardFailureCount{0};
+static metrics::Counter g_welchGuardFallbackCount;
+static metrics::Counter g_welchGuardFailureCount;
+[[maybe_unused]] static const bool g_welchGuardMetricsRegistered = [] {
+    metrics::processGroup().add("heartpy_welch_guard_fallbacks_total", "Welch calls whose nfft/overlap had to be adjusted", g_welchGuardFallbackCount);
+    metrics::processGroup().add("heartpy_welch_guard_failures_total", "Welch calls rejected for unusable parameters", g_welchGuardFailureCount);
+    return true;
+}();
 
-static void logWelchGuard(const char* fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    std::fprintf(stderr, "[HeartPySNR][welchPSD] ");
+static void vlogStderr(const char* tag, const char* fmt, va_list args) {
+    std::fprintf(stderr, "[%s] ", tag);
     std::vfprintf(stderr, fmt, args);
     std::fprintf(stderr, "\n");
     std::fflush(stderr);
-    va_end(args);
 }
 
-static void logAnalyze(const char* fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
+static void vlogPlatform(const char* tag, const char* fmt, va_list args) {
 #if defined(__ANDROID__)
-    __android_log_vprint(ANDROID_LOG_DEBUG, "HeartPyAnalyze", fmt, args);
+    __android_log_vprint(ANDROID_LOG_DEBUG, tag, fmt, args);
 #elif defined(__APPLE__)
 #if TARGET_OS_IPHONE || TARGET_OS_SIMULATOR
     char buffer[512];
     vsnprintf(buffer, sizeof(buffer), fmt, args);
-    os_log_with_type(OS_LOG_DEFAULT, OS_LOG_TYPE_DEBUG, "[HeartPyAnalyze] %{public}s", buffer);
+    os_log_with_type(OS_LOG_DEFAULT, OS_LOG_TYPE_DEBUG, "[%{public}s] %{public}s", tag, buffer);
 #else
-    std::fprintf(stderr, "[HeartPyAnalyze] ");
-    std::vfprintf(stderr, fmt, args);
-    std::fprintf(stderr, "\n");
-    std::fflush(stderr);
+    vlogStderr(tag, fmt, args);
 #endif
 #else
-    std::fprintf(stderr, "[HeartPyAnalyze] ");
-    std::vfprintf(stderr, fmt, args);
-    std::fprintf(stderr, "\n");
-    std::fflush(stderr);
+    vlogStderr(tag, fmt, args);
 #endif
-    va_end(args);
 }
 
-#if defined(USE_ACCELERATE_FFT)
-class FFTSetupCache {
+// Accumulates steady-clock time since the previous mark into a stage slot;
+// a null target makes every call a single predictable branch. Audit builds
+// also attribute the thread's allocations between marks to the stage, and
+// with tracing enabled every stage is recorded as a span.
+class StageClock {
 public:
-    FFTSetupD acquire(int nfft) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = cache_.find(nfft);
-        if (it != cache_.end()) {
-            return it->second;
-        }
-        FFTSetupD setup = vDSP_create_fftsetupD(
-            static_cast<vDSP_Length>(std::log2(nfft)),
-            kFFTRadix2);
-        cache_[nfft] = setup;
-        logWelchGuard("Created FFTSetupD cache entry (nfft=%d)", nfft);
-        return setup;
-    }
-
-    ~FFTSetupCache() {
-        for (auto& entry : cache_) {
-            if (entry.second) {
-                vDSP_destroy_fftsetupD(entry.second);
-            }
-        }
+    explicit StageClock(StageTimings* t) : t_(t) {
+        if (t_) { t_->valid = true; start_ = last_ = std::chrono::steady_clock::now(); }
+        if (trace::enabled()) traceStart_ = traceLast_ = trace::nowNs();
+#if HEARTPY_ALLOC_AUDIT
+        allocStart_ = allocLast_ = alloc_audit::threadCounters();
+        if (t_) t_->allocsValid = true;
+#endif
     }
-
-private:
-    std::mutex mutex_;
-    std::unordered_map<int, FFTSetupD> cache_;
-};
-
-static FFTSetupCache& getFFTSetupCache() {
-    static FFTSetupCache cache;
-    return cache;
-}
-#elif defined(USE_KISSFFT)
-class KissFftCache {
-public:
-    kiss_fftr_cfg acquire(int nfft) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto [it, inserted] = cache_.emplace(nfft, nullptr);
-        if (inserted || it->second == nullptr) {
-            it->second = kiss_fftr_alloc(nfft, 0, nullptr, nullptr);
-            logWelchGuard("Created kiss_fftr_cfg cache entry (nfft=%d)", nfft);
+    void mark(StageTimings::Stage stage) {
+#if HEARTPY_ALLOC_AUDIT
+        attribute(stage, allocLast_);
+#endif
+        if (traceLast_) {
+            const uint64_t now = trace::nowNs();
+            trace::complete(StageTimings::name(stage), traceLast_, now);
+            traceLast_ = now;
         }
-        return it->second;
+        if (!t_) return;
+        auto now = std::chrono::steady_clock::now();
+        t_->us[stage] += std::chrono::duration<double, std::micro>(now - last_).count();
+        last_ = now;
     }
-
-    ~KissFftCache() {
-        for (auto& entry : cache_) {
-            if (entry.second) {
-                kiss_fftr_free(entry.second);
-            }
-        }
+    void finish() {
+#if HEARTPY_ALLOC_AUDIT
+        attribute(StageTimings::TOTAL, allocStart_);
+#endif
+        if (traceStart_) trace::complete("analyzeSignal", traceStart_, trace::nowNs());
+        if (!t_) return;
+        t_->us[StageTimings::TOTAL] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
     }
-
 private:
-    std::mutex mutex_;
-    std::unordered_map<int, kiss_fftr_cfg> cache_;
+#if HEARTPY_ALLOC_AUDIT
+    void attribute(StageTimings::Stage stage, const AllocCounters& since) {
+        const AllocCounters now = alloc_audit::threadCounters();
+        AllocCounters d;
+        d.allocs = now.allocs - since.allocs; d.frees = now.frees - since.frees; d.bytes = now.bytes - since.bytes;
+        alloc_audit::addStage(stage, d);
+        if (t_) { t_->allocs[stage] += d.allocs; t_->allocBytes[stage] += d.bytes; }
+        allocLast_ = now;
+    }
+    AllocCounters allocStart_, allocLast_;
+#endif
+    StageTimings* t_;
+    std::chrono::steady_clock::time_point start_{}, last_{};
+    uint64_t traceStart_ = 0, traceLast_ = 0; // 0 = not tracing
 };
 
-static KissFftCache& getKissFftCache() {
-    static KissFftCache cache;
-    return cache;
+static FftPlanCache& planCacheFor(const ExecutionContext& ctx) {
+    if (ctx.planCache) return *ctx.planCache;
+    static FftPlanCache shared;
+    return shared;
 }
-#endif
 
 // fwd decl
-static std::vector<int> quotientFilterMask(const std::vector<double>& rr, const std::vector<int>& base_mask, int iterations = 2);
+static std::vector<int> quotientFilterMask(SampleView<double> rr, const std::vector<int>& base_mask, int iterations = 2);
 
 static inline double clamp(double v, double lo, double hi) {
 	return std::max(lo, std::min(hi, v));
@@ -149,22 +289,6 @@ static inline double clamp(double v, double lo, double hi) {
 // Round to 1e-6 precision to match HeartPy float behavior in threshold comparisons
 static inline double round6(double x) { return std::round(x * 1e6) / 1e6; }
 
-// Simple moving average detrend
-std::vector<double> movingAverageDetrend(const std::vector<double>& x, int window) {
-	if (window <= 1) return x;
-	const int n = static_cast<int>(x.size());
-	std::vector<double> out(n);
-	std::vector<double> cumsum(n + 1, 0.0);
-	for (int i = 0; i < n; ++i) cumsum[i + 1] = cumsum[i] + x[i];
-	for (int i = 0; i < n; ++i) {
-		int start = std::max(0, i - window / 2);
-		int end = std::min(n, i + (window - window / 2));
-		double mean = (cumsum[end] - cumsum[start]) / std::max(1, end - start);
-		out[i] = x[i] - mean;
-	}
-	return out;
-}
-
 // Biquad IIR bandpass (RBJ cookbook)
 struct Biquad {
 	double b0{0}, b1{0}, b2{0}, a1{0}, a2{0};
@@ -199,23 +323,6 @@ Biquad designBandpass(double fs, double f0, double Q) {
 	return bi;
 }
 
-std::vector<double> bandpassFilter(const std::vector<double>& x, double fs, double lowHz, double highHz, int order) {
-	if (lowHz <= 0.0 && highHz <= 0.0) return x;
-	const int n = static_cast<int>(x.size());
-	std::vector<double> y = x;
-	// Cascade bandpass sections across center freqs between low-high
-	const int sections = std::max(1, order);
-	for (int s = 0; s < sections; ++s) {
-		double f0 = lowHz + (highHz - lowHz) * (s + 0.5) / sections;
-		double bw = (highHz - lowHz);
-		double Q = (bw > 0.0 && f0 > 0.0) ? f0 / bw : 0.707;
-		Biquad bi = designBandpass(fs, clamp(f0, 0.001, fs * 0.45), std::max(0.2, Q));
-		double z1 = 0.0, z2 = 0.0; (void)z1; (void)z2;
-		for (int i = 0; i < n; ++i) y[i] = bi.process(y[i]);
-	}
-	return y;
-}
-
 // Adaptive threshold peak detection
 std::vector<int> detectPeaks(const std::vector<double>& x, double fs, double refractoryMs, double scale) {
 	const int n = static_cast<int>(x.size());
@@ -247,15 +354,48 @@ std::vector<int> detectPeaks(const std::vector<double>& x, double fs, double ref
 	return peaks;
 }
 
-// Utility stats
-double mean(const std::vector<double>& v) {
+// Utility stats (double accumulator for either sample type)
+template <class T>
+double mean(const std::vector<T>& v) {
 	if (v.empty()) return 0.0;
 	double s = std::accumulate(v.begin(), v.end(), 0.0);
 	return s / static_cast<double>(v.size());
 }
 
+template <class T>
+double mean(SampleView<T> v) {
+	if (v.empty()) return 0.0;
+	double s = std::accumulate(v.begin(), v.end(), 0.0);
+	return s / static_cast<double>(v.size());
+}
+
+// Packed sample accessor: views with the default stride take this path so
+// their loops index a plain pointer
+template <class T>
+struct PackedSamples {
+    const T* p;
+    size_t n;
+    const T& operator[](size_t i) const { return p[i]; }
+    size_t size() const { return n; }
+};
+
+// Double view of a sample buffer for stages that only exist in double
+// (a float buffer is widened, a double one is passed through)
+inline const std::vector<double>& asDouble(const std::vector<double>& v) { return v; }
+inline std::vector<double> asDouble(const std::vector<float>& v) { return {v.begin(), v.end()}; }
+
+template <class T, class Stage>
+void applyInDouble(std::vector<T>& v, Stage stage) {
+    if constexpr (std::is_same<T, double>::value) {
+        v = stage(v);
+    } else {
+        const std::vector<double> y = stage(asDouble(v));
+        v.assign(y.begin(), y.end());
+    }
+}
+
 // HeartPy-style quotient filter: builds/updates a mask (0=accept,1=reject)
-static std::vector<int> quotientFilterMask(const std::vector<double>& rr, const std::vector<int>& base_mask, int iterations) {
+static std::vector<int> quotientFilterMask(SampleView<double> rr, const std::vector<int>& base_mask, int iterations) {
     const size_t n = rr.size();
     std::vector<int> mask;
     if (base_mask.empty()) mask.assign(n, 0); else mask = base_mask;
@@ -286,8 +426,6 @@ double sd(const std::vector<double>& v) {
 }
 
 // Welch PSD (density), Hann window, one-sided, SciPy-like normalization
-struct PSDResult { std::vector<double> freqs; std::vector<double> psd; };
-
 static inline bool isPowerOfTwo(int x) { return x > 0 && (x & (x - 1)) == 0; }
 
 static void fft_inplace(std::vector<std::complex<double>>& a) {
@@ -318,7 +456,305 @@ static void fft_inplace(std::vector<std::complex<double>>& a) {
     }
 }
 
-PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap) {
+// HeartPy-style band integration: select bins fully inside band and apply trapz with constant dx
+double integrateBand(const std::vector<double>& f, const std::vector<double>& p, double lo, double hi) {
+    if (f.size() < 2 || p.size() != f.size()) return 0.0;
+    // constant spacing assumed by our welchPSD
+    double df = f[1] - f[0];
+    std::vector<double> vals;
+    vals.reserve(p.size());
+    for (size_t i = 0; i < f.size(); ++i) if (f[i] >= lo && f[i] < hi) vals.push_back(std::abs(p[i]));
+    if (vals.size() < 2) return 0.0;
+    double area = 0.0;
+    for (size_t i = 1; i < vals.size(); ++i) area += 0.5 * (vals[i-1] + vals[i]) * df;
+    return area;
+}
+    
+// Helper: enforce refractory by keeping strongest peak in conflicts
+static std::vector<int> enforceRefractory(const std::vector<double>& x, const std::vector<int>& peaks, int refSamples) {
+    if (peaks.empty()) return peaks;
+    std::vector<int> out;
+    out.reserve(peaks.size());
+    int i = 0;
+    while (i < static_cast<int>(peaks.size())) {
+        int j = i + 1;
+        int best = peaks[i];
+        double bestVal = x[best];
+        while (j < static_cast<int>(peaks.size()) && (peaks[j] - peaks[i]) < refSamples) {
+            if (x[peaks[j]] > bestVal) { best = peaks[j]; bestVal = x[best]; }
+            ++j;
+        }
+        out.push_back(best);
+        int next = j;
+        while (next < static_cast<int>(peaks.size()) && (peaks[next] - best) < refSamples) ++next;
+        i = next;
+    }
+    return out;
+}
+
+// Natural cubic spline for 1D interpolation (no smoothing)
+struct CubicSpline {
+    std::vector<double> x, a, b, c, d; // a=y
+    bool ok{false};
+};
+
+CubicSpline buildNaturalCubic(const std::vector<double>& xs, const std::vector<double>& ys) {
+    CubicSpline sp; sp.x = xs; sp.a = ys;
+    int n = static_cast<int>(xs.size());
+    if (n < 3) { sp.ok = false; return sp; }
+    std::vector<double> h(n-1);
+    for (int i=0;i<n-1;++i) h[i] = xs[i+1]-xs[i];
+    std::vector<double> alpha(n); alpha[0]=0; alpha[n-1]=0;
+    for (int i=1;i<n-1;++i) {
+        alpha[i] = 3.0*((ys[i+1]-ys[i])/h[i] - (ys[i]-ys[i-1])/h[i-1]);
+    }
+    std::vector<double> l(n), mu(n), z(n);
+    l[0]=1; mu[0]=0; z[0]=0;
+    for (int i=1;i<n-1;++i) {
+        l[i] = 2.0*(xs[i+1]-xs[i-1]) - h[i-1]*mu[i-1];
+        mu[i] = h[i]/l[i];
+        z[i] = (alpha[i]-h[i-1]*z[i-1])/l[i];
+    }
+    l[n-1]=1; z[n-1]=0; std::vector<double> c(n), b(n-1), d(n-1);
+    c[n-1]=0;
+    for (int j=n-2;j>=0;--j) {
+        c[j] = z[j] - mu[j]*c[j+1];
+        b[j] = (ys[j+1]-ys[j])/h[j] - h[j]*(c[j+1]+2.0*c[j])/3.0;
+        d[j] = (c[j+1]-c[j])/(3.0*h[j]);
+    }
+    sp.b=b; sp.c=c; sp.d=d; sp.ok=true; return sp;
+}
+
+static std::vector<double> boxcarSmooth(const std::vector<double>& y, int win) {
+    if (win <= 1 || y.empty()) return y;
+    int n = static_cast<int>(y.size());
+    std::vector<double> out(n);
+    int hw = win / 2;
+    for (int i = 0; i < n; ++i) {
+        int a = std::max(0, i - hw);
+        int b = std::min(n - 1, i + hw);
+        double sum = 0.0; int cnt = 0;
+        for (int j = a; j <= b; ++j) { sum += y[j]; ++cnt; }
+        out[i] = sum / std::max(1, cnt);
+    }
+    return out;
+}
+
+// Apply A = I + lambda * L^T L to vector v, where L is second-difference operator
+static void applySmoothingMatrix(const std::vector<double>& v, double lambda, std::vector<double>& out) {
+    size_t n = v.size();
+    out.assign(n, 0.0);
+    if (n == 0) return;
+    // u = L^T (L v)
+    std::vector<double> u(n, 0.0);
+    if (n >= 3) {
+        for (size_t k = 0; k + 2 < n; ++k) {
+            double w = v[k] - 2.0 * v[k + 1] + v[k + 2];
+            u[k]     += w;
+            u[k + 1] += -2.0 * w;
+            u[k + 2] += w;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) out[i] = v[i] + lambda * u[i];
+}
+
+static std::vector<double> smoothRR_TargetSse(const std::vector<double>& rr, double target_sse) {
+    if (rr.size() < 3 || target_sse <= 0.0) return rr;
+    auto sse_for_lambda = [&](double lambda) {
+        auto yhat = smoothRR_CG(rr, lambda);
+        double sse = 0.0; for (size_t i = 0; i < rr.size(); ++i) { double d = yhat[i] - rr[i]; sse += d * d; }
+        return std::pair<double, std::vector<double>>(sse, std::move(yhat));
+    };
+    // bracket lambda so that sse(lambda_high) >= target
+    double lo = 0.0, hi = 1.0;
+    auto p0 = sse_for_lambda(lo);
+    if (p0.first >= target_sse) return p0.second; // already enough error (shouldn't happen)
+    std::pair<double, std::vector<double>> phi;
+    for (int k = 0; k < 40; ++k) { // expand hi exponentially
+        phi = sse_for_lambda(hi);
+        if (phi.first >= target_sse) break;
+        hi *= 2.0;
+        if (hi > 1e12) break;
+    }
+    std::vector<double> best = phi.second;
+    // bisection
+    for (int it = 0; it < 40; ++it) {
+        double mid = (lo + hi) * 0.5;
+        auto pm = sse_for_lambda(mid);
+        best = pm.second;
+        if (pm.first > target_sse) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+        if (std::fabs(pm.first - target_sse) / std::max(1.0, target_sse) < 1e-3) break;
+    }
+    return best;
+}
+
+double splineEval(const CubicSpline& sp, double xx) {
+    int n = static_cast<int>(sp.x.size());
+    if (!sp.ok || n<2) return 0.0;
+    // binary search
+    int lo=0, hi=n-1;
+    if (xx <= sp.x.front()) {
+        hi=1; lo=0;
+    } else if (xx >= sp.x.back()) {
+        lo=n-2; hi=n-1;
+    } else {
+        while (hi-lo>1) { int mid=(lo+hi)/2; if (sp.x[mid] > xx) hi=mid; else lo=mid; }
+    }
+    double dx = xx - sp.x[lo];
+    return sp.a[lo] + sp.b[lo]*dx + sp.c[lo]*dx*dx + sp.d[lo]*dx*dx*dx;
+}
+
+// HeartPy-style rolling mean (0.75s window typical); the running sum is double
+template <class T>
+std::vector<T> rollingMeanHP(const std::vector<T>& data, double fs, double windowSeconds) {
+    const int N = static_cast<int>(windowSeconds * fs);
+    const int n = static_cast<int>(data.size());
+    if (N <= 1 || n == 0 || N > n) {
+        double m = mean(data);
+        return std::vector<T>(n, static_cast<T>(m));
+    }
+    std::vector<T> rol; rol.reserve(n - N + 1);
+    double s = 0.0;
+    for (int i = 0; i < N; ++i) s += data[i];
+    rol.push_back(static_cast<T>(s / N));
+    for (int i = N; i < n; ++i) { s += data[i]; s -= data[i - N]; rol.push_back(static_cast<T>(s / N)); }
+    int n_miss = static_cast<int>(std::abs(n - static_cast<int>(rol.size())) / 2);
+    std::vector<T> out; out.reserve(n);
+    for (int i = 0; i < n_miss; ++i) out.push_back(rol.front());
+    out.insert(out.end(), rol.begin(), rol.end());
+    while (static_cast<int>(out.size()) < n) out.push_back(rol.back());
+    if (static_cast<int>(out.size()) > n) out.resize(n);
+    return out;
+}
+
+// HP detect_peaks using raised rolling mean and segment maxima. `active`
+// holds ascending candidate indices; it is narrowed to those above
+// rol_mean + lift, and the first maximum of each run of consecutive survivors
+// is a peak. Raising the lift only shrinks the set, so a threshold sweep can
+// keep narrowing the same list instead of rescanning the signal.
+template <class T>
+void detectPeaksHPRuns(const std::vector<T>& x, const std::vector<T>& rol_mean, double lift,
+                       double fs, std::vector<int>& active, std::vector<int>& peaklist) {
+    peaklist.clear();
+    size_t kept = 0;
+    int prev = -2, best_idx = 0;
+    double best_val = 0.0;
+    for (int i : active) {
+        if (!(x[i] > rol_mean[i] + lift)) continue;
+        if (i != prev + 1) {
+            if (kept) peaklist.push_back(best_idx);
+            best_idx = i; best_val = x[i];
+        } else if (x[i] > best_val) {
+            best_idx = i; best_val = x[i];
+        }
+        active[kept++] = i;
+        prev = i;
+    }
+    if (kept) peaklist.push_back(best_idx);
+    active.resize(kept);
+    if (!peaklist.empty()) {
+        if (peaklist[0] <= static_cast<int>((fs / 1000.0) * 150.0)) peaklist.erase(peaklist.begin());
+    }
+}
+
+// Population std (ddof=0) like numpy's default
+double std_pop(const std::vector<double>& v) {
+    if (v.empty()) return 0.0;
+    double m = mean(v); double acc = 0.0; for (double x : v) { double d = x - m; acc += d * d; }
+    return std::sqrt(acc / static_cast<double>(v.size()));
+}
+
+// Simplified adaptive threshold tuning to keep BPM in [bpmMin, bpmMax]
+static std::vector<int> detectPeaksAdaptive(const std::vector<double>& x, double fs, double refractoryMs,
+                                            double initScale, double bpmMin, double bpmMax) {
+    double scale = initScale;
+    const int refSamples = static_cast<int>(std::round(refractoryMs * 0.001 * fs));
+    std::vector<int> best;
+    for (int iter = 0; iter < 6; ++iter) {
+        std::vector<int> p = detectPeaks(x, fs, refractoryMs, scale);
+        p = enforceRefractory(x, p, refSamples);
+        if (p.size() >= 2) {
+            std::vector<double> ibis;
+            ibis.reserve(p.size() - 1);
+            for (size_t i = 1; i < p.size(); ++i) ibis.push_back((p[i] - p[i-1]) * 1000.0 / fs);
+            double meanIbi = mean(ibis);
+            double bpm = meanIbi > 1e-6 ? 60000.0 / meanIbi : 0.0;
+            best = p;
+            if (bpm > bpmMax) scale *= 1.25; else if (bpm < bpmMin) scale *= 0.8; else break;
+        } else {
+            scale *= 0.8;
+        }
+    }
+    if (!best.empty()) return best;
+    return enforceRefractory(x, detectPeaks(x, fs, refractoryMs, scale), refSamples);
+}
+
+} // namespace
+
+// Stage entry points (declared in heartpy_dsp.h)
+
+// Simple moving average detrend (prefix sums in double)
+template <class T>
+static std::vector<T> movingAverageDetrendT(const std::vector<T>& x, int window) {
+	if (window <= 1) return x;
+	const int n = static_cast<int>(x.size());
+	std::vector<T> out(n);
+	std::vector<double> cumsum(n + 1, 0.0);
+	for (int i = 0; i < n; ++i) cumsum[i + 1] = cumsum[i] + x[i];
+	for (int i = 0; i < n; ++i) {
+		int start = std::max(0, i - window / 2);
+		int end = std::min(n, i + (window - window / 2));
+		double mean = (cumsum[end] - cumsum[start]) / std::max(1, end - start);
+		out[i] = static_cast<T>(x[i] - mean);
+	}
+	return out;
+}
+
+std::vector<double> movingAverageDetrend(const std::vector<double>& x, int window) {
+	return movingAverageDetrendT(x, window);
+}
+
+std::vector<float> movingAverageDetrend(const std::vector<float>& x, int window) {
+	return movingAverageDetrendT(x, window);
+}
+
+// Biquad state is double; float samples are narrowed once per section
+template <class T>
+static std::vector<T> bandpassFilterT(const std::vector<T>& x, double fs, double lowHz, double highHz, int order) {
+	if (lowHz <= 0.0 && highHz <= 0.0) return x;
+	const int n = static_cast<int>(x.size());
+	std::vector<T> y = x;
+	// Cascade bandpass sections across center freqs between low-high
+	const int sections = std::max(1, order);
+	for (int s = 0; s < sections; ++s) {
+		double f0 = lowHz + (highHz - lowHz) * (s + 0.5) / sections;
+		double bw = (highHz - lowHz);
+		double Q = (bw > 0.0 && f0 > 0.0) ? f0 / bw : 0.707;
+		Biquad bi = designBandpass(fs, clamp(f0, 0.001, fs * 0.45), std::max(0.2, Q));
+		double z1 = 0.0, z2 = 0.0; (void)z1; (void)z2;
+		for (int i = 0; i < n; ++i) y[i] = static_cast<T>(bi.process(y[i]));
+	}
+	return y;
+}
+
+std::vector<double> bandpassFilter(const std::vector<double>& x, double fs, double lowHz, double highHz, int order) {
+	return bandpassFilterT(x, fs, lowHz, highHz, order);
+}
+
+std::vector<float> bandpassFilter(const std::vector<float>& x, double fs, double lowHz, double highHz, int order) {
+	return bandpassFilterT(x, fs, lowHz, highHz, order);
+}
+
+// Samples are read as T and widened per element; windowing, spectra and
+// their accumulation are double (the KissFFT input is float either way)
+template <class Samples>
+static PSDResult welchPSDT(const Samples& x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    AllocScope allocScope(AllocSite::WELCH_PSD);
+    trace::Span traceSpan("welchPSD");
     const int n = static_cast<int>(x.size());
     if (nfft <= 0) nfft = 256;
     overlap = clamp(overlap, 0.0, 0.95);
@@ -350,7 +786,7 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
                 break;
             }
             if (nextNfft != workingNfft) {
-                logWelchGuard("Signal shorter than nfft (%d < %d). Reducing nfft to %d", n, workingNfft, nextNfft);
+                ctx.log(kTagWelch, "Signal shorter than nfft (%d < %d). Reducing nfft to %d", n, workingNfft, nextNfft);
                 adjustmentOccurred = true;
                 workingNfft = nextNfft;
                 continue;
@@ -366,7 +802,7 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             if (nextNfft < kMinNfft) {
                 break;
             }
-            logWelchGuard("Insufficient signal span for nfft=%d (n=%d). Reducing to %d", workingNfft, n, nextNfft);
+            ctx.log(kTagWelch, "Insufficient signal span for nfft=%d (n=%d). Reducing to %d", workingNfft, n, nextNfft);
             adjustmentOccurred = true;
             workingNfft = nextNfft;
             continue;
@@ -404,36 +840,40 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
         if (nextNfft < kMinNfft) {
             break;
         }
-        logWelchGuard("Rounding prevented nseg>=2 for nfft=%d (n=%d). Reducing to %d", workingNfft, n, nextNfft);
+        ctx.log(kTagWelch, "Rounding prevented nseg>=2 for nfft=%d (n=%d). Reducing to %d", workingNfft, n, nextNfft);
         adjustmentOccurred = true;
         workingNfft = nextNfft;
     }
 
     if (!paramsReady) {
-        g_welchGuardFailureCount.fetch_add(1);
-        logWelchGuard("Unable to satisfy Welch params (n=%d, requested nfft=%d)", n, originalNfft);
+        g_welchGuardFailureCount.inc();
+        ctx.log(kTagWelch, "Unable to satisfy Welch params (n=%d, requested nfft=%d)", n, originalNfft);
         return {{}, {}};
     }
 
     if (adjustmentOccurred) {
-        g_welchGuardFallbackCount.fetch_add(1);
-        logWelchGuard("Adjusted Welch params: nfft %d -> %d, overlap %.3f -> %.3f, nseg=%d, n=%d", originalNfft, workingNfft, originalOverlap, workingOverlap, nseg, n);
+        g_welchGuardFallbackCount.inc();
+        ctx.log(kTagWelch, "Adjusted Welch params: nfft %d -> %d, overlap %.3f -> %.3f, nseg=%d, n=%d", originalNfft, workingNfft, originalOverlap, workingOverlap, nseg, n);
     }
 
     // Enforce a lower bound on usable nfft for PSD stability
     constexpr int kWelchMinimumUsableNfft = 64;
     if (workingNfft < kWelchMinimumUsableNfft) {
-        g_welchGuardFailureCount.fetch_add(1);
-        logWelchGuard("Rejecting Welch params: nfft=%d < %d (n=%d)", workingNfft, kWelchMinimumUsableNfft, n);
+        g_welchGuardFailureCount.inc();
+        ctx.log(kTagWelch, "Rejecting Welch params: nfft=%d < %d (n=%d)", workingNfft, kWelchMinimumUsableNfft, n);
         return {{}, {}};
     }
 
     nfft = workingNfft;
     overlap = workingOverlap;
 
-    // Hann window
-    std::vector<double> w(nfft);
-    for (int i = 0; i < nfft; ++i) w[i] = 0.5 - 0.5 * std::cos(2.0 * PI * i / (nfft - 1));
+    // Hann window (cached in the context scratch for repeated nfft)
+    std::vector<double>& w = ctx.scratch.window;
+    if (ctx.scratch.windowNfft != nfft || static_cast<int>(w.size()) != nfft) {
+        w.resize(nfft);
+        for (int i = 0; i < nfft; ++i) w[i] = 0.5 - 0.5 * std::cos(2.0 * PI * i / (nfft - 1));
+        ctx.scratch.windowNfft = nfft;
+    }
     double U = 0.0;
 #if defined(HEARTPY_ENABLE_ACCELERATE)
     // Use vDSP to compute sum of squares when enabled
@@ -446,17 +886,19 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
     std::vector<double> P(kmax, 0.0);
 
     bool useFFT = isPowerOfTwo(nfft);
-    if (heartpy::isDeterministic()) useFFT = false; // force DFT for determinism
+    if (ctx.useDft()) useFFT = false; // force DFT for determinism
     if (useFFT) {
 #ifdef USE_ACCELERATE_FFT
         // Use Accelerate vDSP double-precision split-complex FFT if available
-        FFTSetupD setup = getFFTSetupCache().acquire(nfft);
-        std::vector<double> real(nfft), imag(nfft, 0.0);
+        FFTSetupD setup = planCacheFor(ctx).acquire(nfft, ctx)->setup;
+        std::vector<double>& real = ctx.scratch.re;
+        std::vector<double>& imag = ctx.scratch.im;
+        real.resize(nfft); imag.assign(nfft, 0.0);
         DSPDoubleSplitComplex split{real.data(), imag.data()};
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // Copy segment into real buffer
-            std::memcpy(real.data(), &x[start], sizeof(double) * (size_t)nfft);
+            for (int t = 0; t < nfft; ++t) real[t] = x[start + t];
 #if defined(HEARTPY_ENABLE_ACCELERATE)
             // mu = mean(real)
             double mu = 0.0; vDSP_meanvD(real.data(), 1, &mu, (vDSP_Length)nfft);
@@ -479,18 +921,30 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             }
         }
 #elif defined(USE_KISSFFT)
-        kiss_fftr_cfg cfg = getKissFftCache().acquire(nfft);
-        std::vector<float> in(nfft);
-        std::vector<kiss_fft_cpx> out(kmax);
+        const FftPlanCache::Plan& plan = *planCacheFor(ctx).acquire(nfft, ctx);
+        std::vector<float>& in = ctx.scratch.fin;
+        in.resize(nfft);
+        ctx.scratch.fout.resize(2 * static_cast<size_t>(kmax));
+        ctx.scratch.fwork.resize(static_cast<size_t>(nfft));
+        kiss_fft_cpx* out = reinterpret_cast<kiss_fft_cpx*>(ctx.scratch.fout.data());
+        kiss_fft_cpx* work = reinterpret_cast<kiss_fft_cpx*>(ctx.scratch.fwork.data());
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // detrend (constant) and window
 #if defined(HEARTPY_ENABLE_NEON) && defined(__ARM_NEON)
+            // Packed float input loads directly; anything else is gathered
+            auto load4 = [&x](int i) -> float32x4_t {
+                if constexpr (std::is_same<Samples, PackedSamples<float>>::value) {
+                    return vld1q_f32(&x[i]);
+                } else {
+                    return float32x4_t{ (float)x[i], (float)x[i + 1], (float)x[i + 2], (float)x[i + 3] };
+                }
+            };
             // Compute mean using NEON reduction in float
             float32x4_t acc4 = vdupq_n_f32(0.0f);
             int t_mean = 0;
             for (; t_mean + 4 <= nfft; t_mean += 4) {
-                float32x4_t xv = { (float)x[start + t_mean + 0], (float)x[start + t_mean + 1], (float)x[start + t_mean + 2], (float)x[start + t_mean + 3] };
+                float32x4_t xv = load4(start + t_mean);
                 acc4 = vaddq_f32(acc4, xv);
             }
             float acc = vgetq_lane_f32(acc4, 0) + vgetq_lane_f32(acc4, 1) + vgetq_lane_f32(acc4, 2) + vgetq_lane_f32(acc4, 3);
@@ -498,7 +952,7 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             const float fmu = acc / (float)nfft;
             int t = 0;
             for (; t + 4 <= nfft; t += 4) {
-                float32x4_t xv = { (float)x[start + t + 0], (float)x[start + t + 1], (float)x[start + t + 2], (float)x[start + t + 3] };
+                float32x4_t xv = load4(start + t);
                 float32x4_t wv = { (float)w[t + 0], (float)w[t + 1], (float)w[t + 2], (float)w[t + 3] };
                 float32x4_t mu4 = vdupq_n_f32(fmu);
                 float32x4_t dv = vsubq_f32(xv, mu4);
@@ -510,7 +964,7 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             double mu = 0.0; for (int t = 0; t < nfft; ++t) mu += x[start + t]; mu /= nfft;
             for (int t = 0; t < nfft; ++t) in[t] = static_cast<float>((x[start + t] - mu) * w[t]);
 #endif
-            kiss_fftr(cfg, in.data(), out.data());
+            plan.forward(in.data(), work, out);
             for (int k = 0; k < kmax; ++k) {
                 double realv = out[k].r;
                 double imagv = out[k].i;
@@ -520,7 +974,8 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             }
         }
 #else
-        std::vector<std::complex<double>> buf(nfft);
+        std::vector<std::complex<double>>& buf = ctx.scratch.cbuf;
+        buf.resize(nfft);
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // detrend (constant)
@@ -545,129 +1000,49 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
                 for (int t = 0; t < nfft; ++t) {
                     double sample = x[start + t] * w[t];
                     double ang = -2.0 * PI * k * t / nfft;
-                    real += sample * std::cos(ang);
-                    imag += sample * std::sin(ang);
-                }
-                double Sxx = real * real + imag * imag;
-                double Pseg = Sxx / (fs * U);
-                P[k] += Pseg;
-            }
-        }
-    }
-    for (double& v : P) v /= static_cast<double>(nseg);
-    // one-sided correction (DC and Nyquist untouched)
-    if (kmax > 1) {
-        int last = (nfft % 2 == 0) ? (kmax - 1) : kmax;
-        for (int k = 1; k < last; ++k) P[k] *= 2.0;
-    }
-    std::vector<double> freqs(kmax);
-    for (int k = 0; k < kmax; ++k) freqs[k] = (fs * k) / nfft;
-    return {freqs, P};
-}
-
-// HeartPy-style band integration: select bins fully inside band and apply trapz with constant dx
-double integrateBand(const std::vector<double>& f, const std::vector<double>& p, double lo, double hi) {
-    if (f.size() < 2 || p.size() != f.size()) return 0.0;
-    // constant spacing assumed by our welchPSD
-    double df = f[1] - f[0];
-    std::vector<double> vals;
-    vals.reserve(p.size());
-    for (size_t i = 0; i < f.size(); ++i) if (f[i] >= lo && f[i] < hi) vals.push_back(std::abs(p[i]));
-    if (vals.size() < 2) return 0.0;
-    double area = 0.0;
-    for (size_t i = 1; i < vals.size(); ++i) area += 0.5 * (vals[i-1] + vals[i]) * df;
-    return area;
-}
-    
-// Helper: enforce refractory by keeping strongest peak in conflicts
-static std::vector<int> enforceRefractory(const std::vector<double>& x, const std::vector<int>& peaks, int refSamples) {
-    if (peaks.empty()) return peaks;
-    std::vector<int> out;
-    out.reserve(peaks.size());
-    int i = 0;
-    while (i < static_cast<int>(peaks.size())) {
-        int j = i + 1;
-        int best = peaks[i];
-        double bestVal = x[best];
-        while (j < static_cast<int>(peaks.size()) && (peaks[j] - peaks[i]) < refSamples) {
-            if (x[peaks[j]] > bestVal) { best = peaks[j]; bestVal = x[best]; }
-            ++j;
-        }
-        out.push_back(best);
-        int next = j;
-        while (next < static_cast<int>(peaks.size()) && (peaks[next] - best) < refSamples) ++next;
-        i = next;
-    }
-    return out;
-}
-
-// Natural cubic spline for 1D interpolation (no smoothing)
-struct CubicSpline {
-    std::vector<double> x, a, b, c, d; // a=y
-    bool ok{false};
-};
-
-CubicSpline buildNaturalCubic(const std::vector<double>& xs, const std::vector<double>& ys) {
-    CubicSpline sp; sp.x = xs; sp.a = ys;
-    int n = static_cast<int>(xs.size());
-    if (n < 3) { sp.ok = false; return sp; }
-    std::vector<double> h(n-1);
-    for (int i=0;i<n-1;++i) h[i] = xs[i+1]-xs[i];
-    std::vector<double> alpha(n); alpha[0]=0; alpha[n-1]=0;
-    for (int i=1;i<n-1;++i) {
-        alpha[i] = 3.0*((ys[i+1]-ys[i])/h[i] - (ys[i]-ys[i-1])/h[i-1]);
-    }
-    std::vector<double> l(n), mu(n), z(n);
-    l[0]=1; mu[0]=0; z[0]=0;
-    for (int i=1;i<n-1;++i) {
-        l[i] = 2.0*(xs[i+1]-xs[i-1]) - h[i-1]*mu[i-1];
-        mu[i] = h[i]/l[i];
-        z[i] = (alpha[i]-h[i-1]*z[i-1])/l[i];
+                    real += sample * std::cos(ang);
+                    imag += sample * std::sin(ang);
+                }
+                double Sxx = real * real + imag * imag;
+                double Pseg = Sxx / (fs * U);
+                P[k] += Pseg;
+            }
+        }
     }
-    l[n-1]=1; z[n-1]=0; std::vector<double> c(n), b(n-1), d(n-1);
-    c[n-1]=0;
-    for (int j=n-2;j>=0;--j) {
-        c[j] = z[j] - mu[j]*c[j+1];
-        b[j] = (ys[j+1]-ys[j])/h[j] - h[j]*(c[j+1]+2.0*c[j])/3.0;
-        d[j] = (c[j+1]-c[j])/(3.0*h[j]);
+    for (double& v : P) v /= static_cast<double>(nseg);
+    // one-sided correction (DC and Nyquist untouched)
+    if (kmax > 1) {
+        int last = (nfft % 2 == 0) ? (kmax - 1) : kmax;
+        for (int k = 1; k < last; ++k) P[k] *= 2.0;
     }
-    sp.b=b; sp.c=c; sp.d=d; sp.ok=true; return sp;
+    std::vector<double> freqs(kmax);
+    for (int k = 0; k < kmax; ++k) freqs[k] = (fs * k) / nfft;
+    return {freqs, P};
 }
 
-static std::vector<double> boxcarSmooth(const std::vector<double>& y, int win) {
-    if (win <= 1 || y.empty()) return y;
-    int n = static_cast<int>(y.size());
-    std::vector<double> out(n);
-    int hw = win / 2;
-    for (int i = 0; i < n; ++i) {
-        int a = std::max(0, i - hw);
-        int b = std::min(n - 1, i + hw);
-        double sum = 0.0; int cnt = 0;
-        for (int j = a; j <= b; ++j) { sum += y[j]; ++cnt; }
-        out[i] = sum / std::max(1, cnt);
-    }
-    return out;
+template <class T>
+static PSDResult welchPSDView(SampleView<T> x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    if (x.contiguous()) return welchPSDT(PackedSamples<T>{x.data(), x.size()}, fs, nfft, overlap, ctx);
+    return welchPSDT(x, fs, nfft, overlap, ctx);
 }
 
-// Apply A = I + lambda * L^T L to vector v, where L is second-difference operator
-static void applySmoothingMatrix(const std::vector<double>& v, double lambda, std::vector<double>& out) {
-    size_t n = v.size();
-    out.assign(n, 0.0);
-    if (n == 0) return;
-    // u = L^T (L v)
-    std::vector<double> u(n, 0.0);
-    if (n >= 3) {
-        for (size_t k = 0; k + 2 < n; ++k) {
-            double w = v[k] - 2.0 * v[k + 1] + v[k + 2];
-            u[k]     += w;
-            u[k + 1] += -2.0 * w;
-            u[k + 2] += w;
-        }
-    }
-    for (size_t i = 0; i < n; ++i) out[i] = v[i] + lambda * u[i];
+PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    return welchPSDView(SampleView<double>(x), fs, nfft, overlap, ctx);
+}
+
+PSDResult welchPSD(const std::vector<float>& x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    return welchPSDView(SampleView<float>(x), fs, nfft, overlap, ctx);
+}
+
+PSDResult welchPSD(SampleView<double> x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    return welchPSDView(x, fs, nfft, overlap, ctx);
 }
 
-static std::vector<double> smoothRR_CG(const std::vector<double>& rr, double lambda, int max_iters = 200, double tol = 1e-6) {
+PSDResult welchPSD(SampleView<float> x, double fs, int nfft, double overlap, ExecutionContext& ctx) {
+    return welchPSDView(x, fs, nfft, overlap, ctx);
+}
+
+std::vector<double> smoothRR_CG(const std::vector<double>& rr, double lambda, int max_iters, double tol) {
     size_t n = rr.size();
     if (n < 3 || lambda <= 0.0) return rr;
     std::vector<double> x = rr; // initial guess
@@ -693,176 +1068,127 @@ static std::vector<double> smoothRR_CG(const std::vector<double>& rr, double lam
     return x;
 }
 
-static std::vector<double> smoothRR_TargetSse(const std::vector<double>& rr, double target_sse) {
-    if (rr.size() < 3 || target_sse <= 0.0) return rr;
-    auto sse_for_lambda = [&](double lambda) {
-        auto yhat = smoothRR_CG(rr, lambda);
-        double sse = 0.0; for (size_t i = 0; i < rr.size(); ++i) { double d = yhat[i] - rr[i]; sse += d * d; }
-        return std::pair<double, std::vector<double>>(sse, std::move(yhat));
-    };
-    // bracket lambda so that sse(lambda_high) >= target
-    double lo = 0.0, hi = 1.0;
-    auto p0 = sse_for_lambda(lo);
-    if (p0.first >= target_sse) return p0.second; // already enough error (shouldn't happen)
-    std::pair<double, std::vector<double>> phi;
-    for (int k = 0; k < 40; ++k) { // expand hi exponentially
-        phi = sse_for_lambda(hi);
-        if (phi.first >= target_sse) break;
-        hi *= 2.0;
-        if (hi > 1e12) break;
-    }
-    std::vector<double> best = phi.second;
-    // bisection
-    for (int it = 0; it < 40; ++it) {
-        double mid = (lo + hi) * 0.5;
-        auto pm = sse_for_lambda(mid);
-        best = pm.second;
-        if (pm.first > target_sse) {
-            hi = mid;
-        } else {
-            lo = mid;
+template <class T>
+static HPFitResult fitPeaksHPT(const std::vector<T>& x, double fs, double bpmMin, double bpmMax) {
+    std::vector<T> rmean = rollingMeanHP(x, fs, 0.75);
+    int ma_list_vals[] = {5,10,15,20,25,30,40,50,60,70,80,90,100,110,120,150,200,300};
+    HPFitResult out;
+    if (x.empty()) return out;
+    const double rmeanPct = mean(rmean) / 100.0;
+    // Ascending ma gives ascending lifts unless the rolling mean is negative
+    const bool nested = rmeanPct >= 0.0;
+    double best_rrsd = std::numeric_limits<double>::infinity();
+    std::vector<int> active(x.size()), peaks;
+    std::vector<double> rr;
+    std::iota(active.begin(), active.end(), 0);
+    for (int ma : ma_list_vals) {
+        if (!nested) { active.resize(x.size()); std::iota(active.begin(), active.end(), 0); }
+        detectPeaksHPRuns(x, rmean, rmeanPct * static_cast<double>(ma), fs, active, peaks);
+        double bpm = (static_cast<double>(peaks.size()) / (static_cast<double>(x.size()) / fs)) * 60.0;
+        if (bpm < bpmMin || bpm > bpmMax) continue; // rejected regardless of RRSD
+        rr.clear();
+        for (size_t i = 1; i < peaks.size(); ++i) rr.push_back((peaks[i] - peaks[i-1]) * 1000.0 / fs);
+        double rrsd = rr.empty() ? std::numeric_limits<double>::infinity() : std_pop(rr);
+        if (rrsd > 0.1 && rrsd < best_rrsd) {
+            best_rrsd = rrsd; out.peaks = peaks; out.best_ma = ma; out.rrsd = rrsd; out.bpm = bpm; out.ok = true;
         }
-        if (std::fabs(pm.first - target_sse) / std::max(1.0, target_sse) < 1e-3) break;
     }
-    return best;
+    return out;
 }
 
-double splineEval(const CubicSpline& sp, double xx) {
-    int n = static_cast<int>(sp.x.size());
-    if (!sp.ok || n<2) return 0.0;
-    // binary search
-    int lo=0, hi=n-1;
-    if (xx <= sp.x.front()) {
-        hi=1; lo=0;
-    } else if (xx >= sp.x.back()) {
-        lo=n-2; hi=n-1;
-    } else {
-        while (hi-lo>1) { int mid=(lo+hi)/2; if (sp.x[mid] > xx) hi=mid; else lo=mid; }
-    }
-    double dx = xx - sp.x[lo];
-    return sp.a[lo] + sp.b[lo]*dx + sp.c[lo]*dx*dx + sp.d[lo]*dx*dx*dx;
+HPFitResult fitPeaksHP(const std::vector<double>& x, double fs, double bpmMin, double bpmMax) {
+    return fitPeaksHPT(x, fs, bpmMin, bpmMax);
 }
 
-// HeartPy-style rolling mean (0.75s window typical)
-std::vector<double> rollingMeanHP(const std::vector<double>& data, double fs, double windowSeconds) {
-    const int N = static_cast<int>(windowSeconds * fs);
-    const int n = static_cast<int>(data.size());
-    if (N <= 1 || n == 0 || N > n) {
-        double m = mean(data);
-        return std::vector<double>(n, m);
-    }
-    std::vector<double> rol; rol.reserve(n - N + 1);
-    double s = 0.0;
-    for (int i = 0; i < N; ++i) s += data[i];
-    rol.push_back(s / N);
-    for (int i = N; i < n; ++i) { s += data[i]; s -= data[i - N]; rol.push_back(s / N); }
-    int n_miss = static_cast<int>(std::abs(n - static_cast<int>(rol.size())) / 2);
-    std::vector<double> out; out.reserve(n);
-    for (int i = 0; i < n_miss; ++i) out.push_back(rol.front());
-    out.insert(out.end(), rol.begin(), rol.end());
-    while (static_cast<int>(out.size()) < n) out.push_back(rol.back());
-    if (static_cast<int>(out.size()) > n) out.resize(n);
-    return out;
+HPFitResult fitPeaksHP(const std::vector<float>& x, double fs, double bpmMin, double bpmMax) {
+    return fitPeaksHPT(x, fs, bpmMin, bpmMax);
 }
 
-// HP detect_peaks using raised rolling mean and segment maxima
-std::vector<int> detectPeaksHP(const std::vector<double>& x, const std::vector<double>& rol_mean, double ma_perc, double fs) {
-    const int n = static_cast<int>(x.size());
-    if (n == 0 || rol_mean.size() != x.size()) return {};
-    double mn = (mean(rol_mean) / 100.0) * ma_perc;
-    std::vector<double> thr(n);
-    for (int i = 0; i < n; ++i) thr[i] = rol_mean[i] + mn;
-    std::vector<int> maskIdx; maskIdx.reserve(n);
-    for (int i = 0; i < n; ++i) if (x[i] > thr[i]) maskIdx.push_back(i);
-    if (maskIdx.empty()) return {};
-    std::vector<int> edges; edges.push_back(0);
-    for (size_t i = 1; i < maskIdx.size(); ++i) if (maskIdx[i] - maskIdx[i-1] > 1) edges.push_back(static_cast<int>(i));
-    edges.push_back(static_cast<int>(maskIdx.size()));
-    std::vector<int> peaklist; peaklist.reserve(edges.size());
-    for (size_t e = 0; e + 1 < edges.size(); ++e) {
-        int a = edges[e], b = edges[e+1]; if (a >= b) continue;
-        int best_idx = maskIdx[a]; double best_val = x[best_idx];
-        for (int j = a + 1; j < b; ++j) { int idx = maskIdx[j]; if (x[idx] > best_val) { best_val = x[idx]; best_idx = idx; } }
-        peaklist.push_back(best_idx);
+template <class T>
+static ProvisionalHR estimateHRAutocorrT(const T* x, size_t n, double fs, double bpmMin, double bpmMax, std::vector<double>& acf) {
+    ProvisionalHR out;
+    if (!x || fs <= 0.0 || bpmMin <= 0.0 || bpmMax <= bpmMin) return out;
+    const int lagMin = std::max(2, static_cast<int>(std::floor(fs * 60.0 / bpmMax)));
+    // Two full periods at the longest lag keep the correlation meaningful
+    const int lagMax = std::min(static_cast<int>(std::ceil(fs * 60.0 / bpmMin)), static_cast<int>(n / 2));
+    if (lagMax < lagMin + 2) return out;
+    double mean = 0.0;
+    for (size_t i = 0; i < n; ++i) mean += x[i];
+    mean /= static_cast<double>(n);
+    acf.assign(static_cast<size_t>(lagMax) + 2, 0.0);
+    for (int lag = lagMin - 1; lag <= lagMax + 1; ++lag) {
+        const size_t m = n - static_cast<size_t>(lag);
+        double sxy = 0.0, sxx = 0.0, syy = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+            const double a = x[i] - mean, b = x[i + lag] - mean;
+            sxy += a * b; sxx += a * a; syy += b * b;
+        }
+        acf[lag] = (sxx > 0.0 && syy > 0.0) ? sxy / std::sqrt(sxx * syy) : 0.0;
     }
-    if (!peaklist.empty()) {
-        if (peaklist[0] <= static_cast<int>((fs / 1000.0) * 150.0)) peaklist.erase(peaklist.begin());
+    auto isPeak = [&acf](int lag) { return acf[lag] > acf[lag - 1] && acf[lag] >= acf[lag + 1]; };
+    int best = -1;
+    for (int lag = lagMin; lag <= lagMax; ++lag) {
+        if (isPeak(lag) && (best < 0 || acf[lag] > acf[best])) best = lag;
     }
-    return peaklist;
-}
-
-// Population std (ddof=0) like numpy's default
-double std_pop(const std::vector<double>& v) {
-    if (v.empty()) return 0.0;
-    double m = mean(v); double acc = 0.0; for (double x : v) { double d = x - m; acc += d * d; }
-    return std::sqrt(acc / static_cast<double>(v.size()));
-}
-
-struct HPFitResult { std::vector<int> peaks; double best_ma{0}; double rrsd{0}; double bpm{0}; bool ok{false}; };
-
-HPFitResult fitPeaksHP(const std::vector<double>& x, double fs, double bpmMin, double bpmMax) {
-    std::vector<double> rmean = rollingMeanHP(x, fs, 0.75);
-    int ma_list_vals[] = {5,10,15,20,25,30,40,50,60,70,80,90,100,110,120,150,200,300};
-    HPFitResult out;
-    double best_rrsd = std::numeric_limits<double>::infinity();
-    for (int ma : ma_list_vals) {
-        auto peaks = detectPeaksHP(x, rmean, static_cast<double>(ma), fs);
-        double bpm = (x.empty()) ? 0.0 : (static_cast<double>(peaks.size()) / (static_cast<double>(x.size()) / fs)) * 60.0;
-        std::vector<double> rr; rr.reserve(peaks.size() > 1 ? peaks.size()-1 : 0);
-        for (size_t i = 1; i < peaks.size(); ++i) rr.push_back((peaks[i] - peaks[i-1]) * 1000.0 / fs);
-        double rrsd = rr.empty() ? std::numeric_limits<double>::infinity() : std_pop(rr);
-        if (rrsd > 0.1 && bpm >= bpmMin && bpm <= bpmMax) {
-            if (rrsd < best_rrsd) { best_rrsd = rrsd; out.peaks = peaks; out.best_ma = ma; out.rrsd = rrsd; out.bpm = bpm; out.ok = true; }
+    if (best < 0 || acf[best] <= 0.0) return out;
+    // The ACF repeats at every multiple of the period, so the tallest peak can
+    // be a sub-harmonic (half the HR): take the shortest nearly-as-tall peak
+    // whose own double is also correlated (rules out dicrotic-notch lags).
+    int pick = best;
+    for (int lag = lagMin; lag < best; ++lag) {
+        if (!isPeak(lag) || acf[lag] < 0.85 * acf[best]) continue;
+        const int twice = 2 * lag;
+        bool consistent = true;
+        if (twice + 1 <= lagMax + 1) {
+            consistent = std::max({acf[twice - 1], acf[twice], acf[twice + 1]}) >= 0.5 * acf[lag];
         }
+        if (consistent) { pick = lag; break; }
     }
+    const double y0 = acf[pick - 1], y1 = acf[pick], y2 = acf[pick + 1];
+    const double den = y0 - 2.0 * y1 + y2;
+    const double delta = (den < 0.0) ? std::clamp(0.5 * (y0 - y2) / den, -0.5, 0.5) : 0.0;
+    out.lagSamples = pick + delta;
+    out.bpm = 60.0 * fs / out.lagSamples;
+    out.confidence = std::clamp(y1, 0.0, 1.0);
+    out.ok = out.bpm >= bpmMin && out.bpm <= bpmMax;
     return out;
 }
 
-// Simplified adaptive threshold tuning to keep BPM in [bpmMin, bpmMax]
-static std::vector<int> detectPeaksAdaptive(const std::vector<double>& x, double fs, double refractoryMs,
-                                            double initScale, double bpmMin, double bpmMax) {
-    double scale = initScale;
-    const int refSamples = static_cast<int>(std::round(refractoryMs * 0.001 * fs));
-    std::vector<int> best;
-    for (int iter = 0; iter < 6; ++iter) {
-        std::vector<int> p = detectPeaks(x, fs, refractoryMs, scale);
-        p = enforceRefractory(x, p, refSamples);
-        if (p.size() >= 2) {
-            std::vector<double> ibis;
-            ibis.reserve(p.size() - 1);
-            for (size_t i = 1; i < p.size(); ++i) ibis.push_back((p[i] - p[i-1]) * 1000.0 / fs);
-            double meanIbi = mean(ibis);
-            double bpm = meanIbi > 1e-6 ? 60000.0 / meanIbi : 0.0;
-            best = p;
-            if (bpm > bpmMax) scale *= 1.25; else if (bpm < bpmMin) scale *= 0.8; else break;
-        } else {
-            scale *= 0.8;
-        }
-    }
-    if (!best.empty()) return best;
-    return enforceRefractory(x, detectPeaks(x, fs, refractoryMs, scale), refSamples);
+ProvisionalHR estimateHRAutocorr(const double* x, size_t n, double fs, double bpmMin, double bpmMax, std::vector<double>& acf) {
+    return estimateHRAutocorrT(x, n, fs, bpmMin, bpmMax, acf);
 }
 
-} // namespace
+ProvisionalHR estimateHRAutocorr(const float* x, size_t n, double fs, double bpmMin, double bpmMax, std::vector<double>& acf) {
+    return estimateHRAutocorrT(x, n, fs, bpmMin, bpmMax, acf);
+}
 
 // Public preprocessing functions (match header declarations) in heartpy namespace
-std::vector<double> scaleData(const std::vector<double>& signal, double newMin, double newMax) {
+template <class T>
+static std::vector<T> scaleDataT(const std::vector<T>& signal, double newMin, double newMax) {
     if (signal.empty()) return signal;
     auto minmax = std::minmax_element(signal.begin(), signal.end());
     double oldMin = *minmax.first;
     double oldMax = *minmax.second;
     double oldRange = oldMax - oldMin;
     if (oldRange < 1e-12) return signal;
-    std::vector<double> scaled;
+    std::vector<T> scaled;
     scaled.reserve(signal.size());
     double newRange = newMax - newMin;
     for (double val : signal) {
         double normalized = (val - oldMin) / oldRange;
-        scaled.push_back(newMin + normalized * newRange);
+        scaled.push_back(static_cast<T>(newMin + normalized * newRange));
     }
     return scaled;
 }
 
+std::vector<double> scaleData(const std::vector<double>& signal, double newMin, double newMax) {
+    return scaleDataT(signal, newMin, newMax);
+}
+
+std::vector<float> scaleData(const std::vector<float>& signal, double newMin, double newMax) {
+    return scaleDataT(signal, newMin, newMax);
+}
+
 std::vector<double> interpolateClipping(const std::vector<double>& signal, double /*fs*/, double threshold) {
     std::vector<double> result = signal;
     std::vector<bool> clipped(signal.size(), false);
@@ -946,29 +1272,41 @@ std::string vectorToString(const std::vector<T>& vec) {
     return oss.str();
 }
 
-HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt) {
+static double breathingRateWelch(const std::vector<double>& rrIntervals, ExecutionContext& ctx);
+static QualityInfo assessPeakQuality(const std::vector<int>& peaks, double fs);
+
+// Signal-length stages run on T (double or float). Sums, RR and spectral
+// statistics are double in both; the optional preprocessing filters exist
+// only in double and widen a float window while they run.
+template <class T>
+static HeartMetrics analyzeSignalT(SampleView<T> signal, double fs, const Options& opt, ExecutionContext& ctx) {
+	AllocScope allocScope(AllocSite::ANALYZE_SIGNAL);
 
 	if (signal.empty()) throw std::invalid_argument("signal is empty");
 	if (fs <= 0.0) throw std::invalid_argument("fs must be > 0");
 
 	HeartMetrics m;
-	std::vector<double> processed = signal;
+	StageClock clock(opt.profileStages ? &m.timings : nullptr);
+	// The one working copy; views of any stride land here directly
+	std::vector<T> processed;
+	if (signal.contiguous()) processed.assign(signal.data(), signal.data() + signal.size());
+	else processed.assign(signal.begin(), signal.end());
 
 	// Preprocessing pipeline
 	if (opt.interpClipping) {
-		processed = interpolateClipping(processed, fs, opt.clippingThreshold);
+		applyInDouble(processed, [&](const std::vector<double>& v) { return interpolateClipping(v, fs, opt.clippingThreshold); });
 	}
 	
 	if (opt.hampelCorrect) {
-		processed = hampelFilter(processed, opt.hampelWindow, opt.hampelThreshold);
+		applyInDouble(processed, [&](const std::vector<double>& v) { return hampelFilter(v, opt.hampelWindow, opt.hampelThreshold); });
 	}
 	
 	if (opt.removeBaselineWander) {
-		processed = removeBaselineWander(processed, fs);
+		applyInDouble(processed, [&](const std::vector<double>& v) { return removeBaselineWander(v, fs); });
 	}
 	
 	if (opt.enhancePeaks) {
-		processed = enhancePeaks(processed, fs);
+		applyInDouble(processed, [&](const std::vector<double>& v) { return enhancePeaks(v, fs); });
 	}
 
 	// Ensure positive baseline
@@ -976,35 +1314,46 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 	if (*minMax.first < 0) {
 		double offset = std::abs(*minMax.first);
 		std::transform(processed.begin(), processed.end(), processed.begin(),
-					  [offset](double val) { return val + offset; });
+					  [offset](T val) { return static_cast<T>(val + offset); });
 	}
 
-	logAnalyze("analyzeSignal: filtered signal size=%zu (fs=%.3f)", processed.size(), fs);
+	ctx.log(kTagAnalyze, "analyzeSignal: filtered signal size=%zu (fs=%.3f)", processed.size(), fs);
 
+	clock.mark(StageTimings::PREPROCESS);
+	// The detrended/bandpassed copy is kept for the spectral outputs; the quality
+	// check below reads peaks alone, so profiles without them skip it
+	const bool spectral = opt.wants(Options::OUTPUT_FREQ_DOMAIN | Options::OUTPUT_BREATHING);
 	// 1) Detrend for later spectral analysis
-	int detrendWin = std::max(5, static_cast<int>(std::round(0.75 * fs)));
-	std::vector<double> x = movingAverageDetrend(processed, detrendWin);
+	std::vector<T> x;
+	if (spectral) {
+		int detrendWin = std::max(5, static_cast<int>(std::round(0.75 * fs)));
+		x = movingAverageDetrend(processed, detrendWin);
+	}
 
+	clock.mark(StageTimings::DETREND);
 	// 2) Bandpass (used primarily for spectral analysis); peak detection will use processed
 	// Modes: AUTO (legacy), RBJ biquad, or BUTTER_FILTFILT (zero‑phase via forward+reverse one‑pole cascades)
-	{
-		auto onePoleLP = [&](const std::vector<double>& s, double fc){
+	if (spectral) {
+		// Filter state is carried in double so float outputs do not feed back
+		auto onePoleLP = [&](const std::vector<T>& s, double fc){
 			double rc = 1.0 / (2.0 * PI * fc);
 			double dt = 1.0 / fs;
 			double alpha = dt / (rc + dt);
-			std::vector<double> y(s.size()); if (s.empty()) return y; y[0] = s[0];
-			for (size_t i = 1; i < s.size(); ++i) y[i] = y[i-1] + alpha * (s[i] - y[i-1]);
+			std::vector<T> y(s.size()); if (s.empty()) return y; y[0] = s[0];
+			double prev = s[0];
+			for (size_t i = 1; i < s.size(); ++i) { prev = prev + alpha * (s[i] - prev); y[i] = static_cast<T>(prev); }
 			return y;
 		};
-		auto onePoleHP = [&](const std::vector<double>& s, double fc){
+		auto onePoleHP = [&](const std::vector<T>& s, double fc){
 			double rc = 1.0 / (2.0 * PI * fc);
 			double dt = 1.0 / fs;
 			double alpha = rc / (rc + dt);
-			std::vector<double> y(s.size()); if (s.empty()) return y; y[0] = s[0];
-			for (size_t i = 1; i < s.size(); ++i) y[i] = alpha * (y[i-1] + s[i] - s[i-1]);
+			std::vector<T> y(s.size()); if (s.empty()) return y; y[0] = s[0];
+			double prev = s[0];
+			for (size_t i = 1; i < s.size(); ++i) { prev = alpha * (prev + s[i] - s[i-1]); y[i] = static_cast<T>(prev); }
 			return y;
 		};
-		auto do_filtfilt = [&](std::vector<double> in, double lo, double hi, int order){
+		auto do_filtfilt = [&](std::vector<T> in, double lo, double hi, int order){
 			order = std::max(1, order);
 			for (int i = 0; i < order; ++i) in = onePoleHP(in, lo);
 			for (int i = 0; i < order; ++i) in = onePoleLP(in, hi);
@@ -1031,31 +1380,33 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 		}
 	}
 
+	clock.mark(StageTimings::FILTER);
 	// 3) Peak detection: HeartPy-style fit_peaks on scaled processed signal
-	std::vector<double> procForPeaks = scaleData(processed, 0.0, 1024.0);
+	std::vector<T> procForPeaks = scaleData(processed, 0.0, 1024.0);
 	// Use scaled signal directly for HeartPy-style detection (HP uses rolling mean threshold)
 	HPFitResult hpfit = fitPeaksHP(procForPeaks, fs, opt.bpmMin, opt.bpmMax);
     std::vector<int> peaks = hpfit.ok ? hpfit.peaks
-                                        : detectPeaksAdaptive(procForPeaks, fs, opt.refractoryMs, opt.thresholdScale, opt.bpmMin, opt.bpmMax);
+                                        : detectPeaksAdaptive(asDouble(procForPeaks), fs, opt.refractoryMs, opt.thresholdScale, opt.bpmMin, opt.bpmMax);
     // Optional high-precision refinement by local interpolation on scaled signal
     if (opt.highPrecision && opt.highPrecisionFs > fs && !peaks.empty()) {
-        peaks = interpolatePeaks(procForPeaks, peaks, fs, opt.highPrecisionFs);
+        peaks = interpolatePeaks(asDouble(procForPeaks), peaks, fs, opt.highPrecisionFs);
     }
     m.peakList = peaks;
-    m.peakListRaw = peaks; // capture raw peaks before cleaning
-    // After peak detection (detectPeaksHP_local)
-    logAnalyze("analyzeSignal: raw peaks detected=%zu (hpfit_ok=%d)", m.peakListRaw.size(), hpfit.ok ? 1 : 0);
-    logAnalyze("analyzeSignal: raw peaks content: %s", vectorToString(m.peakListRaw).c_str());
+    if (opt.wants(Options::OUTPUT_PEAKS_RAW)) m.peakListRaw = peaks; // capture raw peaks before cleaning
+    // After peak detection (detectPeaksHP_local); log strings are built only when logging
+    ctx.log(kTagAnalyze, "analyzeSignal: raw peaks detected=%zu (hpfit_ok=%d)", peaks.size(), hpfit.ok ? 1 : 0);
+    if (ctx.logEnabled) ctx.log(kTagAnalyze, "analyzeSignal: raw peaks content: %s", vectorToString(peaks).c_str());
 
 	// Quality assessment
-	m.quality = assessSignalQuality(x, peaks, fs);
+	m.quality = assessPeakQuality(peaks, fs);
 
+    clock.mark(StageTimings::PEAK_FIT);
     // 4) HeartPy-style check_peaks: remove RR outliers based on mean ± max(30%, 300ms)
 	    if (peaks.size() >= 2) {
         std::vector<double> rr_raw;
         rr_raw.reserve(peaks.size() - 1);
         for (size_t i = 1; i < peaks.size(); ++i) rr_raw.push_back((peaks[i] - peaks[i - 1]) * 1000.0 / fs);
-        logAnalyze("analyzeSignal: rr intervals raw (ms): %s", vectorToString(rr_raw).c_str());
+        if (ctx.logEnabled) ctx.log(kTagAnalyze, "analyzeSignal: rr intervals raw (ms): %s", vectorToString(rr_raw).c_str());
         double mean_rr = mean(rr_raw);
         double rrPercent = clamp(opt.rrOutlierPercent, 0.0, 1.0);
         double percentDelta = mean_rr * rrPercent;
@@ -1064,7 +1415,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
         double rrDelta = clamp(percentDelta, deltaMin > 0.0 ? deltaMin : percentDelta, deltaMax);
         double lower = mean_rr - rrDelta;
         double upper = mean_rr + rrDelta;
-        logAnalyze("analyzeSignal: rr bounds lower=%.3f upper=%.3f mean=%.3f delta=%.3f (percent=%.2f%%)",
+        ctx.log(kTagAnalyze, "analyzeSignal: rr bounds lower=%.3f upper=%.3f mean=%.3f delta=%.3f (percent=%.2f%%)",
                    lower, upper, mean_rr, rrDelta, rrPercent * 100.0);
         // indices to remove in peaklist are rr indices + 1
         std::vector<char> keep_peak(peaks.size(), 1);
@@ -1073,9 +1424,9 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                 size_t idx = i + 1; if (idx < keep_peak.size()) keep_peak[idx] = 0;
             }
         }
-        size_t keepCount = 0;
-        size_t rejectCount = 0;
-        {
+        if (ctx.logEnabled) {
+            size_t keepCount = 0;
+            size_t rejectCount = 0;
             std::vector<int> keepMask;
             keepMask.reserve(keep_peak.size());
             for (char v : keep_peak) {
@@ -1086,10 +1437,9 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                 }
                 keepMask.push_back(static_cast<int>(v));
             }
-            logAnalyze("analyzeSignal: keep mask after rr filter: %s", vectorToString(keepMask).c_str());
-        }
-        logAnalyze("analyzeSignal: rr filter keep_count=%zu reject_count=%zu", keepCount, rejectCount);
-        {
+            ctx.log(kTagAnalyze, "analyzeSignal: keep mask after rr filter: %s", vectorToString(keepMask).c_str());
+            ctx.log(kTagAnalyze, "analyzeSignal: rr filter keep_count=%zu reject_count=%zu", keepCount, rejectCount);
+
             std::vector<std::string> decisions;
             decisions.reserve(peaks.size());
             for (size_t i = 0; i < peaks.size(); ++i) {
@@ -1097,15 +1447,14 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                 oss << peaks[i] << (keep_peak[i] ? "@keep" : "@drop");
                 decisions.push_back(oss.str());
             }
-            logAnalyze("analyzeSignal: rr filter decisions: %s", vectorToString(decisions).c_str());
-        }
-        {
+            ctx.log(kTagAnalyze, "analyzeSignal: rr filter decisions: %s", vectorToString(decisions).c_str());
+
             std::vector<int> peakDiffSamples;
             peakDiffSamples.reserve(peaks.size() > 1 ? peaks.size() - 1 : 0);
             for (size_t i = 1; i < peaks.size(); ++i) {
                 peakDiffSamples.push_back(peaks[i] - peaks[i - 1]);
             }
-            logAnalyze("analyzeSignal: peak sample deltas: %s", vectorToString(peakDiffSamples).c_str());
+            ctx.log(kTagAnalyze, "analyzeSignal: peak sample deltas: %s", vectorToString(peakDiffSamples).c_str());
         }
         // Segmentwise rejection (HeartPy check_binary_quality): non-overlapping windows of N beats
         if (opt.rejectSegmentwise) {
@@ -1132,11 +1481,12 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
         }
         std::vector<int> peaks_cor; peaks_cor.reserve(peaks.size());
         std::vector<size_t> acceptedRawIndices; acceptedRawIndices.reserve(peaks.size());
-        m.binaryPeakMask.clear(); m.binaryPeakMask.reserve(keep_peak.size());
+        const bool wantMask = opt.wants(Options::OUTPUT_PEAKS_RAW);
+        m.binaryPeakMask.clear(); if (wantMask) m.binaryPeakMask.reserve(keep_peak.size());
         m.quality.rejectedIndices.clear();
         for (size_t i = 0; i < peaks.size(); ++i) {
             int accept = keep_peak[i] ? 1 : 0;
-            m.binaryPeakMask.push_back(accept);
+            if (wantMask) m.binaryPeakMask.push_back(accept);
             if (accept) {
                 peaks_cor.push_back(peaks[i]);
                 acceptedRawIndices.push_back(i);
@@ -1167,7 +1517,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                         spacingRejectedRawIndices.push_back(static_cast<int>(rawIdx));
                         spacingRejectedDeltaMs.push_back(deltaMs);
                         keep_peak[rawIdx] = 0;
-                        m.binaryPeakMask[rawIdx] = 0;
+                        if (wantMask) m.binaryPeakMask[rawIdx] = 0;
                         m.quality.rejectedIndices.push_back(static_cast<int>(rawIdx));
                         continue;
                     }
@@ -1176,20 +1526,22 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                     lastSample = sample;
                 }
                 if (!spacingRejectedRawIndices.empty()) {
-                    logAnalyze("analyzeSignal: spacing filter min_ms=%.3f removed=%zu", spacingMs, spacingRejectedRawIndices.size());
-                    logAnalyze("analyzeSignal: spacing rejected raw indices: %s", vectorToString(spacingRejectedRawIndices).c_str());
-                    logAnalyze("analyzeSignal: spacing rejected delta (ms): %s", vectorToString(spacingRejectedDeltaMs).c_str());
+                    ctx.log(kTagAnalyze, "analyzeSignal: spacing filter min_ms=%.3f removed=%zu", spacingMs, spacingRejectedRawIndices.size());
                     peaks_cor = std::move(filteredPeaks);
                     acceptedRawIndices = std::move(filteredRawIndices);
-                    std::vector<int> keepMaskUpdated;
-                    keepMaskUpdated.reserve(keep_peak.size());
-                    for (char v : keep_peak) keepMaskUpdated.push_back(static_cast<int>(v));
-                    logAnalyze("analyzeSignal: keep mask after spacing: %s", vectorToString(keepMaskUpdated).c_str());
+                    if (ctx.logEnabled) {
+                        ctx.log(kTagAnalyze, "analyzeSignal: spacing rejected raw indices: %s", vectorToString(spacingRejectedRawIndices).c_str());
+                        ctx.log(kTagAnalyze, "analyzeSignal: spacing rejected delta (ms): %s", vectorToString(spacingRejectedDeltaMs).c_str());
+                        std::vector<int> keepMaskUpdated;
+                        keepMaskUpdated.reserve(keep_peak.size());
+                        for (char v : keep_peak) keepMaskUpdated.push_back(static_cast<int>(v));
+                        ctx.log(kTagAnalyze, "analyzeSignal: keep mask after spacing: %s", vectorToString(keepMaskUpdated).c_str());
+                    }
                 }
             }
         }
 
-        if (peaks_cor.size() > 1) {
+        if (ctx.logEnabled && peaks_cor.size() > 1) {
             std::vector<int> peakDiffSamplesCor;
             peakDiffSamplesCor.reserve(peaks_cor.size() - 1);
             std::vector<double> peakDiffMsCor;
@@ -1199,8 +1551,8 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                 peakDiffSamplesCor.push_back(sampleDelta);
                 peakDiffMsCor.push_back(sampleDelta * 1000.0 / fs);
             }
-            logAnalyze("analyzeSignal: corrected peak sample deltas: %s", vectorToString(peakDiffSamplesCor).c_str());
-            logAnalyze("analyzeSignal: corrected peak delta (ms): %s", vectorToString(peakDiffMsCor).c_str());
+            ctx.log(kTagAnalyze, "analyzeSignal: corrected peak sample deltas: %s", vectorToString(peakDiffSamplesCor).c_str());
+            ctx.log(kTagAnalyze, "analyzeSignal: corrected peak delta (ms): %s", vectorToString(peakDiffMsCor).c_str());
         }
         // recompute RR list corrected
         m.ibiMs.clear();
@@ -1211,12 +1563,12 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
             m.quality.rejectedIndices.erase(std::unique(m.quality.rejectedIndices.begin(), m.quality.rejectedIndices.end()), m.quality.rejectedIndices.end());
         }
     }
-	logAnalyze("analyzeSignal: consolidated peaks=%zu (raw=%zu)", m.peakList.size(), m.peakListRaw.size());
-	logAnalyze("analyzeSignal: consolidated peaks content: %s", vectorToString(m.peakList).c_str());
+	ctx.log(kTagAnalyze, "analyzeSignal: consolidated peaks=%zu (raw=%zu)", m.peakList.size(), m.peakListRaw.size());
+	if (ctx.logEnabled) ctx.log(kTagAnalyze, "analyzeSignal: consolidated peaks content: %s", vectorToString(m.peakList).c_str());
 
 	m.rrList = m.ibiMs; // Initially same
-	logAnalyze("analyzeSignal: rrList input peaks=%zu", m.peakList.size());
-	logAnalyze("analyzeSignal: rr intervals (initial): %s", vectorToString(m.rrList).c_str());
+	ctx.log(kTagAnalyze, "analyzeSignal: rrList input peaks=%zu", m.peakList.size());
+	if (ctx.logEnabled) ctx.log(kTagAnalyze, "analyzeSignal: rr intervals (initial): %s", vectorToString(m.rrList).c_str());
 
 	// Apply HeartPy threshold_rr masking before optional cleaning (parity with HP)
 	if (opt.thresholdRR && !m.rrList.empty()) {
@@ -1232,7 +1584,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 		}
 		if (!rr_cor.empty()) {
 			m.rrList.swap(rr_cor);
-			logAnalyze("analyzeSignal: threshold_rr masked rrList size=%zu", m.rrList.size());
+			ctx.log(kTagAnalyze, "analyzeSignal: threshold_rr masked rrList size=%zu", m.rrList.size());
 		}
 	}
 
@@ -1252,19 +1604,20 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 				break;
 		}
 	}
-	logAnalyze("analyzeSignal: rrList size=%zu", m.rrList.size());
-	logAnalyze("analyzeSignal: rrList content: %s", vectorToString(m.rrList).c_str());
+	clock.mark(StageTimings::RR_CLEAN);
+	ctx.log(kTagAnalyze, "analyzeSignal: rrList size=%zu", m.rrList.size());
+	if (ctx.logEnabled) ctx.log(kTagAnalyze, "analyzeSignal: rrList content: %s", vectorToString(m.rrList).c_str());
 
 	if (!m.rrList.empty()) {
 		double meanIbi = mean(m.rrList);
 		m.bpm = 60000.0 / meanIbi;
-		logAnalyze("analyzeSignal: calculated BPM=%.2f (rrCount=%zu)", m.bpm, m.rrList.size());
+		ctx.log(kTagAnalyze, "analyzeSignal: calculated BPM=%.2f (rrCount=%zu)", m.bpm, m.rrList.size());
 	} else {
-		logAnalyze("analyzeSignal: unable to compute BPM (rrCount=0, peaks=%zu)", m.peakList.size());
+		ctx.log(kTagAnalyze, "analyzeSignal: unable to compute BPM (rrCount=0, peaks=%zu)", m.peakList.size());
 	}
 
 	// 5) Enhanced Time-domain metrics
-	if (!m.rrList.empty()) {
+	if (opt.wants(Options::OUTPUT_TIME_DOMAIN) && !m.rrList.empty()) {
 		m.sdnn = std_pop(m.rrList);
 		m.mad = calculateMAD(m.rrList);
 		
@@ -1311,16 +1664,18 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 			m.sd1sd2Ratio = (m.sd2 > 1e-12) ? m.sd1 / m.sd2 : 0.0;
 			m.ellipseArea = PI * m.sd1 * m.sd2;
 		}
-		
-		// Breathing analysis (Hz by default; convert if requested)
-		if (m.rrList.size() >= 10) {
-			double br_hz = calculateBreathingRate(m.rrList);
-			m.breathingRate = opt.breathingAsBpm ? (br_hz * 60.0) : br_hz;
-		}
+	}
+	clock.mark(StageTimings::TIME_DOMAIN);
+
+	// Breathing analysis (Hz by default; convert if requested)
+	if (opt.wants(Options::OUTPUT_BREATHING) && m.rrList.size() >= 10) {
+		double br_hz = breathingRateWelch(m.rrList, ctx);
+		m.breathingRate = opt.breathingAsBpm ? (br_hz * 60.0) : br_hz;
+		clock.mark(StageTimings::WELCH);
 	}
 
 	// RR-based Welch per HeartPy/SciPy (guarded by calcFreq)
-	if (opt.calcFreq && m.ibiMs.size() >= 2) {
+	if (opt.calcFreq && opt.wants(Options::OUTPUT_FREQ_DOMAIN) && m.ibiMs.size() >= 2) {
 		// RR_list_cor equivalent
 		const std::vector<double>& rr = m.ibiMs;
 		// cumulative time in ms
@@ -1363,7 +1718,8 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 			int nperseg = opt.nfft > 0 ? opt.nfft : static_cast<int>(std::round(opt.welchWsizeSec * fs_new));
 			if (nperseg <= 0) nperseg = 256;
 			if (nperseg > static_cast<int>(rr_interp.size())) nperseg = static_cast<int>(rr_interp.size());
-			PSDResult psd = welchPSD(rr_interp, fs_new, nperseg, 0.5);
+			clock.mark(StageTimings::SPLINE);
+			PSDResult psd = welchPSD(rr_interp, fs_new, nperseg, 0.5, ctx);
             if (!psd.freqs.empty()) {
                 m.vlf = integrateBand(psd.freqs, psd.psd, 0.0033, 0.04);
                 m.lf  = integrateBand(psd.freqs, psd.psd, 0.04,   0.15);
@@ -1373,7 +1729,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
                 double sumLFHF = m.lf + m.hf; if (sumLFHF > 1e-12){ m.lfNorm = (m.lf/sumLFHF)*100.0; m.hfNorm = (m.hf/sumLFHF)*100.0; }
                 // breathing rate: peak frequency in 0.1–0.4 Hz band (Hz) per HeartPy
                 double fpeak=0.0, vmax=-1.0; for (size_t i=0;i<psd.freqs.size();++i){ double f=psd.freqs[i]; if (f>=0.10 && f<=0.40 && psd.psd[i]>vmax){ vmax=psd.psd[i]; fpeak=f; } }
-                m.breathingRate = opt.breathingAsBpm ? (fpeak * 60.0) : fpeak;
+                if (opt.wants(Options::OUTPUT_BREATHING)) m.breathingRate = opt.breathingAsBpm ? (fpeak * 60.0) : fpeak;
             } else {
                 m.vlf = std::numeric_limits<double>::quiet_NaN();
                 m.lf = std::numeric_limits<double>::quiet_NaN();
@@ -1388,9 +1744,46 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 		m.lfhf = std::numeric_limits<double>::quiet_NaN();
 	}
 
+	clock.mark(StageTimings::WELCH);
+	// Peaks and RR are needed for BPM; drop them from the result when unselected
+	if (!opt.wants(Options::OUTPUT_PEAKS)) m.peakList.clear();
+	if (!opt.wants(Options::OUTPUT_RR)) { m.ibiMs.clear(); m.rrList.clear(); }
+	clock.finish();
 	return m;
 }
 
+HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt) {
+    return analyzeSignal(signal, fs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt, ExecutionContext& ctx) {
+    return analyzeSignalT(SampleView<double>(signal), fs, opt, ctx);
+}
+
+HeartMetrics analyzeSignal(const std::vector<float>& signal, double fs, const Options& opt) {
+    return analyzeSignal(signal, fs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeSignal(const std::vector<float>& signal, double fs, const Options& opt, ExecutionContext& ctx) {
+    return analyzeSignalT(SampleView<float>(signal), fs, opt, ctx);
+}
+
+HeartMetrics analyzeSignal(SampleView<double> signal, double fs, const Options& opt) {
+    return analyzeSignalT(signal, fs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeSignal(SampleView<double> signal, double fs, const Options& opt, ExecutionContext& ctx) {
+    return analyzeSignalT(signal, fs, opt, ctx);
+}
+
+HeartMetrics analyzeSignal(SampleView<float> signal, double fs, const Options& opt) {
+    return analyzeSignalT(signal, fs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeSignal(SampleView<float> signal, double fs, const Options& opt, ExecutionContext& ctx) {
+    return analyzeSignalT(signal, fs, opt, ctx);
+}
+
 // Outlier detection functions
 std::vector<double> removeOutliersIQR(const std::vector<double>& data, double& lowerBound, double& upperBound) {
     if (data.size() < 4) return data;
@@ -1462,7 +1855,12 @@ std::vector<double> removeOutliersQuotientFilter(const std::vector<double>& rrIn
 }
 
 // Quality assessment
-QualityInfo assessSignalQuality(const std::vector<double>& signal, const std::vector<int>& peaks, double fs) {
+QualityInfo assessSignalQuality(const std::vector<double>& /*signal*/, const std::vector<int>& peaks, double fs) {
+    return assessPeakQuality(peaks, fs);
+}
+
+// RR plausibility of the detected peaks (the signal itself is not read)
+static QualityInfo assessPeakQuality(const std::vector<int>& peaks, double fs) {
     QualityInfo quality;
     quality.totalBeats = peaks.size();
     
@@ -1503,7 +1901,11 @@ bool checkSegmentQuality(const std::vector<int>& rejectedBeats, int totalBeats,
 }
 
 // Breathing analysis
-double calculateBreathingRate(const std::vector<double>& rrIntervals, const std::string& method) {
+double calculateBreathingRate(const std::vector<double>& rrIntervals, const std::string& /*method*/) {
+    return breathingRateWelch(rrIntervals, defaultExecutionContext());
+}
+
+static double breathingRateWelch(const std::vector<double>& rrIntervals, ExecutionContext& ctx) {
     if (rrIntervals.size() < 10) return 0.0;
     // Build time series from RR intervals (ms) -> seconds
     std::vector<double> t; t.reserve(rrIntervals.size());
@@ -1534,7 +1936,7 @@ double calculateBreathingRate(const std::vector<double>& rrIntervals, const std:
     // Detrend
     reg = movingAverageDetrend(reg, static_cast<int>(std::round(2.0 * fs)));
     // Welch PSD
-    PSDResult psd = welchPSD(reg, fs, 256, 0.5);
+    PSDResult psd = welchPSD(reg, fs, 256, 0.5, ctx);
     if (psd.freqs.empty()) return 0.0;
     // Find peak in 0.10-0.40 Hz (HeartPy default breathing band)
     double fpeak = 0.0, pmax = -1.0;
@@ -1568,6 +1970,12 @@ double calculateMAD(const std::vector<double>& data) {
 
 // Enhanced analysis functions
 HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double fs, const Options& opt) {
+    return analyzeSignalSegmentwise(signal, fs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double fs, const Options& opt, ExecutionContext& ctx) {
+    AllocScope allocScope(AllocSite::ANALYZE_SEGMENTWISE);
+    trace::Span traceSpan("analyzeSignalSegmentwise");
     HeartMetrics result;
     
     double segmentLength = opt.segmentWidth * fs;
@@ -1579,10 +1987,10 @@ HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double
         
         if (end - start < minSegmentSize) break;
         
-        std::vector<double> segment(signal.begin() + start, signal.begin() + end);
+        const SampleView<double> segment = SampleView<double>(signal).subview(start, end - start);
         
         try {
-            HeartMetrics segmentMetrics = analyzeSignal(segment, fs, opt);
+            HeartMetrics segmentMetrics = analyzeSignal(segment, fs, opt, ctx);
             if (segmentMetrics.quality.goodQuality || !opt.rejectSegmentwise) {
                 result.segments.push_back(segmentMetrics);
             }
@@ -1616,8 +2024,22 @@ HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double
 }
 
 HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options& opt) {
+    return analyzeRRIntervals(rrMs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options& opt, ExecutionContext& ctx) {
+    return analyzeRRIntervals(SampleView<double>(rrMs), opt, ctx);
+}
+
+HeartMetrics analyzeRRIntervals(SampleView<double> rrMs, const Options& opt) {
+    return analyzeRRIntervals(rrMs, opt, defaultExecutionContext());
+}
+
+HeartMetrics analyzeRRIntervals(SampleView<double> rrMs, const Options& opt, ExecutionContext& ctx) {
+    AllocScope allocScope(AllocSite::ANALYZE_RR);
+    trace::Span traceSpan("analyzeRRIntervals");
     HeartMetrics metrics;
-    metrics.rrList = rrMs;
+    metrics.rrList.assign(rrMs.begin(), rrMs.end());
 
     if (rrMs.empty()) return metrics;
 
@@ -1746,7 +2168,7 @@ HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options&
         
         // Breathing analysis (Hz by default; convert if requested)
         if (metrics.rrList.size() >= 10) {
-            double br_hz = calculateBreathingRate(metrics.rrList);
+            double br_hz = breathingRateWelch(metrics.rrList, ctx);
             metrics.breathingRate = opt.breathingAsBpm ? (br_hz * 60.0) : br_hz;
         }
     }
@@ -1861,14 +2283,112 @@ std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
     double fs,
     int nfft,
     double overlap) {
-    PSDResult psd = welchPSD(signal, fs, nfft, overlap);
-    return {psd.freqs, psd.psd};
+    return welchPowerSpectrum(signal, fs, nfft, overlap, defaultExecutionContext());
+}
+
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
+    const std::vector<double>& signal,
+    double fs,
+    int nfft,
+    double overlap,
+    ExecutionContext& ctx) {
+    PSDResult psd = welchPSD(signal, fs, nfft, overlap, ctx);
+    return {std::move(psd.freqs), std::move(psd.psd)};
+}
+
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
+    const std::vector<float>& signal,
+    double fs,
+    int nfft,
+    double overlap,
+    ExecutionContext& ctx) {
+    PSDResult psd = welchPSD(signal, fs, nfft, overlap, ctx);
+    return {std::move(psd.freqs), std::move(psd.psd)};
+}
+
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
+    SampleView<double> signal,
+    double fs,
+    int nfft,
+    double overlap,
+    ExecutionContext& ctx) {
+    PSDResult psd = welchPSD(signal, fs, nfft, overlap, ctx);
+    return {std::move(psd.freqs), std::move(psd.psd)};
+}
+
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
+    SampleView<float> signal,
+    double fs,
+    int nfft,
+    double overlap,
+    ExecutionContext& ctx) {
+    PSDResult psd = welchPSD(signal, fs, nfft, overlap, ctx);
+    return {std::move(psd.freqs), std::move(psd.psd)};
+}
+
+void prewarmFftPlans(const std::vector<int>& nffts, ExecutionContext& ctx) {
+    trace::Span traceSpan("prewarmFftPlans");
+    std::vector<double> x;
+    for (int nfft : nffts) {
+        if (nfft < 64) continue;
+        // Two segments at 50% overlap plus one hop: no guard adjustments
+        const size_t n = static_cast<size_t>(nfft) * 2;
+        x.resize(n);
+        for (size_t i = 0; i < n; ++i) x[i] = std::sin(2.0 * PI * 0.1 * static_cast<double>(i));
+        (void)welchPSD(x, 1.0, nfft, 0.5, ctx);
+    }
+}
+
+void prewarmAnalysis(double fs, double windowSec, const Options& opt, ExecutionContext& ctx) {
+    trace::Span traceSpan("prewarmAnalysis");
+    if (!(fs > 0.0) || !(windowSec > 0.0)) return;
+    const size_t n = static_cast<size_t>(std::ceil(fs * windowSec));
+    if (n < 4) return;
+    // 72 bpm pulse with a dicrotic harmonic and slow baseline, ADC-like scale
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double t = static_cast<double>(i) / fs;
+        x[i] = 512.0 + 100.0 * std::sin(2.0 * PI * 1.2 * t) + 35.0 * std::sin(2.0 * PI * 2.4 * t + 0.8)
+             + 30.0 * std::sin(2.0 * PI * 0.25 * t);
+    }
+    // Warm the instantiation the streaming analyzer will run
+    if (opt.singlePrecision) (void)analyzeSignal(std::vector<float>(x.begin(), x.end()), fs, opt, ctx);
+    else (void)analyzeSignal(x, fs, opt, ctx);
+}
+
+unsigned long long getWelchPsdGuardFallbackCount() { return g_welchGuardFallbackCount.value(); }
+unsigned long long getWelchPsdGuardFailureCount() { return g_welchGuardFailureCount.value(); }
+
+ExecutionContext& defaultExecutionContext() {
+    thread_local ExecutionContext ctx;
+    return ctx;
+}
+
+void ExecutionContext::log(const char* tag, const char* fmt, ...) const {
+    if (!logEnabled) return;
+    va_list args;
+    va_start(args, fmt);
+    if (logSink) {
+        char buffer[1024];
+        std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+        logSink(tag, buffer);
+    } else if (std::strcmp(tag, kTagWelch) == 0) {
+        vlogStderr(tag, fmt, args); // guard diagnostics always went to stderr
+    } else {
+        vlogPlatform(tag, fmt, args);
+    }
+    va_end(args);
 }
 
-unsigned long long getWelchPsdGuardFallbackCount() { return g_welchGuardFallbackCount.load(); }
-unsigned long long getWelchPsdGuardFailureCount() { return g_welchGuardFailureCount.load(); }
+const char* StageTimings::name(int stage) {
+    static const char* const kNames[COUNT] = {
+        "preprocess", "detrend", "filter", "peakFit", "rrClean", "timeDomain",
+        "spline", "welch", "pollCopy", "snr", "harmonic", "total"
+    };
+    return (stage >= 0 && stage < COUNT) ? kNames[stage] : "unknown";
+}
 
-void setDeterministic(bool on) { s_deterministic = on; }
-bool isDeterministic() { return s_deterministic; }
+void setDeterministic(bool on) { defaultExecutionContext().deterministic = on; }
+bool isDeterministic() { return defaultExecutionContext().deterministic; }
 
 } // namespace heartpy
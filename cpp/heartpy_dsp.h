@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "heartpy_core.h"
+
+// Internal DSP stages of analyzeSignal/analyzeRRIntervals. Not part of the
+// public API (no stability guarantees); exposed so the benchmarks in
+// examples/ can time each stage in isolation. Signal stages have double and
+// float overloads (see the float analyzeSignal in heartpy_core.h).
+namespace heartpy {
+
+struct PSDResult { std::vector<double> freqs; std::vector<double> psd; };
+struct HPFitResult { std::vector<int> peaks; double best_ma{0}; double rrsd{0}; double bpm{0}; bool ok{false}; };
+struct ProvisionalHR { double bpm{0}; double confidence{0}; double lagSamples{0}; bool ok{false}; };
+
+// Centered moving-average detrend (window in samples)
+std::vector<double> movingAverageDetrend(const std::vector<double>& x, int window);
+std::vector<float> movingAverageDetrend(const std::vector<float>& x, int window);
+// Cascaded RBJ biquad bandpass, `order` sections between lowHz and highHz
+std::vector<double> bandpassFilter(const std::vector<double>& x, double fs, double lowHz, double highHz, int order);
+std::vector<float> bandpassFilter(const std::vector<float>& x, double fs, double lowHz, double highHz, int order);
+// HeartPy-style rolling-mean threshold sweep; picks the lowest-RRSD threshold
+HPFitResult fitPeaksHP(const std::vector<double>& x, double fs, double bpmMin, double bpmMax);
+HPFitResult fitPeaksHP(const std::vector<float>& x, double fs, double bpmMin, double bpmMax);
+// Hann-windowed Welch PSD (one-sided, density scaling)
+PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap, ExecutionContext& ctx);
+PSDResult welchPSD(const std::vector<float>& x, double fs, int nfft, double overlap, ExecutionContext& ctx);
+PSDResult welchPSD(SampleView<double> x, double fs, int nfft, double overlap, ExecutionContext& ctx);
+PSDResult welchPSD(SampleView<float> x, double fs, int nfft, double overlap, ExecutionContext& ctx);
+// Second-difference penalized RR smoothing solved by conjugate gradient
+std::vector<double> smoothRR_CG(const std::vector<double>& rr, double lambda, int max_iters = 200, double tol = 1e-6);
+// Short-window HR from the normalized autocorrelation peak with a
+// sub-harmonic check (streaming warm-up); acf is reusable scratch
+ProvisionalHR estimateHRAutocorr(const double* x, size_t n, double fs, double bpmMin, double bpmMax, std::vector<double>& acf);
+ProvisionalHR estimateHRAutocorr(const float* x, size_t n, double fs, double bpmMin, double bpmMax, std::vector<double>& acf);
+
+} // namespace heartpy
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace heartpy {
+
+// Fixed-memory log-linear (HDR-style) latency histogram.
+// Values are nanoseconds; each power-of-two range is split into kSubBuckets
+// linear sub-buckets (~6% worst-case relative error), values >= 2^kMaxLog2
+// ns (~68 s) saturate into the last bucket. record() is lock-free (relaxed
+// atomics only), so one instance can be shared by any number of threads;
+// merge() folds another histogram in (e.g. per-analyzer -> global).
+// Copies and reset() are not atomic snapshots of the whole histogram.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kMaxLog2 = 36;
+    static constexpr int kBuckets = (kMaxLog2 - kSubBits + 1) * kSubBuckets;
+
+    LatencyHistogram() { reset(); }
+    LatencyHistogram(const LatencyHistogram& o) { reset(); merge(o); }
+    LatencyHistogram& operator=(const LatencyHistogram& o) {
+        if (this != &o) { reset(); merge(o); }
+        return *this;
+    }
+
+    void recordNs(uint64_t ns) {
+        counts_[indexOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumNs_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t cur = maxNs_.load(std::memory_order_relaxed);
+        while (ns > cur && !maxNs_.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+    }
+    void recordUs(double us) {
+        recordNs((us > 0.0 && std::isfinite(us)) ? static_cast<uint64_t>(us * 1000.0 + 0.5) : 0);
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int i = 0; i < kBuckets; ++i) {
+            uint64_t c = o.counts_[i].load(std::memory_order_relaxed);
+            if (c) counts_[i].fetch_add(c, std::memory_order_relaxed);
+        }
+        count_.fetch_add(o.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        sumNs_.fetch_add(o.sumNs_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint64_t om = o.maxNs_.load(std::memory_order_relaxed);
+        uint64_t cur = maxNs_.load(std::memory_order_relaxed);
+        while (om > cur && !maxNs_.compare_exchange_weak(cur, om, std::memory_order_relaxed)) {}
+    }
+
+    void reset() {
+        for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sumNs_.store(0, std::memory_order_relaxed);
+        maxNs_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double meanUs() const {
+        uint64_t n = count();
+        return n ? static_cast<double>(sumNs_.load(std::memory_order_relaxed)) / n / 1000.0 : 0.0;
+    }
+    double maxUs() const { return static_cast<double>(maxNs_.load(std::memory_order_relaxed)) / 1000.0; }
+
+    // Value at quantile q (0..1): upper edge of the holding bucket, capped at max
+    double percentileUs(double q) const {
+        uint64_t n = count();
+        if (n == 0) return 0.0;
+        q = std::min(1.0, std::max(0.0, q));
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(n))));
+        uint64_t acc = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            acc += counts_[i].load(std::memory_order_relaxed);
+            if (acc >= rank) {
+                uint64_t hi = upperEdgeNs(i);
+                return static_cast<double>(std::min(hi, maxNs_.load(std::memory_order_relaxed))) / 1000.0;
+            }
+        }
+        return maxUs();
+    }
+
+    static int indexOf(uint64_t ns) {
+        if (ns < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(ns);
+        int msb = 63;
+        while (!((ns >> msb) & 1ULL)) --msb;
+        if (msb >= kMaxLog2) return kBuckets - 1;
+        const int group = msb - kSubBits + 1;                  // >= 1
+        const int sub = static_cast<int>((ns >> (msb - kSubBits)) - kSubBuckets);
+        return group * kSubBuckets + sub;
+    }
+    static uint64_t upperEdgeNs(int idx) {
+        const int group = idx / kSubBuckets;
+        const uint64_t sub = static_cast<uint64_t>(idx % kSubBuckets);
+        if (group == 0) return sub;
+        return ((kSubBuckets + sub + 1) << (group - 1)) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_;
+    std::atomic<uint64_t> count_ {0};
+    std::atomic<uint64_t> sumNs_ {0};
+    std::atomic<uint64_t> maxNs_ {0};
+};
+
+// Records the lifetime of the scope into a histogram (no-op when null)
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* h)
+        : h_(h), t0_(h ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}) {}
+    ~ScopedLatency() {
+        if (h_) h_->recordNs(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0_).count()));
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+private:
+    LatencyHistogram* h_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+} // namespace heartpy
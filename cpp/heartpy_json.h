@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "heartpy_core.h"
+
+// JSON serialization of analysis results for the bridges and tools. Output
+// is appended to a caller-owned string, so a reused buffer stops allocating
+// once it has grown to the size of a result. Doubles are written in their
+// shortest round-trip form (std::to_chars where the standard library has it,
+// otherwise the shortest of %.15g/%.16g/%.17g that parses back exactly),
+// never locale-dependent; NaN and infinities become null. Integral values
+// and fixed-precision arrays are formatted without the C library.
+
+namespace heartpy {
+
+struct JsonOptions {
+    // Field groups written by appendMetricsJson
+    enum Field : uint32_t {
+        FIELD_SCALARS         = 1u << 0, // bpm, time/frequency domain, Poincare, breathingRate
+        FIELD_BEATS           = 1u << 1, // ibiMs, rrList, peakList, peakTimestamps
+        FIELD_PEAKS_RAW       = 1u << 2, // peakListRaw, binaryPeakMask
+        FIELD_WAVEFORM        = 1u << 3, // waveform_values, waveform_timestamps
+        FIELD_QUALITY         = 1u << 4, // quality object
+        FIELD_TIMINGS         = 1u << 5, // timingsUs / stageAllocs (only when filled)
+        FIELD_BINARY_SEGMENTS = 1u << 6, // binarySegments
+        FIELD_SEGMENTS        = 1u << 7, // segments (nested results, same fields minus segments)
+        FIELD_ALL             = 0xFFu
+    };
+    uint32_t fields = FIELD_ALL;
+    // Decimals for the waveform arrays: < 0 writes them shortest round-trip
+    // like every other number; 0..9 rounds to at most that many decimals
+    // (trailing zeros dropped), much faster and smaller for plotting.
+    int waveformDecimals = -1;
+    bool wants(uint32_t field) const { return (fields & field) != 0; }
+};
+
+// Low-level writer appending to a string. Callers place commas themselves.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void raw(const char* s, size_t n) { out_.append(s, n); }
+    void raw(const char* s);
+    void raw(char c) { out_.push_back(c); }
+    void key(const char* k);             // "k":
+    void number(double v);               // shortest round-trip, null if not finite
+    void number(double v, int decimals); // at most `decimals` decimals (0..9)
+    void integer(long long v);
+    void boolean(bool v) { raw(v ? "true" : "false"); }
+    void string(const std::string& s);   // quoted and escaped
+    void array(const double* v, size_t n, int decimals = -1);
+    void array(const int* v, size_t n);
+
+private:
+    std::string& out_;
+};
+
+// Appends r as a JSON object. Key names and order match the bridges'
+// historical to_json output.
+void appendMetricsJson(std::string& out, const HeartMetrics& r, const JsonOptions& jopt = {});
+std::string metricsJson(const HeartMetrics& r, const JsonOptions& jopt = {});
+
+} // namespace heartpy
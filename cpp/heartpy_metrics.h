@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include "heartpy_histogram.h"
+
+// Process-wide registry of operational metrics (audit counters, gauges and
+// latency histograms). Owners keep their metric objects and publish them
+// through a MetricGroup that carries common labels (e.g. analyzer="3").
+// Scrapes pull the current values through collect() or one of the exporters.
+// Nothing is copied into analysis results.
+//
+// Counter increments go to one of kShards cache-line sized slots picked per
+// thread, so push and poll threads never contend on the same line. Reads sum
+// the shards. Gauges are single relaxed atomics. Histograms are the existing
+// lock-free LatencyHistogram, exported as Prometheus summaries in seconds.
+
+namespace heartpy {
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+public:
+    static constexpr int kShards = 8;
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void inc(uint64_t n = 1) { if (n) shards_[shardIndex()].v.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const {
+        uint64_t s = 0;
+        for (const auto& sh : shards_) s += sh.v.load(std::memory_order_relaxed);
+        return s;
+    }
+    void reset() { for (auto& sh : shards_) sh.v.store(0, std::memory_order_relaxed); }
+
+    static int shardIndex();
+private:
+    struct alignas(64) Shard { std::atomic<uint64_t> v {0}; };
+    std::array<Shard, kShards> shards_ {};
+};
+
+class Gauge {
+public:
+    Gauge() = default;
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void set(double v) { v_.store(v, std::memory_order_relaxed); }
+    double value() const { return v_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<double> v_ {0.0};
+};
+
+enum class MetricType { COUNTER = 0, GAUGE, SUMMARY };
+
+// One exported series as seen by a scrape
+struct MetricSample {
+    std::string name;
+    const char* help = "";
+    MetricType type = MetricType::COUNTER;
+    Labels labels;
+    double value = 0.0;                // counter/gauge value; summary: sum (seconds)
+    uint64_t count = 0;                // summary only
+    std::array<double, 3> quantiles {}; // summary only: p50, p90, p99 (seconds)
+};
+
+// Named series sharing a label set. Registered on construction and removed
+// on destruction, which waits for an in-flight scrape. The referenced
+// objects must outlive the group (declare the group after them).
+class MetricGroup {
+public:
+    explicit MetricGroup(Labels labels = {});
+    ~MetricGroup();
+    MetricGroup(const MetricGroup&) = delete;
+    MetricGroup& operator=(const MetricGroup&) = delete;
+
+    // Names and help texts must be string literals
+    void add(const char* name, const char* help, const Counter& c, Labels extra = {});
+    void add(const char* name, const char* help, const Gauge& g, Labels extra = {});
+    void add(const char* name, const char* help, const LatencyHistogram& h, Labels extra = {});
+
+    const Labels& labels() const { return labels_; }
+
+    // Removes the group from scrapes and adds it back (e.g. while a pooled
+    // owner is idle). Waits for an in-flight scrape; idempotent.
+    void setExported(bool on);
+
+private:
+    friend class Registry;
+    struct Entry {
+        const char* name;
+        const char* help;
+        MetricType type;
+        Labels extra;
+        const void* obj;
+    };
+    void addEntry(const char* name, const char* help, MetricType type, Labels extra, const void* obj);
+    Labels labels_;
+    std::deque<Entry> entries_;
+    bool exported_ {true}; // guarded by the registry mutex
+};
+
+class Registry {
+public:
+    // All series, sorted by name (stable within a name: registration order)
+    std::vector<MetricSample> collect() const;
+    // Prometheus text exposition format 0.0.4
+    std::string prometheusText() const;
+    // {"metrics":[{"name":..,"type":..,"labels":{..},"value":..}, ...]}
+    std::string json() const;
+};
+
+Registry& registry();
+
+// Process-wide series (Welch guard counters, global latency histograms)
+MetricGroup& processGroup();
+
+} // namespace metrics
+} // namespace heartpy
+
+// Plain C bridge. Writes up to cap bytes (NUL-terminated when cap > 0) and
+// returns the full length, so callers can retry with a larger buffer.
+extern "C" {
+    size_t hp_metrics_prometheus(char* buf, size_t cap);
+    size_t hp_metrics_json(char* buf, size_t cap);
+}
@@ -0,0 +1,351 @@
+#include "heartpy_recording.h"
+#include "heartpy_trace.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace heartpy {
+
+static constexpr const char* kTagRecording = "HeartPyRecording";
+
+// ------------------------------------------------------------------
+// SampleFile
+// ------------------------------------------------------------------
+
+SampleFile::Region::Region(Region&& o) noexcept { *this = std::move(o); }
+
+SampleFile::Region& SampleFile::Region::operator=(Region&& o) noexcept {
+    if (this != &o) {
+        release();
+        base_ = o.base_; length_ = o.length_; data_ = o.data_;
+        offset_ = o.offset_; count_ = o.count_; format_ = o.format_;
+        o.base_ = nullptr; o.length_ = 0; o.data_ = nullptr; o.count_ = 0;
+    }
+    return *this;
+}
+
+SampleFile::Region::~Region() { release(); }
+
+void SampleFile::Region::release() {
+#if !defined(_WIN32)
+    if (base_) munmap(base_, length_);
+#endif
+    base_ = nullptr; length_ = 0; data_ = nullptr; count_ = 0;
+}
+
+SampleView<float> SampleFile::Region::f32() const {
+    if (format_ != Format::FLOAT32) return {};
+    return SampleView<float>(reinterpret_cast<const float*>(data_), count_);
+}
+
+SampleView<double> SampleFile::Region::f64() const {
+    if (format_ != Format::FLOAT64) return {};
+    return SampleView<double>(reinterpret_cast<const double*>(data_), count_);
+}
+
+void SampleFile::Region::prefetch() const {
+#if !defined(_WIN32)
+    if (base_) madvise(base_, length_, MADV_WILLNEED);
+#endif
+}
+
+SampleFile::SampleFile(const std::string& path, Format format, uint64_t headerBytes)
+    : format_(format), headerBytes_(headerBytes) {
+    if (headerBytes % sampleBytes() != 0) {
+        throw std::invalid_argument("SampleFile: header size must be a multiple of the sample size");
+    }
+#if defined(_WIN32)
+    (void)path;
+    throw std::runtime_error("SampleFile: memory-mapped files are not supported on this platform");
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("SampleFile: cannot open " + path);
+    struct stat st {};
+    if (fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("SampleFile: cannot stat " + path);
+    }
+    const uint64_t bytes = static_cast<uint64_t>(st.st_size);
+    samples_ = bytes > headerBytes ? (bytes - headerBytes) / sampleBytes() : 0;
+#endif
+}
+
+SampleFile::SampleFile(SampleFile&& o) noexcept
+    : fd_(o.fd_), format_(o.format_), headerBytes_(o.headerBytes_), samples_(o.samples_) {
+    o.fd_ = -1;
+    o.samples_ = 0;
+}
+
+SampleFile& SampleFile::operator=(SampleFile&& o) noexcept {
+    if (this != &o) {
+#if !defined(_WIN32)
+        if (fd_ >= 0) ::close(fd_);
+#endif
+        fd_ = o.fd_; format_ = o.format_; headerBytes_ = o.headerBytes_; samples_ = o.samples_;
+        o.fd_ = -1;
+        o.samples_ = 0;
+    }
+    return *this;
+}
+
+SampleFile::~SampleFile() {
+#if !defined(_WIN32)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+SampleFile::Region SampleFile::map(uint64_t offset, size_t count) const {
+    Region r;
+    r.format_ = format_;
+    r.offset_ = offset;
+    if (fd_ < 0 || offset >= samples_ || count == 0) return r;
+    count = static_cast<size_t>(std::min<uint64_t>(count, samples_ - offset));
+#if !defined(_WIN32)
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t begin = headerBytes_ + offset * sampleBytes();
+    const uint64_t aligned = begin - begin % page;
+    const size_t length = static_cast<size_t>(begin - aligned) + count * sampleBytes();
+    void* base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd_, static_cast<off_t>(aligned));
+    if (base == MAP_FAILED) throw std::runtime_error("SampleFile: mmap failed");
+    madvise(base, length, MADV_SEQUENTIAL);
+    r.base_ = base;
+    r.length_ = length;
+    r.data_ = static_cast<const char*>(base) + (begin - aligned);
+    r.count_ = count;
+#endif
+    return r;
+}
+
+// ------------------------------------------------------------------
+// Chunked analysis
+// ------------------------------------------------------------------
+
+namespace {
+
+// Sample windows of an in-memory view
+template <class T>
+struct ViewWindows {
+    SampleView<T> signal;
+    SampleView<T> get(uint64_t offset, size_t count) { return signal.subview(static_cast<size_t>(offset), count); }
+    void prefetch(uint64_t, size_t) {}
+};
+
+// Mapped windows of a file; the next window is mapped and read ahead while
+// the current one is analyzed, and a window is unmapped once it is passed
+template <class T>
+struct FileWindows {
+    const SampleFile& file;
+    SampleFile::Region cur, next;
+
+    static SampleView<T> view(const SampleFile::Region& r);
+    SampleView<T> get(uint64_t offset, size_t count) {
+        if (next.size() == count && next.offset() == offset) cur = std::move(next);
+        else cur = file.map(offset, count);
+        next = SampleFile::Region();
+        return view(cur);
+    }
+    void prefetch(uint64_t offset, size_t count) {
+        next = file.map(offset, count);
+        next.prefetch();
+    }
+};
+
+template <> SampleView<float> FileWindows<float>::view(const SampleFile::Region& r) { return r.f32(); }
+template <> SampleView<double> FileWindows<double>::view(const SampleFile::Region& r) { return r.f64(); }
+
+// Online RR statistics; successive differences only between adjacent intervals
+struct RRAccumulator {
+    int64_t n = 0;
+    double meanRR = 0.0, m2 = 0.0;
+    int64_t diffs = 0, over20 = 0, over50 = 0;
+    double sumsq = 0.0;
+    double prev = std::numeric_limits<double>::quiet_NaN();
+
+    void add(double rr) {
+        ++n;
+        const double d = rr - meanRR;
+        meanRR += d / static_cast<double>(n);
+        m2 += d * (rr - meanRR);
+        if (!std::isnan(prev)) {
+            const double diff = rr - prev;
+            sumsq += diff * diff;
+            ++diffs;
+            if (std::fabs(diff) > 20.0) ++over20;
+            if (std::fabs(diff) > 50.0) ++over50;
+        }
+        prev = rr;
+    }
+    void breakChain() { prev = std::numeric_limits<double>::quiet_NaN(); }
+};
+
+} // namespace
+
+template <class T, class Windows>
+static RecordingResult analyzeChunks(Windows& windows, uint64_t total, double fs, const Options& opt,
+                                     const RecordingOptions& ropt, ExecutionContext& ctx) {
+    if (fs <= 0.0) throw std::invalid_argument("fs must be > 0");
+    RecordingResult res;
+    res.samples = static_cast<int64_t>(total);
+    res.durationSec = static_cast<double>(total) / fs;
+    if (total == 0) return res;
+
+    // analyzeSignal indexes with int; keep a chunk and its margins well inside
+    const double maxWindow = static_cast<double>(INT_MAX / 8);
+    const double marginSamples = std::clamp(std::round(std::max(0.0, ropt.marginSec) * fs), 0.0, maxWindow / 4);
+    const double coreSamples = std::clamp(std::round(std::max(10.0, ropt.chunkSec) * fs), 1.0, maxWindow - 2 * marginSamples);
+    const uint64_t core = static_cast<uint64_t>(coreSamples);
+    const uint64_t margin = static_cast<uint64_t>(marginSamples);
+    auto windowOf = [&](uint64_t begin, uint64_t& wb, uint64_t& we) {
+        const uint64_t end = std::min(total, begin + core);
+        wb = begin > margin ? begin - margin : 0;
+        we = std::min(total, end + margin);
+    };
+
+    // The stitcher only needs peaks and the raw peaks/accept mask
+    Options copt = opt;
+    copt.outputs = Options::OUTPUT_PEAKS | Options::OUTPUT_PEAKS_RAW;
+    const double spacingMs = opt.minPeakDistanceMs > 0.0 ? opt.minPeakDistanceMs : opt.refractoryMs;
+    const int64_t minGap = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(spacingMs * fs / 1000.0)));
+    const double rrMin = 60000.0 / std::max(1.0, opt.bpmMax);
+    const double rrMax = 60000.0 / std::max(1.0, opt.bpmMin);
+
+    RecordingChunk chunk;
+    RRAccumulator acc;
+    int64_t lastAny = -1;  // last detected peak (accepted or not), for boundary de-duplication
+    int64_t lastBeat = -1; // last accepted peak still chained to the next interval
+
+    for (uint64_t begin = 0; begin < total; begin += core, ++chunk.index) {
+        trace::Span span("recording.chunk");
+        const uint64_t end = std::min(total, begin + core);
+        uint64_t wb = 0, we = 0;
+        windowOf(begin, wb, we);
+        const SampleView<T> window = windows.get(wb, static_cast<size_t>(we - wb));
+        if (end < total) {
+            uint64_t nb = 0, ne = 0;
+            windowOf(end, nb, ne);
+            windows.prefetch(nb, static_cast<size_t>(ne - nb));
+        }
+
+        chunk.beginSample = static_cast<int64_t>(begin);
+        chunk.endSample = static_cast<int64_t>(end);
+        chunk.peaks.clear();
+        chunk.bpm = 0.0;
+        chunk.quality = QualityInfo{};
+        chunk.analyzed = false;
+        HeartMetrics m;
+        try {
+            m = analyzeSignal(window, fs, copt, ctx);
+            chunk.analyzed = true;
+        } catch (const std::exception& e) {
+            ++res.failedChunks;
+            ctx.log(kTagRecording, "chunk %llu [%lld, %lld) not analyzed: %s",
+                    static_cast<unsigned long long>(chunk.index), static_cast<long long>(begin),
+                    static_cast<long long>(end), e.what());
+        }
+
+        if (chunk.analyzed) {
+            chunk.bpm = m.bpm;
+            chunk.quality = std::move(m.quality);
+            // Raw peaks in order; a peak is accepted when the mask kept it and
+            // it survived the spacing guard (i.e. is also in peakList)
+            const bool masked = m.binaryPeakMask.size() == m.peakListRaw.size() && !m.peakListRaw.empty();
+            const std::vector<int>& raw = masked ? m.peakListRaw : m.peakList;
+            size_t accIt = 0;
+            for (size_t i = 0; i < raw.size(); ++i) {
+                const int64_t g = static_cast<int64_t>(wb) + raw[i];
+                while (accIt < m.peakList.size() && m.peakList[accIt] < raw[i]) ++accIt;
+                const bool accepted = !masked ||
+                    (m.binaryPeakMask[i] && accIt < m.peakList.size() && m.peakList[accIt] == raw[i]);
+                if (g < static_cast<int64_t>(begin) || g >= static_cast<int64_t>(end)) continue;
+                // The previous chunk may have placed the same beat a sample or
+                // two before the boundary
+                if (lastAny >= 0 && g < static_cast<int64_t>(begin) + minGap && g - lastAny < minGap) continue;
+                lastAny = g;
+                if (!accepted) {
+                    ++res.rejectedBeats;
+                    lastBeat = -1;
+                    acc.breakChain();
+                    continue;
+                }
+                ++res.beats;
+                chunk.peaks.push_back(g);
+                if (lastBeat >= 0) {
+                    const double rr = static_cast<double>(g - lastBeat) * 1000.0 / fs;
+                    if (rr >= rrMin && rr <= rrMax) {
+                        acc.add(rr);
+                    } else {
+                        ++res.gaps;
+                        acc.breakChain();
+                    }
+                }
+                lastBeat = g;
+            }
+        } else {
+            // Nothing is known about this span; do not bridge an interval over it
+            lastBeat = -1;
+            acc.breakChain();
+        }
+
+        if (ropt.keepPeaks) res.peaks.insert(res.peaks.end(), chunk.peaks.begin(), chunk.peaks.end());
+        if (ropt.onChunk) ropt.onChunk(chunk);
+        ++res.chunks;
+    }
+
+    res.intervals = acc.n;
+    if (acc.n > 0) {
+        res.meanRR = acc.meanRR;
+        res.bpm = 60000.0 / acc.meanRR;
+        res.sdnn = std::sqrt(acc.m2 / static_cast<double>(acc.n));
+    }
+    if (acc.diffs > 0) {
+        const double d = static_cast<double>(acc.diffs);
+        res.rmssd = std::sqrt(acc.sumsq / d);
+        res.pnn20 = (opt.pnnAsPercent ? 100.0 : 1.0) * static_cast<double>(acc.over20) / d;
+        res.pnn50 = (opt.pnnAsPercent ? 100.0 : 1.0) * static_cast<double>(acc.over50) / d;
+    }
+    return res;
+}
+
+RecordingResult analyzeRecording(const SampleFile& file, double fs, const Options& opt, const RecordingOptions& ropt) {
+    return analyzeRecording(file, fs, opt, ropt, defaultExecutionContext());
+}
+
+RecordingResult analyzeRecording(const SampleFile& file, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx) {
+    if (file.format() == SampleFile::Format::FLOAT32) {
+        FileWindows<float> windows{file, {}, {}};
+        return analyzeChunks<float>(windows, file.size(), fs, opt, ropt, ctx);
+    }
+    FileWindows<double> windows{file, {}, {}};
+    return analyzeChunks<double>(windows, file.size(), fs, opt, ropt, ctx);
+}
+
+RecordingResult analyzeRecording(SampleView<float> signal, double fs, const Options& opt, const RecordingOptions& ropt) {
+    return analyzeRecording(signal, fs, opt, ropt, defaultExecutionContext());
+}
+
+RecordingResult analyzeRecording(SampleView<double> signal, double fs, const Options& opt, const RecordingOptions& ropt) {
+    return analyzeRecording(signal, fs, opt, ropt, defaultExecutionContext());
+}
+
+RecordingResult analyzeRecording(SampleView<float> signal, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx) {
+    ViewWindows<float> windows{signal};
+    return analyzeChunks<float>(windows, signal.size(), fs, opt, ropt, ctx);
+}
+
+RecordingResult analyzeRecording(SampleView<double> signal, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx) {
+    ViewWindows<double> windows{signal};
+    return analyzeChunks<double>(windows, signal.size(), fs, opt, ropt, ctx);
+}
+
+} // namespace heartpy
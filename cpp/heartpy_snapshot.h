@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Immutable, reference-counted sample buffers. The realtime analyzer fills a
+// buffer once per update and publishes it; results and accessors that refer
+// to the same window share it instead of copying. Copying a SharedSamples
+// only bumps a reference count, and a holder keeps its buffer alive and
+// unchanged for as long as it likes.
+//
+// SnapshotWriter recycles published storage once its last holder is gone, so
+// a steady producer allocates only while consumers keep old snapshots alive.
+
+namespace heartpy {
+
+template <class T>
+class SharedSamples {
+public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    SharedSamples() = default;
+    explicit SharedSamples(std::shared_ptr<const std::vector<T>> buf) : buf_(std::move(buf)) {}
+    // Takes ownership of v (for results built outside the streaming path)
+    SharedSamples(std::vector<T> v) : buf_(std::make_shared<const std::vector<T>>(std::move(v))) {}
+
+    const T* data() const { return buf_ ? buf_->data() : nullptr; }
+    size_t size() const { return buf_ ? buf_->size() : 0; }
+    bool empty() const { return size() == 0; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    const T& operator[](size_t i) const { return (*buf_)[i]; }
+    const T& front() const { return buf_->front(); }
+    const T& back() const { return buf_->back(); }
+
+    // Vector view for APIs taking const std::vector<T>& (no copy)
+    const std::vector<T>& vector() const {
+        static const std::vector<T> kEmpty;
+        return buf_ ? *buf_ : kEmpty;
+    }
+    operator const std::vector<T>&() const { return vector(); }
+
+    // Holders of this buffer, including the producer's slot (0 when empty)
+    long useCount() const { return buf_.use_count(); }
+    void reset() { buf_.reset(); }
+
+private:
+    std::shared_ptr<const std::vector<T>> buf_;
+};
+
+template <class T>
+class SnapshotWriter {
+public:
+    // Storage for the next publish(). Reuses a slot no reader holds any more
+    // (its old contents are still there; assign over them), otherwise starts a
+    // fresh buffer in the least recently replaced slot.
+    std::vector<T>& next() {
+        for (auto& s : slots_) {
+            if (s && s.use_count() == 1) {
+                // Pairs with the release decrement of the last reader's drop
+                std::atomic_thread_fence(std::memory_order_acquire);
+                cur_ = &s;
+                return *s;
+            }
+        }
+        auto& s = slots_[replace_];
+        replace_ = (replace_ + 1) % kSlots;
+        s = std::make_shared<std::vector<T>>();
+        cur_ = &s;
+        return *s;
+    }
+    // Freezes the storage last returned by next()
+    SharedSamples<T> publish() const {
+        return cur_ ? SharedSamples<T>(std::shared_ptr<const std::vector<T>>(*cur_)) : SharedSamples<T>();
+    }
+
+private:
+    static constexpr size_t kSlots = 2;
+    std::array<std::shared_ptr<std::vector<T>>, kSlots> slots_ {};
+    std::shared_ptr<std::vector<T>>* cur_ {nullptr};
+    size_t replace_ {0};
+};
+
+// Lazily published copy of a mutable buffer: copied at most once per
+// generation and shared by every reader until the owner bumps it
+template <class T>
+class SnapshotCache {
+public:
+    SharedSamples<T> get(const std::vector<T>& src, uint64_t generation) {
+        if (!valid_ || generation != generation_) {
+            shared_.reset(); // lets the writer recycle the previous copy
+            writer_.next().assign(src.begin(), src.end());
+            shared_ = writer_.publish();
+            generation_ = generation;
+            valid_ = true;
+        }
+        return shared_;
+    }
+
+private:
+    SnapshotWriter<T> writer_;
+    SharedSamples<T> shared_;
+    uint64_t generation_ {0};
+    bool valid_ {false};
+};
+
+} // namespace heartpy
@@ -0,0 +1,251 @@
+#include "heartpy_trace.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace heartpy {
+namespace trace {
+
+namespace detail { std::atomic<bool> g_enabled{false}; }
+
+namespace {
+
+constexpr size_t kEventsPerThread = 8192; // power of two
+
+enum Phase : uint32_t { PH_COMPLETE = 0, PH_COUNTER, PH_INSTANT };
+
+// Fields are relaxed atomics so a concurrent dump never reads a torn slot
+// under the memory model; validity is decided by the ring head instead.
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> ts{0};
+    std::atomic<uint64_t> dur{0};
+    std::atomic<double> value{0.0};
+    std::atomic<uint32_t> phase{PH_COMPLETE};
+};
+
+struct ThreadRing {
+    uint32_t tid = 0;
+    std::string name;                  // guarded by registryMutex()
+    std::atomic<uint64_t> head{0};     // events written so far
+    std::atomic<bool> exited{false};   // owning thread is gone; head is final
+    std::array<Event, kEventsPerThread> events;
+};
+
+std::mutex& registryMutex() { static std::mutex m; return m; }
+std::vector<std::shared_ptr<ThreadRing>>& registry() {
+    static std::vector<std::shared_ptr<ThreadRing>> r;
+    return r;
+}
+std::atomic<uint64_t> g_clearedBeforeNs{0};
+std::atomic<uint32_t> g_nextTid{1};
+
+// Unlinks rings whose thread has exited; the last dump holding one frees it
+template <class Pred>
+void dropExitedRings(Pred pred) {
+    auto& r = registry();
+    r.erase(std::remove_if(r.begin(), r.end(), [&](const std::shared_ptr<ThreadRing>& ring) {
+        return ring->exited.load(std::memory_order_acquire) && pred(*ring);
+    }), r.end());
+}
+
+const std::chrono::steady_clock::time_point& origin() {
+    static const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    return t0;
+}
+
+// Per-thread handle. The ring itself is shared with the registry so a dump
+// can still read it after the thread exits.
+struct LocalRing {
+    std::shared_ptr<ThreadRing> ring;
+    std::string pendingName; // set before the first event
+    ~LocalRing() {
+        if (ring) ring->exited.store(true, std::memory_order_release);
+    }
+};
+
+LocalRing& local() {
+    thread_local LocalRing l;
+    return l;
+}
+
+ThreadRing& localRing() {
+    LocalRing& l = local();
+    if (!l.ring) {
+        l.ring = std::make_shared<ThreadRing>();
+        l.ring->tid = g_nextTid.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(registryMutex());
+        l.ring->name.swap(l.pendingName);
+        registry().push_back(l.ring);
+    }
+    return *l.ring;
+}
+
+void record(Phase ph, const char* name, uint64_t ts, uint64_t dur, double value) {
+    ThreadRing& r = localRing();
+    const uint64_t h = r.head.load(std::memory_order_relaxed);
+    Event& e = r.events[h & (kEventsPerThread - 1)];
+    e.name.store(name, std::memory_order_relaxed);
+    e.ts.store(ts, std::memory_order_relaxed);
+    e.dur.store(dur, std::memory_order_relaxed);
+    e.value.store(value, std::memory_order_relaxed);
+    e.phase.store(ph, std::memory_order_relaxed);
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void appendEscaped(std::string& out, const char* s) {
+    for (; s && *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) out += ' ';
+        else out += c;
+    }
+}
+
+} // namespace
+
+void setEnabled(bool on) {
+    (void)origin();
+    detail::g_enabled.store(on, std::memory_order_relaxed);
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin()).count());
+}
+
+void complete(const char* name, uint64_t startNs, uint64_t endNs) {
+    if (!enabled()) return;
+    record(PH_COMPLETE, name, startNs, endNs >= startNs ? endNs - startNs : 0, 0.0);
+}
+
+void counter(const char* name, double value) {
+    if (!enabled()) return;
+    record(PH_COUNTER, name, nowNs(), 0, value);
+}
+
+void instant(const char* name) {
+    if (!enabled()) return;
+    record(PH_INSTANT, name, nowNs(), 0, 0.0);
+}
+
+void setThreadName(const char* name) {
+    LocalRing& l = local();
+    if (!l.ring) {
+        // Applied when the thread records its first event
+        l.pendingName = name ? name : "";
+        return;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex());
+    l.ring->name = name ? name : "";
+}
+
+void clear() {
+    g_clearedBeforeNs.store(nowNs(), std::memory_order_relaxed);
+    // Everything an exited thread recorded is hidden now
+    std::lock_guard<std::mutex> lock(registryMutex());
+    dropExitedRings([](const ThreadRing&) { return true; });
+}
+
+std::string chromeJson() {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        rings = registry();
+        for (const auto& r : rings) names.push_back(r->name);
+    }
+    // Rings of threads that exited before the snapshot are complete; this
+    // dump flushes them, so they are released afterwards
+    std::vector<const ThreadRing*> flushed;
+    for (const auto& r : rings) {
+        if (r->exited.load(std::memory_order_acquire)) flushed.push_back(r.get());
+    }
+    const uint64_t cutoff = g_clearedBeforeNs.load(std::memory_order_relaxed);
+    std::string out;
+    out.reserve(256 + rings.size() * 4096);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"heartpy\"}}";
+    char buf[160];
+    for (size_t ri = 0; ri < rings.size(); ++ri) {
+        ThreadRing& r = *rings[ri];
+        if (!names[ri].empty()) {
+            out += ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            out += std::to_string(r.tid);
+            out += ",\"args\":{\"name\":\"";
+            appendEscaped(out, names[ri].c_str());
+            out += "\"}}";
+        }
+        const uint64_t h = r.head.load(std::memory_order_acquire);
+        // Slot h - N is the one the writer fills next (or is filling now), so
+        // it may hold a half-written event: the oldest dumped slot is h - N + 1
+        const uint64_t first = h >= kEventsPerThread ? h - kEventsPerThread + 1 : 0;
+        struct Copy { const char* name; uint64_t ts, dur; double value; uint32_t ph; };
+        std::vector<Copy> copies;
+        copies.reserve(static_cast<size_t>(h - first));
+        for (uint64_t i = first; i < h; ++i) {
+            const Event& e = r.events[i & (kEventsPerThread - 1)];
+            copies.push_back({e.name.load(std::memory_order_relaxed), e.ts.load(std::memory_order_relaxed),
+                              e.dur.load(std::memory_order_relaxed), e.value.load(std::memory_order_relaxed),
+                              e.phase.load(std::memory_order_relaxed)});
+        }
+        // Slots the writer lapped while we copied are stale
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t h2 = r.head.load(std::memory_order_relaxed);
+        const uint64_t valid = h2 >= kEventsPerThread ? h2 - kEventsPerThread + 1 : 0;
+        for (uint64_t i = std::max(first, valid); i < h; ++i) {
+            const Copy& c = copies[static_cast<size_t>(i - first)];
+            if (!c.name || c.ts < cutoff) continue;
+            if (c.ph == PH_COUNTER && !std::isfinite(c.value)) continue; // no JSON literal for NaN/Inf
+            out += ",{\"name\":\"";
+            appendEscaped(out, c.name);
+            switch (c.ph) {
+                case PH_COMPLETE:
+                    std::snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                  r.tid, c.ts / 1000.0, c.dur / 1000.0);
+                    break;
+                case PH_COUNTER:
+                    std::snprintf(buf, sizeof(buf), "\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.6g}}",
+                                  r.tid, c.ts / 1000.0, c.value);
+                    break;
+                default:
+                    std::snprintf(buf, sizeof(buf), "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                                  r.tid, c.ts / 1000.0);
+                    break;
+            }
+            out += buf;
+        }
+    }
+    out += "]}";
+    if (!flushed.empty()) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        dropExitedRings([&](const ThreadRing& r) {
+            return std::find(flushed.begin(), flushed.end(), &r) != flushed.end();
+        });
+    }
+    return out;
+}
+
+bool writeChromeJson(const char* path) {
+    if (!path) return false;
+    const std::string json = chromeJson();
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const bool ok = std::fwrite(json.data(), 1, json.size(), f) == json.size();
+    return (std::fclose(f) == 0) && ok;
+}
+
+} // namespace trace
+} // namespace heartpy
+
+extern "C" {
+void hp_trace_enable(int on) { heartpy::trace::setEnabled(on != 0); }
+int hp_trace_write(const char* path) { return heartpy::trace::writeChromeJson(path) ? 1 : 0; }
+void hp_trace_clear(void) { heartpy::trace::clear(); }
+}
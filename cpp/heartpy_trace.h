@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Low-overhead timeline recorder for the analysis pipeline, exported as
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Each thread records into its own fixed-size ring buffer, allocated on its
+// first event while recording is on. After the thread exits the ring is kept
+// until one dump has included it (or clear() hid its events), then freed.
+// Writers never lock: events are published with a release store of the ring
+// head. A dump copies every ring and drops slots that were overwritten while
+// it read them, plus the one slot the writer may be filling. Old events are overwritten once a ring is full.
+//
+// Recording is off by default. While it is off, every hook costs one relaxed
+// atomic load. Event names must be string literals (or otherwise outlive the
+// dump): only the pointer is stored. Build with HEARTPY_TRACE=0 to compile
+// all hooks out.
+#if !defined(HEARTPY_TRACE)
+#define HEARTPY_TRACE 1
+#endif
+
+namespace heartpy {
+namespace trace {
+
+namespace detail { extern std::atomic<bool> g_enabled; }
+
+inline bool enabled() {
+#if HEARTPY_TRACE
+    return detail::g_enabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+void setEnabled(bool on);
+
+// Monotonic nanoseconds since the trace origin
+uint64_t nowNs();
+
+// Complete span [startNs, endNs] on the calling thread
+void complete(const char* name, uint64_t startNs, uint64_t endNs);
+// Counter sample (one track per name)
+void counter(const char* name, double value);
+// Zero-duration marker on the calling thread
+void instant(const char* name);
+// Label for the calling thread's track
+void setThreadName(const char* name);
+
+// Hide everything recorded so far from later dumps
+void clear();
+// Chrome trace JSON ({"traceEvents":[...]}) of all threads
+std::string chromeJson();
+bool writeChromeJson(const char* path);
+
+// Records the scope as a complete span when tracing is enabled at entry
+class Span {
+public:
+    explicit Span(const char* name) : name_(enabled() ? name : nullptr), t0_(name_ ? nowNs() : 0) {}
+    ~Span() { if (name_) complete(name_, t0_, nowNs()); }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+private:
+    const char* name_;
+    uint64_t t0_;
+};
+
+} // namespace trace
+} // namespace heartpy
+
+// Plain C bridge
+extern "C" {
+    void hp_trace_enable(int on);
+    // Writes Chrome trace JSON; returns 1 on success
+    int  hp_trace_write(const char* path);
+    void hp_trace_clear(void);
+}
@@ -0,0 +1,112 @@
+// DSP stage microbenchmarks on deterministic synthetic PPG/RR input.
+// Output: JSON Lines on stdout (see bench_util.h); progress on stderr.
+//   bench_filter_psd [--quick] [--filter welchPSD] > dsp.jsonl
+
+#include "heartpy_core.h"
+#include "heartpy_dsp.h"
+
+#include "bench_synth.h"
+#include "bench_util.h"
+
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_bench;
+
+int main(int argc, char** argv) {
+    const BenchConfig cfg = BenchConfig::fromArgs(argc, argv, "dsp");
+
+    SynthParams sp; sp.fs = 50.0;
+    const double fs = sp.fs;
+    const std::vector<double> ppg60 = synthPPG(60.0, sp);
+    const std::vector<double> ppg300 = synthPPG(300.0, sp);
+    const std::vector<double> rr300 = synthRR(300.0, sp);
+    const size_t n60 = ppg60.size();
+
+    for (int win : {static_cast<int>(0.75 * fs), static_cast<int>(2.0 * fs)}) {
+        runBench(cfg, "movingAverageDetrend", "win=" + std::to_string(win), n60, [&] {
+            doNotOptimize(movingAverageDetrend(ppg60, win));
+        });
+    }
+    for (int order : {2, 4}) {
+        runBench(cfg, "bandpassFilter", "order=" + std::to_string(order), n60, [&] {
+            doNotOptimize(bandpassFilter(ppg60, fs, 0.5, 5.0, order));
+        });
+    }
+    {
+        const std::vector<double> filtered = bandpassFilter(ppg60, fs, 0.5, 5.0, 2);
+        runBench(cfg, "fitPeaksHP", "60s", n60, [&] {
+            doNotOptimize(fitPeaksHP(filtered, fs, 40.0, 180.0));
+        });
+        const std::vector<float> filteredF(filtered.begin(), filtered.end());
+        runBench(cfg, "fitPeaksHP", "60s,f32", n60, [&] {
+            doNotOptimize(fitPeaksHP(filteredF, fs, 40.0, 180.0));
+        });
+        std::vector<double> acf;
+        const size_t n8 = static_cast<size_t>(8 * fs);
+        runBench(cfg, "estimateHRAutocorr", "8s", n8, [&] {
+            doNotOptimize(estimateHRAutocorr(filtered.data(), n8, fs, 35.0, 180.0, acf));
+        });
+    }
+    for (int win : {6, 12}) {
+        runBench(cfg, "hampelFilter", "win=" + std::to_string(win), n60, [&] {
+            doNotOptimize(hampelFilter(ppg60, win, 3.0));
+        });
+    }
+
+    // Welch PSD: powers of two take the compiled FFT, the rest the DFT path
+    {
+        ExecutionContext ctx;
+        for (int nfft : {64, 128, 256, 500, 512, 1000, 1024, 2048, 4096}) {
+            runBench(cfg, "welchPSD", "nfft=" + std::to_string(nfft), ppg300.size(), [&] {
+                doNotOptimize(welchPSD(ppg300, fs, nfft, 0.5, ctx));
+            });
+        }
+        const std::vector<float> ppg300f(ppg300.begin(), ppg300.end());
+        runBench(cfg, "welchPSD", "nfft=1024,f32", ppg300.size(), [&] {
+            doNotOptimize(welchPSD(ppg300f, fs, 1024, 0.5, ctx));
+        });
+        ExecutionContext det; det.deterministic = true;
+        runBench(cfg, "welchPSD", "nfft=256,dft", ppg300.size(), [&] {
+            doNotOptimize(welchPSD(ppg300, fs, 256, 0.5, det));
+        });
+    }
+
+    for (double lambda : {10.0, 1000.0}) {
+        runBench(cfg, "smoothRR_CG", "lambda=" + std::to_string(static_cast<int>(lambda)), rr300.size(), [&] {
+            doNotOptimize(smoothRR_CG(rr300, lambda));
+        });
+    }
+
+    {
+        Options opt;
+        ExecutionContext ctx;
+        runBench(cfg, "analyzeRRIntervals", "300s", rr300.size(), [&] {
+            doNotOptimize(analyzeRRIntervals(rr300, opt, ctx));
+        });
+        opt.breathingAsBpm = true;
+        runBench(cfg, "analyzeRRIntervals", "300s,breathing", rr300.size(), [&] {
+            doNotOptimize(analyzeRRIntervals(rr300, opt, ctx));
+        });
+    }
+    {
+        ExecutionContext ctx;
+        Options opt;
+        runBench(cfg, "analyzeSignal", "60s", n60, [&] {
+            doNotOptimize(analyzeSignal(ppg60, fs, opt, ctx));
+        });
+        opt.useHPThreshold = true;
+        runBench(cfg, "analyzeSignal", "60s,hpThreshold", n60, [&] {
+            doNotOptimize(analyzeSignal(ppg60, fs, opt, ctx));
+        });
+        runBench(cfg, "analyzeSignal", "300s,hpThreshold", ppg300.size(), [&] {
+            doNotOptimize(analyzeSignal(ppg300, fs, opt, ctx));
+        });
+        const std::vector<float> ppg300f(ppg300.begin(), ppg300.end());
+        runBench(cfg, "analyzeSignal", "300s,hpThreshold,f32", ppg300.size(), [&] {
+            doNotOptimize(analyzeSignal(ppg300f, fs, opt, ctx));
+        });
+    }
+    return 0;
+}
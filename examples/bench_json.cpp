@@ -0,0 +1,105 @@
+// Result serialization for the bridges: heartpy_json.h against the
+// ostringstream to_json the Android bridge used before, and the columnar
+// binary encoding (heartpy_columnar.h), on streaming results with a full
+// waveform.
+// Output: JSON Lines on stdout (see bench_util.h).
+//   bench_json [--quick] > json.jsonl
+
+#include "heartpy_columnar.h"
+#include "heartpy_json.h"
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_bench;
+
+namespace {
+
+// The previous bridge serializer (scalars, arrays, waveform, quality core)
+std::string legacyJson(const HeartMetrics& r) {
+    std::ostringstream os;
+    os << "{";
+    auto arr = [&](const char* k, const double* v, size_t n) {
+        os << "\"" << k << "\":[";
+        for (size_t i = 0; i < n; ++i) { if (i) os << ","; os << v[i]; }
+        os << "]";
+    };
+    auto arrI = [&](const char* k, const std::vector<int>& v) {
+        os << "\"" << k << "\":[";
+        for (size_t i = 0; i < v.size(); ++i) { if (i) os << ","; os << v[i]; }
+        os << "]";
+    };
+    auto kv = [&](const char* k, double v) { os << "\"" << k << "\":" << v; };
+    kv("bpm", r.bpm); os << ","; kv("sdnn", r.sdnn); os << ","; kv("rmssd", r.rmssd); os << ",";
+    kv("sdsd", r.sdsd); os << ","; kv("pnn20", r.pnn20); os << ","; kv("pnn50", r.pnn50); os << ",";
+    kv("sd1", r.sd1); os << ","; kv("sd2", r.sd2); os << ","; kv("lf", r.lf); os << ","; kv("hf", r.hf); os << ",";
+    arr("ibiMs", r.ibiMs.data(), r.ibiMs.size()); os << ",";
+    arr("rrList", r.rrList.data(), r.rrList.size()); os << ",";
+    arrI("peakList", r.peakList); os << ",";
+    arr("peakTimestamps", r.peakTimestamps.data(), r.peakTimestamps.size()); os << ",";
+    arr("waveform_values", r.waveform_values.data(), r.waveform_values.size()); os << ",";
+    arr("waveform_timestamps", r.waveform_timestamps.data(), r.waveform_timestamps.size()); os << ",";
+    os << "\"quality\":{";
+    kv("totalBeats", r.quality.totalBeats); os << ","; kv("rejectedBeats", r.quality.rejectedBeats); os << ",";
+    os << "\"goodQuality\":" << (r.quality.goodQuality ? "true" : "false");
+    os << ",\"snrDb\":" << r.quality.snrDb << ",\"confidence\":" << r.quality.confidence << ",\"f0Hz\":" << r.quality.f0Hz;
+    os << "}}";
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const BenchConfig cfg = BenchConfig::fromArgs(argc, argv, "json");
+
+    SynthParams sp; sp.fs = 30.0;
+    const std::vector<double> src = synthPPG(120.0, sp);
+    std::vector<float> x(src.begin(), src.end());
+    std::vector<double> ts(x.size());
+    for (size_t i = 0; i < ts.size(); ++i) ts[i] = 1.7e9 + static_cast<double>(i) / sp.fs; // epoch-style stamps
+
+    for (double windowSec : {10.0, 60.0}) {
+        const std::string w = "win=" + std::to_string(static_cast<int>(windowSec));
+        RealtimeAnalyzer a(sp.fs, Options{});
+        a.setWindowSeconds(windowSec);
+        a.setDisplayHz(sp.fs);
+        a.push(x.data(), ts.data(), x.size());
+        HeartMetrics m;
+        a.poll(m);
+        const size_t items = m.waveform_values.size() * 2 + m.ibiMs.size() + m.rrList.size() + 40;
+
+        runBench(cfg, "legacyOstream", w, items, [&] { doNotOptimize(legacyJson(m).size()); });
+        std::string buf;
+        runBench(cfg, "metricsJson", w, items, [&] {
+            buf.clear();
+            appendMetricsJson(buf, m);
+            doNotOptimize(buf.size());
+        });
+        JsonOptions fixed; fixed.waveformDecimals = 4;
+        runBench(cfg, "metricsJson", w + ",waveform=4dp", items, [&] {
+            buf.clear();
+            appendMetricsJson(buf, m, fixed);
+            doNotOptimize(buf.size());
+        });
+        std::vector<uint8_t> bin;
+        runBench(cfg, "encodeMetrics", w, items, [&] {
+            encodeMetrics(m, bin);
+            doNotOptimize(bin.data());
+        });
+        HeartMetrics decoded;
+        runBench(cfg, "decodeMetrics", w, items, [&] {
+            decodeMetrics(bin.data(), bin.size(), decoded);
+            doNotOptimize(decoded.bpm);
+        });
+        std::fprintf(stderr, "  %s: legacy %zu bytes, shortest %zu bytes, waveform 4dp %zu bytes, columnar %zu bytes\n",
+                     w.c_str(), legacyJson(m).size(), metricsJson(m).size(), metricsJson(m, fixed).size(), bin.size());
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// RealtimeAnalyzer push/poll benchmarks on deterministic synthetic PPG.
+// Output: JSON Lines on stdout (see bench_util.h). After the timed runs each
+// window configuration also prints a "latency" line with the analyzer's own
+// push/poll/PSD histograms (p50/p95/p99/max in microseconds).
+//   bench_poll_latency [--quick] [--filter poll] > rt.jsonl
+
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_bench;
+
+namespace {
+
+// Endless timestamped feed over a pre-generated synthetic recording
+struct Feed {
+    std::vector<float> x;
+    double fs;
+    size_t pos = 0;
+    unsigned long long emitted = 0;
+    std::vector<double> ts;
+
+    Feed(const std::vector<double>& src, double fs_) : x(src.begin(), src.end()), fs(fs_) {}
+
+    void pushBlock(RealtimeAnalyzer& a, size_t n) {
+        ts.resize(n);
+        if (pos + n > x.size()) pos = 0;
+        for (size_t i = 0; i < n; ++i) ts[i] = static_cast<double>(emitted + i) / fs;
+        a.push(x.data() + pos, ts.data(), n);
+        pos += n;
+        emitted += n;
+    }
+};
+
+void printLatency(const BenchConfig& cfg, const std::string& param, const RealtimeAnalyzer& a) {
+    static const struct { LatencyMetric m; const char* name; } kMetrics[] = {
+        {LatencyMetric::PUSH, "push"}, {LatencyMetric::POLL, "poll"}, {LatencyMetric::PSD, "psd"},
+    };
+    std::printf("{\"suite\":\"%s\",\"bench\":\"latency\",\"param\":\"%s\"", cfg.suite, param.c_str());
+    for (const auto& e : kMetrics) {
+        const LatencyHistogram& h = a.latencyHistogram(e.m);
+        std::printf(",\"%s\":{\"count\":%llu,\"mean_us\":%.2f,\"p50_us\":%.2f,\"p95_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}",
+                    e.name, static_cast<unsigned long long>(h.count()), h.meanUs(), h.percentileUs(0.50),
+                    h.percentileUs(0.95), h.percentileUs(0.99), h.maxUs());
+    }
+    std::printf("}\n");
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const BenchConfig cfg = BenchConfig::fromArgs(argc, argv, "realtime");
+
+    SynthParams sp; sp.fs = 30.0;
+    const double fs = sp.fs;
+    const std::vector<double> src = synthPPG(600.0, sp);
+
+    for (double windowSec : {10.0, 30.0, 60.0}) {
+        const std::string w = "win=" + std::to_string(static_cast<int>(windowSec));
+        Options opt; opt.useHPThreshold = true;
+        RealtimeAnalyzer a(fs, opt);
+        a.setWindowSeconds(windowSec);
+        Feed feed(src, fs);
+        HeartMetrics m;
+        // Fill the window once so every measurement runs at steady state
+        for (int i = 0; i < static_cast<int>(windowSec) + 2; ++i) { feed.pushBlock(a, static_cast<size_t>(fs)); a.poll(m); }
+
+        // push only: ingest cost per block size (poll keeps the buffer trimmed)
+        for (size_t block : {size_t(1), size_t(15), size_t(256)}) {
+            runBench(cfg, "push", w + ",block=" + std::to_string(block), block, [&] {
+                feed.pushBlock(a, block);
+            });
+            a.poll(m);
+        }
+        // One second of signal per call: push at camera cadence, then poll.
+        // The default update interval, clamp(windowSec * 0.08, 0.2, 0.5) s,
+        // is shorter than that, so every call emits one update
+        runBench(cfg, "push+poll", w + ",per_second", static_cast<size_t>(fs), [&] {
+            feed.pushBlock(a, static_cast<size_t>(fs / 2));
+            feed.pushBlock(a, static_cast<size_t>(fs) - static_cast<size_t>(fs / 2));
+            doNotOptimize(a.poll(m));
+        });
+        printLatency(cfg, w, a);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Out-of-core recording analysis (heartpy_recording.h) against a plain
+// sequential read of the same file, on a synthetic float32 recording.
+// Output: JSON Lines on stdout (see bench_util.h); progress on stderr.
+//   bench_recording [--quick] > recording.jsonl
+
+#include "heartpy_recording.h"
+
+#include "bench_synth.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_bench;
+
+int main(int argc, char** argv) {
+    const BenchConfig cfg = BenchConfig::fromArgs(argc, argv, "recording");
+
+    SynthParams sp; sp.fs = 50.0;
+    const double hours = cfg.repetitions < 5 ? 1.0 : 6.0;
+    const uint64_t n = static_cast<uint64_t>(hours * 3600.0 * sp.fs);
+    const std::string path = "bench_recording.f32";
+    {
+        PPGStream gen(sp);
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) { std::fprintf(stderr, "cannot write %s\n", path.c_str()); return 1; }
+        std::vector<float> buf(1 << 16);
+        for (uint64_t off = 0; off < n; off += buf.size()) {
+            const size_t k = static_cast<size_t>(std::min<uint64_t>(buf.size(), n - off));
+            gen.fill(buf.data(), k);
+            std::fwrite(buf.data(), sizeof(float), k, f);
+        }
+        std::fclose(f);
+    }
+    const std::string param = std::to_string(static_cast<int>(hours)) + "h@50Hz";
+
+    // Storage baseline: what a streaming reader costs without any analysis
+    std::vector<float> buf(1 << 16);
+    runBench(cfg, "readFile", param, static_cast<size_t>(n), [&] {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        double sum = 0.0;
+        size_t k = 0;
+        while ((k = std::fread(buf.data(), sizeof(float), buf.size(), f)) > 0) sum += buf[k - 1];
+        std::fclose(f);
+        doNotOptimize(sum);
+    });
+
+    SampleFile file(path, SampleFile::Format::FLOAT32);
+    ExecutionContext ctx; ctx.logEnabled = false;
+    const Options opt;
+    for (double chunkSec : {60.0, 300.0}) {
+        RecordingOptions ropt; ropt.chunkSec = chunkSec;
+        const unsigned long long rss0 = residentBytes();
+        RecordingResult last;
+        runBench(cfg, "analyzeRecording", param + ",chunk=" + std::to_string(static_cast<int>(chunkSec)) + "s",
+                 static_cast<size_t>(n), [&] {
+            last = analyzeRecording(file, sp.fs, opt, ropt, ctx);
+            doNotOptimize(last.beats);
+        });
+        std::fprintf(stderr, "  beats=%lld chunks=%llu bpm=%.2f sdnn=%.2f rss_growth=%.1f MB\n",
+                     static_cast<long long>(last.beats), static_cast<unsigned long long>(last.chunks),
+                     last.bpm, last.sdnn, (static_cast<double>(residentBytes()) - static_cast<double>(rss0)) / 1e6);
+    }
+    std::remove(path.c_str());
+    return 0;
+}
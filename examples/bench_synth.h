@@ -0,0 +1,124 @@
+#pragma once
+
+// Deterministic synthetic PPG / RR generator shared by the benchmarks.
+// Uses its own PRNG (splitmix64 + Box-Muller) instead of <random>
+// distributions, so the same seed yields the same inputs on every standard
+// library. The waveform goes through libm (sin, cos, log, exp, sqrt), so
+// the output is deterministic for a given libm, not across platforms.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace heartpy_bench {
+
+constexpr double kPi = 3.14159265358979323846;
+
+class SynthRng {
+public:
+    explicit SynthRng(uint64_t seed) : state_(seed) {}
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); } // [0,1)
+    double gaussian() {
+        if (haveSpare_) { haveSpare_ = false; return spare_; }
+        double u1 = uniform(), u2 = uniform();
+        if (u1 < 1e-300) u1 = 1e-300;
+        const double r = std::sqrt(-2.0 * std::log(u1));
+        const double th = 2.0 * kPi * u2;
+        spare_ = r * std::sin(th); haveSpare_ = true;
+        return r * std::cos(th);
+    }
+private:
+    uint64_t state_;
+    double spare_ = 0.0;
+    bool haveSpare_ = false;
+};
+
+struct SynthParams {
+    double fs = 50.0;
+    double bpm = 72.0;
+    double rsaDepth = 0.05;      // respiratory sinus arrhythmia, fraction of the mean RR
+    double breathHz = 0.25;
+    double rrJitter = 0.02;      // white RR jitter, fraction of the mean RR
+    double dicroticRatio = 0.35; // dicrotic notch wave amplitude relative to the systolic wave
+    double baselineAmp = 0.3;    // slow baseline wander (units of pulse amplitude)
+    double noiseStd = 0.03;
+    double offset = 512.0;       // ADC-like DC level
+    double scale = 100.0;
+    uint64_t seed = 0x5EED0001ULL;
+};
+
+// Endless RR generator (milliseconds): RSA-modulated mean RR plus jitter
+class RRStream {
+public:
+    explicit RRStream(const SynthParams& p = {}) : p_(p), rng_(p.seed ^ 0xA5A5A5A5ULL) {}
+    double next() {
+        const double meanRr = 60000.0 / p_.bpm;
+        const double resp = std::sin(2.0 * kPi * p_.breathHz * tMs_ / 1000.0);
+        const double v = meanRr * (1.0 + p_.rsaDepth * resp + p_.rrJitter * rng_.gaussian());
+        tMs_ += v;
+        return v;
+    }
+private:
+    SynthParams p_;
+    SynthRng rng_;
+    double tMs_ = 0.0;
+};
+
+// Endless PPG generator at p.fs: Gaussian systolic + dicrotic waves placed
+// on the RRStream beats, plus baseline wander and white noise. Generating in
+// pieces yields exactly the same samples as one long call, so soak runs of
+// any length need no looped buffer (and no splice artefact at the wrap).
+class PPGStream {
+public:
+    explicit PPGStream(const SynthParams& p = {}) : p_(p), rr_(p), noise_(p.seed) {}
+    double next() {
+        const double t = static_cast<double>(index_++) / p_.fs;
+        while (nextBeat_ < t + kAhead) { beats_.push_back(nextBeat_); nextBeat_ += rr_.next() / 1000.0; }
+        size_t drop = 0;
+        while (drop < beats_.size() && beats_[drop] < t - kBehind) ++drop;
+        beats_.erase(beats_.begin(), beats_.begin() + static_cast<std::ptrdiff_t>(drop));
+        double v = 0.0;
+        for (double tb : beats_) {
+            const double ds = (t - tb) / kSysW, dd = (t - tb - kDiaDelay) / kDiaW;
+            v += std::exp(-0.5 * ds * ds) + p_.dicroticRatio * std::exp(-0.5 * dd * dd);
+        }
+        const double base = p_.baselineAmp * std::sin(2.0 * kPi * 0.05 * t + 0.7);
+        return p_.offset + p_.scale * (v + base + p_.noiseStd * noise_.gaussian());
+    }
+    void fill(float* out, size_t n) { for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(next()); }
+    unsigned long long samplesEmitted() const { return index_; }
+private:
+    static constexpr double kSysW = 0.08, kDiaW = 0.12, kDiaDelay = 0.28; // seconds
+    static constexpr double kAhead = 4 * kDiaW, kBehind = kDiaDelay + 4 * kDiaW;
+    SynthParams p_;
+    RRStream rr_;
+    SynthRng noise_;
+    std::vector<double> beats_;
+    double nextBeat_ = 0.0;
+    unsigned long long index_ = 0;
+};
+
+// RR series in milliseconds covering at least `durationSec`
+inline std::vector<double> synthRR(double durationSec, const SynthParams& p = {}) {
+    RRStream gen(p);
+    std::vector<double> rr;
+    for (double t = 0.0; t < durationSec * 1000.0;) { rr.push_back(gen.next()); t += rr.back(); }
+    return rr;
+}
+
+// `durationSec` of PPGStream output
+inline std::vector<double> synthPPG(double durationSec, const SynthParams& p = {}) {
+    PPGStream gen(p);
+    std::vector<double> x(static_cast<size_t>(std::llround(durationSec * p.fs)));
+    for (double& v : x) v = gen.next();
+    return x;
+}
+
+} // namespace heartpy_bench
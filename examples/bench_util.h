@@ -0,0 +1,207 @@
+#pragma once
+
+// Minimal benchmark harness for the examples/ benchmark and soak executables.
+// Each result is one JSON object per line on stdout (JSON Lines), e.g.
+//   {"suite":"dsp","bench":"welchPSD","param":"nfft=256","samples":3000,
+//    "iters":812,"ns_per_call":...,"ns_per_call_min":...,"ns_per_sample":...,
+//    "msamples_per_s":...,"allocs_per_call":...,"bytes_per_call":...}
+// Human-readable progress goes to stderr so stdout stays machine-readable.
+//
+// Allocation counting replaces the global operator new/delete, so this header
+// must be included by exactly one translation unit per executable. In
+// HEARTPY_ALLOC_AUDIT builds the library's counters are used instead and each
+// record gains "alloc_sites"/"alloc_stages" with per-call attribution.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "heartpy_alloc_audit.h"
+#include "heartpy_core.h"
+#if defined(__linux__)
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace heartpy_bench {
+
+#if HEARTPY_ALLOC_AUDIT
+// Audit builds: the library owns operator new/delete; read its totals
+inline unsigned long long allocsSoFar() { return heartpy::alloc_audit::processTotals().allocs; }
+inline unsigned long long bytesSoFar() { return heartpy::alloc_audit::processTotals().bytes; }
+inline unsigned long long freesSoFar() { return heartpy::alloc_audit::processTotals().frees; }
+#else
+inline std::atomic<unsigned long long>& allocCount() { static std::atomic<unsigned long long> c{0}; return c; }
+inline std::atomic<unsigned long long>& allocBytes() { static std::atomic<unsigned long long> c{0}; return c; }
+inline std::atomic<unsigned long long>& freeCount() { static std::atomic<unsigned long long> c{0}; return c; }
+inline unsigned long long allocsSoFar() { return allocCount().load(std::memory_order_relaxed); }
+inline unsigned long long bytesSoFar() { return allocBytes().load(std::memory_order_relaxed); }
+inline unsigned long long freesSoFar() { return freeCount().load(std::memory_order_relaxed); }
+#endif
+// Allocations not yet freed (process-wide, includes static/one-time buffers)
+inline long long liveAllocations() {
+    return static_cast<long long>(allocsSoFar()) - static_cast<long long>(freesSoFar());
+}
+
+// Resident set size in bytes (0 where unsupported)
+inline unsigned long long residentBytes() {
+#if defined(__linux__)
+    unsigned long long pages = 0, resident = 0;
+    if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%llu %llu", &pages, &resident) != 2) resident = 0;
+        std::fclose(f);
+    }
+    return resident * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) return 0;
+    return info.resident_size;
+#else
+    return 0;
+#endif
+}
+
+// Defeats dead-code elimination of a benchmark result
+template <typename T>
+inline void doNotOptimize(const T& v) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(v) : "memory");
+#else
+    static volatile const void* sink; sink = &v;
+#endif
+}
+
+struct BenchConfig {
+    double minSeconds = 0.25;  // per repetition
+    int repetitions = 5;       // ns_per_call reports the median repetition
+    std::string filter;        // substring match on "bench/param"
+    const char* suite = "";
+
+    static BenchConfig fromArgs(int argc, char** argv, const char* suite) {
+        BenchConfig c; c.suite = suite;
+        for (int i = 1; i < argc; ++i) {
+            if (!std::strcmp(argv[i], "--quick")) { c.minSeconds = 0.02; c.repetitions = 3; }
+            else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) c.filter = argv[++i];
+            else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) c.minSeconds = std::atof(argv[++i]);
+            else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc) c.repetitions = std::max(1, std::atoi(argv[++i]));
+            else {
+                std::fprintf(stderr, "usage: %s [--quick] [--filter substr] [--min-time sec] [--reps n]\n", argv[0]);
+                std::exit(2);
+            }
+        }
+        return c;
+    }
+};
+
+// Per-call allocations of every site/stage touched since the last reset
+inline void printAllocAttribution(double calls) {
+    using namespace heartpy;
+    std::printf(",\"alloc_sites\":{");
+    bool first = true;
+    for (int i = 0; i < static_cast<int>(AllocSite::COUNT); ++i) {
+        const AllocCounters c = alloc_audit::site(static_cast<AllocSite>(i));
+        if (!c.calls) continue;
+        std::printf("%s\"%s\":{\"calls_per_call\":%.2f,\"allocs_per_call\":%.2f,\"bytes_per_call\":%.0f}",
+                    first ? "" : ",", alloc_audit::siteName(static_cast<AllocSite>(i)),
+                    c.calls / calls, c.allocs / calls, c.bytes / calls);
+        first = false;
+    }
+    std::printf("},\"alloc_stages\":{");
+    first = true;
+    for (int i = 0; i < StageTimings::COUNT; ++i) {
+        const AllocCounters c = alloc_audit::stage(i);
+        if (!c.calls) continue;
+        std::printf("%s\"%s\":{\"allocs_per_call\":%.2f,\"bytes_per_call\":%.0f}",
+                    first ? "" : ",", StageTimings::name(i), c.allocs / calls, c.bytes / calls);
+        first = false;
+    }
+    std::printf("}");
+}
+
+// Times fn() and prints one JSON line. samplesPerCall is the input length the
+// ns_per_sample / throughput figures are normalized by (0: omit them).
+template <typename Fn>
+inline void runBench(const BenchConfig& cfg, const char* bench, const std::string& param,
+                     size_t samplesPerCall, Fn&& fn) {
+    const std::string key = std::string(bench) + "/" + param;
+    if (!cfg.filter.empty() && key.find(cfg.filter) == std::string::npos) return;
+    using clock = std::chrono::steady_clock;
+
+    fn(); // warm-up: plan caches, scratch growth, page faults
+    // Calibrate the iteration count so one repetition lasts ~minSeconds
+    unsigned long long iters = 1;
+    for (;;) {
+        auto t0 = clock::now();
+        for (unsigned long long i = 0; i < iters; ++i) fn();
+        double s = std::chrono::duration<double>(clock::now() - t0).count();
+        if (s >= cfg.minSeconds * 0.5 || iters >= (1ULL << 30)) {
+            if (s > 0) iters = std::max<unsigned long long>(1, static_cast<unsigned long long>(iters * cfg.minSeconds / s));
+            break;
+        }
+        iters *= (s > 0 && s < cfg.minSeconds * 0.05) ? 10 : 2;
+    }
+
+    std::vector<double> perCall;
+    unsigned long long allocs = 0, bytes = 0;
+    heartpy::alloc_audit::reset();
+    for (int r = 0; r < cfg.repetitions; ++r) {
+        const unsigned long long a0 = allocsSoFar();
+        const unsigned long long b0 = bytesSoFar();
+        auto t0 = clock::now();
+        for (unsigned long long i = 0; i < iters; ++i) fn();
+        const double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        allocs += allocsSoFar() - a0;
+        bytes += bytesSoFar() - b0;
+        perCall.push_back(ns / static_cast<double>(iters));
+    }
+    std::vector<double> sorted = perCall;
+    std::sort(sorted.begin(), sorted.end());
+    const double med = sorted[sorted.size() / 2];
+    const double calls = static_cast<double>(iters) * cfg.repetitions;
+
+    std::printf("{\"suite\":\"%s\",\"bench\":\"%s\",\"param\":\"%s\",\"samples\":%zu,\"iters\":%llu,"
+                "\"ns_per_call\":%.1f,\"ns_per_call_min\":%.1f",
+                cfg.suite, bench, param.c_str(), samplesPerCall, iters, med, sorted.front());
+    if (samplesPerCall > 0) {
+        std::printf(",\"ns_per_sample\":%.3f,\"msamples_per_s\":%.3f",
+                    med / samplesPerCall, samplesPerCall * 1e3 / med);
+    }
+    std::printf(",\"allocs_per_call\":%.2f,\"bytes_per_call\":%.0f", allocs / calls, bytes / calls);
+    if (heartpy::alloc_audit::kEnabled) printAllocAttribution(calls);
+    std::printf("}\n");
+    std::fflush(stdout);
+    std::fprintf(stderr, "%-28s %-18s %12.1f ns/call %8.2f allocs/call\n", bench, param.c_str(), med, allocs / calls);
+}
+
+} // namespace heartpy_bench
+
+#if !HEARTPY_ALLOC_AUDIT
+// Counting global allocator (see header comment: one TU per executable)
+void* operator new(std::size_t n) {
+    heartpy_bench::allocCount().fetch_add(1, std::memory_order_relaxed);
+    heartpy_bench::allocBytes().fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return ::operator new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    try { return ::operator new(n); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    try { return ::operator new(n); } catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept {
+    if (p) heartpy_bench::freeCount().fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+#endif
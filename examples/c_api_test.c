@@ -0,0 +1,158 @@
+/* Drives the realtime analyzer through heartpy_c.h only, compiled as C: an
+ * analyzer created with every field group, one created with a narrow mask
+ * (groups left out must come back empty/NaN with the same BPM), a pooled
+ * handle, and untimestamped pushes that continue from t0. */
+
+#include "heartpy_c.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++g_failures;                                                         \
+        }                                                                         \
+    } while (0)
+
+enum { FS = 50, SECONDS = 40, N = FS * SECONDS, CAP = 4096 };
+
+static float g_x[N];
+static double g_x64[N];
+static double g_ts[N];
+
+typedef struct polled {
+    hp_rt_poll_buffers b;
+    int32_t peaks[CAP], peaksRaw[CAP], mask[CAP], rejected[CAP];
+    hp_rt_segment segments[64];
+    double peakTs[CAP], ibi[CAP], rr[CAP], waveV[CAP], waveT[CAP];
+    char warning[256];
+} polled;
+
+static void initBuffers(polled* p, uint32_t fields) {
+    memset(p, 0, sizeof(*p));
+    p->b.fields = fields;
+    p->b.peakList.data = p->peaks;
+    p->b.peakList.capacity = CAP;
+    p->b.peakTimestamps.data = p->peakTs;
+    p->b.peakTimestamps.capacity = CAP;
+    p->b.peakListRaw.data = p->peaksRaw;
+    p->b.peakListRaw.capacity = CAP;
+    p->b.binaryPeakMask.data = p->mask;
+    p->b.binaryPeakMask.capacity = CAP;
+    p->b.ibiMs.data = p->ibi;
+    p->b.ibiMs.capacity = CAP;
+    p->b.rrList.data = p->rr;
+    p->b.rrList.capacity = CAP;
+    p->b.waveformValues.data = p->waveV;
+    p->b.waveformValues.capacity = CAP;
+    p->b.waveformTimestamps.data = p->waveT;
+    p->b.waveformTimestamps.capacity = CAP;
+    p->b.binarySegments.data = p->segments;
+    p->b.binarySegments.capacity = 64;
+    p->b.rejectedIndices.data = p->rejected;
+    p->b.rejectedIndices.capacity = CAP;
+    p->b.warning = p->warning;
+    p->b.warningCapacity = sizeof(p->warning);
+}
+
+enum { PUSH_TS, PUSH_T0, PUSH_T0_F64 };
+
+/* Pushes the whole signal in 1 s batches; keeps the last result. The
+ * untimestamped modes pass the first timestamp once, then 0 (continue). */
+static void run(void* h, polled* p, int mode) {
+    size_t i;
+    int polls = 0;
+    for (i = 0; i < N; i += FS) {
+        int st;
+        const double t0 = i == 0 ? g_ts[0] : 0.0;
+        if (mode == PUSH_TS) hp_rt_push_ts(h, g_x + i, g_ts + i, FS);
+        else if (mode == PUSH_T0) hp_rt_push(h, g_x + i, FS, t0);
+        else hp_rt_push_f64(h, g_x64 + i, FS, t0);
+        st = hp_rt_poll_into(h, &p->b);
+        CHECK(st != HP_RT_POLL_ERROR && st != HP_RT_POLL_TRUNCATED);
+        if (st == HP_RT_POLL_OK) ++polls;
+    }
+    CHECK(polls > 0);
+}
+
+int main(void) {
+    const double pi = 3.14159265358979323846;
+    const uint32_t narrow = HP_RT_FIELD_QUALITY | HP_RT_FIELD_RR;
+    polled full, part, pooled, untimed;
+    int mode;
+    void* h;
+    void* pool;
+    size_t i;
+
+    for (i = 0; i < N; ++i) {
+        const double t = (double)i / FS;
+        const double phase = fmod(t * 72.0 / 60.0, 1.0);
+        g_x[i] = (float)(512.0 + 100.0 * exp(-pow((phase - 0.2) / 0.06, 2.0)) +
+                         30.0 * exp(-pow((phase - 0.5) / 0.1, 2.0)) + 5.0 * sin(2.0 * pi * 0.25 * t));
+        g_x64[i] = g_x[i];
+        g_ts[i] = 500.0 + t;
+    }
+
+    initBuffers(&full, HP_RT_FIELD_ALL);
+    h = hp_rt_create_fields(FS, HP_RT_FIELD_ALL);
+    CHECK(h != NULL);
+    hp_rt_set_window(h, 15.0);
+    run(h, &full, PUSH_TS);
+    hp_rt_destroy(h);
+    CHECK(fabs(full.b.scalars.bpm - 72.0) < 2.0);
+    CHECK(full.b.peakList.size > 0 && full.b.peakTimestamps.size == full.b.peakList.size);
+    CHECK(full.b.rrList.size > 0 && full.b.waveformValues.size > 0);
+    CHECK(full.b.scalars.rmssd > 0.0);
+
+    /* Same stream with only RR + quality requested */
+    initBuffers(&part, HP_RT_FIELD_ALL);
+    h = hp_rt_create_fields(FS, narrow);
+    hp_rt_set_window(h, 15.0);
+    run(h, &part, PUSH_TS);
+    hp_rt_destroy(h);
+    CHECK(part.b.scalars.bpm == full.b.scalars.bpm);
+    CHECK(part.b.scalars.snrDb == full.b.scalars.snrDb);
+    CHECK(part.b.rrList.size == full.b.rrList.size);
+    CHECK(part.b.peakList.size == 0 && part.b.peakTimestamps.size == 0);
+    CHECK(part.b.peakListRaw.size == 0 && part.b.waveformValues.size == 0);
+    CHECK(isnan(part.b.scalars.lf) && part.b.scalars.rmssd == 0.0);
+
+    /* Pooled handle; fields outside b.fields are left untouched */
+    pool = hp_rt_pool_create(2);
+    initBuffers(&pooled, narrow);
+    pooled.b.scalars.lf = 123.0;
+    h = hp_rt_pool_acquire_fields(pool, FS, HP_RT_FIELD_ALL, 15.0);
+    CHECK(h != NULL);
+    run(h, &pooled, PUSH_TS);
+    hp_rt_pool_release(pool, h);
+    hp_rt_pool_destroy(pool);
+    CHECK(pooled.b.scalars.bpm == 0.0 && pooled.b.scalars.lf == 123.0);
+    CHECK(pooled.b.rrList.size == full.b.rrList.size);
+    CHECK(pooled.b.scalars.snrDb == full.b.scalars.snrDb);
+    CHECK(pooled.b.peakList.size == 0);
+
+    /* Nominal timestamps from t0 match the timestamped stream */
+    for (mode = PUSH_T0; mode <= PUSH_T0_F64; ++mode) {
+        initBuffers(&untimed, HP_RT_FIELD_ALL);
+        h = hp_rt_create_fields(FS, HP_RT_FIELD_ALL);
+        hp_rt_set_window(h, 15.0);
+        run(h, &untimed, mode);
+        hp_rt_destroy(h);
+        CHECK(fabs(untimed.b.scalars.bpm - full.b.scalars.bpm) < 1e-6);
+        CHECK(untimed.b.peakList.size == full.b.peakList.size);
+        CHECK(untimed.b.peakTimestamps.size > 0 &&
+              fabs(untimed.b.peakTimestamps.data[0] - full.b.peakTimestamps.data[0]) < 1e-6);
+    }
+
+    if (g_failures) {
+        fprintf(stderr, "c_api_test: %d check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("c_api_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Replays a session capture (heartpy_capture.h) through a fresh analyzer.
+// Output: one JSON object per emitted result on stdout, summary on stderr.
+//   capture_replay session.hpcap [--speed N] > results.jsonl
+// Diff the output of two builds to check a change against a field capture.
+
+#include "heartpy_capture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+using namespace heartpy;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s capture.hpcap [--speed N]\n", argv[0]);
+        return 2;
+    }
+    ReplayOptions ropt;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--speed") && i + 1 < argc) ropt.speed = std::atof(argv[++i]);
+        else { std::fprintf(stderr, "unknown argument %s\n", argv[i]); return 2; }
+    }
+    uint64_t n = 0;
+    ropt.onResult = [&](const HeartMetrics& m) {
+        // %.17g keeps doubles exact, so equal lines mean bit-identical results
+        std::printf("{\"result\":%llu,\"bpm\":%.17g,\"confidence\":%.17g,\"snrDb\":%.17g,"
+                    "\"sdnn\":%.17g,\"rmssd\":%.17g,\"peaks\":%zu,\"goodQuality\":%s}\n",
+                    static_cast<unsigned long long>(n++), m.bpm, m.quality.confidence, m.quality.snrDb,
+                    m.sdnn, m.rmssd, m.peakList.size(), m.quality.goodQuality ? "true" : "false");
+    };
+    try {
+        const ReplayStats st = replayCapture(argv[1], ropt);
+        std::fprintf(stderr, "blocks=%llu samples=%llu polls=%llu results=%llu corrupt=%llu dropped=%llu state=%d truncated=%d\n",
+                     static_cast<unsigned long long>(st.blocks), static_cast<unsigned long long>(st.samples),
+                     static_cast<unsigned long long>(st.polls), static_cast<unsigned long long>(st.results),
+                     static_cast<unsigned long long>(st.corruptBlocks), static_cast<unsigned long long>(st.droppedSamples),
+                     st.stateRestored ? 1 : 0, st.truncated ? 1 : 0);
+        return (st.corruptBlocks || st.truncated || st.results != st.polls) ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
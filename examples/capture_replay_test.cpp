@@ -0,0 +1,131 @@
+// Session capture: replaying a capture through a fresh analyzer reproduces
+// every result of the live session exactly, including a capture started
+// mid-session (restored from its opening checkpoint) and setting changes.
+// The recorder splits pushes larger than its ring and reports write errors.
+
+#include "heartpy_capture.h"
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+namespace {
+
+std::vector<HeartMetrics> replay(const std::string& path, ReplayStats& st) {
+    std::vector<HeartMetrics> out;
+    ReplayOptions ropt;
+    ropt.onResult = [&](const HeartMetrics& m) { out.push_back(m); };
+    st = replayCapture(path, ropt);
+    return out;
+}
+
+} // namespace
+
+int main() {
+    heartpy_bench::SynthParams sp;
+    sp.fs = 30.0;
+    sp.bpm = 84.0;
+    const Stream s = makeStream(heartpy_bench::synthPPG(120.0, sp), sp.fs);
+    const size_t third = s.x.size() / 3;
+    const std::string path = "capture_replay_test.hpcap";
+
+    Options opt;
+    opt.provisionalHR = true;
+    {
+        RealtimeAnalyzer live(sp.fs, opt);
+        live.setWindowSeconds(20.0);
+        pushAndPoll(live, s, 0, third, 12); // before the capture
+        auto rec = live.startCapture(path);
+        std::vector<HeartMetrics> expected = pushAndPoll(live, s, third, 2 * third, 12);
+        live.setWindowSeconds(12.0);
+        live.setUpdateIntervalSeconds(0.5);
+        // One push of 40 s, ingested (and captured) in slices
+        live.push(s.x.data() + 2 * third, s.ts.data() + 2 * third, s.x.size() - 2 * third);
+        HeartMetrics m;
+        if (live.poll(m)) expected.push_back(m);
+        live.stopCapture();
+        const CaptureRecorder::Stats rs = rec->stats();
+        HP_CHECK(rs.droppedBlocks == 0 && rs.writeErrors == 0);
+        HP_CHECK(expected.size() > 40);
+
+        ReplayStats st;
+        const std::vector<HeartMetrics> replayed = replay(path, st);
+        HP_CHECK(st.stateRestored && !st.truncated && st.corruptBlocks == 0 && st.droppedSamples == 0);
+        HP_CHECK(st.polls == expected.size() && st.results == st.polls);
+        checkSamePolls(expected, replayed, "replay");
+    }
+
+    // A damaged block is skipped and reported, not replayed: flip a byte in
+    // the opening checkpoint, the first block after the header
+    std::FILE* f = std::fopen(path.c_str(), "r+b");
+    HP_CHECK(f != nullptr);
+    if (f) {
+        const long at = static_cast<long>(sizeof(CaptureHeader) + ((sizeof(Options) + 7) & ~size_t(7)) +
+                                          sizeof(CaptureBlockHeader) + 64);
+        std::fseek(f, at, SEEK_SET);
+        const int c = std::fgetc(f);
+        std::fseek(f, at, SEEK_SET);
+        std::fputc(c ^ 0x5A, f);
+        std::fclose(f);
+        ReplayStats st;
+        replay(path, st);
+        HP_CHECK(st.corruptBlocks == 1 && !st.stateRestored);
+    }
+
+    // A push far larger than the ring is split into blocks the ring can take.
+    // The writer may not keep up, but whatever was queued decodes exactly and
+    // the rest is accounted for as dropped.
+    {
+        const size_t n = s.x.size();
+        CaptureRecorder rec(path, sp.fs, opt, 4096);
+        rec.recordPush(SampleView<float>(s.x), SampleView<double>(s.ts));
+        rec.stop();
+        const CaptureRecorder::Stats rs = rec.stats();
+        HP_CHECK(rs.writeErrors == 0);
+        HP_CHECK(rs.samples > 0 && rs.blocks > 0);
+        HP_CHECK(rs.samples + rs.droppedSamples == n);
+
+        CaptureReader reader(path);
+        CaptureReader::Block b;
+        std::vector<double> ts;
+        uint64_t samples = 0, dropped = 0, blocks = 0;
+        bool firstMatches = false;
+        while (reader.next(b)) {
+            HP_CHECK(b.checksumOk);
+            if (b.kind == CaptureBlock::DROPPED) { dropped += CaptureReader::dropped(b); continue; }
+            HP_CHECK(b.kind == CaptureBlock::SAMPLES_TS);
+            const SampleView<float> x = CaptureReader::samples(b);
+            HP_CHECK(x.size() == b.count && CaptureReader::timestamps(b, ts) && ts.size() == b.count);
+            HP_CHECK(b.count < n);
+            // The first piece always fits the empty ring
+            if (blocks++ == 0) {
+                firstMatches = x.size() > 0 && sameSeq(std::vector<float>(x.begin(), x.end()),
+                                                       std::vector<float>(s.x.begin(), s.x.begin() + x.size())) &&
+                               sameSeq(ts, std::vector<double>(s.ts.begin(), s.ts.begin() + ts.size()));
+            }
+            samples += b.count;
+        }
+        HP_CHECK(!reader.truncated() && firstMatches);
+        HP_CHECK(blocks == rs.blocks && samples == rs.samples && dropped == rs.droppedSamples);
+    }
+
+#if defined(__linux__)
+    // Writes that fail reach the stats instead of vanishing
+    {
+        CaptureRecorder rec("/dev/full", sp.fs, opt);
+        rec.recordPush(SampleView<float>(s.x), SampleView<double>(s.ts));
+        rec.stop();
+        HP_CHECK(rec.stats().writeErrors > 0);
+    }
+#endif
+
+    std::remove(path.c_str());
+    return finish("capture_replay_test");
+}
@@ -0,0 +1,83 @@
+// Writes the columnar result fixture decoded by the RN bridge tests: one
+// streaming result encoded with encodeMetrics (heartpy_columnar.h) and the
+// same result as metricsJson, which the test uses as the expected values.
+// Timings, allocation counts, a warning and a NaN are filled in with fixed
+// values so every column is populated and the output is reproducible.
+//   columnar_fixture react-native-heartpy/__tests__/fixtures/result_buffer
+// writes result_buffer.bin and result_buffer.json.
+
+#include "heartpy_columnar.h"
+#include "heartpy_json.h"
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+
+namespace {
+
+bool writeFile(const std::string& path, const void* data, size_t size) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = std::fwrite(data, 1, size, f) == size;
+    return (std::fclose(f) == 0) && ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <output prefix>\n", argv[0]);
+        return 2;
+    }
+    const std::string prefix = argv[1];
+
+    heartpy_bench::SynthParams sp;
+    sp.fs = 25.0;
+    sp.bpm = 75.0;
+    const std::vector<double> signal = heartpy_bench::synthPPG(30.0, sp);
+    RealtimeAnalyzer rt(sp.fs);
+    rt.setWindowSeconds(10.0);
+    rt.setDisplayHz(10.0);
+    HeartMetrics r;
+    bool have = false;
+    for (size_t i = 0; i < signal.size(); i += 25) {
+        const size_t n = std::min<size_t>(25, signal.size() - i);
+        std::vector<float> x(signal.begin() + i, signal.begin() + i + n);
+        std::vector<double> ts(n);
+        for (size_t k = 0; k < n; ++k) ts[k] = 1700000000.0 + static_cast<double>(i + k) / sp.fs;
+        rt.push(x.data(), ts.data(), n);
+        HeartMetrics m;
+        if (rt.poll(m)) { r = std::move(m); have = true; }
+    }
+    if (!have || r.peakList.empty() || r.waveform_values.empty()) {
+        std::fprintf(stderr, "columnar_fixture: no usable result\n");
+        return 1;
+    }
+
+    r.lf = std::numeric_limits<double>::quiet_NaN();
+    r.quality.qualityWarning = "Fixture warning";
+    r.timings.valid = true;
+    r.timings.allocsValid = true;
+    for (int s = 0; s < StageTimings::COUNT; ++s) {
+        r.timings.us[s] = 10.25 * (s + 1);
+        r.timings.allocs[s] = static_cast<uint64_t>(s % 3);
+    }
+
+    std::vector<uint8_t> bin;
+    encodeMetrics(r, bin);
+    const std::string json = metricsJson(r);
+    if (!writeFile(prefix + ".bin", bin.data(), bin.size()) || !writeFile(prefix + ".json", json.data(), json.size())) {
+        std::fprintf(stderr, "columnar_fixture: cannot write %s.{bin,json}\n", prefix.c_str());
+        return 1;
+    }
+    std::printf("%s.bin: %zu bytes, %zu peaks, %zu waveform samples\n", prefix.c_str(), bin.size(),
+                r.peakList.size(), r.waveform_values.size());
+    return 0;
+}
@@ -0,0 +1,277 @@
+// Streaming latency / soak harness for RealtimeAnalyzer.
+//
+// Runs one producer thread (push) and one poller thread (poll) per analyzer.
+// Input is synthetic camera-rate PPG with per-frame timestamp jitter and
+// periodic timestamp backtracks. The feed runs faster than real time: the
+// producer only waits when it gets more than --lead seconds of stream time
+// ahead of the last emitted update.
+//
+// Default is a short smoke run (2 analyzers x 30 fps x 10 simulated minutes).
+// A full soak:
+//   concurrency_smoke --fps 30,60,120,240 --hours 24 > soak.jsonl
+//
+// Output is JSON Lines on stdout:
+// - one "analyzer" record per instance: push/poll latency, time to first
+//   BPM, allocations per update;
+// - one "memory" record per sample of RSS and live heap allocations;
+// - one final "summary" record.
+// Exits 1 when an analyzer never reports a BPM, or when RSS or live
+// allocations keep growing after warm-up beyond the tolerances.
+
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "bench_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_bench;
+
+namespace {
+
+struct SoakConfig {
+    std::vector<double> fpsList{30.0};
+    int analyzersPerFps = 2;
+    double hours = 10.0 / 60.0;       // simulated stream duration
+    double windowSec = 20.0;
+    double jitterMs = 2.0;            // per-frame timestamp jitter (std dev)
+    int backtrackEvery = 5000;        // frames between timestamp backtracks (0: off)
+    double backtrackMs = 40.0;
+    size_t blockFrames = 0;           // frames per push (0: ~1/15 s like camera callbacks)
+    double leadSec = 1.1;             // max stream time the producer may run ahead of the last update
+    double warmupFraction = 0.2;      // memory baseline is taken after this share of the run
+    double rssToleranceMb = 16.0;
+    long long liveAllocTolerance = 4096;
+    int memorySamples = 40;
+};
+
+std::vector<double> parseList(const char* s) {
+    std::vector<double> out;
+    std::stringstream ss(s);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) if (!tok.empty()) out.push_back(std::atof(tok.c_str()));
+    return out;
+}
+
+SoakConfig parseArgs(int argc, char** argv) {
+    SoakConfig c;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", argv[i]); std::exit(2); }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--fps")) c.fpsList = parseList(next());
+        else if (!std::strcmp(argv[i], "--analyzers")) c.analyzersPerFps = std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--hours")) c.hours = std::atof(next());
+        else if (!std::strcmp(argv[i], "--window")) c.windowSec = std::atof(next());
+        else if (!std::strcmp(argv[i], "--jitter-ms")) c.jitterMs = std::atof(next());
+        else if (!std::strcmp(argv[i], "--backtrack-every")) c.backtrackEvery = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--block")) c.blockFrames = static_cast<size_t>(std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--lead")) c.leadSec = std::atof(next());
+        else if (!std::strcmp(argv[i], "--rss-tolerance-mb")) c.rssToleranceMb = std::atof(next());
+        else if (!std::strcmp(argv[i], "--live-alloc-tolerance")) c.liveAllocTolerance = std::atoll(next());
+        else {
+            std::fprintf(stderr,
+                "usage: %s [--fps 30,60,120,240] [--analyzers n] [--hours h] [--window sec]\n"
+                "          [--jitter-ms ms] [--backtrack-every frames] [--block frames] [--lead sec]\n"
+                "          [--rss-tolerance-mb mb] [--live-alloc-tolerance n]\n", argv[0]);
+            std::exit(2);
+        }
+    }
+    if (c.fpsList.empty() || c.hours <= 0.0) { std::fprintf(stderr, "invalid --fps/--hours\n"); std::exit(2); }
+    c.leadSec = std::max(1.05, c.leadSec); // must exceed the 1 s update interval or push/poll deadlock
+    return c;
+}
+
+struct Session {
+    int id = 0;
+    double fs = 30.0;
+    std::unique_ptr<RealtimeAnalyzer> analyzer;
+    std::unique_ptr<PPGStream> signal;
+    std::atomic<double> pushedUntil{0.0};    // stream seconds pushed so far
+    std::atomic<double> polledUntil{0.0};    // stream seconds covered by the last update
+    std::atomic<bool> producerDone{false};
+    // Poller-owned results
+    LatencyHistogram emitLatency;            // polls that produced an update
+    unsigned long long updates = 0;
+    unsigned long long updatesWithBpm = 0;
+    double firstBpmStreamSec = -1.0;
+    double firstBpmWallMs = -1.0;
+    double lastBpm = 0.0;
+    unsigned long long backtracksInjected = 0;
+};
+
+void producer(const SoakConfig& cfg, Session& s) {
+    const double durationSec = cfg.hours * 3600.0;
+    const size_t block = cfg.blockFrames ? cfg.blockFrames : std::max<size_t>(1, static_cast<size_t>(std::lround(s.fs / 15.0)));
+    SynthRng rng(0xC0FFEEULL + static_cast<uint64_t>(s.id));
+    std::vector<float> x(block);
+    std::vector<double> ts(block);
+    unsigned long long frame = 0;
+    double lastTs = 0.0;
+    while (lastTs < durationSec) {
+        // Pace by analysis progress instead of the wall clock
+        while (lastTs - s.polledUntil.load(std::memory_order_acquire) > cfg.leadSec) std::this_thread::yield();
+        s.signal->fill(x.data(), block);
+        for (size_t i = 0; i < block; ++i, ++frame) {
+            double t = static_cast<double>(frame) / s.fs + cfg.jitterMs * 1e-3 * rng.gaussian();
+            if (cfg.backtrackEvery > 0 && frame > 0 && frame % static_cast<unsigned long long>(cfg.backtrackEvery) == 0) {
+                t = lastTs - cfg.backtrackMs * 1e-3;
+                ++s.backtracksInjected;
+            }
+            ts[i] = t;
+            lastTs = std::max(lastTs, t);
+        }
+        s.analyzer->push(x.data(), ts.data(), block);
+        s.pushedUntil.store(lastTs, std::memory_order_release);
+    }
+    s.producerDone.store(true, std::memory_order_release);
+}
+
+void poller(Session& s, std::chrono::steady_clock::time_point wall0) {
+    using Clock = std::chrono::steady_clock;
+    HeartMetrics m;
+    for (;;) {
+        const bool done = s.producerDone.load(std::memory_order_acquire);
+        const auto t0 = Clock::now();
+        if (s.analyzer->poll(m)) {
+            s.emitLatency.recordNs(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count()));
+            ++s.updates;
+            const double streamSec = m.waveform_timestamps.empty() ? s.pushedUntil.load() : m.waveform_timestamps.back();
+            if (std::isfinite(m.bpm) && m.bpm > 0.0) {
+                ++s.updatesWithBpm;
+                s.lastBpm = m.bpm;
+                if (s.firstBpmStreamSec < 0.0) {
+                    s.firstBpmStreamSec = streamSec;
+                    s.firstBpmWallMs = std::chrono::duration<double, std::milli>(Clock::now() - wall0).count();
+                }
+            }
+            s.polledUntil.store(streamSec, std::memory_order_release);
+        } else if (done) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+struct MemSample { double progress; unsigned long long rss; long long live; };
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const SoakConfig cfg = parseArgs(argc, argv);
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (double fps : cfg.fpsList) {
+        for (int k = 0; k < cfg.analyzersPerFps; ++k) {
+            auto s = std::make_unique<Session>();
+            s->id = static_cast<int>(sessions.size());
+            s->fs = fps;
+            SynthParams sp; sp.fs = fps; sp.seed += static_cast<uint64_t>(s->id);
+            s->signal = std::make_unique<PPGStream>(sp);
+            Options opt; opt.useHPThreshold = true;
+            s->analyzer = std::make_unique<RealtimeAnalyzer>(fps, opt);
+            s->analyzer->setWindowSeconds(cfg.windowSec);
+            s->analyzer->executionContext().logEnabled = false; // diagnostics would dominate the timings
+            sessions.push_back(std::move(s));
+        }
+    }
+
+    const unsigned long long allocs0 = allocsSoFar();
+    const auto wall0 = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& s : sessions) {
+        threads.emplace_back(producer, std::cref(cfg), std::ref(*s));
+        threads.emplace_back(poller, std::ref(*s), wall0);
+    }
+
+    // Sample memory against the slowest session's stream progress
+    const double durationSec = cfg.hours * 3600.0;
+    std::vector<MemSample> mem;
+    double nextMark = 0.0;
+    for (;;) {
+        double progress = durationSec;
+        bool allDone = true;
+        for (auto& s : sessions) {
+            progress = std::min(progress, s->polledUntil.load());
+            allDone = allDone && s->producerDone.load();
+        }
+        progress = std::min(1.0, progress / durationSec);
+        if (progress >= nextMark || allDone) {
+            MemSample ms{progress, residentBytes(), liveAllocations()};
+            mem.push_back(ms);
+            std::printf("{\"suite\":\"soak\",\"bench\":\"memory\",\"progress\":%.3f,\"wall_s\":%.2f,\"rss_bytes\":%llu,\"live_allocs\":%lld}\n",
+                        ms.progress, std::chrono::duration<double>(Clock::now() - wall0).count(), ms.rss, ms.live);
+            std::fflush(stdout);
+            nextMark = progress + 1.0 / cfg.memorySamples;
+        }
+        if (allDone) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    for (auto& t : threads) t.join();
+    const double wallSec = std::chrono::duration<double>(Clock::now() - wall0).count();
+    const unsigned long long allocsTotal = allocsSoFar() - allocs0;
+
+    bool pass = true;
+    unsigned long long totalUpdates = 0;
+    for (auto& s : sessions) {
+        const LatencyHistogram& push = s->analyzer->latencyHistogram(LatencyMetric::PUSH);
+        const LatencyHistogram& psd = s->analyzer->latencyHistogram(LatencyMetric::PSD);
+        totalUpdates += s->updates;
+        const bool ok = s->firstBpmStreamSec >= 0.0;
+        pass = pass && ok;
+        std::printf("{\"suite\":\"soak\",\"bench\":\"analyzer\",\"id\":%d,\"fps\":%.0f,\"stream_s\":%.1f,\"updates\":%llu,"
+                    "\"updates_with_bpm\":%llu,\"last_bpm\":%.2f,\"ttfb_stream_s\":%.2f,\"ttfb_wall_ms\":%.1f,"
+                    "\"push\":{\"count\":%llu,\"mean_us\":%.2f,\"p50_us\":%.2f,\"p99_us\":%.2f,\"p999_us\":%.2f,\"max_us\":%.2f},"
+                    "\"poll\":{\"count\":%llu,\"mean_us\":%.2f,\"p50_us\":%.2f,\"p99_us\":%.2f,\"p999_us\":%.2f,\"max_us\":%.2f},"
+                    "\"psd_p99_us\":%.2f,\"backtracks_injected\":%llu,\"ok\":%s}\n",
+                    s->id, s->fs, s->pushedUntil.load(), s->updates, s->updatesWithBpm, s->lastBpm,
+                    s->firstBpmStreamSec, s->firstBpmWallMs,
+                    static_cast<unsigned long long>(push.count()), push.meanUs(), push.percentileUs(0.5),
+                    push.percentileUs(0.99), push.percentileUs(0.999), push.maxUs(),
+                    static_cast<unsigned long long>(s->emitLatency.count()), s->emitLatency.meanUs(),
+                    s->emitLatency.percentileUs(0.5), s->emitLatency.percentileUs(0.99),
+                    s->emitLatency.percentileUs(0.999), s->emitLatency.maxUs(),
+                    psd.percentileUs(0.99), s->backtracksInjected, ok ? "true" : "false");
+    }
+
+    // Memory must be flat after warm-up: compare the warm baseline with the
+    // highest value seen in the last quarter of the run
+    const MemSample* base = nullptr;
+    for (const auto& m : mem) if (m.progress >= cfg.warmupFraction) { base = &m; break; }
+    unsigned long long tailRss = 0; long long tailLive = 0;
+    for (const auto& m : mem) {
+        if (m.progress >= 0.75) { tailRss = std::max(tailRss, m.rss); tailLive = std::max(tailLive, m.live); }
+    }
+    double rssGrowthMb = 0.0; long long liveGrowth = 0;
+    bool memoryOk = true;
+    if (base) {
+        rssGrowthMb = (static_cast<double>(tailRss) - static_cast<double>(base->rss)) / (1024.0 * 1024.0);
+        liveGrowth = tailLive - base->live;
+        memoryOk = rssGrowthMb <= cfg.rssToleranceMb && liveGrowth <= cfg.liveAllocTolerance;
+    }
+    pass = pass && memoryOk;
+    std::printf("{\"suite\":\"soak\",\"bench\":\"summary\",\"analyzers\":%zu,\"hours\":%.3f,\"wall_s\":%.2f,"
+                "\"speedup\":%.1f,\"updates\":%llu,\"allocs_total\":%llu,\"allocs_per_update\":%.1f,"
+                "\"rss_growth_mb\":%.2f,\"live_alloc_growth\":%lld,\"memory_ok\":%s,\"pass\":%s}\n",
+                sessions.size(), cfg.hours, wallSec, durationSec / std::max(1e-9, wallSec), totalUpdates,
+                allocsTotal, totalUpdates ? static_cast<double>(allocsTotal) / totalUpdates : 0.0,
+                rssGrowthMb, liveGrowth, memoryOk ? "true" : "false", pass ? "true" : "false");
+    std::fflush(stdout);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// float32 analysis path: analyzeSignal on float samples and the streaming
+// Options::singlePrecision window agree with the double path on the same
+// (float-representable) input, within a tolerance for the float arithmetic.
+
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+#include <cmath>
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+namespace {
+
+bool near(double a, double b, double rel, double abs = 1e-12) {
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+    return std::fabs(a - b) <= std::max(abs, rel * std::max(std::fabs(a), std::fabs(b)));
+}
+
+void checkBatch(const std::vector<float>& x, double fs, const Options& opt, const char* what) {
+    const std::vector<double> xd(x.begin(), x.end());
+    const HeartMetrics d = analyzeSignal(xd, fs, opt);
+    const HeartMetrics f = analyzeSignal(x, fs, opt);
+    const bool samePeaks = d.peakList == f.peakList && d.binaryPeakMask == f.binaryPeakMask;
+    if (!samePeaks) std::fprintf(stderr, "%s: peak lists differ\n", what);
+    HP_CHECK(samePeaks);
+    HP_CHECK(!d.peakList.empty());
+    for (auto field : {&HeartMetrics::bpm, &HeartMetrics::sdnn, &HeartMetrics::rmssd, &HeartMetrics::pnn50,
+                       &HeartMetrics::sd1, &HeartMetrics::sd2}) {
+        HP_CHECK(near(d.*field, f.*field, 1e-9));
+    }
+    for (auto field : {&HeartMetrics::lf, &HeartMetrics::hf, &HeartMetrics::lfhf, &HeartMetrics::breathingRate}) {
+        HP_CHECK(near(d.*field, f.*field, 1e-6));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (double fs : {30.0, 60.0, 125.0}) {
+        for (double bpm : {55.0, 72.0, 130.0}) {
+            heartpy_bench::SynthParams sp;
+            sp.fs = fs;
+            sp.bpm = bpm;
+            sp.noiseStd = (bpm > 100.0) ? 0.15 : 0.03;
+            sp.seed = static_cast<uint64_t>(fs * 1000.0 + bpm);
+            const Stream s = makeStream(heartpy_bench::synthPPG(120.0, sp), fs);
+
+            // Batch: default pipeline plus the stages that widen to double
+            Options opt;
+            opt.calcFreq = true;
+            checkBatch(s.x, fs, opt, "default");
+            Options widened = opt;
+            widened.hampelCorrect = true;
+            widened.highPrecision = true;
+            widened.filterMode = Options::FilterMode::BUTTER_FILTFILT;
+            checkBatch(s.x, fs, widened, "hampel+highPrecision+filtfilt");
+
+            // Streaming
+            if (fs > 100.0) continue;
+            Options f32;
+            f32.singlePrecision = true;
+            RealtimeAnalyzer d(fs, Options{}), f(fs, f32);
+            d.setWindowSeconds(20.0);
+            f.setWindowSeconds(20.0);
+            const std::vector<HeartMetrics> pd = pushAndPoll(d, s, 0, s.x.size(), 10);
+            const std::vector<HeartMetrics> pf = pushAndPoll(f, s, 0, s.x.size(), 10);
+            HP_CHECK(pd.size() == pf.size() && pd.size() > 50);
+            size_t mismatches = 0;
+            for (size_t i = 0; i < std::min(pd.size(), pf.size()); ++i) {
+                const bool ok = pd[i].peakList == pf[i].peakList && near(pd[i].bpm, pf[i].bpm, 1e-9) &&
+                                near(pd[i].quality.snrDb, pf[i].quality.snrDb, 0.0, 1e-3) &&
+                                near(pd[i].quality.confidence, pf[i].quality.confidence, 0.0, 1e-4) &&
+                                sameSeq(pd[i].waveform_values, pf[i].waveform_values);
+                if (!ok && mismatches++ == 0) std::fprintf(stderr, "fs=%g bpm=%g: poll %zu differs\n", fs, bpm, i);
+            }
+            HP_CHECK(mismatches == 0);
+        }
+    }
+    return finish("float_path_test");
+}
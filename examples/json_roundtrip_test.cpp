@@ -0,0 +1,363 @@
+// metricsJson output parses as strict JSON and every number reads back as
+// exactly the value in the result (shortest round-trip formatting), with
+// non-finite values written as null. Covers batch, segmentwise and
+// streaming results, the field mask and rounded waveform decimals.
+
+#include "heartpy_json.h"
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+namespace {
+
+// Minimal strict JSON reader (RFC 8259; \u escapes limited to ASCII)
+struct Value {
+    enum Kind { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } kind = NUL;
+    bool b = false;
+    double num = 0.0;
+    std::string str;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> fields;
+
+    const Value* get(const char* key) const {
+        for (const auto& kv : fields) {
+            if (kv.first == key) return &kv.second;
+        }
+        return nullptr;
+    }
+};
+
+class Parser {
+public:
+    explicit Parser(const std::string& s) : p_(s.c_str()), end_(s.c_str() + s.size()) {}
+
+    bool parse(Value& v) {
+        if (!value(v)) return false;
+        ws();
+        return p_ == end_;
+    }
+
+private:
+    void ws() { while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_; }
+    bool lit(const char* s) {
+        const size_t n = std::strlen(s);
+        if (static_cast<size_t>(end_ - p_) < n || std::strncmp(p_, s, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+    bool string(std::string& out) {
+        if (p_ >= end_ || *p_ != '"') return false;
+        for (++p_; p_ < end_; ++p_) {
+            if (*p_ == '"') { ++p_; return true; }
+            if (static_cast<unsigned char>(*p_) < 0x20) return false;
+            if (*p_ == '\\') {
+                if (++p_ >= end_) return false;
+                switch (*p_) {
+                    case '"': case '\\': case '/': out += *p_; break;
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': {
+                        if (end_ - p_ < 5) return false;
+                        char hex[5] = {p_[1], p_[2], p_[3], p_[4], 0};
+                        char* stop = nullptr;
+                        const long cp = std::strtol(hex, &stop, 16);
+                        if (stop != hex + 4 || cp >= 0x80) return false;
+                        out += static_cast<char>(cp);
+                        p_ += 4;
+                        break;
+                    }
+                    default: return false;
+                }
+            } else {
+                out += *p_;
+            }
+        }
+        return false;
+    }
+    bool number(double& out) {
+        // JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        const char* s = p_;
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (p_ >= end_ || !std::isdigit(static_cast<unsigned char>(*p_))) return false;
+        if (*p_ == '0') ++p_;
+        else while (p_ < end_ && std::isdigit(static_cast<unsigned char>(*p_))) ++p_;
+        if (p_ < end_ && *p_ == '.') {
+            ++p_;
+            if (p_ >= end_ || !std::isdigit(static_cast<unsigned char>(*p_))) return false;
+            while (p_ < end_ && std::isdigit(static_cast<unsigned char>(*p_))) ++p_;
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (p_ >= end_ || !std::isdigit(static_cast<unsigned char>(*p_))) return false;
+            while (p_ < end_ && std::isdigit(static_cast<unsigned char>(*p_))) ++p_;
+        }
+        out = std::strtod(std::string(s, p_).c_str(), nullptr);
+        return true;
+    }
+    bool value(Value& v) {
+        ws();
+        if (p_ >= end_) return false;
+        switch (*p_) {
+            case 'n': v.kind = Value::NUL; return lit("null");
+            case 't': v.kind = Value::BOOL; v.b = true; return lit("true");
+            case 'f': v.kind = Value::BOOL; v.b = false; return lit("false");
+            case '"': v.kind = Value::STRING; return string(v.str);
+            case '[': {
+                v.kind = Value::ARRAY;
+                ++p_;
+                ws();
+                if (p_ < end_ && *p_ == ']') { ++p_; return true; }
+                for (;;) {
+                    v.items.emplace_back();
+                    if (!value(v.items.back())) return false;
+                    ws();
+                    if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                    if (p_ < end_ && *p_ == ']') { ++p_; return true; }
+                    return false;
+                }
+            }
+            case '{': {
+                v.kind = Value::OBJECT;
+                ++p_;
+                ws();
+                if (p_ < end_ && *p_ == '}') { ++p_; return true; }
+                for (;;) {
+                    ws();
+                    std::string key;
+                    if (!string(key)) return false;
+                    if (v.get(key.c_str())) return false; // duplicate key
+                    ws();
+                    if (p_ >= end_ || *p_ != ':') return false;
+                    ++p_;
+                    v.fields.emplace_back(std::move(key), Value());
+                    if (!value(v.fields.back().second)) return false;
+                    ws();
+                    if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                    if (p_ < end_ && *p_ == '}') { ++p_; return true; }
+                    return false;
+                }
+            }
+            default:
+                v.kind = Value::NUMBER;
+                return number(v.num);
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// Exact read-back: finite values as the same double, others as null
+bool matches(const Value* v, double expected) {
+    if (!v) return false;
+    if (!std::isfinite(expected)) return v->kind == Value::NUL;
+    return v->kind == Value::NUMBER && v->num == expected;
+}
+
+template <class Seq>
+bool matchesArray(const Value* v, const Seq& expected, double tolerance = 0.0) {
+    if (!v || v->kind != Value::ARRAY || v->items.size() != expected.size()) return false;
+    size_t i = 0;
+    for (const auto& e : expected) {
+        const double x = static_cast<double>(e);
+        const Value& item = v->items[i++];
+        if (tolerance > 0.0 && std::isfinite(x)) {
+            if (item.kind != Value::NUMBER || std::fabs(item.num - x) > tolerance) return false;
+        } else if (!matches(&item, x)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void reportContext(const char* what, int before) {
+    if (failures() != before) std::fprintf(stderr, "  (in %s)\n", what);
+}
+
+// Checks every field appendMetricsJson writes for r
+void checkResult(const HeartMetrics& r, const Value& o, const JsonOptions& jopt, const char* what) {
+    const int before = failures();
+    HP_CHECK(o.kind == Value::OBJECT);
+    if (jopt.wants(JsonOptions::FIELD_SCALARS)) {
+        HP_CHECK(matches(o.get("bpm"), r.bpm));
+        HP_CHECK(matches(o.get("sdnn"), r.sdnn) && matches(o.get("rmssd"), r.rmssd) && matches(o.get("sdsd"), r.sdsd));
+        HP_CHECK(matches(o.get("pnn20"), r.pnn20) && matches(o.get("pnn50"), r.pnn50));
+        HP_CHECK(matches(o.get("nn20"), r.nn20) && matches(o.get("nn50"), r.nn50) && matches(o.get("mad"), r.mad));
+        HP_CHECK(matches(o.get("sd1"), r.sd1) && matches(o.get("sd2"), r.sd2));
+        HP_CHECK(matches(o.get("sd1sd2Ratio"), r.sd1sd2Ratio) && matches(o.get("ellipseArea"), r.ellipseArea));
+        HP_CHECK(matches(o.get("vlf"), r.vlf) && matches(o.get("lf"), r.lf) && matches(o.get("hf"), r.hf));
+        HP_CHECK(matches(o.get("lfhf"), r.lfhf) && matches(o.get("totalPower"), r.totalPower));
+        HP_CHECK(matches(o.get("lfNorm"), r.lfNorm) && matches(o.get("hfNorm"), r.hfNorm));
+        HP_CHECK(matches(o.get("breathingRate"), r.breathingRate));
+    } else {
+        HP_CHECK(!o.get("bpm"));
+    }
+    if (jopt.wants(JsonOptions::FIELD_BEATS)) {
+        HP_CHECK(matchesArray(o.get("ibiMs"), r.ibiMs) && matchesArray(o.get("rrList"), r.rrList));
+        HP_CHECK(matchesArray(o.get("peakList"), r.peakList));
+        HP_CHECK(matchesArray(o.get("peakTimestamps"), r.peakTimestamps));
+    } else {
+        HP_CHECK(!o.get("peakList"));
+    }
+    if (jopt.wants(JsonOptions::FIELD_WAVEFORM)) {
+        // Rounded to d decimals: within half a unit of the last place
+        const double tol = jopt.waveformDecimals >= 0 ? 0.5000001 * std::pow(10.0, -jopt.waveformDecimals) : 0.0;
+        HP_CHECK(matchesArray(o.get("waveform_values"), r.waveform_values, tol));
+        HP_CHECK(matchesArray(o.get("waveform_timestamps"), r.waveform_timestamps, tol));
+    }
+    if (jopt.wants(JsonOptions::FIELD_PEAKS_RAW)) {
+        HP_CHECK(matchesArray(o.get("peakListRaw"), r.peakListRaw));
+        HP_CHECK(matchesArray(o.get("binaryPeakMask"), r.binaryPeakMask));
+    }
+    if (jopt.wants(JsonOptions::FIELD_QUALITY)) {
+        const Value* q = o.get("quality");
+        HP_CHECK(q && q->kind == Value::OBJECT);
+        if (q) {
+            const QualityInfo& e = r.quality;
+            HP_CHECK(matches(q->get("totalBeats"), e.totalBeats) && matches(q->get("rejectedBeats"), e.rejectedBeats));
+            HP_CHECK(matches(q->get("rejectionRate"), e.rejectionRate));
+            const Value* good = q->get("goodQuality");
+            HP_CHECK(good && good->kind == Value::BOOL && good->b == e.goodQuality);
+            HP_CHECK(matches(q->get("snrDb"), e.snrDb) && matches(q->get("confidence"), e.confidence));
+            HP_CHECK(matches(q->get("f0Hz"), e.f0Hz) && matches(q->get("maPercActive"), e.maPercActive));
+            HP_CHECK(matches(q->get("doublingFlag"), e.doublingFlag) && matches(q->get("softDoublingFlag"), e.softDoublingFlag));
+            HP_CHECK(matches(q->get("doublingHintFlag"), e.doublingHintFlag));
+            HP_CHECK(matches(q->get("hardFallbackActive"), e.hardFallbackActive));
+            HP_CHECK(matches(q->get("rrFallbackModeActive"), e.rrFallbackModeActive));
+            HP_CHECK(matches(q->get("snrWarmupActive"), e.snrWarmupActive));
+            HP_CHECK(matches(q->get("snrSampleCount"), e.snrSampleCount));
+            HP_CHECK(matches(q->get("refractoryMsActive"), e.refractoryMsActive));
+            HP_CHECK(matches(q->get("minRRBoundMs"), e.minRRBoundMs) && matches(q->get("pairFrac"), e.pairFrac));
+            HP_CHECK(matches(q->get("rrShortFrac"), e.rrShortFrac) && matches(q->get("rrLongMs"), e.rrLongMs));
+            HP_CHECK(matches(q->get("pHalfOverFund"), e.pHalfOverFund));
+            HP_CHECK(matches(q->get("provisionalActive"), e.provisionalActive));
+            HP_CHECK(matches(q->get("provisionalBpm"), e.provisionalBpm));
+            HP_CHECK(matches(q->get("provisionalConfidence"), e.provisionalConfidence));
+            const Value* warning = q->get("qualityWarning");
+            if (e.qualityWarning.empty()) HP_CHECK(!warning);
+            else HP_CHECK(warning && warning->kind == Value::STRING && warning->str == e.qualityWarning);
+        }
+    }
+    if (jopt.wants(JsonOptions::FIELD_TIMINGS)) {
+        const Value* t = o.get("timingsUs");
+        HP_CHECK(r.timings.valid == (t != nullptr));
+        if (t && r.timings.valid) {
+            HP_CHECK(t->fields.size() == static_cast<size_t>(StageTimings::COUNT));
+            for (int s = 0; s < StageTimings::COUNT; ++s) HP_CHECK(matches(t->get(StageTimings::name(s)), r.timings.us[s]));
+        }
+        const Value* a = o.get("stageAllocs");
+        HP_CHECK(r.timings.allocsValid == (a != nullptr));
+        if (a && r.timings.allocsValid) {
+            for (int s = 0; s < StageTimings::COUNT; ++s) {
+                HP_CHECK(matches(a->get(StageTimings::name(s)), static_cast<double>(r.timings.allocs[s])));
+            }
+        }
+    }
+    if (jopt.wants(JsonOptions::FIELD_BINARY_SEGMENTS)) {
+        const Value* b = o.get("binarySegments");
+        HP_CHECK(b && b->kind == Value::ARRAY && b->items.size() == r.binarySegments.size());
+        for (size_t i = 0; b && i < b->items.size() && i < r.binarySegments.size(); ++i) {
+            const Value& v = b->items[i];
+            const auto& e = r.binarySegments[i];
+            HP_CHECK(matches(v.get("index"), e.index) && matches(v.get("startBeat"), e.startBeat));
+            HP_CHECK(matches(v.get("endBeat"), e.endBeat) && matches(v.get("totalBeats"), e.totalBeats));
+            HP_CHECK(matches(v.get("rejectedBeats"), e.rejectedBeats));
+            HP_CHECK(v.get("accepted") && v.get("accepted")->b == e.accepted);
+        }
+    }
+    if (jopt.wants(JsonOptions::FIELD_SEGMENTS)) {
+        const Value* segs = o.get("segments");
+        HP_CHECK(segs && segs->kind == Value::ARRAY && segs->items.size() == r.segments.size());
+        JsonOptions inner = jopt;
+        inner.fields &= ~static_cast<uint32_t>(JsonOptions::FIELD_SEGMENTS);
+        for (size_t i = 0; segs && i < segs->items.size() && i < r.segments.size(); ++i) {
+            HP_CHECK(!segs->items[i].get("segments"));
+            checkResult(r.segments[i], segs->items[i], inner, what);
+        }
+    }
+    reportContext(what, before);
+}
+
+void roundTrip(const HeartMetrics& r, const JsonOptions& jopt, const char* what) {
+    // Appending after existing content must leave it alone
+    std::string out = "[";
+    appendMetricsJson(out, r, jopt);
+    out += ']';
+    Value doc;
+    const bool parsed = Parser(out).parse(doc);
+    HP_CHECK(parsed && doc.kind == Value::ARRAY && doc.items.size() == 1);
+    if (!parsed || doc.items.size() != 1) {
+        std::fprintf(stderr, "  (%s: not valid JSON)\n", what);
+        return;
+    }
+    HP_CHECK(metricsJson(r, jopt) == out.substr(1, out.size() - 2));
+    checkResult(r, doc.items[0], jopt, what);
+}
+
+} // namespace
+
+int main() {
+    heartpy_bench::SynthParams sp;
+    sp.fs = 50.0;
+    sp.bpm = 68.0;
+    const std::vector<double> signal = heartpy_bench::synthPPG(300.0, sp);
+
+    Options opt;
+    opt.profileStages = true;
+    opt.segmentWidth = 60.0;
+    const HeartMetrics batch = analyzeSignal(signal, sp.fs, opt);
+    HP_CHECK(batch.peakList.size() > 100 && batch.timings.valid);
+    roundTrip(batch, {}, "batch");
+
+    Options seg = opt;
+    seg.rejectSegmentwise = true;
+    const HeartMetrics segmentwise = analyzeSignalSegmentwise(signal, sp.fs, seg);
+    HP_CHECK(segmentwise.segments.size() >= 4);
+    roundTrip(segmentwise, {}, "segmentwise");
+
+    JsonOptions partial;
+    partial.fields = JsonOptions::FIELD_SCALARS | JsonOptions::FIELD_QUALITY | JsonOptions::FIELD_SEGMENTS;
+    roundTrip(segmentwise, partial, "field mask");
+
+    // Streaming results carry the waveform
+    const Stream s = makeStream(signal, sp.fs);
+    RealtimeAnalyzer rt(sp.fs, Options());
+    rt.setWindowSeconds(20.0);
+    const std::vector<HeartMetrics> polls = pushAndPoll(rt, s, 0, 60 * static_cast<size_t>(sp.fs), 25);
+    HP_CHECK(polls.size() > 20 && !polls.back().waveform_values.empty());
+    for (const HeartMetrics& m : polls) roundTrip(m, {}, "stream");
+    JsonOptions rounded;
+    rounded.waveformDecimals = 3;
+    roundTrip(polls.back(), rounded, "waveform decimals");
+
+    // Non-finite values become null; extremes and escapes survive
+    HeartMetrics odd = batch;
+    odd.bpm = std::numeric_limits<double>::quiet_NaN();
+    odd.lfhf = std::numeric_limits<double>::infinity();
+    odd.hf = -std::numeric_limits<double>::infinity();
+    odd.sdnn = std::numeric_limits<double>::denorm_min();
+    odd.rmssd = std::numeric_limits<double>::max();
+    odd.sdsd = -0.1;
+    odd.rrList.push_back(std::numeric_limits<double>::quiet_NaN());
+    odd.quality.snrDb = std::numeric_limits<double>::quiet_NaN();
+    odd.quality.qualityWarning = "quote \" backslash \\ newline \n";
+    roundTrip(odd, {}, "non-finite");
+    return finish("json_roundtrip_test");
+}
@@ -0,0 +1,106 @@
+// analyzeRecording: on 50 Hz PPG the peaks stitched across chunks equal one
+// analyzeSignal call over the same samples, for any chunk length, from
+// memory or from a mapped sample file. At 30 and 100 Hz each chunk's own
+// ma_perc fit can move a marginal beat; those rates are held to the bounds
+// documented in heartpy_recording.h instead.
+
+#include "heartpy_recording.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+namespace {
+
+bool samePeaks(const std::vector<int64_t>& stitched, const std::vector<int>& batch, const char* what) {
+    bool same = stitched.size() == batch.size();
+    for (size_t i = 0; same && i < stitched.size(); ++i) same = stitched[i] == batch[i];
+    if (!same) std::fprintf(stderr, "%s: %zu stitched peaks vs %zu from analyzeSignal\n", what, stitched.size(), batch.size());
+    return same;
+}
+
+// Tolerance for rates where chunks fit their own threshold: beat counts
+// within 0.2%, at most 2% of stitched beats off the whole-signal index, and
+// each of those within 0.15 s of a whole-signal beat (one unmatched beat per
+// 500 allowed)
+bool closePeaks(const std::vector<int64_t>& stitched, const std::vector<int>& batch, double fs, const char* what) {
+    const int64_t nb = static_cast<int64_t>(batch.size());
+    const int64_t countDiff = std::llabs(static_cast<int64_t>(stitched.size()) - nb);
+    int64_t moved = 0, unmatched = 0;
+    for (int64_t p : stitched) {
+        auto it = std::lower_bound(batch.begin(), batch.end(), p);
+        int64_t dist = INT64_MAX;
+        if (it != batch.end()) dist = std::min<int64_t>(dist, std::llabs(*it - p));
+        if (it != batch.begin()) dist = std::min<int64_t>(dist, std::llabs(*(it - 1) - p));
+        if (dist == 0) continue;
+        ++moved;
+        if (static_cast<double>(dist) / fs > 0.15) ++unmatched;
+    }
+    const bool ok = countDiff * 500 <= nb && moved * 50 <= nb && unmatched * 500 <= nb;
+    if (!ok) {
+        std::fprintf(stderr, "%s: %zu stitched vs %zu peaks, %lld moved, %lld beyond 0.15 s\n", what,
+                     stitched.size(), batch.size(), static_cast<long long>(moved), static_cast<long long>(unmatched));
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    const std::string path = "recording_test.f32";
+    for (double fs : {30.0, 50.0, 100.0}) {
+        const bool exact = fs == 50.0;
+        for (double bpm : {60.0, 95.0, 140.0}) {
+            heartpy_bench::SynthParams sp;
+            sp.fs = fs;
+            sp.bpm = bpm;
+            sp.seed = static_cast<uint64_t>(fs * 1000.0 + bpm);
+            const std::vector<double> x = heartpy_bench::synthPPG(600.0, sp);
+            const std::vector<float> xf(x.begin(), x.end());
+            const HeartMetrics whole = analyzeSignal(xf, fs);
+            HP_CHECK(whole.peakList.size() > 500);
+
+            RecordingOptions ropt;
+            ropt.keepPeaks = true;
+            uint64_t chunksSeen = 0;
+            for (double chunkSec : {45.0, 120.0, 300.0, 1000.0}) {
+                ropt.chunkSec = chunkSec;
+                ropt.onChunk = [&](const RecordingChunk&) { ++chunksSeen; };
+                chunksSeen = 0;
+                const RecordingResult r = analyzeRecording(SampleView<float>(xf), fs, Options{}, ropt);
+                if (exact) HP_CHECK(samePeaks(r.peaks, whole.peakList, "in memory"));
+                else HP_CHECK(closePeaks(r.peaks, whole.peakList, fs, "in memory"));
+                HP_CHECK(r.chunks == chunksSeen && r.failedChunks == 0);
+                HP_CHECK(r.samples == static_cast<int64_t>(xf.size()));
+                HP_CHECK(r.beats == static_cast<int64_t>(r.peaks.size()));
+            }
+
+            // Same samples through a mapped file, with a header to skip
+            std::FILE* f = std::fopen(path.c_str(), "wb");
+            HP_CHECK(f != nullptr);
+            if (!f) continue;
+            const float header[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            std::fwrite(header, sizeof(float), 4, f);
+            std::fwrite(xf.data(), sizeof(float), xf.size(), f);
+            std::fclose(f);
+            ropt.chunkSec = 120.0;
+            ropt.onChunk = nullptr;
+            const SampleFile file(path, SampleFile::Format::FLOAT32, sizeof(header));
+            const RecordingResult fromFile = analyzeRecording(file, fs, Options{}, ropt);
+            const RecordingResult fromMemory = analyzeRecording(SampleView<float>(xf), fs, Options{}, ropt);
+            HP_CHECK(fromFile.peaks == fromMemory.peaks);
+            if (exact) HP_CHECK(samePeaks(fromFile.peaks, whole.peakList, "mapped file"));
+            HP_CHECK(same(fromFile.sdnn, fromMemory.sdnn) && same(fromFile.rmssd, fromMemory.rmssd) &&
+                     same(fromFile.bpm, fromMemory.bpm));
+        }
+    }
+    std::remove(path.c_str());
+    return finish("recording_test");
+}
@@ -0,0 +1,74 @@
+// RealtimeAnalyzer::reset() and AnalyzerPool: an analyzer reset in place (or
+// recycled through the pool) after a session polls exactly what a freshly
+// constructed one does. Idle pooled analyzers export no metrics.
+
+#include "heartpy_metrics.h"
+#include "heartpy_pool.h"
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+#include <string>
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+namespace {
+
+// Series currently exported with analyzer="<id>"
+size_t exportedSeries(uint64_t id) {
+    const std::string label = std::to_string(id);
+    size_t n = 0;
+    for (const metrics::MetricSample& s : metrics::registry().collect()) {
+        for (const auto& kv : s.labels) {
+            if (kv.first == "analyzer" && kv.second == label) ++n;
+        }
+    }
+    return n;
+}
+
+} // namespace
+
+int main() {
+    heartpy_bench::SynthParams first, second;
+    first.fs = 50.0; first.bpm = 110.0; first.seed = 11;
+    second.fs = 30.0; second.bpm = 64.0; second.seed = 22;
+    const Stream a = makeStream(heartpy_bench::synthPPG(45.0, first), first.fs, 50.0);
+    const Stream b = makeStream(heartpy_bench::synthPPG(45.0, second), second.fs, 7000.0);
+
+    Options opt;
+    opt.provisionalHR = true;
+    RealtimeAnalyzer fresh(second.fs, opt);
+    fresh.setWindowSeconds(15.0);
+    const std::vector<HeartMetrics> expected = pushAndPoll(fresh, b, 0, b.x.size(), 15);
+    HP_CHECK(expected.size() > 20);
+
+    // Different fs, options and window in the first session
+    Options other;
+    other.singlePrecision = true;
+    RealtimeAnalyzer reused(first.fs, other);
+    reused.setWindowSeconds(30.0);
+    HP_CHECK(!pushAndPoll(reused, a, 0, a.x.size(), 25).empty());
+    reused.reset(second.fs, opt);
+    reused.setWindowSeconds(15.0);
+    checkSamePolls(expected, pushAndPoll(reused, b, 0, b.x.size(), 15), "reset");
+
+    // Pool: a recycled analyzer matches too (same capacity class, so the
+    // second checkout is a hit)
+    heartpy_bench::SynthParams third = first;
+    third.fs = second.fs;
+    const Stream c = makeStream(heartpy_bench::synthPPG(45.0, third), third.fs, 50.0);
+    AnalyzerPool pool(2);
+    auto p = pool.acquire(third.fs, other, 15.0);
+    pushAndPoll(*p, c, 0, c.x.size(), 25);
+    const uint64_t id = p->id();
+    HP_CHECK(exportedSeries(id) > 0);
+    pool.release(std::move(p));
+    HP_CHECK(exportedSeries(id) == 0);
+    p = pool.acquire(second.fs, opt, 15.0);
+    HP_CHECK(pool.stats().hits == 1 && p->id() == id);
+    HP_CHECK(exportedSeries(id) > 0);
+    checkSamePolls(expected, pushAndPoll(*p, b, 0, b.x.size(), 15), "pool hit");
+    return finish("reset_test");
+}
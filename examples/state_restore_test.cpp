@@ -0,0 +1,53 @@
+// saveState()/restoreState(): an analyzer restored from a checkpoint and fed
+// the rest of the stream polls exactly what the uninterrupted analyzer does.
+
+#include "heartpy_stream.h"
+
+#include "bench_synth.h"
+#include "test_util.h"
+
+using namespace heartpy;
+using namespace heartpy_test;
+
+int main() {
+    heartpy_bench::SynthParams sp;
+    sp.fs = 30.0;
+    const Stream s = makeStream(heartpy_bench::synthPPG(90.0, sp), sp.fs);
+    const size_t batch = 10, cut = 40 * 30; // checkpoint 40 s in, mid-window
+
+    for (bool f32 : {false, true}) {
+        Options opt;
+        opt.singlePrecision = f32;
+        RealtimeAnalyzer reference(sp.fs, opt);
+        reference.setWindowSeconds(20.0);
+        pushAndPoll(reference, s, 0, cut, batch);
+        const std::vector<HeartMetrics> expected = pushAndPoll(reference, s, cut, s.x.size(), batch);
+        HP_CHECK(expected.size() > 30);
+
+        RealtimeAnalyzer first(sp.fs, opt);
+        first.setWindowSeconds(20.0);
+        pushAndPoll(first, s, 0, cut, batch);
+        const std::vector<uint8_t> blob = first.saveState();
+
+        // Different construction parameters: the checkpoint carries them
+        RealtimeAnalyzer resumed(50.0);
+        HP_CHECK(resumed.restoreState(blob.data(), blob.size()));
+        checkSamePolls(expected, pushAndPoll(resumed, s, cut, s.x.size(), batch),
+                       f32 ? "restored (float32)" : "restored");
+
+        // The original keeps going unaffected by the save
+        checkSamePolls(expected, pushAndPoll(first, s, cut, s.x.size(), batch), "saved");
+
+        // Damaged blobs are rejected and leave the analyzer untouched
+        std::vector<uint8_t> bad = blob;
+        bad[bad.size() / 2] ^= 0x40;
+        RealtimeAnalyzer untouched(sp.fs, opt);
+        untouched.setWindowSeconds(20.0);
+        HP_CHECK(!untouched.restoreState(bad.data(), bad.size()));
+        HP_CHECK(!untouched.restoreState(blob.data(), blob.size() - 8));
+        RealtimeAnalyzer fresh(sp.fs, opt);
+        fresh.setWindowSeconds(20.0);
+        checkSamePolls(pushAndPoll(fresh, s, 0, cut, batch), pushAndPoll(untouched, s, 0, cut, batch), "rejected blob");
+    }
+    return finish("state_restore_test");
+}
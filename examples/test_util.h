@@ -0,0 +1,120 @@
+#pragma once
+
+// Shared helpers for the examples/*_test.cpp programs registered with ctest.
+// HP_CHECK prints and counts failures without stopping the test; main()
+// returns heartpy_test::finish(name), which is non-zero on any failure.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "heartpy_stream.h"
+
+namespace heartpy_test {
+
+inline int& failures() {
+    static int n = 0;
+    return n;
+}
+
+#define HP_CHECK(cond)                                                                  \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++heartpy_test::failures();                                                 \
+        }                                                                               \
+    } while (0)
+
+inline int finish(const char* name) {
+    if (failures()) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+// Bitwise-equal doubles (NaN equals NaN)
+inline bool same(double a, double b) { return (std::isnan(a) && std::isnan(b)) || a == b; }
+
+template <class A, class B>
+bool sameSeq(const A& a, const B& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!same(static_cast<double>(a[i]), static_cast<double>(b[i]))) return false;
+    }
+    return true;
+}
+
+// Name of the first field that differs between two results, nullptr if they
+// are identical. Stage timings are wall-clock and not compared.
+inline const char* firstDifference(const heartpy::HeartMetrics& a, const heartpy::HeartMetrics& b) {
+#define HP_SAME(field) if (!same(a.field, b.field)) return #field
+#define HP_SAME_SEQ(field) if (!sameSeq(a.field, b.field)) return #field
+    HP_SAME(bpm); HP_SAME(sdnn); HP_SAME(rmssd); HP_SAME(sdsd); HP_SAME(pnn20); HP_SAME(pnn50);
+    HP_SAME(nn20); HP_SAME(nn50); HP_SAME(mad); HP_SAME(sd1); HP_SAME(sd2); HP_SAME(sd1sd2Ratio);
+    HP_SAME(ellipseArea); HP_SAME(vlf); HP_SAME(lf); HP_SAME(hf); HP_SAME(lfhf); HP_SAME(totalPower);
+    HP_SAME(lfNorm); HP_SAME(hfNorm); HP_SAME(breathingRate);
+    HP_SAME_SEQ(ibiMs); HP_SAME_SEQ(rrList); HP_SAME_SEQ(peakList); HP_SAME_SEQ(peakTimestamps);
+    HP_SAME_SEQ(peakListRaw); HP_SAME_SEQ(binaryPeakMask);
+    HP_SAME_SEQ(waveform_values); HP_SAME_SEQ(waveform_timestamps);
+    HP_SAME(quality.totalBeats); HP_SAME(quality.rejectedBeats); HP_SAME(quality.rejectionRate);
+    HP_SAME(quality.goodQuality); HP_SAME(quality.snrDb); HP_SAME(quality.confidence); HP_SAME(quality.f0Hz);
+    HP_SAME(quality.maPercActive); HP_SAME(quality.doublingFlag); HP_SAME(quality.softDoublingFlag);
+    HP_SAME(quality.doublingHintFlag); HP_SAME(quality.hardFallbackActive); HP_SAME(quality.rrFallbackModeActive);
+    HP_SAME(quality.snrWarmupActive); HP_SAME(quality.refractoryMsActive); HP_SAME(quality.minRRBoundMs);
+    HP_SAME(quality.provisionalActive); HP_SAME(quality.provisionalBpm); HP_SAME(quality.provisionalConfidence);
+#undef HP_SAME
+#undef HP_SAME_SEQ
+    if (a.quality.qualityWarning != b.quality.qualityWarning) return "quality.qualityWarning";
+    return nullptr;
+}
+
+// Checks two poll sequences result by result; reports the first mismatch
+inline void checkSamePolls(const std::vector<heartpy::HeartMetrics>& expected,
+                           const std::vector<heartpy::HeartMetrics>& actual, const char* what) {
+    if (expected.size() != actual.size()) {
+        std::fprintf(stderr, "%s: %zu polls, expected %zu\n", what, actual.size(), expected.size());
+        ++failures();
+        return;
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (const char* field = firstDifference(expected[i], actual[i])) {
+            std::fprintf(stderr, "%s: poll %zu differs in %s\n", what, i, field);
+            ++failures();
+            return;
+        }
+    }
+}
+
+// Camera-like stream: float samples with timestamps that jitter around 1/fs
+struct Stream {
+    std::vector<float> x;
+    std::vector<double> ts;
+};
+
+inline Stream makeStream(const std::vector<double>& signal, double fs, double t0 = 1000.0) {
+    Stream s;
+    s.x.assign(signal.begin(), signal.end());
+    s.ts.resize(signal.size());
+    for (size_t i = 0; i < signal.size(); ++i) {
+        const double jitter = 0.1 * std::sin(0.37 * static_cast<double>(i));
+        s.ts[i] = t0 + (static_cast<double>(i) + jitter) / fs;
+    }
+    return s;
+}
+
+// Pushes s[begin, end) in batches, polling after each; returns emitted results
+inline std::vector<heartpy::HeartMetrics> pushAndPoll(heartpy::RealtimeAnalyzer& a, const Stream& s,
+                                                      size_t begin, size_t end, size_t batch) {
+    std::vector<heartpy::HeartMetrics> out;
+    for (size_t i = begin; i < end; i += batch) {
+        const size_t n = std::min(batch, end - i);
+        a.push(s.x.data() + i, s.ts.data() + i, n);
+        heartpy::HeartMetrics m;
+        if (a.poll(m)) out.push_back(std::move(m));
+    }
+    return out;
+}
+
+} // namespace heartpy_test
@@ -0,0 +1,87 @@
+import * as fs from 'fs';
+import * as path from 'path';
+import { RealtimeAnalyzer, decodeResultBuffer } from '../src/index';
+
+// Written by the native encoder: build/columnar_fixture __tests__/fixtures/result_buffer
+// (examples/columnar_fixture.cpp). The .json is metricsJson() of the same result.
+const FIXTURE = path.join(__dirname, 'fixtures', 'result_buffer');
+
+function fixtureBuffer(): ArrayBuffer {
+  const bytes = fs.readFileSync(FIXTURE + '.bin');
+  return bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.byteLength);
+}
+
+const expected = JSON.parse(fs.readFileSync(FIXTURE + '.json', 'utf8'));
+
+// metricsJson writes non-finite values as null
+const num = (v: number | null) => (v === null ? NaN : v);
+
+describe('columnar result buffer', () => {
+  it('decodes the native encoding to the values of the JSON path', () => {
+    const res: any = decodeResultBuffer(fixtureBuffer());
+    const scalars = ['bpm', 'sdnn', 'rmssd', 'sdsd', 'pnn20', 'pnn50', 'nn20', 'nn50', 'mad', 'sd1', 'sd2',
+      'sd1sd2Ratio', 'ellipseArea', 'vlf', 'lf', 'hf', 'lfhf', 'totalPower', 'lfNorm', 'hfNorm', 'breathingRate'];
+    for (const k of scalars) expect([k, res[k]]).toEqual([k, num(expected[k])]);
+    expect(res.lf).toBeNaN();
+    for (const k of ['ibiMs', 'rrList', 'peakList', 'peakTimestamps', 'peakListRaw', 'binaryPeakMask']) {
+      expect([k, res[k]]).toEqual([k, expected[k]]);
+    }
+    expect(res.peakList.length).toBeGreaterThan(0);
+    // Waveform travels as float32 (timestamps relative to the first one)
+    const t0 = expected.waveform_timestamps[0];
+    expect(res.waveform_values).toEqual(expected.waveform_values.map(Math.fround));
+    expect(res.waveform_timestamps).toEqual(expected.waveform_timestamps.map((t: number) => t0 + Math.fround(t - t0)));
+    expect(res.waveform_values.length).toBeGreaterThan(0);
+
+    const q = expected.quality;
+    const flags = ['doublingFlag', 'softDoublingFlag', 'doublingHintFlag', 'hardFallbackActive', 'rrFallbackModeActive'];
+    for (const k of Object.keys(q)) {
+      if (flags.includes(k)) expect([k, res.quality[k]]).toEqual([k, q[k] !== 0]);
+      else if (typeof q[k] === 'number' || q[k] === null) expect([k, res.quality[k]]).toEqual([k, num(q[k])]);
+      else expect([k, res.quality[k]]).toEqual([k, q[k]]);
+    }
+    expect(res.quality.qualityWarning).toBe('Fixture warning');
+    expect(res.timingsUs).toEqual(expected.timingsUs);
+    expect(res.stageAllocs).toEqual(expected.stageAllocs);
+  });
+
+  it('rejects a foreign buffer with HEARTPY_E112', () => {
+    const codeOf = (buf: ArrayBuffer) => {
+      try {
+        decodeResultBuffer(buf);
+      } catch (e: any) {
+        return e.code;
+      }
+      return undefined;
+    };
+    expect(codeOf(new ArrayBuffer(8))).toBe('HEARTPY_E112');
+    const foreign = fixtureBuffer();
+    new DataView(foreign).setUint32(0, 0, true);
+    expect(codeOf(foreign)).toBe('HEARTPY_E112');
+    const otherVersion = fixtureBuffer();
+    new DataView(otherVersion).setUint16(4, 1, true);
+    expect(codeOf(otherVersion)).toBe('HEARTPY_E112');
+    expect(codeOf(fixtureBuffer().slice(0, 200))).toBe('HEARTPY_E112');
+  });
+
+  it('JSI poll prefers __hpRtPollBinary', async () => {
+    const g: any = global as any;
+    g.__hpRtCreate = jest.fn(() => 7);
+    g.__hpRtPush = jest.fn();
+    g.__hpRtPushTs = jest.fn();
+    g.__hpRtPoll = jest.fn(() => null);
+    g.__hpRtPollBinary = jest.fn(() => fixtureBuffer());
+    g.__hpRtDestroy = jest.fn();
+    RealtimeAnalyzer.setConfig({ jsiEnabled: true });
+    const a = await RealtimeAnalyzer.create(50, {});
+    const res = await a.poll();
+    expect(g.__hpRtPollBinary).toHaveBeenCalledWith(7);
+    expect(g.__hpRtPoll).not.toHaveBeenCalled();
+    expect(res?.bpm).toBe(expected.bpm);
+    expect(res?.rrList).toEqual(expected.rrList);
+    g.__hpRtPollBinary = jest.fn(() => null);
+    await expect(a.poll()).resolves.toBeNull();
+    await a.destroy();
+    delete g.__hpRtPollBinary;
+  });
+});
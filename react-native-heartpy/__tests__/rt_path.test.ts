@@ -23,6 +23,51 @@ describe('RealtimeAnalyzer path selection', () => {
     await a.destroy();
   });
 
+  it('passes typed arrays to __hpRtPushTs without converting them', async () => {
+    g.__hpRtPushTs = jest.fn();
+    RealtimeAnalyzer.setConfig({ jsiEnabled: true, debug: false });
+    const a = await RealtimeAnalyzer.create(50, {});
+    const x64 = new Float64Array([1, 2, 3]);
+    const x32 = new Float32Array([1, 2, 3]);
+    const ts = new Float64Array([0, 0.02, 0.04]);
+    await a.pushWithTimestamps(x64, ts);
+    await a.pushWithTimestamps(x32, ts);
+    expect(g.__hpRtPushTs.mock.calls[0][1]).toBe(x64);
+    expect(g.__hpRtPushTs.mock.calls[0][2]).toBe(ts);
+    expect(g.__hpRtPushTs.mock.calls[1][1]).toBe(x32);
+    await a.destroy();
+  });
+
+  it('routes calls to the analyzer HostObject from __hpRtCreateObject', async () => {
+    const obj = {
+      push: jest.fn(),
+      pushTs: jest.fn(),
+      poll: jest.fn(),
+      pollBinary: jest.fn(() => null),
+      setWindow: jest.fn(),
+      destroy: jest.fn(),
+    };
+    g.__hpRtCreateObject = jest.fn(() => obj);
+    RealtimeAnalyzer.setConfig({ jsiEnabled: true, debug: false });
+    const a = await RealtimeAnalyzer.create(50, { windowSeconds: 20 });
+    expect(g.__hpRtCreateObject).toHaveBeenCalledWith(50, expect.anything());
+    expect(g.__hpRtCreate).not.toHaveBeenCalled();
+    expect(obj.setWindow).toHaveBeenCalledWith(20);
+    const x = new Float32Array([1, 2, 3]);
+    const ts = new Float64Array([0, 0.02, 0.04]);
+    await a.push(x, 5);
+    await a.pushWithTimestamps(x, ts);
+    await expect(a.poll()).resolves.toBeNull();
+    expect(obj.push).toHaveBeenCalledWith(x, 5);
+    expect(obj.pushTs).toHaveBeenCalledWith(x, ts);
+    expect(obj.pollBinary).toHaveBeenCalledTimes(1);
+    expect(g.__hpRtPush).not.toHaveBeenCalled();
+    await a.destroy();
+    expect(obj.destroy).toHaveBeenCalledTimes(1);
+    await expect(a.poll()).rejects.toThrow('RealtimeAnalyzer destroyed');
+    delete g.__hpRtCreateObject;
+  });
+
   it('falls back to NativeModules when jsiEnabled=false', async () => {
     const { NativeModules } = require('react-native');
     (NativeModules.HeartPyModule.installJSI as jest.Mock).mockReturnValue(true);
@@ -1,100 +1,33 @@
 #include <jni.h>
 #include <vector>
 #include <algorithm>
-#include <sstream>
 #include <string>
 #include <android/log.h>
 #include <unordered_map>
 #include <mutex>
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <jsi/jsi.h>
 #include "../../../../cpp/heartpy_core.h"
 // Realtime streaming API
 #include "../../../../cpp/heartpy_stream.h"
+#include "../../../../cpp/heartpy_json.h"
+#include "../../../../cpp/heartpy_columnar.h"
 // RN options validator (step 1)
 #include "../../cpp/rn_options_builder.h"
 
-static std::string to_json(const heartpy::HeartMetrics& r, bool includeSegments=false) {
-    std::ostringstream os;
-    os << "{";
-    auto arr = [&](const char* k, const std::vector<double>& v){
-        os << "\"" << k << "\":" << "[";
-        for (size_t i=0;i<v.size();++i){ if(i) os << ","; os << v[i]; }
-        os << "]";
-    };
-    auto arr_i = [&](const char* k, const std::vector<int>& v){
-        os << "\"" << k << "\":" << "[";
-        for (size_t i=0;i<v.size();++i){ if(i) os << ","; os << v[i]; }
-        os << "]";
-    };
-    auto kv = [&](const char* k, double v){ os << "\""<<k<<"\":"<<v; };
-    // scalars
-    kv("bpm", r.bpm); os << ",";
-    kv("sdnn", r.sdnn); os << ","; kv("rmssd", r.rmssd); os << ","; kv("sdsd", r.sdsd); os << ",";
-    kv("pnn20", r.pnn20); os << ","; kv("pnn50", r.pnn50); os << ","; kv("nn20", r.nn20); os << ","; kv("nn50", r.nn50); os << ","; kv("mad", r.mad); os << ",";
-    kv("sd1", r.sd1); os << ","; kv("sd2", r.sd2); os << ","; kv("sd1sd2Ratio", r.sd1sd2Ratio); os << ","; kv("ellipseArea", r.ellipseArea); os << ",";
-    kv("vlf", r.vlf); os << ","; kv("lf", r.lf); os << ","; kv("hf", r.hf); os << ","; kv("lfhf", r.lfhf); os << ","; kv("totalPower", r.totalPower); os << ","; kv("lfNorm", r.lfNorm); os << ","; kv("hfNorm", r.hfNorm); os << ",";
-    kv("breathingRate", r.breathingRate); os << ",";
-    // arrays
-    arr("ibiMs", r.ibiMs); os << ","; arr("rrList", r.rrList); os << ","; arr_i("peakList", r.peakList); os << ",";
-    // timestamps of detected peaks (if available)
-    arr("peakTimestamps", r.peakTimestamps); os << ",";
-    arr("waveform_values", r.waveform_values); os << ",";
-    arr("waveform_timestamps", r.waveform_timestamps); os << ",";
-    arr_i("peakListRaw", r.peakListRaw); os << ",";
-    arr_i("binaryPeakMask", r.binaryPeakMask); os << ",";
-    // quality
-    os << "\"quality\":{";
-    kv("totalBeats", r.quality.totalBeats); os << ","; kv("rejectedBeats", r.quality.rejectedBeats); os << ","; kv("rejectionRate", r.quality.rejectionRate); os << ",";
-    os << "\"goodQuality\":" << (r.quality.goodQuality ? "true" : "false");
-    // Streaming metrics (if available)
-    os << ",\"snrDb\":" << r.quality.snrDb;
-    os << ",\"confidence\":" << r.quality.confidence;
-    os << ",\"f0Hz\":" << r.quality.f0Hz;
-    os << ",\"maPercActive\":" << r.quality.maPercActive;
-    os << ",\"doublingFlag\":" << r.quality.doublingFlag;
-    os << ",\"softDoublingFlag\":" << r.quality.softDoublingFlag;
-    os << ",\"doublingHintFlag\":" << r.quality.doublingHintFlag;
-    os << ",\"hardFallbackActive\":" << r.quality.hardFallbackActive;
-    os << ",\"rrFallbackModeActive\":" << r.quality.rrFallbackModeActive;
-    os << ",\"snrWarmupActive\":" << r.quality.snrWarmupActive;
-    os << ",\"snrSampleCount\":" << r.quality.snrSampleCount;
-    os << ",\"refractoryMsActive\":" << r.quality.refractoryMsActive;
-    os << ",\"minRRBoundMs\":" << r.quality.minRRBoundMs;
-    os << ",\"pairFrac\":" << r.quality.pairFrac;
-    os << ",\"rrShortFrac\":" << r.quality.rrShortFrac;
-    os << ",\"rrLongMs\":" << r.quality.rrLongMs;
-    os << ",\"pHalfOverFund\":" << r.quality.pHalfOverFund;
-    if (!r.quality.qualityWarning.empty()) {
-        os << ",\"qualityWarning\":\"";
-        // naive string escape for quotes/backslashes
-        for (char c : r.quality.qualityWarning) { if (c=='"' || c=='\\') os << '\\'; os << c; }
-        os << "\"";
-    }
-    os << "}";
-    // binary segments
-    os << ",\"binarySegments\":[";
-    for (size_t i=0;i<r.binarySegments.size();++i){
-        if(i) os << ",";
-        const auto &bs = r.binarySegments[i];
-        os << "{"
-           << "\"index\":" << bs.index << ","
-           << "\"startBeat\":" << bs.startBeat << ","
-           << "\"endBeat\":" << bs.endBeat << ","
-           << "\"totalBeats\":" << bs.totalBeats << ","
-           << "\"rejectedBeats\":" << bs.rejectedBeats << ","
-           << "\"accepted\":" << (bs.accepted?"true":"false")
-           << "}";
-    }
-    os << "]";
-    if (includeSegments) {
-        os << ",\"segments\":[";
-        for (size_t i=0;i<r.segments.size();++i){ if(i) os << ","; os << to_json(r.segments[i], false); }
-        os << "]";
-    }
-    os << "}";
-    return os.str();
+// Results go to Java as JSON (parsed into a WritableMap there). The per-thread
+// buffer keeps its capacity, so steady-state polls do not reallocate it.
+static jstring metricsJString(JNIEnv* env, const heartpy::HeartMetrics& r, bool includeSegments = false,
+                              int waveformDecimals = -1) {
+    static thread_local std::string buf;
+    heartpy::JsonOptions jopt;
+    if (!includeSegments) jopt.fields &= ~static_cast<uint32_t>(heartpy::JsonOptions::FIELD_SEGMENTS);
+    jopt.waveformDecimals = waveformDecimals;
+    buf.clear();
+    heartpy::appendMetricsJson(buf, r, jopt);
+    return env->NewStringUTF(buf.c_str());
 }
 
 static heartpy::Options buildOptions(
@@ -276,6 +209,9 @@ struct TypedClassCache {
     jfieldID qualityRrShortFracField = nullptr;
     jfieldID qualityRrLongMsField = nullptr;
     jfieldID qualityPHalfOverFundField = nullptr;
+    jfieldID qualityProvisionalActiveField = nullptr;
+    jfieldID qualityProvisionalBpmField = nullptr;
+    jfieldID qualityProvisionalConfidenceField = nullptr;
     jfieldID qualityWarningField = nullptr;
 
     jclass binarySegmentCls = nullptr;
@@ -352,6 +288,9 @@ struct TypedClassCache {
         qualityRrShortFracField = env->GetFieldID(qualityCls, "rrShortFrac", "D");
         qualityRrLongMsField = env->GetFieldID(qualityCls, "rrLongMs", "D");
         qualityPHalfOverFundField = env->GetFieldID(qualityCls, "pHalfOverFund", "D");
+        qualityProvisionalActiveField = env->GetFieldID(qualityCls, "provisionalActive", "D");
+        qualityProvisionalBpmField = env->GetFieldID(qualityCls, "provisionalBpm", "D");
+        qualityProvisionalConfidenceField = env->GetFieldID(qualityCls, "provisionalConfidence", "D");
         qualityWarningField = env->GetFieldID(qualityCls, "qualityWarning", "Ljava/lang/String;");
 
         jclass localSegment = env->FindClass("com/heartpy/HeartPyModule$BinarySegmentTyped");
@@ -490,8 +429,7 @@ Java_com_heartpy_HeartPyModule_analyzeNativeJson(
             filterMode);
 
     auto res = heartpy::analyzeSignal(signal, fs, opt);
-    std::string json = to_json(res, false);
-    return env->NewStringUTF(json.c_str());
+    return metricsJString(env, res, false);
 }
 
 extern "C" JNIEXPORT jobject JNICALL
@@ -678,6 +616,9 @@ Java_com_heartpy_HeartPyModule_analyzeNativeTyped(
         env->SetDoubleField(qualityObj, cache.qualityRrShortFracField, q.rrShortFrac);
         env->SetDoubleField(qualityObj, cache.qualityRrLongMsField, q.rrLongMs);
         env->SetDoubleField(qualityObj, cache.qualityPHalfOverFundField, q.pHalfOverFund);
+        env->SetDoubleField(qualityObj, cache.qualityProvisionalActiveField, static_cast<double>(q.provisionalActive));
+        env->SetDoubleField(qualityObj, cache.qualityProvisionalBpmField, q.provisionalBpm);
+        env->SetDoubleField(qualityObj, cache.qualityProvisionalConfidenceField, q.provisionalConfidence);
         if (!q.qualityWarning.empty()) {
             jstring warning = env->NewStringUTF(q.qualityWarning.c_str());
             env->SetObjectField(qualityObj, cache.qualityWarningField, warning);
@@ -717,8 +658,7 @@ Java_com_heartpy_HeartPyModule_analyzeRRNativeJson(
     opt.poincareMode = (poincareMode==1 ? heartpy::Options::PoincareMode::MASKED : heartpy::Options::PoincareMode::FORMULA);
     opt.pnnAsPercent = (pnnAsPercent==JNI_TRUE);
     auto res = heartpy::analyzeRRIntervals(rr, opt);
-    std::string json = to_json(res, false);
-    return env->NewStringUTF(json.c_str());
+    return metricsJString(env, res, false);
 }
 
 // ----- Typed Helpers and Typed JNI for Segmentwise / RR -----
@@ -785,6 +725,9 @@ static jobject makeTypedMetrics(JNIEnv* env, const heartpy::HeartMetrics& res) {
         env->SetDoubleField(q, cache.qualityRrShortFracField, qu.rrShortFrac);
         env->SetDoubleField(q, cache.qualityRrLongMsField, qu.rrLongMs);
         env->SetDoubleField(q, cache.qualityPHalfOverFundField, qu.pHalfOverFund);
+        env->SetDoubleField(q, cache.qualityProvisionalActiveField, static_cast<double>(qu.provisionalActive));
+        env->SetDoubleField(q, cache.qualityProvisionalBpmField, qu.provisionalBpm);
+        env->SetDoubleField(q, cache.qualityProvisionalConfidenceField, qu.provisionalConfidence);
         if (!qu.qualityWarning.empty()) {
             jstring s = env->NewStringUTF(qu.qualityWarning.c_str());
             env->SetObjectField(q, cache.qualityWarningField, s);
@@ -962,8 +905,7 @@ Java_com_heartpy_HeartPyModule_analyzeSegmentwiseNativeJson(
     opt.calcFreq = (calcFreq == JNI_TRUE);
     opt.filterMode = (filterMode==1? heartpy::Options::FilterMode::RBJ : (filterMode==2? heartpy::Options::FilterMode::BUTTER_FILTFILT : heartpy::Options::FilterMode::AUTO));
     auto res = heartpy::analyzeSignalSegmentwise(signal, fs, opt);
-    std::string json = to_json(res, true);
-    return env->NewStringUTF(json.c_str());
+    return metricsJString(env, res, true);
 }
 
 extern "C" JNIEXPORT jdoubleArray JNICALL
@@ -1071,7 +1013,8 @@ Java_com_heartpy_HeartPyModule_rtCreateNative(
     opt.thresholdRR = (thresholdRR == JNI_TRUE);
     opt.calcFreq = (calcFreq == JNI_TRUE);
     opt.filterMode = (filterMode==1? heartpy::Options::FilterMode::RBJ : (filterMode==2? heartpy::Options::FilterMode::BUTTER_FILTFILT : heartpy::Options::FilterMode::AUTO));
-    void* h = hp_rt_create(fs, &opt);
+    // Recycled from the shared pool (reset in place, warm from its last session) or new and prewarmed
+    void* h = hp_rt_pool_acquire(nullptr, fs, &opt, 60.0);
     return (jlong)h;
 }
 
@@ -1080,11 +1023,12 @@ Java_com_heartpy_HeartPyModule_rtPushNative(JNIEnv* env, jclass, jlong h, jdoubl
     if (!h || !jData) return;
     jsize len = env->GetArrayLength(jData);
     if (len <= 0) return;
-    std::vector<double> tmp(len);
-    env->GetDoubleArrayRegion(jData, 0, len, tmp.data());
-    std::vector<float> x(len);
-    for (jsize i = 0; i < len; ++i) x[i] = static_cast<float>(tmp[i]);
-    hp_rt_push((void*)h, x.data(), (size_t)x.size(), t0);
+    // Read the Java array in place (pinned or VM copy); the analyzer narrows
+    // samples to float as it ingests them
+    jdouble* data = env->GetDoubleArrayElements(jData, nullptr);
+    if (!data) return;
+    hp_rt_push_f64((void*)h, data, (size_t)len, t0);
+    env->ReleaseDoubleArrayElements(jData, data, JNI_ABORT);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1094,12 +1038,13 @@ Java_com_heartpy_HeartPyModule_rtPushTsNative(JNIEnv* env, jclass, jlong h, jdou
     jsize lt = env->GetArrayLength(jTs);
     if (len <= 0 || lt <= 0) return;
     jsize n = std::min(len, lt);
-    std::vector<double> tmp(n), tsv(n);
-    env->GetDoubleArrayRegion(jData, 0, n, tmp.data());
-    env->GetDoubleArrayRegion(jTs, 0, n, tsv.data());
-    std::vector<float> x(n);
-    for (jsize i = 0; i < n; ++i) x[i] = static_cast<float>(tmp[i]);
-    hp_rt_push_ts((void*)h, x.data(), tsv.data(), (size_t)n);
+    jdouble* data = env->GetDoubleArrayElements(jData, nullptr);
+    jdouble* ts = data ? env->GetDoubleArrayElements(jTs, nullptr) : nullptr;
+    if (ts) {
+        hp_rt_push_ts_f64((void*)h, data, ts, (size_t)n);
+        env->ReleaseDoubleArrayElements(jTs, ts, JNI_ABORT);
+    }
+    if (data) env->ReleaseDoubleArrayElements(jData, data, JNI_ABORT);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1113,14 +1058,14 @@ Java_com_heartpy_HeartPyModule_rtPollNative(JNIEnv* env, jclass, jlong h) {
     if (!h) return nullptr;
     heartpy::HeartMetrics out;
     if (!hp_rt_poll((void*)h, &out)) return nullptr;
-    std::string json = to_json(out, false);
-    return env->NewStringUTF(json.c_str());
+    // Waveform at 0.1 ms / 1e-4 amplitude resolution: plotted, not analyzed
+    return metricsJString(env, out, false, 4);
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_heartpy_HeartPyModule_rtDestroyNative(JNIEnv* env, jclass, jlong h) {
     if (!h) return;
-    hp_rt_destroy((void*)h);
+    hp_rt_pool_release(nullptr, (void*)h);
 }
 
 // Validator JNI: returns error code string on failure, or null on success
@@ -1188,14 +1133,60 @@ static void hp_handle_remove(uint32_t id) {
     if (it != g_handles.end()) {
         void* p = it->second;
         g_handles.erase(it);
-        hp_rt_destroy(p);
+        hp_rt_pool_release(nullptr, p);
     }
 }
 
+// Ingest backlog reported back to JS after each push
+static facebook::jsi::Value hp_backlog_to_jsi(facebook::jsi::Runtime& rt, void* p) {
+    size_t pending = 0, window = 0;
+    int bp = hp_rt_backlog(p, &pending, &window);
+    facebook::jsi::Object o(rt);
+    o.setProperty(rt, "pendingSamples", (double)pending);
+    o.setProperty(rt, "windowSamples", (double)window);
+    o.setProperty(rt, "backpressure", bp != 0);
+    return o;
+}
+
 // Zero-copy flag (updated from Java setConfig)
 static std::atomic<bool> g_zero_copy_enabled{true};
+// Push calls per path; the ts_ pair counts the timestamped subset
 static std::atomic<unsigned long long> g_zero_copy_used{0};
 static std::atomic<unsigned long long> g_fallback_copy_used{0};
+static std::atomic<unsigned long long> g_ts_zero_copy_used{0};
+static std::atomic<unsigned long long> g_ts_fallback_copy_used{0};
+
+// Element storage of a typed array (e.g. "Float32Array") inside its
+// ArrayBuffer, checked for element type, bounds and alignment. nullptr when
+// zero-copy is disabled or the value is anything else (plain array, other
+// element type, detached or misaligned view): callers then copy.
+static const uint8_t* hp_typed_array_data(facebook::jsi::Runtime& rt, const facebook::jsi::Object& o,
+                                          const char* ctorName, size_t elemSize, size_t len) {
+    using namespace facebook::jsi;
+    if (!g_zero_copy_enabled.load()) return nullptr;
+    try {
+        Value ctor = o.getProperty(rt, "constructor");
+        if (!ctor.isObject()) return nullptr;
+        Value name = ctor.asObject(rt).getProperty(rt, "name");
+        if (!name.isString() || name.asString(rt).utf8(rt) != ctorName) return nullptr;
+        Value off = o.getProperty(rt, "byteOffset");
+        Value buf = o.getProperty(rt, "buffer");
+        if (!off.isNumber() || !buf.isObject()) return nullptr;
+        Object bufObj = buf.asObject(rt);
+        if (!bufObj.isArrayBuffer(rt)) return nullptr;
+        ArrayBuffer ab = bufObj.getArrayBuffer(rt);
+        uint8_t* base = ab.data(rt);
+        const size_t size = ab.size(rt);
+        const double offset = off.asNumber();
+        if (!base || !(offset >= 0.0) || offset > (double)size) return nullptr;
+        const size_t byteOffset = (size_t)offset;
+        if (len > (size - byteOffset) / elemSize) return nullptr;
+        if ((reinterpret_cast<uintptr_t>(base) + byteOffset) % elemSize != 0) return nullptr;
+        return base + byteOffset;
+    } catch (...) {
+        return nullptr;
+    }
+}
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_heartpy_HeartPyModule_setZeroCopyEnabledNative(JNIEnv*, jclass, jboolean enabled) {
@@ -1204,37 +1195,252 @@ Java_com_heartpy_HeartPyModule_setZeroCopyEnabledNative(JNIEnv*, jclass, jboolea
 
 extern "C" JNIEXPORT jlongArray JNICALL
 Java_com_heartpy_HeartPyModule_getJSIStatsNative(JNIEnv* env, jclass) {
-    jlongArray arr = env->NewLongArray(2);
-    jlong vals[2];
+    jlongArray arr = env->NewLongArray(4);
+    jlong vals[4];
     vals[0] = (jlong)g_zero_copy_used.load();
     vals[1] = (jlong)g_fallback_copy_used.load();
-    env->SetLongArrayRegion(arr, 0, 2, vals);
+    vals[2] = (jlong)g_ts_zero_copy_used.load();
+    vals[3] = (jlong)g_ts_fallback_copy_used.load();
+    env->SetLongArrayRegion(arr, 0, 4, vals);
     return arr;
 }
 
+// JSI bodies shared by the id-based globals and the analyzer HostObject.
+// Each takes the resolved analyzer and the arguments after the handle.
+
+static void* hp_jsi_create(facebook::jsi::Runtime& rt, const facebook::jsi::Value* args, size_t count) {
+    using namespace facebook::jsi;
+    if (count < 1 || !args[0].isNumber()) {
+        throw JSError(rt, "HEARTPY_E001: invalid fs");
+    }
+    double fs = args[0].asNumber();
+    heartpy::Options opt;
+    if (count > 1 && args[1].isObject()) {
+        opt = hp_build_options_from_jsi(rt, args[1].asObject(rt), nullptr, nullptr);
+    }
+    const char* code = nullptr; std::string msg;
+    if (!hp_validate_options(fs, opt, &code, &msg)) {
+        std::string m = (code ? code : "HEARTPY_E015"); m += ": "; m += msg;
+        throw JSError(rt, m.c_str());
+    }
+    // Pool misses prewarm on this (JS) thread, where JSI polls run
+    void* p = hp_rt_pool_acquire(nullptr, fs, &opt, 60.0);
+    if (!p) throw JSError(rt, "HEARTPY_E004: create failed");
+    return p;
+}
+
+static facebook::jsi::Value hp_jsi_set_window(facebook::jsi::Runtime& rt, void* p, const facebook::jsi::Value* args, size_t count) {
+    using namespace facebook::jsi;
+    if (count < 1 || !args[0].isNumber()) {
+        throw JSError(rt, "HEARTPY_E201: invalid arguments for setWindow");
+    }
+    double windowSec = args[0].asNumber();
+    if (!(windowSec > 0.0)) {
+        throw JSError(rt, "HEARTPY_E201: windowSeconds must be > 0");
+    }
+    hp_rt_set_window(p, windowSec);
+    return Value::undefined();
+}
+
+static facebook::jsi::Value hp_jsi_push(facebook::jsi::Runtime& rt, void* p, const facebook::jsi::Value* args, size_t count) {
+    using namespace facebook::jsi;
+    if (count < 1) throw JSError(rt, "HEARTPY_E102: missing data");
+    if (!args[0].isObject()) throw JSError(rt, "HEARTPY_E102: invalid buffer");
+    auto o = args[0].asObject(rt);
+    size_t len = (size_t)o.getProperty(rt, "length").asNumber();
+    if (len == 0) throw JSError(rt, "HEARTPY_E102: empty buffer");
+    double t0 = (count > 1 && args[1].isNumber()) ? args[1].asNumber() : 0.0;
+    // No batch cap: the analyzer ingests oversized batches in bounded slices.
+
+    bool usedZeroCopy = false;
+    if (const uint8_t* bytes = hp_typed_array_data(rt, o, "Float32Array", sizeof(float), len)) {
+        hp_rt_push(p, reinterpret_cast<const float*>(bytes), len, t0);
+        usedZeroCopy = true;
+        g_zero_copy_used.fetch_add(1);
+        __android_log_print(ANDROID_LOG_DEBUG, "HeartPyJSI", "rtPush: zero-copy used (len=%zu)", len);
+    }
+    if (!usedZeroCopy) {
+        __android_log_print(ANDROID_LOG_DEBUG, "HeartPyJSI", "rtPush: fallback copy path (len=%zu)", len);
+        std::vector<float> tmp; tmp.reserve(len);
+        for (size_t i = 0; i < len; ++i) tmp.push_back((float)o.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
+        hp_rt_push(p, tmp.data(), tmp.size(), t0);
+        g_fallback_copy_used.fetch_add(1);
+    }
+    return hp_backlog_to_jsi(rt, p);
+}
+
+static facebook::jsi::Value hp_jsi_push_ts(facebook::jsi::Runtime& rt, void* p, const facebook::jsi::Value* args, size_t count) {
+    using namespace facebook::jsi;
+    if (count < 2) throw JSError(rt, "HEARTPY_E102: missing buffers");
+    const Value& samplesVal = args[0];
+    const Value& timestampsVal = args[1];
+    if (!samplesVal.isObject() || !timestampsVal.isObject()) {
+        throw JSError(rt, "HEARTPY_E102: invalid buffers");
+    }
+
+    auto samplesObj = samplesVal.asObject(rt);
+    auto timestampsObj = timestampsVal.asObject(rt);
+    size_t len = (size_t)samplesObj.getProperty(rt, "length").asNumber();
+    size_t lenTs = (size_t)timestampsObj.getProperty(rt, "length").asNumber();
+    if (len == 0 || lenTs == 0) throw JSError(rt, "HEARTPY_E102: empty buffer");
+    size_t countEffective = std::min(len, lenTs);
+
+    // Zero-copy: Float32Array (or Float64Array) samples and Float64Array
+    // timestamps are read in place from their ArrayBuffers. Anything
+    // else is copied element by element, per buffer.
+    const uint8_t* xs32 = hp_typed_array_data(rt, samplesObj, "Float32Array", sizeof(float), countEffective);
+    const uint8_t* xs64 = xs32 ? nullptr : hp_typed_array_data(rt, samplesObj, "Float64Array", sizeof(double), countEffective);
+    const uint8_t* tsBytes = hp_typed_array_data(rt, timestampsObj, "Float64Array", sizeof(double), countEffective);
+
+    std::vector<float> samples;
+    if (!xs32 && !xs64) {
+        samples.reserve(countEffective);
+        for (size_t i = 0; i < countEffective; ++i) {
+            samples.push_back((float)samplesObj.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
+        }
+    }
+    std::vector<double> timestamps;
+    if (!tsBytes) {
+        timestamps.reserve(countEffective);
+        for (size_t i = 0; i < countEffective; ++i) {
+            timestamps.push_back(timestampsObj.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
+        }
+    }
+    const double* ts = tsBytes ? reinterpret_cast<const double*>(tsBytes) : timestamps.data();
+    if (xs64) hp_rt_push_ts_f64(p, reinterpret_cast<const double*>(xs64), ts, countEffective);
+    else hp_rt_push_ts(p, xs32 ? reinterpret_cast<const float*>(xs32) : samples.data(), ts, countEffective);
+
+    const bool zeroCopy = (xs32 || xs64) && tsBytes;
+    (zeroCopy ? g_zero_copy_used : g_fallback_copy_used).fetch_add(1);
+    (zeroCopy ? g_ts_zero_copy_used : g_ts_fallback_copy_used).fetch_add(1);
+    return hp_backlog_to_jsi(rt, p);
+}
+
+static facebook::jsi::Value hp_jsi_poll(facebook::jsi::Runtime& rt, void* p) {
+    using namespace facebook::jsi;
+    heartpy::HeartMetrics out;
+    if (!hp_rt_poll(p, &out)) return Value::null();
+    Object obj(rt);
+    obj.setProperty(rt, "bpm", out.bpm);
+    // rrList
+    {
+        Array rr(rt, out.rrList.size());
+        for (size_t i=0;i<out.rrList.size();++i) rr.setValueAtIndex(rt, i, out.rrList[i]);
+        obj.setProperty(rt, "rrList", rr);
+    }
+    // quality
+    {
+        Object q(rt);
+        q.setProperty(rt, "snrDb", out.quality.snrDb);
+        q.setProperty(rt, "confidence", out.quality.confidence);
+        obj.setProperty(rt, "quality", q);
+    }
+    return obj;
+}
+
+// Full result as one columnar buffer (heartpy_columnar.h), encoded straight
+// into the JS-owned ArrayBuffer: no per-element JSI calls, one copy
+static facebook::jsi::Value hp_jsi_poll_binary(facebook::jsi::Runtime& rt, void* p) {
+    using namespace facebook::jsi;
+    heartpy::HeartMetrics out;
+    if (!hp_rt_poll(p, &out)) return Value::null();
+    const size_t n = heartpy::encodedMetricsSize(out);
+    ArrayBuffer ab = rt.global().getPropertyAsFunction(rt, "ArrayBuffer")
+        .callAsConstructor(rt, (double)n).getObject(rt).getArrayBuffer(rt);
+    heartpy::encodeMetrics(out, ab.data(rt), ab.size(rt));
+    return Value(std::move(ab));
+}
+
+// Analyzer owned by a JS HostObject. The object and every method taken from
+// it share this state, so the analyzer goes back to the pool on destroy() or
+// once all of them are garbage collected, whichever comes first.
+struct HpRtState {
+    void* p = nullptr;
+    explicit HpRtState(void* analyzer) : p(analyzer) {}
+    ~HpRtState() { release(); }
+    HpRtState(const HpRtState&) = delete;
+    HpRtState& operator=(const HpRtState&) = delete;
+    void release() {
+        if (p) {
+            void* q = p;
+            p = nullptr;
+            hp_rt_pool_release(nullptr, q);
+        }
+    }
+};
+
+// { push, pushTs, poll, pollBinary, setWindow, destroy } bound to one
+// analyzer: calls dereference the captured state, with no registry lookup
+class HpRtHostObject : public facebook::jsi::HostObject {
+public:
+    explicit HpRtHostObject(void* p) : state_(std::make_shared<HpRtState>(p)) {}
+
+    facebook::jsi::Value get(facebook::jsi::Runtime& rt, const facebook::jsi::PropNameID& name) override {
+        using namespace facebook::jsi;
+        const std::string prop = name.utf8(rt);
+        if (prop == "destroy") {
+            return Function::createFromHostFunction(rt, name, 0,
+                [state = state_](Runtime&, const Value&, const Value*, size_t) -> Value {
+                    state->release();
+                    return Value::undefined();
+                });
+        }
+        for (const Method& m : kMethods) {
+            if (prop != m.name) continue;
+            auto call = m.call;
+            return Function::createFromHostFunction(rt, name, m.arity,
+                [state = state_, call](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
+                    if (!state->p) throw JSError(rt, "HEARTPY_E101: analyzer destroyed");
+                    return call(rt, state->p, args, count);
+                });
+        }
+        return Value::undefined();
+    }
+
+    std::vector<facebook::jsi::PropNameID> getPropertyNames(facebook::jsi::Runtime& rt) override {
+        std::vector<facebook::jsi::PropNameID> names;
+        for (const Method& m : kMethods) names.push_back(facebook::jsi::PropNameID::forAscii(rt, m.name));
+        names.push_back(facebook::jsi::PropNameID::forAscii(rt, "destroy"));
+        return names;
+    }
+
+private:
+    using Call = facebook::jsi::Value (*)(facebook::jsi::Runtime&, void*, const facebook::jsi::Value*, size_t);
+    struct Method { const char* name; unsigned arity; Call call; };
+    static constexpr Method kMethods[] = {
+        {"push", 2, hp_jsi_push},
+        {"pushTs", 2, hp_jsi_push_ts},
+        {"poll", 0, [](facebook::jsi::Runtime& rt, void* p, const facebook::jsi::Value*, size_t) { return hp_jsi_poll(rt, p); }},
+        {"pollBinary", 0, [](facebook::jsi::Runtime& rt, void* p, const facebook::jsi::Value*, size_t) { return hp_jsi_poll_binary(rt, p); }},
+        {"setWindow", 1, hp_jsi_set_window},
+    };
+
+    std::shared_ptr<HpRtState> state_;
+};
+
 static void installBinding(facebook::jsi::Runtime& rt) {
     using namespace facebook::jsi;
+    // __hpRtCreateObject(fs:number, options?:object) -> analyzer HostObject
+    auto fnCreateObject = Function::createFromHostFunction(
+        rt,
+        PropNameID::forAscii(rt, "__hpRtCreateObject"),
+        2,
+        [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
+            void* p = hp_jsi_create(rt, args, count);
+            return Object::createFromHostObject(rt, std::make_shared<HpRtHostObject>(p));
+        }
+    );
+    rt.global().setProperty(rt, "__hpRtCreateObject", fnCreateObject);
+
+    // Id-based API below, kept for callers that predate __hpRtCreateObject.
+
     // __hpRtCreate(fs:number, options?:object) -> number (id)
     auto fnCreate = Function::createFromHostFunction(
         rt,
         PropNameID::forAscii(rt, "__hpRtCreate"),
         2,
         [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
-            if (count < 1 || !args[0].isNumber()) {
-                throw JSError(rt, "HEARTPY_E001: invalid fs");
-            }
-            double fs = args[0].asNumber();
-            heartpy::Options opt;
-            if (count > 1 && args[1].isObject()) {
-                opt = hp_build_options_from_jsi(rt, args[1].asObject(rt), nullptr, nullptr);
-            }
-            const char* code = nullptr; std::string msg;
-            if (!hp_validate_options(fs, opt, &code, &msg)) {
-                std::string m = (code ? code : "HEARTPY_E015"); m += ": "; m += msg;
-                throw JSError(rt, m.c_str());
-            }
-            void* p = hp_rt_create(fs, &opt);
-            if (!p) throw JSError(rt, "HEARTPY_E004: create failed");
+            void* p = hp_jsi_create(rt, args, count);
             uint32_t id = hp_handle_register(p);
             return Value((double)id);
         }
@@ -1250,22 +1456,16 @@ static void installBinding(facebook::jsi::Runtime& rt) {
             if (count < 2 || !args[0].isNumber() || !args[1].isNumber()) {
                 throw JSError(rt, "HEARTPY_E201: invalid arguments for setWindow");
             }
-            double h = args[0].asNumber();
-            double windowSec = args[1].asNumber();
-            if (!(windowSec > 0.0)) {
-                throw JSError(rt, "HEARTPY_E201: windowSeconds must be > 0");
-            }
-            void* ptr = hp_handle_get((uint32_t)h);
+            void* ptr = hp_handle_get((uint32_t)args[0].asNumber());
             if (!ptr) {
                 throw JSError(rt, "HEARTPY_E101: invalid or destroyed handle");
             }
-            hp_rt_set_window(ptr, windowSec);
-            return Value::undefined();
+            return hp_jsi_set_window(rt, ptr, args + 1, count - 1);
         }
     );
     rt.global().setProperty(rt, "__hpRtSetWindow", fnSetWindow);
 
-    // __hpRtPush(handle:number, data:Float32Array, t0?:number) -> void
+    // __hpRtPush(handle:number, data:Float32Array, t0?:number) -> backlog
     auto fnPush = Function::createFromHostFunction(
         rt,
         PropNameID::forAscii(rt, "__hpRtPush"),
@@ -1273,52 +1473,14 @@ static void installBinding(facebook::jsi::Runtime& rt) {
         [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
             if (count < 2) throw JSError(rt, "HEARTPY_E102: missing data");
             if (!args[0].isNumber()) throw JSError(rt, "HEARTPY_E101: invalid handle");
-            uint32_t id = (uint32_t)args[0].asNumber();
-            void* p = hp_handle_get(id);
+            void* p = hp_handle_get((uint32_t)args[0].asNumber());
             if (!p) throw JSError(rt, "HEARTPY_E101: invalid handle");
-            auto arr = args[1];
-            if (!arr.isObject()) throw JSError(rt, "HEARTPY_E102: invalid buffer");
-            auto o = arr.asObject(rt);
-            size_t len = (size_t)o.getProperty(rt, "length").asNumber();
-            if (len == 0) throw JSError(rt, "HEARTPY_E102: empty buffer");
-            double t0 = (count > 2 && args[2].isNumber()) ? args[2].asNumber() : 0.0;
-            const size_t MAX_SAMPLES_PER_PUSH = 5000;
-            if (len > MAX_SAMPLES_PER_PUSH) throw JSError(rt, "HEARTPY_E102: buffer too large");
-
-            bool usedZeroCopy = false;
-            if (g_zero_copy_enabled.load()) {
-                try {
-                    size_t bpe = (size_t)o.getProperty(rt, "BYTES_PER_ELEMENT").asNumber();
-                    size_t byteOffset = (size_t)o.getProperty(rt, "byteOffset").asNumber();
-                    auto buf = o.getProperty(rt, "buffer").asObject(rt);
-                    auto ab = buf.getArrayBuffer(rt);
-                    uint8_t* base = ab.data(rt);
-                    size_t abSize = ab.size(rt);
-                    size_t need = byteOffset + len * bpe;
-                    if (bpe == 4 && base && need <= abSize && (byteOffset % 4 == 0)) {
-                        float* data = reinterpret_cast<float*>(base + byteOffset);
-                        hp_rt_push(p, data, len, t0);
-                        usedZeroCopy = true;
-                        g_zero_copy_used.fetch_add(1);
-                        __android_log_print(ANDROID_LOG_DEBUG, "HeartPyJSI", "rtPush: zero-copy used (len=%zu)", len);
-                    }
-                } catch (...) {
-                    // fall through to copy path
-                }
-            }
-            if (!usedZeroCopy) {
-                __android_log_print(ANDROID_LOG_DEBUG, "HeartPyJSI", "rtPush: fallback copy path (len=%zu)", len);
-                std::vector<float> tmp; tmp.reserve(len);
-                for (size_t i = 0; i < len; ++i) tmp.push_back((float)o.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
-                hp_rt_push(p, tmp.data(), tmp.size(), t0);
-                g_fallback_copy_used.fetch_add(1);
-            }
-            return Value::undefined();
+            return hp_jsi_push(rt, p, args + 1, count - 1);
         }
     );
     rt.global().setProperty(rt, "__hpRtPush", fnPush);
 
-    // __hpRtPushTs(handle:number, samples:Float32Array, timestamps:Float64Array) -> void
+    // __hpRtPushTs(handle:number, samples:Float32Array, timestamps:Float64Array) -> backlog
     auto fnPushTs = Function::createFromHostFunction(
         rt,
         PropNameID::forAscii(rt, "__hpRtPushTs"),
@@ -1326,39 +1488,9 @@ static void installBinding(facebook::jsi::Runtime& rt) {
         [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
             if (count < 3) throw JSError(rt, "HEARTPY_E102: missing buffers");
             if (!args[0].isNumber()) throw JSError(rt, "HEARTPY_E101: invalid handle");
-            uint32_t id = (uint32_t)args[0].asNumber();
-            void* p = hp_handle_get(id);
+            void* p = hp_handle_get((uint32_t)args[0].asNumber());
             if (!p) throw JSError(rt, "HEARTPY_E101: invalid handle");
-
-            auto samplesVal = args[1];
-            auto timestampsVal = args[2];
-            if (!samplesVal.isObject() || !timestampsVal.isObject()) {
-                throw JSError(rt, "HEARTPY_E102: invalid buffers");
-            }
-
-            auto samplesObj = samplesVal.asObject(rt);
-            auto timestampsObj = timestampsVal.asObject(rt);
-            size_t len = (size_t)samplesObj.getProperty(rt, "length").asNumber();
-            size_t lenTs = (size_t)timestampsObj.getProperty(rt, "length").asNumber();
-            if (len == 0 || lenTs == 0) throw JSError(rt, "HEARTPY_E102: empty buffer");
-            size_t countEffective = std::min(len, lenTs);
-            const size_t MAX_SAMPLES_PER_PUSH = 5000;
-            if (countEffective > MAX_SAMPLES_PER_PUSH) throw JSError(rt, "HEARTPY_E102: buffer too large");
-
-            std::vector<float> samples;
-            samples.reserve(countEffective);
-            for (size_t i = 0; i < countEffective; ++i) {
-                samples.push_back((float)samplesObj.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
-            }
-
-            std::vector<double> timestamps;
-            timestamps.reserve(countEffective);
-            for (size_t i = 0; i < countEffective; ++i) {
-                timestamps.push_back(timestampsObj.getPropertyAtIndex(rt, (uint32_t)i).asNumber());
-            }
-
-            hp_rt_push_ts(p, samples.data(), timestamps.data(), countEffective);
-            return Value::undefined();
+            return hp_jsi_push_ts(rt, p, args + 1, count - 1);
         }
     );
     rt.global().setProperty(rt, "__hpRtPushTs", fnPushTs);
@@ -1370,31 +1502,27 @@ static void installBinding(facebook::jsi::Runtime& rt) {
         1,
         [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
             if (count < 1 || !args[0].isNumber()) throw JSError(rt, "HEARTPY_E111: invalid handle");
-            uint32_t id = (uint32_t)args[0].asNumber();
-            void* p = hp_handle_get(id);
+            void* p = hp_handle_get((uint32_t)args[0].asNumber());
             if (!p) throw JSError(rt, "HEARTPY_E111: invalid handle");
-            heartpy::HeartMetrics out;
-            if (!hp_rt_poll(p, &out)) return Value::null();
-            Object obj(rt);
-            obj.setProperty(rt, "bpm", out.bpm);
-            // rrList
-            {
-                Array rr(rt, out.rrList.size());
-                for (size_t i=0;i<out.rrList.size();++i) rr.setValueAtIndex(rt, i, out.rrList[i]);
-                obj.setProperty(rt, "rrList", rr);
-            }
-            // quality
-            {
-                Object q(rt);
-                q.setProperty(rt, "snrDb", out.quality.snrDb);
-                q.setProperty(rt, "confidence", out.quality.confidence);
-                obj.setProperty(rt, "quality", q);
-            }
-            return obj;
+            return hp_jsi_poll(rt, p);
         }
     );
     rt.global().setProperty(rt, "__hpRtPoll", fnPoll);
 
+    // __hpRtPollBinary(handle:number) -> ArrayBuffer | null
+    auto fnPollBinary = Function::createFromHostFunction(
+        rt,
+        PropNameID::forAscii(rt, "__hpRtPollBinary"),
+        1,
+        [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
+            if (count < 1 || !args[0].isNumber()) throw JSError(rt, "HEARTPY_E111: invalid handle");
+            void* p = hp_handle_get((uint32_t)args[0].asNumber());
+            if (!p) throw JSError(rt, "HEARTPY_E111: invalid handle");
+            return hp_jsi_poll_binary(rt, p);
+        }
+    );
+    rt.global().setProperty(rt, "__hpRtPollBinary", fnPollBinary);
+
     // __hpRtDestroy(handle:number)
     auto fnDestroy = Function::createFromHostFunction(
         rt,
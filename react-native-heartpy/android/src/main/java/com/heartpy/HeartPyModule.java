@@ -204,6 +204,9 @@ public class HeartPyModule extends NativeHeartPySpec {
         double rrShortFrac;
         double rrLongMs;
         double pHalfOverFund;
+        double provisionalActive;
+        double provisionalBpm;
+        double provisionalConfidence;
         String qualityWarning;
     }
 
@@ -256,7 +259,8 @@ public class HeartPyModule extends NativeHeartPySpec {
     private static volatile boolean CFG_JSI_ENABLED = true;
     private static volatile boolean CFG_ZERO_COPY_ENABLED = true; // honored in JSI step
     private static volatile boolean CFG_DEBUG = false;
-    private static final int MAX_SAMPLES_PER_PUSH = 5000;
+    // 0 = unlimited: the native analyzer ingests oversized batches in bounded slices
+    private static final int MAX_SAMPLES_PER_PUSH = 0;
 
     private static double[] readableArrayToDoubleArray(ReadableArray array) {
         if (array == null) {
@@ -581,6 +585,9 @@ public class HeartPyModule extends NativeHeartPySpec {
             long[] vals = getJSIStatsNative();
             out.putDouble("zeroCopyUsed", (double) (vals != null && vals.length > 0 ? vals[0] : 0));
             out.putDouble("fallbackUsed", (double) (vals != null && vals.length > 1 ? vals[1] : 0));
+            // Timestamped pushes (__hpRtPushTs), included in the totals above
+            out.putDouble("pushTsZeroCopyUsed", (double) (vals != null && vals.length > 2 ? vals[2] : 0));
+            out.putDouble("pushTsFallbackUsed", (double) (vals != null && vals.length > 3 ? vals[3] : 0));
         } catch (Throwable t) {
             out.putString("error", t.getMessage());
         }
@@ -731,6 +738,9 @@ public class HeartPyModule extends NativeHeartPySpec {
             map.putDouble("rrShortFrac", 0.0);
             map.putDouble("rrLongMs", 0.0);
             map.putDouble("pHalfOverFund", 0.0);
+            map.putDouble("provisionalActive", 0.0);
+            map.putDouble("provisionalBpm", 0.0);
+            map.putDouble("provisionalConfidence", 0.0);
             return map;
         }
         map.putDouble("totalBeats", quality.totalBeats);
@@ -754,6 +764,9 @@ public class HeartPyModule extends NativeHeartPySpec {
         map.putDouble("rrShortFrac", quality.rrShortFrac);
         map.putDouble("rrLongMs", quality.rrLongMs);
         map.putDouble("pHalfOverFund", quality.pHalfOverFund);
+        map.putDouble("provisionalActive", quality.provisionalActive);
+        map.putDouble("provisionalBpm", quality.provisionalBpm);
+        map.putDouble("provisionalConfidence", quality.provisionalConfidence);
         if (quality.qualityWarning != null && !quality.qualityWarning.isEmpty()) {
             map.putString("qualityWarning", quality.qualityWarning);
         }
@@ -1298,7 +1311,7 @@ public class HeartPyModule extends NativeHeartPySpec {
             final long h = (long) handle;
             if (h == 0L) { promise.reject("HEARTPY_E101", "Invalid or destroyed handle"); return; }
             if (samples == null || samples.length == 0) { promise.reject("HEARTPY_E102", "Invalid data buffer: empty buffer"); return; }
-            if (samples.length > MAX_SAMPLES_PER_PUSH) { promise.reject("HEARTPY_E102", "Invalid data buffer: too large (max " + MAX_SAMPLES_PER_PUSH + ")"); return; }
+            if (MAX_SAMPLES_PER_PUSH > 0 && samples.length > MAX_SAMPLES_PER_PUSH) { promise.reject("HEARTPY_E102", "Invalid data buffer: too large (max " + MAX_SAMPLES_PER_PUSH + ")"); return; }
             final double ts0 = (t0 == null ? 0.0 : t0.doubleValue());
             executorFor(h).submit(() -> {
                 try { rtPushNative(h, samples, ts0); promise.resolve(null); }
@@ -1370,7 +1383,7 @@ public class HeartPyModule extends NativeHeartPySpec {
             if (h == 0L) { promise.reject("HEARTPY_E101", "Invalid or destroyed handle"); return; }
             if (samples == null || timestamps == null || samples.length == 0 || timestamps.length == 0) { promise.reject("HEARTPY_E102", "Invalid buffers: empty"); return; }
             final int k = Math.min(samples.length, timestamps.length);
-            if (k > MAX_SAMPLES_PER_PUSH) { promise.reject("HEARTPY_E102", "Invalid data buffer: too large (max " + MAX_SAMPLES_PER_PUSH + ")"); return; }
+            if (MAX_SAMPLES_PER_PUSH > 0 && k > MAX_SAMPLES_PER_PUSH) { promise.reject("HEARTPY_E102", "Invalid data buffer: too large (max " + MAX_SAMPLES_PER_PUSH + ")"); return; }
             final double[] xs = (samples.length == k ? samples : java.util.Arrays.copyOf(samples, k));
             final double[] ts = (timestamps.length == k ? timestamps : java.util.Arrays.copyOf(timestamps, k));
             executorFor(h).submit(() -> {
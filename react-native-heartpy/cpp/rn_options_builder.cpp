@@ -171,6 +171,21 @@ heartpy::Options hp_build_options_from_jsi(Runtime& rt, const Object& opts, cons
         o.snrTauSec = getNum(rt, opts, "snrTauSec", o.snrTauSec);
         o.snrActiveTauSec = getNum(rt, opts, "snrActiveTauSec", o.snrActiveTauSec);
         o.adaptivePsd = getBool(rt, opts, "adaptivePsd", o.adaptivePsd);
+        o.profileStages = getBool(rt, opts, "profileStages", o.profileStages);
+        o.singlePrecision = getBool(rt, opts, "singlePrecision", o.singlePrecision);
+        o.provisionalHR = getBool(rt, opts, "provisionalHR", o.provisionalHR);
+        o.provisionalMinSec = getNum(rt, opts, "provisionalMinSec", o.provisionalMinSec);
+        o.provisionalMinConfidence = getNum(rt, opts, "provisionalMinConfidence", o.provisionalMinConfidence);
+        // Output profile: skip metric groups the caller does not read
+        if (hasProp(rt, opts, "profile")) {
+            auto s = opts.getProperty(rt, "profile");
+            if (s.isString()) {
+                std::string p = s.asString(rt).utf8(rt);
+                if (p == "hrOnly") o.outputs = heartpy::Options::PROFILE_HR_ONLY;
+                else if (p == "timeDomainHrv") o.outputs = heartpy::Options::PROFILE_TIME_DOMAIN_HRV;
+                else o.outputs = heartpy::Options::PROFILE_FULL;
+            }
+        }
         // Global FD toggle (calc_freq parity)
         if (hasProp(rt, opts, "calcFreq")) {
             o.calcFreq = getBool(rt, opts, "calcFreq", o.calcFreq);
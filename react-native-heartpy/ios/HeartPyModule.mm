@@ -7,6 +7,7 @@
 #include "heartpy_core.h"
 // Realtime streaming API
 #include "heartpy_stream.h"
+#include "heartpy_columnar.h"
 // Options validator (RN step 1)
 #include "rn_options_builder.h"
 
@@ -37,7 +38,7 @@ static NSMutableDictionary<NSString*, id>* gRuntimeConfig = nil;
             @"jsiEnabled": @YES,
             @"zeroCopyEnabled": @YES,
             @"debug": @NO,
-            @"maxSamplesPerPush": @(5000)
+            @"maxSamplesPerPush": @(0) // 0 = unlimited (chunked ingest)
         } mutableCopy];
         // Subscribe to native PPG notifications from VisionCamera frame processor
         [[NSNotificationCenter defaultCenter] addObserverForName:@"HeartPyPPGSample"
@@ -410,6 +411,23 @@ static void installBinding(jsi::Runtime &rt) {
 					return out;
 				});
 			rtObj.setProperty(rt, "poll", pollFunc);
+
+			// pollBinary() -> ArrayBuffer | null: the full result as one columnar
+			// buffer (heartpy_columnar.h), decoded in JS by decodeResultBuffer
+			auto pollBinaryFunc = jsi::Function::createFromHostFunction(
+				rt,
+				jsi::PropNameID::forAscii(rt, "pollBinary"),
+				0,
+				[analyzer](jsi::Runtime &rt, const jsi::Value &thisVal, const jsi::Value *args, size_t count) -> jsi::Value {
+					heartpy::HeartMetrics result;
+					if (!analyzer->poll(result)) return jsi::Value::null();
+					const size_t n = heartpy::encodedMetricsSize(result);
+					jsi::ArrayBuffer ab = rt.global().getPropertyAsFunction(rt, "ArrayBuffer")
+						.callAsConstructor(rt, (double)n).getObject(rt).getArrayBuffer(rt);
+					heartpy::encodeMetrics(result, ab.data(rt), ab.size(rt));
+					return jsi::Value(std::move(ab));
+				});
+			rtObj.setProperty(rt, "pollBinary", pollBinaryFunc);
 			
 			return rtObj;
 		});
@@ -545,6 +563,18 @@ static heartpy::Options optionsFromNSDictionary(NSDictionary* optDict) {
     if (optDict[@"snrTauSec"]) opt.snrTauSec = [optDict[@"snrTauSec"] doubleValue];
     if (optDict[@"snrActiveTauSec"]) opt.snrActiveTauSec = [optDict[@"snrActiveTauSec"] doubleValue];
     if (optDict[@"adaptivePsd"]) opt.adaptivePsd = [optDict[@"adaptivePsd"] boolValue];
+    if (optDict[@"profileStages"]) opt.profileStages = [optDict[@"profileStages"] boolValue];
+    if (optDict[@"singlePrecision"]) opt.singlePrecision = [optDict[@"singlePrecision"] boolValue];
+    if (optDict[@"provisionalHR"]) opt.provisionalHR = [optDict[@"provisionalHR"] boolValue];
+    if (optDict[@"provisionalMinSec"]) opt.provisionalMinSec = [optDict[@"provisionalMinSec"] doubleValue];
+    if (optDict[@"provisionalMinConfidence"]) opt.provisionalMinConfidence = [optDict[@"provisionalMinConfidence"] doubleValue];
+    id profile = optDict[@"profile"];
+    if ([profile isKindOfClass:[NSString class]]) {
+        NSString* p = (NSString*)profile;
+        if ([p isEqualToString:@"hrOnly"]) opt.outputs = heartpy::Options::PROFILE_HR_ONLY;
+        else if ([p isEqualToString:@"timeDomainHrv"]) opt.outputs = heartpy::Options::PROFILE_TIME_DOMAIN_HRV;
+        else opt.outputs = heartpy::Options::PROFILE_FULL;
+    }
     NSDictionary* filt = optDict[@"filter"];
     if ([filt isKindOfClass:[NSDictionary class]]) {
         id mode = filt[@"mode"];
@@ -649,6 +679,9 @@ RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(analyze:(NSArray<NSNumber*>*)signal
     q[@"rrShortFrac"] = @(res.quality.rrShortFrac);
     q[@"rrLongMs"] = @(res.quality.rrLongMs);
     q[@"pHalfOverFund"] = @(res.quality.pHalfOverFund);
+    q[@"provisionalActive"] = @(res.quality.provisionalActive);
+    q[@"provisionalBpm"] = @(res.quality.provisionalBpm);
+    q[@"provisionalConfidence"] = @(res.quality.provisionalConfidence);
     if (!res.quality.qualityWarning.empty()) {
         q[@"qualityWarning"] = [NSString stringWithUTF8String:res.quality.qualityWarning.c_str()];
     }
@@ -1024,8 +1057,9 @@ RCT_EXPORT_METHOD(rtCreate:(double)fs
             reject(nscode, nsmsg, nil);
             return;
         }
-        void* handlePtr = hp_rt_create(fs, &opt);
-        if (!handlePtr) { reject(@"HEARTPY_E004", @"hp_rt_create returned null", nil); return; }
+        // Recycled from the shared pool (reset in place, warm from its last session) or new and prewarmed
+        void* handlePtr = hp_rt_pool_acquire(nullptr, fs, &opt, 60.0);
+        if (!handlePtr) { reject(@"HEARTPY_E004", @"hp_rt_pool_acquire returned null", nil); return; }
         resolve(@((double)(uintptr_t)handlePtr));
     } @catch (NSException* e) {
         reject(@"HEARTPY_E900", e.reason, nil);
@@ -1235,11 +1269,29 @@ RCT_EXPORT_METHOD(rtPoll:(nonnull NSNumber*)handle
             q[@"rrShortFrac"] = @(res.quality.rrShortFrac);
             q[@"rrLongMs"] = @(res.quality.rrLongMs);
             q[@"pHalfOverFund"] = @(res.quality.pHalfOverFund);
+            q[@"provisionalActive"] = @(res.quality.provisionalActive);
+            q[@"provisionalBpm"] = @(res.quality.provisionalBpm);
+            q[@"provisionalConfidence"] = @(res.quality.provisionalConfidence);
             if (!res.quality.qualityWarning.empty()) {
                 q[@"qualityWarning"] = [NSString stringWithUTF8String:res.quality.qualityWarning.c_str()];
             }
             out[@"quality"] = q;
         }
+        // Stage latency breakdown (options.profileStages)
+        if (res.timings.valid) {
+            NSMutableDictionary* tm = [NSMutableDictionary new];
+            for (int s = 0; s < heartpy::StageTimings::COUNT; ++s) {
+                tm[[NSString stringWithUTF8String:heartpy::StageTimings::name(s)]] = @(res.timings.us[s]);
+            }
+            out[@"timingsUs"] = tm;
+        }
+        if (res.timings.allocsValid) {
+            NSMutableDictionary* al = [NSMutableDictionary new];
+            for (int s = 0; s < heartpy::StageTimings::COUNT; ++s) {
+                al[[NSString stringWithUTF8String:heartpy::StageTimings::name(s)]] = @(res.timings.allocs[s]);
+            }
+            out[@"stageAllocs"] = al;
+        }
         // P1 FIX: Add peakListRaw and remove faulty windowStartAbs calculation
         {
             NSMutableArray* peakListRaw = [NSMutableArray arrayWithCapacity:res.peakListRaw.size()];
@@ -1293,7 +1345,7 @@ RCT_EXPORT_METHOD(rtDestroy:(nonnull NSNumber*)handle
 #endif
         if (handleValue == 0.0) { reject(@"rt_destroy_invalid_args", @"Invalid handle", nil); return; }
         void* h = (void*)(uintptr_t)llround(handleValue);
-        hp_rt_destroy(h);
+        hp_rt_pool_release(nullptr, h);
         resolve(nil);
     } @catch (NSException* e) {
         reject(@"rt_destroy_exception", e.reason, nil);
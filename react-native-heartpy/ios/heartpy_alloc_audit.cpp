@@ -0,0 +1,131 @@
+#include "heartpy_alloc_audit.h"
+#include "heartpy_core.h"
+
+#include <atomic>
+#if HEARTPY_ALLOC_AUDIT
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace heartpy {
+namespace alloc_audit {
+
+namespace {
+
+struct AtomicCounters {
+    std::atomic<uint64_t> calls{0}, allocs{0}, frees{0}, bytes{0};
+    void add(uint64_t c, uint64_t a, uint64_t f, uint64_t b) {
+        if (c) calls.fetch_add(c, std::memory_order_relaxed);
+        if (a) allocs.fetch_add(a, std::memory_order_relaxed);
+        if (f) frees.fetch_add(f, std::memory_order_relaxed);
+        if (b) bytes.fetch_add(b, std::memory_order_relaxed);
+    }
+    AllocCounters load() const {
+        AllocCounters c;
+        c.calls = calls.load(std::memory_order_relaxed);
+        c.allocs = allocs.load(std::memory_order_relaxed);
+        c.frees = frees.load(std::memory_order_relaxed);
+        c.bytes = bytes.load(std::memory_order_relaxed);
+        return c;
+    }
+    void clear() { calls = 0; allocs = 0; frees = 0; bytes = 0; }
+};
+
+// Constant-initialized, so the hooks below never trigger dynamic init
+AtomicCounters g_process;
+AtomicCounters g_sites[static_cast<int>(AllocSite::COUNT)];
+AtomicCounters g_stages[StageTimings::COUNT];
+
+#if HEARTPY_ALLOC_AUDIT
+thread_local uint64_t t_allocs = 0;
+thread_local uint64_t t_frees = 0;
+thread_local uint64_t t_bytes = 0;
+#endif
+
+} // namespace
+
+AllocCounters threadCounters() {
+    AllocCounters c;
+#if HEARTPY_ALLOC_AUDIT
+    c.allocs = t_allocs; c.frees = t_frees; c.bytes = t_bytes;
+#endif
+    return c;
+}
+
+AllocCounters processTotals() { return g_process.load(); }
+
+AllocCounters site(AllocSite s) {
+    const int i = static_cast<int>(s);
+    return (i >= 0 && i < static_cast<int>(AllocSite::COUNT)) ? g_sites[i].load() : AllocCounters{};
+}
+
+AllocCounters stage(int s) {
+    return (s >= 0 && s < StageTimings::COUNT) ? g_stages[s].load() : AllocCounters{};
+}
+
+void reset() {
+    g_process.clear();
+    for (auto& c : g_sites) c.clear();
+    for (auto& c : g_stages) c.clear();
+}
+
+const char* siteName(AllocSite s) {
+    switch (s) {
+        case AllocSite::ANALYZE_SIGNAL: return "analyzeSignal";
+        case AllocSite::ANALYZE_SEGMENTWISE: return "analyzeSignalSegmentwise";
+        case AllocSite::ANALYZE_RR: return "analyzeRRIntervals";
+        case AllocSite::WELCH_PSD: return "welchPSD";
+        case AllocSite::RT_PUSH: return "push";
+        case AllocSite::RT_POLL: return "poll";
+        default: return "unknown";
+    }
+}
+
+void addSite(AllocSite s, const AllocCounters& since) {
+    const int i = static_cast<int>(s);
+    if (i < 0 || i >= static_cast<int>(AllocSite::COUNT)) return;
+    const AllocCounters now = threadCounters();
+    g_sites[i].add(1, now.allocs - since.allocs, now.frees - since.frees, now.bytes - since.bytes);
+}
+
+void addStage(int s, const AllocCounters& delta) {
+    if (s < 0 || s >= StageTimings::COUNT) return;
+    g_stages[s].add(1, delta.allocs, delta.frees, delta.bytes);
+}
+
+#if HEARTPY_ALLOC_AUDIT
+namespace {
+inline void* countedAlloc(std::size_t n) {
+    ++t_allocs; t_bytes += n;
+    g_process.add(0, 1, 0, n);
+    return std::malloc(n ? n : 1);
+}
+inline void countedFree(void* p) {
+    if (!p) return;
+    ++t_frees;
+    g_process.add(0, 0, 1, 0);
+    std::free(p);
+}
+} // namespace
+#endif
+
+} // namespace alloc_audit
+} // namespace heartpy
+
+#if HEARTPY_ALLOC_AUDIT
+// Global replacements (audit builds only). Aligned new/delete keep the
+// runtime's implementation and are not counted.
+void* operator new(std::size_t n) {
+    if (void* p = heartpy::alloc_audit::countedAlloc(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return ::operator new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return heartpy::alloc_audit::countedAlloc(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return heartpy::alloc_audit::countedAlloc(n); }
+void operator delete(void* p) noexcept { heartpy::alloc_audit::countedFree(p); }
+void operator delete[](void* p) noexcept { heartpy::alloc_audit::countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { heartpy::alloc_audit::countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { heartpy::alloc_audit::countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { heartpy::alloc_audit::countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { heartpy::alloc_audit::countedFree(p); }
+#endif
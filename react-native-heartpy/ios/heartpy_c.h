@@ -0,0 +1,146 @@
+/* Plain C view of a realtime poll, for FFI consumers (Rust, Python ctypes,
+ * Dart, JNI/ObjC bridges). The caller owns every buffer: it chooses the
+ * fields it wants with a bitmask and passes fixed-capacity arrays. Each array
+ * reports its required size, so a truncated poll can be sized and retried
+ * on the next update. The library keeps one reusable result per handle and
+ * never allocates on the caller's behalf.
+ *
+ * This header is valid C. hp_rt_create_fields / hp_rt_pool_acquire_fields
+ * build an analyzer with default Options that computes only the groups in a
+ * field mask; the C++ entry points taking heartpy::Options are in
+ * heartpy_stream.h. */
+#ifndef HEARTPY_C_H
+#define HEARTPY_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Field selection (hp_rt_poll_buffers.fields) */
+enum {
+    HP_RT_FIELD_METRICS   = 1u << 0, /* bpm, time/frequency domain, Poincare, breathing */
+    HP_RT_FIELD_QUALITY   = 1u << 1, /* quality scalars */
+    HP_RT_FIELD_PEAKS     = 1u << 2, /* peakList, peakTimestamps */
+    HP_RT_FIELD_PEAKS_RAW = 1u << 3, /* peakListRaw, binaryPeakMask */
+    HP_RT_FIELD_RR        = 1u << 4, /* ibiMs, rrList */
+    HP_RT_FIELD_WAVEFORM  = 1u << 5, /* waveformValues, waveformTimestamps */
+    HP_RT_FIELD_SEGMENTS  = 1u << 6, /* binarySegments */
+    HP_RT_FIELD_REJECTED  = 1u << 7, /* rejectedIndices */
+    HP_RT_FIELD_WARNING   = 1u << 8, /* quality warning text */
+    HP_RT_FIELD_ALL       = 0x1FFu
+};
+
+/* hp_rt_poll_into results */
+enum {
+    HP_RT_POLL_NONE      = 0, /* no update due (buffers untouched) */
+    HP_RT_POLL_OK        = 1, /* update written in full */
+    HP_RT_POLL_TRUNCATED = 2, /* update written; some array had size > capacity */
+    HP_RT_POLL_ERROR     = -1 /* invalid handle or buffers */
+};
+
+typedef struct hp_rt_scalars {
+    /* HP_RT_FIELD_METRICS */
+    double bpm;
+    double sdnn, rmssd, sdsd, pnn20, pnn50, nn20, nn50, mad;
+    double sd1, sd2, sd1sd2Ratio, ellipseArea;
+    double vlf, lf, hf, lfhf, totalPower, lfNorm, hfNorm;
+    double breathingRate;
+    /* HP_RT_FIELD_QUALITY */
+    int32_t totalBeats, rejectedBeats;
+    double  rejectionRate;
+    int32_t goodQuality;
+    double  snrDb, confidence, f0Hz, maPercActive;
+    int32_t doublingFlag, softDoublingFlag;
+    double  rrShortFrac, rrLongMs, pHalfOverFund, pairFrac;
+    double  refractoryMsActive, minRRBoundMs;
+    int32_t softStreak;
+    double  softSecs;
+    int32_t hardFallbackActive, doublingHintFlag, rrFallbackModeActive, snrWarmupActive;
+    double  snrSampleCount;
+    int32_t provisionalActive;
+    double  provisionalBpm, provisionalConfidence;
+} hp_rt_scalars;
+
+/* data may be NULL with capacity 0 to query the size only */
+typedef struct hp_rt_f64_array { double* data; size_t capacity; size_t size; } hp_rt_f64_array;
+typedef struct hp_rt_i32_array { int32_t* data; size_t capacity; size_t size; } hp_rt_i32_array;
+
+typedef struct hp_rt_segment {
+    int32_t index, startBeat, endBeat, totalBeats, rejectedBeats, accepted;
+} hp_rt_segment;
+typedef struct hp_rt_segment_array { hp_rt_segment* data; size_t capacity; size_t size; } hp_rt_segment_array;
+
+typedef struct hp_rt_poll_buffers {
+    uint32_t fields;                 /* in: HP_RT_FIELD_* mask */
+    hp_rt_scalars scalars;           /* out: METRICS/QUALITY groups */
+    hp_rt_i32_array peakList;
+    hp_rt_f64_array peakTimestamps;
+    hp_rt_i32_array peakListRaw;
+    hp_rt_i32_array binaryPeakMask;
+    hp_rt_f64_array ibiMs;
+    hp_rt_f64_array rrList;
+    hp_rt_f64_array waveformValues;
+    hp_rt_f64_array waveformTimestamps;
+    hp_rt_segment_array binarySegments;
+    hp_rt_i32_array rejectedIndices;
+    char*  warning;                  /* NUL-terminated when warningCapacity > 0 */
+    size_t warningCapacity;
+    size_t warningSize;              /* out: length without the NUL */
+} hp_rt_poll_buffers;
+
+/* Analyzer lifecycle. fields (HP_RT_FIELD_*) sets Options::outputs: groups
+ * left out are not computed, so polling them later yields empty arrays and
+ * NaN or zero scalars. BPM and the quality/segment/warning fields are always
+ * computed. */
+void* hp_rt_create_fields(double fs, uint32_t fields);
+void  hp_rt_destroy(void* h);
+void  hp_rt_set_window(void* h, double sec);
+void  hp_rt_set_update_interval(void* h, double sec);
+/* Samples 1/fs apart from t0 (seconds, first sample). A t0 that is not
+ * after the previous sample (e.g. 0) continues the stream 1/fs after it. */
+void  hp_rt_push(void* h, const float* x, size_t n, double t0);
+/* Per-sample timestamped push (seconds) */
+void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n);
+/* Double-precision samples, read in place (no narrowing copy by the caller) */
+void  hp_rt_push_f64(void* h, const double* x, size_t n, double t0);
+void  hp_rt_push_ts_f64(void* h, const double* x, const double* ts, size_t n);
+/* Interleaved sources: consecutive samples/timestamps are xStride/tsStride
+ * bytes apart (e.g. fields of a capture record array) */
+void  hp_rt_push_strided(void* h, const float* x, size_t xStride,
+                         const double* ts, size_t tsStride, size_t n);
+/* Ingest backlog: fills pending/window sample counts (either may be NULL);
+ * returns 1 when more than a window is pending (poll more often), else 0. */
+int   hp_rt_backlog(void* h, size_t* pendingSamples, size_t* windowSamples);
+
+/* Session pool (heartpy_pool.h); pool NULL selects the process-wide pool.
+ * Handles from hp_rt_pool_acquire* work with every hp_rt_* call and are
+ * returned with hp_rt_pool_release instead of hp_rt_destroy. */
+void* hp_rt_pool_create(size_t maxIdlePerClass);
+void  hp_rt_pool_destroy(void* pool);
+void* hp_rt_pool_acquire_fields(void* pool, double fs, uint32_t fields, double windowSec);
+void  hp_rt_pool_release(void* pool, void* h);
+/* RealtimeAnalyzer::prewarm (call on the polling thread) */
+void  hp_rt_prewarm(void* h);
+
+/* Polls the handle and copies the selected fields into b. Fields outside
+ * b->fields are left untouched. */
+int hp_rt_poll_into(void* h, hp_rt_poll_buffers* b);
+
+/* Analyzer checkpoint (RealtimeAnalyzer::saveState). Writes up to cap
+ * bytes and returns the full size, so callers can retry with a larger
+ * buffer; restore returns 1 on success, 0 if the blob was rejected. */
+size_t hp_rt_save_state(void* h, uint8_t* buf, size_t cap);
+int    hp_rt_restore_state(void* h, const uint8_t* data, size_t size);
+/* Session capture (RealtimeAnalyzer::startCapture; start on the polling
+ * thread); returns 1 on success */
+int    hp_rt_capture_start(void* h, const char* path);
+void   hp_rt_capture_stop(void* h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEARTPY_C_H */
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "heartpy_core.h"
+
+// Columnar binary encoding of a HeartMetrics for bridge transfer: one
+// contiguous little-endian buffer that JS can wrap in typed-array views
+// without per-element marshaling. Every section is 8-byte aligned.
+//
+//   offset 0                 ResultBinaryHeader
+//   kScalarsOffset           double[SCALAR_COUNT]    (ResultScalar)
+//   kIntsOffset              int32[INT_COUNT]        (ResultInt)
+//   kDirectoryOffset         ResultColumnEntry[COLUMN_COUNT], always
+//                            all columns in enum order (count may be 0)
+//   entry.offset             column data (padded to 8)
+//
+// Waveform samples travel as float32; waveform timestamps as float32 seconds
+// relative to WAVEFORM_T0, the first timestamp (about 8 us resolution over a
+// 60 s window). Everything else is exact. Nested segments are not encoded.
+
+namespace heartpy {
+
+namespace columnar {
+
+constexpr uint32_t kMagic = 0x42525048u; // "HPRB" as little-endian bytes
+constexpr uint16_t kVersion = 2; // v2: STAGE_ALLOCS column
+
+struct ResultBinaryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t totalSize;   // bytes, including padding of the last column
+    uint32_t columnCount; // ResultColumn::COUNT when written
+};
+
+enum ResultScalar : uint32_t {
+    BPM = 0, SDNN, RMSSD, SDSD, PNN20, PNN50, NN20, NN50, MAD,
+    SD1, SD2, SD1SD2_RATIO, ELLIPSE_AREA,
+    VLF, LF, HF, LFHF, TOTAL_POWER, LF_NORM, HF_NORM, BREATHING_RATE,
+    REJECTION_RATE, SNR_DB, CONFIDENCE, F0_HZ, MA_PERC_ACTIVE, SNR_SAMPLE_COUNT,
+    REFRACTORY_MS_ACTIVE, MIN_RR_BOUND_MS, PAIR_FRAC, RR_SHORT_FRAC, RR_LONG_MS, P_HALF_OVER_FUND,
+    PROVISIONAL_BPM, PROVISIONAL_CONFIDENCE,
+    WAVEFORM_T0, // base of the WAVEFORM_TIMESTAMPS column
+    SCALAR_COUNT
+};
+
+enum ResultInt : uint32_t {
+    TOTAL_BEATS = 0, REJECTED_BEATS, GOOD_QUALITY, DOUBLING_FLAG, SOFT_DOUBLING_FLAG, DOUBLING_HINT_FLAG,
+    HARD_FALLBACK_ACTIVE, RR_FALLBACK_MODE_ACTIVE, SNR_WARMUP_ACTIVE, PROVISIONAL_ACTIVE,
+    INT_COUNT
+};
+
+enum ResultColumn : uint32_t {
+    IBI_MS = 0,          // f64
+    RR_LIST,             // f64
+    PEAK_LIST,           // i32
+    PEAK_TIMESTAMPS,     // f64
+    PEAK_LIST_RAW,       // i32
+    BINARY_PEAK_MASK,    // i32
+    WAVEFORM_VALUES,     // f32
+    WAVEFORM_TIMESTAMPS, // f32, seconds after WAVEFORM_T0
+    BINARY_SEGMENTS,     // i32, 6 per segment: index, startBeat, endBeat, totalBeats, rejectedBeats, accepted
+    TIMINGS_US,          // f64, StageTimings::COUNT values when timings are valid, else empty
+    QUALITY_WARNING,     // u8, UTF-8 without terminator
+    STAGE_ALLOCS,        // f64, StageTimings::COUNT allocation counts when allocsValid, else empty
+    COLUMN_COUNT
+};
+
+enum ColumnType : uint32_t { F64 = 1, F32 = 2, I32 = 3, U8 = 4 };
+
+struct ResultColumnEntry {
+    uint32_t type;   // ColumnType
+    uint32_t count;  // elements
+    uint32_t offset; // bytes from the start of the buffer
+    uint32_t reserved;
+};
+
+constexpr size_t kScalarsOffset = 16;
+constexpr size_t kIntsOffset = kScalarsOffset + 8 * SCALAR_COUNT;
+constexpr size_t kDirectoryOffset = kIntsOffset + ((4 * INT_COUNT + 7) & ~size_t(7));
+constexpr size_t kDataOffset = kDirectoryOffset + sizeof(ResultColumnEntry) * COLUMN_COUNT;
+
+} // namespace columnar
+
+// Size of the encoding of r
+size_t encodedMetricsSize(const HeartMetrics& r);
+// Encodes r into out[0, cap). Returns the bytes written, or 0 if cap is
+// smaller than encodedMetricsSize(r).
+size_t encodeMetrics(const HeartMetrics& r, uint8_t* out, size_t cap);
+// Resizes out to the encoding of r (reusing its capacity)
+void encodeMetrics(const HeartMetrics& r, std::vector<uint8_t>& out);
+// Decodes a buffer written by encodeMetrics. Returns false if it is not a
+// complete encoding of this version. Fields without a column keep their defaults.
+bool decodeMetrics(const uint8_t* data, size_t size, HeartMetrics& out);
+
+} // namespace heartpy
@@ -2,6 +2,14 @@
 
 #include <vector>
 #include <functional>
+#include <string>
+#include <memory>
+#include <complex>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "heartpy_snapshot.h"
+#include "heartpy_view.h"
 
 #ifdef USE_KISSFFT
 #include "kiss_fftr.h"
@@ -135,6 +143,40 @@ struct Options {
     
     // Deterministic mode (runtime): prefer scalar/DFT paths, snap EMA cadence
     bool deterministic = false; // default OFF
+
+    // Stage profiling: fill HeartMetrics::timings (steady clock, ~2 clock reads per stage)
+    bool profileStages = false; // default OFF
+
+    // Streaming: analyze poll windows as float32, the precision of the
+    // filtered buffer, instead of widening them to double. Accumulations stay
+    // double; results can differ from the double path in the last digits.
+    bool singlePrecision = false; // default OFF
+
+    // Output selection for analyzeSignal()/poll(). BPM and the quality block
+    // are always produced; unselected groups are neither computed nor copied
+    // (vectors stay empty, scalars keep their defaults, frequency domain NaN).
+    enum Output : uint32_t {
+        OUTPUT_PEAKS       = 1u << 0, // peakList (+ peakTimestamps when streaming)
+        OUTPUT_PEAKS_RAW   = 1u << 1, // peakListRaw, binaryPeakMask
+        OUTPUT_RR          = 1u << 2, // ibiMs, rrList
+        OUTPUT_TIME_DOMAIN = 1u << 3, // SDNN/RMSSD/SDSD/pNN/MAD, Poincare
+        OUTPUT_BREATHING   = 1u << 4, // breathingRate
+        OUTPUT_FREQ_DOMAIN = 1u << 5, // VLF/LF/HF, LF/HF (still gated by calcFreq)
+        OUTPUT_WAVEFORM    = 1u << 6, // streaming waveform_values/waveform_timestamps
+        OUTPUT_ALL         = 0x7Fu
+    };
+    // Named profiles
+    static constexpr uint32_t PROFILE_HR_ONLY = 0u;
+    static constexpr uint32_t PROFILE_TIME_DOMAIN_HRV = OUTPUT_RR | OUTPUT_TIME_DOMAIN;
+    static constexpr uint32_t PROFILE_FULL = OUTPUT_ALL;
+    uint32_t outputs = PROFILE_FULL;
+    bool wants(uint32_t output) const { return (outputs & output) != 0; }
+
+    // Streaming warm-up: provisional BPM from the autocorrelation of the short
+    // filtered window until SNR/confidence gating opens, then a cross-fade
+    bool provisionalHR = true;             // default ON
+    double provisionalMinSec = 3.0;        // seconds of signal before the first estimate
+    double provisionalMinConfidence = 0.5; // min normalized autocorrelation to report it as bpm
 };
 
 // Quality information structure
@@ -167,21 +209,41 @@ struct QualityInfo {
     int    rrFallbackModeActive = 0; // 1 when RR-only fallback mode gating is active (debug)
     int    snrWarmupActive = 0;      // 1 when SNR warm-up guard is active
     double snrSampleCount = 0.0;     // samples available to SNR computation
+    // Provisional HR (streaming warm-up, Options::provisionalHR)
+    int    provisionalActive = 0;       // 1 when bpm is the provisional estimate
+    double provisionalBpm = 0.0;        // autocorrelation estimate (0 if not computed)
+    double provisionalConfidence = 0.0; // autocorrelation peak height (0..1)
+
+    // Cumulative audit counters (dropped samples, timestamp backtracks, PSD
+    // fallbacks, ...) are not part of results; read them from
+    // metrics::registry() (heartpy_metrics.h).
+};
 
-    // Audit/telemetry (non-blocking; full JSON only)
-    unsigned long long droppedSamplesTotal = 0;      // cumulative samples dropped (vector path trimming)
-    unsigned long long clampedBatchesTotal = 0;      // times input batches were clamped
-    unsigned long long oomPreventedTotal = 0;        // times capacity was saturated via safe sizing
-    unsigned long long paramChangeEventsTotal = 0;   // parameter change events (window/preset/update interval)
-    int mergeBudgetExhausted = 0;                    // 1 if this poll hit merge budget cap
-    unsigned long long mergeBudgetExhaustedTotal = 0;// cumulative polls hitting merge cap
-    // Per-poll deltas and timestamp events
-    unsigned long long droppedSamplesLast = 0;       // samples dropped in this poll's trimming
-    unsigned long long clampedBatchesLast = 0;       // batches clamped in this poll
-    unsigned long long timestampBacktrackEventsTotal = 0; // non-monotonic timestamp events (cumulative)
-    unsigned long long timestampsSkippedTotal = 0;   // timestamps skipped due to backtrack (cumulative)
-    unsigned long long timeJumpEventsTotal = 0;      // dt > threshold events (cumulative)
-    int droppingActive = 0;                          // 1 if consecutive drops observed recently
+// Per-stage wall time of one analyzeSignal()/poll() in microseconds
+// (Options::profileStages). Stages that did not run stay 0.
+struct StageTimings {
+    enum Stage {
+        PREPROCESS = 0, // clipping/hampel/baseline/enhance + offset
+        DETREND,
+        FILTER,         // bandpass / filtfilt
+        PEAK_FIT,       // scaling, fit_peaks, refinement, quality assessment
+        RR_CLEAN,       // check_peaks, segment rejection, threshold_rr, cleanRR
+        TIME_DOMAIN,    // BPM, SDNN/RMSSD/pNN, Poincare
+        SPLINE,         // RR smoothing + cubic resampling (calcFreq)
+        WELCH,          // RR Welch + band integration, breathing PSD
+        POLL_COPY,      // streaming: window snapshot under the data lock
+        SNR,            // streaming: PSD/SNR update
+        HARMONIC,       // streaming: doubling/harmonic suppression logic
+        TOTAL,
+        COUNT
+    };
+    double us[COUNT] = {};
+    bool valid = false;
+    // Heap allocations per stage; filled only in HEARTPY_ALLOC_AUDIT builds
+    uint64_t allocs[COUNT] = {};
+    uint64_t allocBytes[COUNT] = {};
+    bool allocsValid = false;
+    static const char* name(int stage);
 };
 
 // Enhanced metrics structure matching Python HeartPy
@@ -195,9 +257,11 @@ struct HeartMetrics {
     std::vector<int> peakListRaw; // pre-cleaning peaks
     std::vector<int> binaryPeakMask; // 1=accepted, 0=rejected (aligned to peakListRaw)
 
-	// Snapshot waveforms (synchronized with current analysis window)
-	std::vector<double> waveform_values;
-	std::vector<double> waveform_timestamps;
+	// Snapshot waveforms (synchronized with current analysis window). Shared,
+	// immutable buffers: copying the result or keeping these does not copy
+	// samples (heartpy_snapshot.h)
+	SharedSamples<double> waveform_values;
+	SharedSamples<double> waveform_timestamps;
 
 	// Time domain measures
 	double sdnn = 0.0;
@@ -243,18 +307,120 @@ struct HeartMetrics {
         bool accepted = true;   // whether segment passes threshold
     };
     std::vector<BinarySegment> binarySegments;
+
+    // Opt-in stage latency breakdown (Options::profileStages)
+    StageTimings timings;
 };
 
+struct ExecutionContext;
+
+// Read-mostly cache of FFT plans for the compiled backend (vDSP/KissFFT).
+// Lookups go through a small per-thread cache first (one atomic load, no
+// locks on a hit), then an immutable published snapshot; inserts
+// copy the snapshot and republish it under a writer-only mutex. Plans are
+// immutable and shared by all threads (per-call work buffers come from the
+// ExecutionContext scratch). They are reference-counted, so evict()/clear()
+// never free a plan another thread is still using; both bump a generation
+// that makes per-thread slots of this cache drop their reference on the
+// thread's next lookup.
+class FftPlanCache {
+public:
+    struct Plan; // backend-specific, defined in heartpy_core.cpp
+
+    FftPlanCache();
+    ~FftPlanCache();
+    FftPlanCache(const FftPlanCache&) = delete;
+    FftPlanCache& operator=(const FftPlanCache&) = delete;
+
+    // Returns the plan for nfft (power of two), creating it on first use.
+    // The pointer stays valid for the calling thread until it looks up more
+    // distinct (cache, nfft) pairs than its per-thread slots hold.
+    const Plan* acquire(int nfft, const ExecutionContext& ctx);
+    void evict(int nfft);
+    void clear();
+    size_t size() const;
+
+private:
+    struct Snapshot;
+    std::shared_ptr<const Snapshot> loadSnapshot() const;
+
+    const uint64_t id_;
+    std::atomic<uint64_t> generation_{0};      // bumped by evict()/clear(); stale thread slots miss
+    std::shared_ptr<const Snapshot> snapshot_; // accessed via std::atomic_load/atomic_store
+    std::mutex writeMutex_;                    // serializes copy-on-insert/evict only
+};
+std::shared_ptr<FftPlanCache> makeFftPlanCache();
+
+// Execution context for the analysis routines: determinism, FFT backend, plan
+// cache, Welch scratch buffers and log sink. A context is not thread-safe by
+// itself -- give each analyzer/thread its own. Overloads without a context use
+// defaultExecutionContext(), which is thread-local, so concurrent callers never
+// share mutable state beyond the synchronized plan cache.
+struct ExecutionContext {
+    enum class FftBackend { AUTO, DFT }; // AUTO: compiled FFT for power-of-two nfft; DFT: always naive DFT
+    using LogSink = std::function<void(const char* tag, const char* message)>;
+
+    bool deterministic = false;               // force naive DFT (bit-stable spectra across backends)
+    FftBackend fftBackend = FftBackend::AUTO;
+    std::shared_ptr<FftPlanCache> planCache;  // null: process-wide shared cache
+    LogSink logSink;                          // null: platform default (logcat/os_log/stderr)
+    bool logEnabled = true;
+
+    // Reusable Welch buffers (grown on demand, never shrunk)
+    struct Scratch {
+        std::vector<double> window;           // Hann window cached for windowNfft
+        int windowNfft = 0;
+        std::vector<double> re, im;
+        std::vector<float> fin, fout;         // fout: interleaved re/im (kiss_fft_cpx layout)
+        std::vector<float> fwork;             // KissFFT work buffer, nfft/2 interleaved re/im
+        std::vector<std::complex<double>> cbuf;
+    } scratch;
+
+    bool useDft() const { return deterministic || fftBackend == FftBackend::DFT; }
+    void log(const char* tag, const char* fmt, ...) const
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__((format(printf, 3, 4)))
+#endif
+        ;
+};
+
+// Calling thread's default context (used by the overloads without a context)
+ExecutionContext& defaultExecutionContext();
+
+// First-call warm-up. prewarmFftPlans builds the FFT plans for the given
+// Welch sizes and grows ctx's scratch to fit them; the Hann window of the
+// last size stays cached. Sizes below 64 are skipped (Welch rejects them).
+// prewarmAnalysis runs one dummy analyzeSignal over windowSec of synthetic
+// PPG at fs, which touches every stage's plans, scratch and code. Plans are
+// shared, but scratch and the per-thread plan slots are not, so call both on
+// the thread that will run the analysis.
+void prewarmFftPlans(const std::vector<int>& nffts, ExecutionContext& ctx);
+void prewarmAnalysis(double fs, double windowSec, const Options& opt, ExecutionContext& ctx);
+
 // Main API functions matching Python HeartPy interface
 
 // Primary analysis function (equivalent to hp.process)
 HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt = {});
+HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt, ExecutionContext& ctx);
+// float32 pipeline: signal-length stages stay in float (half the memory
+// traffic of double); sums, RR and spectral statistics are still double
+HeartMetrics analyzeSignal(const std::vector<float>& signal, double fs, const Options& opt = {});
+HeartMetrics analyzeSignal(const std::vector<float>& signal, double fs, const Options& opt, ExecutionContext& ctx);
+// Non-owning views (heartpy_view.h): packed or strided arrays, record fields
+HeartMetrics analyzeSignal(SampleView<double> signal, double fs, const Options& opt = {});
+HeartMetrics analyzeSignal(SampleView<double> signal, double fs, const Options& opt, ExecutionContext& ctx);
+HeartMetrics analyzeSignal(SampleView<float> signal, double fs, const Options& opt = {});
+HeartMetrics analyzeSignal(SampleView<float> signal, double fs, const Options& opt, ExecutionContext& ctx);
 
 // Segmentwise analysis (equivalent to hp.process_segmentwise)
 HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double fs, const Options& opt = {});
+HeartMetrics analyzeSignalSegmentwise(const std::vector<double>& signal, double fs, const Options& opt, ExecutionContext& ctx);
 
 // RR-only analysis (equivalent to hp.process_rr)
 HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options& opt = {});
+HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options& opt, ExecutionContext& ctx);
+HeartMetrics analyzeRRIntervals(SampleView<double> rrMs, const Options& opt = {});
+HeartMetrics analyzeRRIntervals(SampleView<double> rrMs, const Options& opt, ExecutionContext& ctx);
 
 // Preprocessing functions
 std::vector<double> interpolateClipping(const std::vector<double>& signal, double fs, double threshold = 1020.0);
@@ -262,6 +428,7 @@ std::vector<double> hampelFilter(const std::vector<double>& signal, int windowSi
 std::vector<double> removeBaselineWander(const std::vector<double>& signal, double fs);
 std::vector<double> enhancePeaks(const std::vector<double>& signal, double fs);
 std::vector<double> scaleData(const std::vector<double>& signal, double newMin = 0.0, double newMax = 1024.0);
+std::vector<float> scaleData(const std::vector<float>& signal, double newMin = 0.0, double newMax = 1024.0);
 
 // Outlier detection functions
 std::vector<double> removeOutliersIQR(const std::vector<double>& data, double& lowerBound, double& upperBound);
@@ -284,12 +451,25 @@ double calculateMAD(const std::vector<double>& data); // Median Absolute Deviati
 std::vector<double> calculatePoincare(const std::vector<double>& rrIntervals);
 std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(const std::vector<double>& signal, 
                                                                         double fs, int nfft = 256, double overlap = 0.5);
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(const std::vector<double>& signal,
+                                                                        double fs, int nfft, double overlap,
+                                                                        ExecutionContext& ctx);
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(const std::vector<float>& signal,
+                                                                        double fs, int nfft, double overlap,
+                                                                        ExecutionContext& ctx);
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(SampleView<double> signal,
+                                                                        double fs, int nfft, double overlap,
+                                                                        ExecutionContext& ctx);
+std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(SampleView<float> signal,
+                                                                        double fs, int nfft, double overlap,
+                                                                        ExecutionContext& ctx);
 
 // Diagnostics for PSD guard fallbacks
 unsigned long long getWelchPsdGuardFallbackCount();
 unsigned long long getWelchPsdGuardFailureCount();
 
-// Global deterministic toggle for core spectral routines (runtime)
+// Legacy deterministic toggle: sets defaultExecutionContext().deterministic
+// for the calling thread only (prefer an explicit ExecutionContext)
 void setDeterministic(bool on);
 bool isDeterministic();
 
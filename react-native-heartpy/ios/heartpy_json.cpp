@@ -0,0 +1,250 @@
+#include "heartpy_json.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Floating-point std::to_chars: libstdc++ 11+ and MSVC advertise it; libc++
+// has had it since LLVM 14 without the feature macro, but Apple platforms
+// gate it on the deployment target, so they take the snprintf fallback.
+#if defined(__cpp_lib_to_chars) || (defined(_LIBCPP_VERSION) && _LIBCPP_VERSION >= 14000 && !defined(__APPLE__))
+#define HEARTPY_JSON_TO_CHARS 1
+#else
+#define HEARTPY_JSON_TO_CHARS 0
+#endif
+
+namespace heartpy {
+
+namespace {
+
+constexpr size_t kNumberMax = 32; // longest double/integer text plus slack
+
+size_t writeUnsigned(char* p, unsigned long long v) {
+    char tmp[24];
+    size_t n = 0;
+    do { tmp[n++] = static_cast<char>('0' + v % 10); v /= 10; } while (v);
+    for (size_t i = 0; i < n; ++i) p[i] = tmp[n - 1 - i];
+    return n;
+}
+
+size_t writeInteger(char* p, long long v) {
+    if (v < 0) {
+        *p = '-';
+        return 1 + writeUnsigned(p + 1, 0ull - static_cast<unsigned long long>(v));
+    }
+    return writeUnsigned(p, static_cast<unsigned long long>(v));
+}
+
+size_t writeShortest(char* p, double v) {
+    if (!std::isfinite(v)) { std::memcpy(p, "null", 4); return 4; }
+    // Counts, flags and whole-valued results: exact integers, no libc call
+    if (std::fabs(v) < 1e15 && v == std::trunc(v)) return writeInteger(p, static_cast<long long>(v));
+#if HEARTPY_JSON_TO_CHARS
+    const auto r = std::to_chars(p, p + kNumberMax, v);
+    return static_cast<size_t>(r.ptr - p);
+#else
+    int n = 0;
+    for (int prec = 15; prec <= 17; ++prec) {
+        n = std::snprintf(p, kNumberMax, "%.*g", prec, v);
+        if (prec == 17 || std::strtod(p, nullptr) == v) break;
+    }
+    // snprintf/strtod follow LC_NUMERIC; JSON always wants '.'
+    for (int i = 0; i < n; ++i) {
+        const char c = p[i];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == 'e' || c == 'E')) p[i] = '.';
+    }
+    return static_cast<size_t>(n);
+#endif
+}
+
+size_t writeFixed(char* p, double v, int decimals) {
+    static const double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    static const long long kPow10i[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    if (decimals < 0) return writeShortest(p, v);
+    if (decimals > 9) decimals = 9;
+    const double scaled = v * kPow10[decimals];
+    if (!(std::fabs(scaled) < 9e15)) return writeShortest(p, v); // also NaN/inf
+    long long q = std::llround(scaled);
+    size_t n = 0;
+    if (q < 0) { p[n++] = '-'; q = -q; }
+    n += writeUnsigned(p + n, static_cast<unsigned long long>(q / kPow10i[decimals]));
+    long long frac = q % kPow10i[decimals];
+    if (frac) {
+        int digits = decimals;
+        while (frac % 10 == 0) { frac /= 10; --digits; }
+        p[n++] = '.';
+        for (int i = digits - 1; i >= 0; --i) { p[n + i] = static_cast<char>('0' + frac % 10); frac /= 10; }
+        n += static_cast<size_t>(digits);
+    }
+    return n;
+}
+
+} // namespace
+
+void JsonWriter::raw(const char* s) { out_.append(s); }
+
+void JsonWriter::key(const char* k) {
+    out_.push_back('"');
+    out_.append(k);
+    out_.append("\":", 2);
+}
+
+void JsonWriter::number(double v) {
+    char buf[kNumberMax];
+    out_.append(buf, writeShortest(buf, v));
+}
+
+void JsonWriter::number(double v, int decimals) {
+    char buf[kNumberMax];
+    out_.append(buf, writeFixed(buf, v, decimals));
+}
+
+void JsonWriter::integer(long long v) {
+    char buf[kNumberMax];
+    out_.append(buf, writeInteger(buf, v));
+}
+
+void JsonWriter::string(const std::string& s) {
+    static const char kHex[] = "0123456789abcdef";
+    out_.push_back('"');
+    for (char c : s) {
+        const unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') { out_.push_back('\\'); out_.push_back(c); }
+        else if (u < 0x20) {
+            const char esc[6] = {'\\', 'u', '0', '0', kHex[u >> 4], kHex[u & 15]};
+            out_.append(esc, 6);
+        } else out_.push_back(c);
+    }
+    out_.push_back('"');
+}
+
+void JsonWriter::array(const double* v, size_t n, int decimals) {
+    // Reserve for the whole array up front; the per-element appends below
+    // then never reallocate
+    out_.reserve(out_.size() + 2 + n * (decimals >= 0 ? 14 : 25));
+    char buf[kNumberMax];
+    out_.push_back('[');
+    for (size_t i = 0; i < n; ++i) {
+        if (i) out_.push_back(',');
+        out_.append(buf, decimals >= 0 ? writeFixed(buf, v[i], decimals) : writeShortest(buf, v[i]));
+    }
+    out_.push_back(']');
+}
+
+void JsonWriter::array(const int* v, size_t n) {
+    out_.reserve(out_.size() + 2 + n * 12);
+    char buf[kNumberMax];
+    out_.push_back('[');
+    for (size_t i = 0; i < n; ++i) {
+        if (i) out_.push_back(',');
+        out_.append(buf, writeInteger(buf, v[i]));
+    }
+    out_.push_back(']');
+}
+
+void appendMetricsJson(std::string& out, const HeartMetrics& r, const JsonOptions& jopt) {
+    JsonWriter w(out);
+    bool first = true;
+    auto sep = [&] { if (!first) w.raw(','); first = false; };
+    auto kv = [&](const char* k, double v) { sep(); w.key(k); w.number(v); };
+    auto arr = [&](const char* k, const std::vector<double>& v) { sep(); w.key(k); w.array(v.data(), v.size()); };
+    auto arrI = [&](const char* k, const std::vector<int>& v) { sep(); w.key(k); w.array(v.data(), v.size()); };
+
+    w.raw('{');
+    if (jopt.wants(JsonOptions::FIELD_SCALARS)) {
+        kv("bpm", r.bpm);
+        kv("sdnn", r.sdnn); kv("rmssd", r.rmssd); kv("sdsd", r.sdsd);
+        kv("pnn20", r.pnn20); kv("pnn50", r.pnn50); kv("nn20", r.nn20); kv("nn50", r.nn50); kv("mad", r.mad);
+        kv("sd1", r.sd1); kv("sd2", r.sd2); kv("sd1sd2Ratio", r.sd1sd2Ratio); kv("ellipseArea", r.ellipseArea);
+        kv("vlf", r.vlf); kv("lf", r.lf); kv("hf", r.hf); kv("lfhf", r.lfhf); kv("totalPower", r.totalPower);
+        kv("lfNorm", r.lfNorm); kv("hfNorm", r.hfNorm);
+        kv("breathingRate", r.breathingRate);
+    }
+    if (jopt.wants(JsonOptions::FIELD_BEATS)) {
+        arr("ibiMs", r.ibiMs); arr("rrList", r.rrList); arrI("peakList", r.peakList);
+        arr("peakTimestamps", r.peakTimestamps);
+    }
+    if (jopt.wants(JsonOptions::FIELD_WAVEFORM)) {
+        sep(); w.key("waveform_values");
+        w.array(r.waveform_values.data(), r.waveform_values.size(), jopt.waveformDecimals);
+        sep(); w.key("waveform_timestamps");
+        w.array(r.waveform_timestamps.data(), r.waveform_timestamps.size(), jopt.waveformDecimals);
+    }
+    if (jopt.wants(JsonOptions::FIELD_PEAKS_RAW)) {
+        arrI("peakListRaw", r.peakListRaw); arrI("binaryPeakMask", r.binaryPeakMask);
+    }
+    if (jopt.wants(JsonOptions::FIELD_QUALITY)) {
+        const QualityInfo& q = r.quality;
+        sep(); w.key("quality"); w.raw('{');
+        first = true;
+        auto ki = [&](const char* k, long long v) { sep(); w.key(k); w.integer(v); };
+        ki("totalBeats", q.totalBeats); ki("rejectedBeats", q.rejectedBeats); kv("rejectionRate", q.rejectionRate);
+        sep(); w.key("goodQuality"); w.boolean(q.goodQuality);
+        kv("snrDb", q.snrDb); kv("confidence", q.confidence); kv("f0Hz", q.f0Hz); kv("maPercActive", q.maPercActive);
+        ki("doublingFlag", q.doublingFlag); ki("softDoublingFlag", q.softDoublingFlag);
+        ki("doublingHintFlag", q.doublingHintFlag); ki("hardFallbackActive", q.hardFallbackActive);
+        ki("rrFallbackModeActive", q.rrFallbackModeActive); ki("snrWarmupActive", q.snrWarmupActive);
+        kv("snrSampleCount", q.snrSampleCount); kv("refractoryMsActive", q.refractoryMsActive);
+        kv("minRRBoundMs", q.minRRBoundMs); kv("pairFrac", q.pairFrac); kv("rrShortFrac", q.rrShortFrac);
+        kv("rrLongMs", q.rrLongMs); kv("pHalfOverFund", q.pHalfOverFund);
+        ki("provisionalActive", q.provisionalActive); kv("provisionalBpm", q.provisionalBpm);
+        kv("provisionalConfidence", q.provisionalConfidence);
+        if (!q.qualityWarning.empty()) { sep(); w.key("qualityWarning"); w.string(q.qualityWarning); }
+        w.raw('}');
+        first = false;
+    }
+    if (jopt.wants(JsonOptions::FIELD_TIMINGS)) {
+        if (r.timings.valid) {
+            sep(); w.key("timingsUs"); w.raw('{');
+            for (int s = 0; s < StageTimings::COUNT; ++s) {
+                if (s) w.raw(',');
+                w.key(StageTimings::name(s)); w.number(r.timings.us[s]);
+            }
+            w.raw('}');
+        }
+        if (r.timings.allocsValid) {
+            sep(); w.key("stageAllocs"); w.raw('{');
+            for (int s = 0; s < StageTimings::COUNT; ++s) {
+                if (s) w.raw(',');
+                w.key(StageTimings::name(s)); w.integer(static_cast<long long>(r.timings.allocs[s]));
+            }
+            w.raw('}');
+        }
+    }
+    if (jopt.wants(JsonOptions::FIELD_BINARY_SEGMENTS)) {
+        sep(); w.key("binarySegments"); w.raw('[');
+        for (size_t i = 0; i < r.binarySegments.size(); ++i) {
+            const auto& bs = r.binarySegments[i];
+            if (i) w.raw(',');
+            w.raw("{\"index\":"); w.integer(bs.index);
+            w.raw(",\"startBeat\":"); w.integer(bs.startBeat);
+            w.raw(",\"endBeat\":"); w.integer(bs.endBeat);
+            w.raw(",\"totalBeats\":"); w.integer(bs.totalBeats);
+            w.raw(",\"rejectedBeats\":"); w.integer(bs.rejectedBeats);
+            w.raw(",\"accepted\":"); w.boolean(bs.accepted);
+            w.raw('}');
+        }
+        w.raw(']');
+    }
+    if (jopt.wants(JsonOptions::FIELD_SEGMENTS)) {
+        JsonOptions inner = jopt;
+        inner.fields &= ~static_cast<uint32_t>(JsonOptions::FIELD_SEGMENTS);
+        sep(); w.key("segments"); w.raw('[');
+        for (size_t i = 0; i < r.segments.size(); ++i) {
+            if (i) w.raw(',');
+            appendMetricsJson(out, r.segments[i], inner);
+        }
+        w.raw(']');
+    }
+    w.raw('}');
+}
+
+std::string metricsJson(const HeartMetrics& r, const JsonOptions& jopt) {
+    std::string out;
+    appendMetricsJson(out, r, jopt);
+    return out;
+}
+
+} // namespace heartpy
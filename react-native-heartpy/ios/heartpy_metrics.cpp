@@ -0,0 +1,235 @@
+#include "heartpy_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace heartpy {
+namespace metrics {
+
+namespace {
+
+std::mutex& registryMutex() { static std::mutex m; return m; }
+std::vector<const MetricGroup*>& groups() {
+    static std::vector<const MetricGroup*> g;
+    return g;
+}
+
+const char* typeName(MetricType t) {
+    switch (t) {
+        case MetricType::COUNTER: return "counter";
+        case MetricType::GAUGE: return "gauge";
+        default: return "summary";
+    }
+}
+
+constexpr double kQuantiles[3] = {0.5, 0.9, 0.99};
+
+void appendEscaped(std::string& out, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+}
+
+void appendNumber(std::string& out, double v) {
+    char buf[32];
+    if (std::isnan(v)) { out += "NaN"; return; }
+    if (std::isinf(v)) { out += v > 0 ? "+Inf" : "-Inf"; return; }
+    std::snprintf(buf, sizeof(buf), "%.10g", v);
+    out += buf;
+}
+
+// JSON has no NaN/Inf literals
+void appendJsonNumber(std::string& out, double v) {
+    if (std::isfinite(v)) appendNumber(out, v); else out += "null";
+}
+
+void appendPromLabels(std::string& out, const Labels& labels, const char* extraKey = nullptr, const char* extraVal = nullptr) {
+    if (labels.empty() && !extraKey) return;
+    out += '{';
+    bool first = true;
+    for (const auto& kv : labels) {
+        if (!first) out += ',';
+        first = false;
+        out += kv.first; out += "=\""; appendEscaped(out, kv.second); out += '"';
+    }
+    if (extraKey) {
+        if (!first) out += ',';
+        out += extraKey; out += "=\""; out += extraVal; out += '"';
+    }
+    out += '}';
+}
+
+size_t copyOut(const std::string& s, char* buf, size_t cap) {
+    if (buf && cap > 0) {
+        const size_t n = std::min(cap - 1, s.size());
+        std::memcpy(buf, s.data(), n);
+        buf[n] = '\0';
+    }
+    return s.size();
+}
+
+} // namespace
+
+int Counter::shardIndex() {
+    static std::atomic<int> next {0};
+    thread_local const int idx = next.fetch_add(1, std::memory_order_relaxed) & (kShards - 1);
+    return idx;
+}
+
+MetricGroup::MetricGroup(Labels labels) : labels_(std::move(labels)) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    groups().push_back(this);
+}
+
+MetricGroup::~MetricGroup() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto& g = groups();
+    g.erase(std::remove(g.begin(), g.end(), this), g.end());
+}
+
+void MetricGroup::setExported(bool on) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    if (on == exported_) return;
+    exported_ = on;
+    auto& g = groups();
+    if (on) g.push_back(this);
+    else g.erase(std::remove(g.begin(), g.end(), this), g.end());
+}
+
+void MetricGroup::addEntry(const char* name, const char* help, MetricType type, Labels extra, const void* obj) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    entries_.push_back(Entry{name, help ? help : "", type, std::move(extra), obj});
+}
+
+void MetricGroup::add(const char* name, const char* help, const Counter& c, Labels extra) {
+    addEntry(name, help, MetricType::COUNTER, std::move(extra), &c);
+}
+void MetricGroup::add(const char* name, const char* help, const Gauge& g, Labels extra) {
+    addEntry(name, help, MetricType::GAUGE, std::move(extra), &g);
+}
+void MetricGroup::add(const char* name, const char* help, const LatencyHistogram& h, Labels extra) {
+    addEntry(name, help, MetricType::SUMMARY, std::move(extra), &h);
+}
+
+std::vector<MetricSample> Registry::collect() const {
+    std::vector<MetricSample> out;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const MetricGroup* g : groups()) {
+            for (const auto& e : g->entries_) {
+                MetricSample s;
+                s.name = e.name;
+                s.help = e.help;
+                s.type = e.type;
+                s.labels = g->labels_;
+                s.labels.insert(s.labels.end(), e.extra.begin(), e.extra.end());
+                switch (e.type) {
+                    case MetricType::COUNTER:
+                        s.value = static_cast<double>(static_cast<const Counter*>(e.obj)->value());
+                        break;
+                    case MetricType::GAUGE:
+                        s.value = static_cast<const Gauge*>(e.obj)->value();
+                        break;
+                    case MetricType::SUMMARY: {
+                        const auto* h = static_cast<const LatencyHistogram*>(e.obj);
+                        s.count = h->count();
+                        s.value = h->meanUs() * static_cast<double>(s.count) * 1e-6;
+                        for (size_t i = 0; i < s.quantiles.size(); ++i) s.quantiles[i] = h->percentileUs(kQuantiles[i]) * 1e-6;
+                        break;
+                    }
+                }
+                out.push_back(std::move(s));
+            }
+        }
+    }
+    std::stable_sort(out.begin(), out.end(), [](const MetricSample& a, const MetricSample& b) { return a.name < b.name; });
+    return out;
+}
+
+std::string Registry::prometheusText() const {
+    const std::vector<MetricSample> samples = collect();
+    std::string out;
+    out.reserve(samples.size() * 96);
+    const std::string* family = nullptr;
+    for (const MetricSample& s : samples) {
+        if (!family || *family != s.name) {
+            out += "# HELP "; out += s.name; out += ' '; out += s.help; out += '\n';
+            out += "# TYPE "; out += s.name; out += ' '; out += typeName(s.type); out += '\n';
+            family = &s.name;
+        }
+        if (s.type == MetricType::SUMMARY) {
+            static const char* const kQNames[3] = {"0.5", "0.9", "0.99"};
+            for (size_t i = 0; i < s.quantiles.size(); ++i) {
+                out += s.name; appendPromLabels(out, s.labels, "quantile", kQNames[i]);
+                out += ' '; appendNumber(out, s.quantiles[i]); out += '\n';
+            }
+            out += s.name; out += "_sum"; appendPromLabels(out, s.labels);
+            out += ' '; appendNumber(out, s.value); out += '\n';
+            out += s.name; out += "_count"; appendPromLabels(out, s.labels);
+            out += ' '; out += std::to_string(s.count); out += '\n';
+        } else {
+            out += s.name; appendPromLabels(out, s.labels);
+            out += ' '; appendNumber(out, s.value); out += '\n';
+        }
+    }
+    return out;
+}
+
+std::string Registry::json() const {
+    const std::vector<MetricSample> samples = collect();
+    std::string out;
+    out.reserve(samples.size() * 128);
+    out += "{\"metrics\":[";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const MetricSample& s = samples[i];
+        if (i) out += ',';
+        out += "{\"name\":\""; out += s.name;
+        out += "\",\"type\":\""; out += typeName(s.type);
+        out += "\",\"labels\":{";
+        for (size_t j = 0; j < s.labels.size(); ++j) {
+            if (j) out += ',';
+            out += '"'; appendEscaped(out, s.labels[j].first); out += "\":\"";
+            appendEscaped(out, s.labels[j].second); out += '"';
+        }
+        out += '}';
+        if (s.type == MetricType::SUMMARY) {
+            out += ",\"count\":"; out += std::to_string(s.count);
+            out += ",\"sum\":"; appendJsonNumber(out, s.value);
+            out += ",\"p50\":"; appendJsonNumber(out, s.quantiles[0]);
+            out += ",\"p90\":"; appendJsonNumber(out, s.quantiles[1]);
+            out += ",\"p99\":"; appendJsonNumber(out, s.quantiles[2]);
+        } else {
+            out += ",\"value\":"; appendJsonNumber(out, s.value);
+        }
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+MetricGroup& processGroup() {
+    static MetricGroup g;
+    return g;
+}
+
+} // namespace metrics
+} // namespace heartpy
+
+extern "C" {
+size_t hp_metrics_prometheus(char* buf, size_t cap) {
+    return heartpy::metrics::copyOut(heartpy::metrics::registry().prometheusText(), buf, cap);
+}
+size_t hp_metrics_json(char* buf, size_t cap) {
+    return heartpy::metrics::copyOut(heartpy::metrics::registry().json(), buf, cap);
+}
+}
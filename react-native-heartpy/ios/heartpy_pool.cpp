@@ -0,0 +1,95 @@
+#include "heartpy_pool.h"
+#include "heartpy_trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace heartpy {
+
+AnalyzerPool::AnalyzerPool(size_t maxIdlePerClass) : maxIdlePerClass_(std::max<size_t>(1, maxIdlePerClass)) {}
+
+size_t AnalyzerPool::capacityClass(double fs, double windowSec) {
+    if (!(fs > 0.0)) fs = 50.0;
+    windowSec = std::clamp(std::isfinite(windowSec) ? windowSec : 60.0, 1.0, 300.0);
+    // Same margin the analyzer reserves beyond the window
+    const size_t need = static_cast<size_t>(std::ceil(windowSec * fs)) + 8 * static_cast<size_t>(std::ceil(fs));
+    size_t cls = 256;
+    while (cls < need) cls <<= 1;
+    return cls;
+}
+
+std::unique_ptr<RealtimeAnalyzer> AnalyzerPool::acquire(double fs, const Options& opt, double windowSec) {
+    trace::Span span("pool.acquire");
+    const size_t cls = capacityClass(fs, windowSec);
+    std::unique_ptr<RealtimeAnalyzer> a;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = idle_.find(cls);
+        if (it != idle_.end() && !it->second.empty()) {
+            a = std::move(it->second.back());
+            it->second.pop_back();
+            ++stats_.hits;
+        } else {
+            ++stats_.misses;
+        }
+    }
+    if (a) {
+        a->reset(fs, opt);
+        a->setWindowSeconds(windowSec);
+        // No prewarm: buffers and scratch are kept and FFT plans are shared
+        // process-wide, so a checkout stays O(1) with no large allocation
+        a->setMetricsExported(true);
+        return a;
+    }
+    a = std::make_unique<RealtimeAnalyzer>(fs, opt);
+    a->reserveSamples(cls);
+    a->setWindowSeconds(windowSec);
+    a->prewarm();
+    return a;
+}
+
+void AnalyzerPool::release(std::unique_ptr<RealtimeAnalyzer> analyzer) {
+    if (!analyzer) return;
+    // Largest class the buffers fully cover
+    const size_t cap = analyzer->reservedSamples();
+    if (cap < 256) return;
+    size_t cls = 256;
+    while ((cls << 1) <= cap) cls <<= 1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& bucket = idle_[cls];
+    if (bucket.size() >= maxIdlePerClass_) {
+        ++stats_.discarded;
+        return; // destroyed on scope exit, after the unlock
+    }
+    if (bucket.capacity() < maxIdlePerClass_) bucket.reserve(maxIdlePerClass_);
+    // An idle analyzer exports no series until it is checked out again
+    analyzer->setMetricsExported(false);
+    bucket.push_back(std::move(analyzer));
+}
+
+size_t AnalyzerPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& kv : idle_) n += kv.second.size();
+    return n;
+}
+
+AnalyzerPool::Stats AnalyzerPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void AnalyzerPool::clear() {
+    std::unordered_map<size_t, std::vector<std::unique_ptr<RealtimeAnalyzer>>> drop;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop.swap(idle_);
+    }
+}
+
+AnalyzerPool& sharedAnalyzerPool() {
+    static AnalyzerPool pool;
+    return pool;
+}
+
+} // namespace heartpy
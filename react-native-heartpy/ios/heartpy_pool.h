@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "heartpy_stream.h"
+
+// Recycles RealtimeAnalyzer instances across short sessions. Idle analyzers
+// are bucketed by capacity class: window samples (plus margin) rounded up to
+// a power of two. acquire() pops one from the matching bucket and reset()s it
+// in place. It keeps the window buffers and Welch scratch, and FFT plans are
+// shared process-wide, so a checkout does no large allocation and no warm-up
+// work. On a miss, acquire() constructs a new analyzer, reserves the full
+// class capacity and prewarms it. release() keeps at most maxIdlePerClass analyzers per
+// class and destroys the rest. Idle analyzers are hidden from
+// metrics::registry() until checked out again.
+
+namespace heartpy {
+
+class AnalyzerPool {
+public:
+    struct Stats {
+        uint64_t hits {0};      // checkouts served by a recycled analyzer
+        uint64_t misses {0};    // checkouts that constructed a new one
+        uint64_t discarded {0}; // releases dropped because the class was full
+    };
+
+    explicit AnalyzerPool(size_t maxIdlePerClass = 4);
+    AnalyzerPool(const AnalyzerPool&) = delete;
+    AnalyzerPool& operator=(const AnalyzerPool&) = delete;
+
+    // Analyzer configured for (fs, opt) with setWindowSeconds(windowSec)
+    // applied. A new analyzer (miss) is prewarmed, so call on the thread that
+    // will poll it; a recycled one is already warm from its earlier session.
+    std::unique_ptr<RealtimeAnalyzer> acquire(double fs, const Options& opt = {}, double windowSec = 60.0);
+    void release(std::unique_ptr<RealtimeAnalyzer> analyzer);
+
+    static size_t capacityClass(double fs, double windowSec);
+    size_t idle() const;
+    Stats stats() const;
+    // Destroys all idle analyzers
+    void clear();
+
+private:
+    const size_t maxIdlePerClass_;
+    mutable std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<std::unique_ptr<RealtimeAnalyzer>>> idle_;
+    Stats stats_ {};
+};
+
+// Process-wide pool (used by the C bridge when no pool is given)
+AnalyzerPool& sharedAnalyzerPool();
+
+} // namespace heartpy
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "heartpy_core.h"
+
+// Out-of-core analysis of recordings too long for one analyzeSignal call
+// (days of contact PPG at up to 1 kHz). The recording is read through
+// memory-mapped windows of a raw sample file, one chunk at a time. Every
+// chunk is analyzed together with a guard margin on each side. Only peaks in
+// its core range are kept, so each sample is owned by exactly one chunk, and
+// the filters and the rolling-mean threshold settle inside the margins.
+// Peaks are stitched across chunk boundaries on 64-bit sample indices. RR
+// and time-domain statistics accumulate online, so memory is bounded by the
+// chunk size. The full peak list is the only exception, and is kept only on
+// request. The window for the next chunk is mapped and read ahead while the
+// current one is analyzed, so a cold file is read at disk speed.
+//
+// Stitching is not exact in general. Each chunk fits its own ma_perc
+// threshold and amplitude scaling, as one analyzeSignal call does, and that
+// fit is global to the signal it sees. On 50 Hz PPG the stitched peaks equal
+// a single whole-signal call. At 30 and 100 Hz a beat near a marginal
+// threshold can move or be dropped. examples/recording_test.cpp asserts
+// beat counts within 0.2%, at most 2% of beats off the whole-signal index,
+// and moves of at most 0.15 s (observed: up to 0.12 s, 20 of 1400 beats).
+
+namespace heartpy {
+
+// Read-only raw sample file: native-endian float32 or float64 samples after
+// an optional header. Windows are mapped on demand, so the file size is not
+// limited by the address space.
+class SampleFile {
+public:
+    enum class Format { FLOAT32, FLOAT64 };
+
+    // Mapped samples [offset, offset + count); valid while the region lives
+    class Region {
+    public:
+        Region() = default;
+        Region(Region&& o) noexcept;
+        Region& operator=(Region&& o) noexcept;
+        Region(const Region&) = delete;
+        Region& operator=(const Region&) = delete;
+        ~Region();
+
+        uint64_t offset() const { return offset_; }
+        size_t size() const { return count_; }
+        SampleView<float> f32() const;  // FLOAT32 files only (empty otherwise)
+        SampleView<double> f64() const; // FLOAT64 files only (empty otherwise)
+        // Starts asynchronous read-ahead of the whole region
+        void prefetch() const;
+
+    private:
+        friend class SampleFile;
+        void release();
+        void* base_ {nullptr};
+        size_t length_ {0};
+        const char* data_ {nullptr};
+        uint64_t offset_ {0};
+        size_t count_ {0};
+        Format format_ {Format::FLOAT32};
+    };
+
+    // Throws std::runtime_error if the file cannot be opened or mapped, and
+    // std::invalid_argument if headerBytes is not a multiple of the sample size
+    SampleFile(const std::string& path, Format format, uint64_t headerBytes = 0);
+    SampleFile(SampleFile&& o) noexcept;
+    SampleFile& operator=(SampleFile&& o) noexcept;
+    SampleFile(const SampleFile&) = delete;
+    SampleFile& operator=(const SampleFile&) = delete;
+    ~SampleFile();
+
+    uint64_t size() const { return samples_; }
+    Format format() const { return format_; }
+    size_t sampleBytes() const { return format_ == Format::FLOAT32 ? sizeof(float) : sizeof(double); }
+    // Clamped to the end of the file; throws std::runtime_error if mmap fails
+    Region map(uint64_t offset, size_t count) const;
+
+private:
+    int fd_ {-1};
+    Format format_ {Format::FLOAT32};
+    uint64_t headerBytes_ {0};
+    uint64_t samples_ {0};
+};
+
+struct RecordingChunk {
+    uint64_t index = 0;
+    int64_t beginSample = 0, endSample = 0; // core range [begin, end)
+    std::vector<int64_t> peaks;             // accepted beats in the core, global sample indices
+    double bpm = 0.0;                       // from the chunk analysis (core plus margins)
+    QualityInfo quality;                    // likewise
+    bool analyzed = false;                  // false when analyzeSignal rejected the chunk
+};
+
+struct RecordingOptions {
+    double chunkSec = 300.0;  // core span owned by each chunk
+    double marginSec = 10.0;  // guard analyzed on each side of the core, then discarded
+    bool keepPeaks = false;   // collect every accepted peak in RecordingResult::peaks
+    // Called after each chunk, in order
+    std::function<void(const RecordingChunk&)> onChunk;
+};
+
+struct RecordingResult {
+    int64_t samples = 0;
+    double durationSec = 0.0;
+    uint64_t chunks = 0;
+    uint64_t failedChunks = 0;  // chunks analyzeSignal rejected (e.g. flat signal)
+    int64_t beats = 0;          // accepted beats after stitching
+    int64_t rejectedBeats = 0;  // detected beats the chunk analysis rejected
+    int64_t intervals = 0;      // RR intervals between consecutive accepted beats
+    int64_t gaps = 0;           // intervals outside the bpmMin..bpmMax range (dropouts, missed beats)
+    std::vector<int64_t> peaks; // RecordingOptions::keepPeaks only
+    // Over all intervals; differences only between adjacent intervals
+    double bpm = 0.0;
+    double meanRR = 0.0;
+    double sdnn = 0.0;
+    double rmssd = 0.0;
+    double pnn20 = 0.0; // percent or ratio per Options::pnnAsPercent
+    double pnn50 = 0.0;
+};
+
+RecordingResult analyzeRecording(const SampleFile& file, double fs, const Options& opt = {}, const RecordingOptions& ropt = {});
+RecordingResult analyzeRecording(const SampleFile& file, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx);
+// In-memory or caller-mapped recordings (same chunking and stitching)
+RecordingResult analyzeRecording(SampleView<float> signal, double fs, const Options& opt = {}, const RecordingOptions& ropt = {});
+RecordingResult analyzeRecording(SampleView<double> signal, double fs, const Options& opt = {}, const RecordingOptions& ropt = {});
+RecordingResult analyzeRecording(SampleView<float> signal, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx);
+RecordingResult analyzeRecording(SampleView<double> signal, double fs, const Options& opt, const RecordingOptions& ropt, ExecutionContext& ctx);
+
+} // namespace heartpy
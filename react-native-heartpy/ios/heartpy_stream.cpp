@@ -1,33 +1,34 @@
 #include "heartpy_stream.h"
+#include "heartpy_capture.h"
+#include "heartpy_pool.h"
+#include "heartpy_c.h"
+#include "heartpy_dsp.h"
+#include "heartpy_trace.h"
 #include <algorithm>
 #include <deque>
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
 #include <optional>
 #include <limits>
-#if defined(__ANDROID__)
-#include <android/log.h>
-#define LOG_TAG "HeartPySNR"
-#define LOGD(fmt, ...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, fmt, ##__VA_ARGS__)
-#elif defined(__APPLE__)
 #include <cstdio>
-#define LOGD(fmt, ...)                                                                                             \
-    do {                                                                                                           \
-        std::fprintf(stderr, "[HeartPySNR] " fmt "\n", ##__VA_ARGS__);                                           \
-        std::fflush(stderr);                                                                                       \
+// Streaming diagnostics go through the analyzer's ExecutionContext, so they
+// honour logSink/logEnabled; with logging off the arguments are not evaluated.
+#define LOGD(fmt, ...)                                                 \
+    do {                                                               \
+        if (ctx_.logEnabled) ctx_.log(kTagStream, fmt, ##__VA_ARGS__); \
     } while (0)
-#else
-#include <cstdio>
-#define LOGD(fmt, ...)                                                                                             \
-    do {                                                                                                           \
-        std::fprintf(stderr, "[HeartPySNR] " fmt "\n", ##__VA_ARGS__);                                           \
-        std::fflush(stderr);                                                                                       \
-    } while (0)
-#endif
 
 namespace heartpy {
 
-namespace { constexpr double kSnrFallbackDb = -5.0; }
+namespace {
+constexpr const char* kTagStream = "HeartPySNR";
+constexpr double kSnrFallbackDb = -5.0;
+constexpr double kProvisionalMaxSec = 8.0;     // most recent signal used by the provisional estimator
+constexpr double kProvisionalHandoffSec = 3.0; // cross-fade from provisional to full-pipeline BPM
+constexpr double kProvisionalReadyConfidence = 0.8; // pipeline confidence that ends provisional output on disagreement
+}
 
 // Defensive helpers
 static inline int clampIndexInt(int i, int n) {
@@ -38,6 +39,19 @@ static inline bool absToRel(size_t abs, size_t firstAbs, size_t n, size_t& rel)
     if (abs < firstAbs) return false; size_t v = abs - firstAbs; if (v >= n) return false; rel = v; return true;
 }
 
+// Appends a view to a window buffer: packed views in one insert, strided
+// ones element by element
+template <class T>
+static void appendView(std::vector<double>& out, SampleView<T> x) {
+    if (x.contiguous()) out.insert(out.end(), x.data(), x.data() + x.size());
+    else out.insert(out.end(), x.begin(), x.end());
+}
+// Signal samples are kept at float precision whatever the source type
+static void appendSignal(std::vector<double>& out, SampleView<float> x) { appendView(out, x); }
+static void appendSignal(std::vector<double>& out, SampleView<double> x) {
+    for (double v : x) out.push_back(static_cast<float>(v));
+}
+
 // Size safety helpers
 static inline size_t safeSizeMul(double a, double b, size_t cap) {
     if (!(std::isfinite(a) && std::isfinite(b))) return 0;
@@ -51,24 +65,187 @@ static inline size_t safeSizeMul(double a, double b, size_t cap) {
 }
 static constexpr double MAX_WINDOW_SEC = 300.0; // acceptance memory limit
 
-#ifdef HEARTPY_LOCK_TIMING
-static std::vector<double> g_lock1_times_us; // snapshot lock
-static std::vector<double> g_lock2_times_us; // commit lock
-static inline void push_lock_time(int which, double us) {
-    (which == 2 ? g_lock2_times_us : g_lock1_times_us).push_back(us);
+static int largestPowerOfTwoLE(size_t value) {
+    if (value < 1) return 0;
+    size_t pow2 = 1;
+    while ((pow2 << 1) <= value) {
+        pow2 <<= 1;
+    }
+    return static_cast<int>(pow2);
 }
-void RealtimeAnalyzer::lockStatsGet(int which, double& avg_us, double& p95_us, bool reset) {
-    avg_us = 0.0; p95_us = 0.0;
-    auto& v = (which == 2 ? g_lock2_times_us : g_lock1_times_us);
-    if (!v.empty()) {
-        double sum = 0.0; for (double x : v) sum += x; avg_us = sum / v.size();
-        auto tmp = v; std::sort(tmp.begin(), tmp.end());
-        size_t idx = (size_t)std::min(tmp.size() - 1, (size_t)std::floor(0.95 * (tmp.size() - 1)));
-        p95_us = tmp[idx];
-        if (reset) v.clear();
+
+// Snaps Options::nfft to the Welch sizes the SNR update supports
+static int coerceWelchNfft(int n) {
+    if (n <= 0) return 256;
+    int candidates[] = {1024, 512, 384, 256, 192, 128, 96, 64, 48, 32};
+    int best = candidates[sizeof(candidates)/sizeof(candidates[0]) - 1];
+    int bestd = std::numeric_limits<int>::max();
+    for (int cand : candidates) {
+        if (cand < 32) continue;
+        int d = std::abs(n - cand);
+        if (d < bestd) { bestd = d; best = cand; }
+    }
+    return best;
+}
+
+// Welch parameters the SNR update runs on a window of sampleCount samples:
+// Options::nfft and overlap, shrunk or overlapped further until at least two
+// segments fit (adaptivePsd), or just capped at the window otherwise
+struct WelchConfig {
+    int nfft;
+    double overlap;
+    int nseg;
+    bool adjusted;
+};
+
+static std::optional<WelchConfig> chooseWelchConfig(size_t sampleCount, const Options& opt) {
+    constexpr int kMinNfft = 32;
+    if (sampleCount < static_cast<size_t>(kMinNfft)) {
+        return std::nullopt;
+    }
+    double baseOverlap = std::clamp(opt.overlap, 0.0, 0.90);
+    int desired = coerceWelchNfft(opt.nfft);
+    desired = std::min(desired, largestPowerOfTwoLE(sampleCount));
+    desired = std::max(desired, kMinNfft);
+
+    int workingNfft = desired;
+    double workingOverlap = baseOverlap;
+    bool adjusted = false;
+
+    while (workingNfft >= kMinNfft) {
+        if (workingNfft > static_cast<int>(sampleCount)) {
+            int next = largestPowerOfTwoLE(sampleCount);
+            if (next < kMinNfft) break;
+            workingNfft = next;
+            adjusted = true;
+            continue;
+        }
+        if (static_cast<size_t>(workingNfft) >= sampleCount) {
+            if (workingNfft == kMinNfft) break;
+            int next = largestPowerOfTwoLE(static_cast<size_t>(workingNfft - 1));
+            if (next < kMinNfft) break;
+            workingNfft = next;
+            adjusted = true;
+            continue;
+        }
+
+        double minOverlapForTwo = 1.0 - (static_cast<double>(sampleCount - workingNfft) / static_cast<double>(workingNfft));
+        minOverlapForTwo = std::clamp(minOverlapForTwo, 0.0, 0.93);
+        double overlapCandidate = std::max(workingOverlap, minOverlapForTwo + 0.02);
+        overlapCandidate = std::clamp(overlapCandidate, baseOverlap, 0.93);
+
+        double stepFloat = static_cast<double>(workingNfft) * (1.0 - overlapCandidate);
+        if (stepFloat < 1.0) stepFloat = 1.0;
+        int step = std::max(1, static_cast<int>(std::round(stepFloat)));
+        int nseg = 1 + static_cast<int>((sampleCount - workingNfft) / step);
+        if (nseg >= 2) {
+            if (std::fabs(overlapCandidate - baseOverlap) > 1e-6 || workingNfft != desired) {
+                adjusted = true;
+            }
+            return WelchConfig{workingNfft, overlapCandidate, nseg, adjusted};
+        }
+
+        if (overlapCandidate < 0.93 - 1e-6) {
+            workingOverlap = std::min(0.93, overlapCandidate + 0.05);
+            adjusted = true;
+            continue;
+        }
+
+        if (workingNfft == kMinNfft) break;
+        int next = largestPowerOfTwoLE(static_cast<size_t>(workingNfft - 1));
+        if (next < kMinNfft) break;
+        workingNfft = next;
+        adjusted = true;
     }
+
+    return std::nullopt;
+}
+
+static std::optional<WelchConfig> presetWelchConfig(size_t sampleCount, const Options& opt) {
+    WelchConfig preset{
+        coerceWelchNfft(opt.nfft),
+        std::clamp(opt.overlap, 0.0, 0.90),
+        0,
+        false,
+    };
+    if (preset.nfft > static_cast<int>(sampleCount)) {
+        int fallbackNfft = largestPowerOfTwoLE(sampleCount);
+        preset.nfft = (fallbackNfft >= 32) ? fallbackNfft : 0;
+    }
+    if (preset.nfft < 32) return std::nullopt;
+    return preset;
 }
-void RealtimeAnalyzer::recordLockHold(int which, double us) { push_lock_time(which, us); }
+
+static std::optional<WelchConfig> welchConfigFor(size_t sampleCount, const Options& opt) {
+    return opt.adaptivePsd ? chooseWelchConfig(sampleCount, opt) : presetWelchConfig(sampleCount, opt);
+}
+
+static const char* latencyMetricLabel(int m) {
+    static const char* const kLabels[static_cast<int>(LatencyMetric::COUNT)] = {
+        "push", "poll", "psd", "lock_snapshot", "lock_commit", "lock_ingest"
+    };
+    return (m >= 0 && m < static_cast<int>(LatencyMetric::COUNT)) ? kLabels[m] : "unknown";
+}
+
+LatencyHistogram& RealtimeAnalyzer::globalLatencyHistogram(LatencyMetric m) {
+    static std::array<LatencyHistogram, static_cast<int>(LatencyMetric::COUNT)> g_latency;
+    static const bool registered = [] {
+        for (int i = 0; i < static_cast<int>(LatencyMetric::COUNT); ++i) {
+            metrics::processGroup().add("heartpy_latency_seconds", "Realtime push/poll/PSD and lock-hold latency, all analyzers",
+                                        g_latency[i], {{"op", latencyMetricLabel(i)}});
+        }
+        return true;
+    }();
+    (void)registered;
+    return g_latency[static_cast<int>(m)];
+}
+
+void RealtimeAnalyzer::registerMetrics() {
+    metrics_.add("heartpy_rt_dropped_samples_total", "Samples trimmed from the analysis window", droppedSamplesTotal_);
+    metrics_.add("heartpy_rt_chunked_batches_total", "Push batches ingested in more than one slice", chunkedBatchesTotal_);
+    metrics_.add("heartpy_rt_backpressure_events_total", "Pushes that left more than a window pending", backpressureEventsTotal_);
+    metrics_.add("heartpy_rt_param_change_events_total", "Window/preset/update interval changes", paramChangeEventsTotal_);
+    metrics_.add("heartpy_rt_timestamp_backtrack_events_total", "Non-monotonic timestamps received", timestampBacktrackEventsTotal_);
+    metrics_.add("heartpy_rt_timestamps_skipped_total", "Samples skipped because their timestamp went backwards", timestampsSkippedTotal_);
+    metrics_.add("heartpy_rt_time_jump_events_total", "Timestamp gaps larger than 2 s", timeJumpEventsTotal_);
+    metrics_.add("heartpy_rt_psd_param_clamp_events_total", "SNR PSD updates with clamped nfft/overlap", psdParamClampEventsTotal_);
+    metrics_.add("heartpy_rt_psd_reuse_fallback_events_total", "SNR updates that reused the previous PSD", psdReuseFallbackEventsTotal_);
+    metrics_.add("heartpy_rt_psd_time_domain_fallback_events_total", "SNR updates computed in the time domain", psdTimeDomainFallbackEventsTotal_);
+    metrics_.add("heartpy_rt_psd_invalid_frames_total", "SNR PSD frames rejected as invalid", psdInvalidFramesTotal_);
+    metrics_.add("heartpy_rt_pending_samples", "Samples ingested since the last emitted poll", pendingSamplesGauge_);
+    metrics_.add("heartpy_rt_effective_fs_hz", "Effective sample rate of the stream", effectiveFsGauge_);
+    metrics_.add("heartpy_rt_snr_db", "Smoothed SNR of the last emitted poll", snrDbGauge_);
+    metrics_.add("heartpy_rt_confidence", "Confidence of the last emitted poll", confidenceGauge_);
+    for (int i = 0; i < static_cast<int>(LatencyMetric::COUNT); ++i) {
+        metrics_.add("heartpy_rt_latency_seconds", "Realtime push/poll/PSD and lock-hold latency per analyzer",
+                     latency_[i], {{"op", latencyMetricLabel(i)}});
+    }
+}
+
+void RealtimeAnalyzer::recordLatency(LatencyMetric m, std::chrono::steady_clock::time_point t0) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    const uint64_t v = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    latency_[static_cast<int>(m)].recordNs(v);
+    globalLatencyHistogram(m).recordNs(v);
+}
+
+void RealtimeAnalyzer::lockStatsGet(int which, double& avg_us, double& p95_us, bool reset) {
+    LatencyHistogram& h = globalLatencyHistogram(which == 2 ? LatencyMetric::LOCK_COMMIT : LatencyMetric::LOCK_SNAPSHOT);
+    avg_us = h.meanUs();
+    p95_us = h.percentileUs(0.95);
+    if (reset) h.reset();
+}
+void RealtimeAnalyzer::recordLockHold(int which, double us) {
+    globalLatencyHistogram(which == 2 ? LatencyMetric::LOCK_COMMIT : LatencyMetric::LOCK_SNAPSHOT).recordUs(us);
+}
+
+// Lock-hold timing is dev instrumentation: compiled in with HEARTPY_LOCK_TIMING only
+#ifdef HEARTPY_LOCK_TIMING
+#define HP_LOCK_HOLD_BEGIN() const auto hpLockT0 = std::chrono::steady_clock::now()
+#define HP_LOCK_HOLD_END(metric) recordLatency(metric, hpLockT0)
+#else
+#define HP_LOCK_HOLD_BEGIN() do {} while (0)
+#define HP_LOCK_HOLD_END(metric) do {} while (0)
 #endif
 // Local HP-style helpers (mirrors core behavior, kept local to avoid linkage deps)
 static std::vector<double> rollingMeanHP_local(const std::vector<double>& data, double fs, double windowSeconds) {
@@ -204,9 +381,22 @@ static inline double std_pop_vec(const std::vector<double>& v) {
 }
 static inline double round6_local(double x) { return std::round(x * 1e6) / 1e6; }
 
+static uint64_t nextAnalyzerId() {
+    static std::atomic<uint64_t> next {1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
 RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
-    : fs_(fs), opt_(opt) {
+    : fs_(fs), opt_(opt), id_(nextAnalyzerId()), metrics_({{"analyzer", std::to_string(id_)}}) {
+    registerMetrics();
+    configure();
+}
+
+// fs_/opt_-derived setup shared by the constructor and reset(); every other
+// member is at its default when this runs
+void RealtimeAnalyzer::configure() {
     if (fs_ <= 0.0) fs_ = 50.0;
+    ctx_.deterministic = opt_.deterministic;
     if (windowSec_ < 1.0) windowSec_ = 10.0;
     if (windowSec_ > MAX_WINDOW_SEC) windowSec_ = MAX_WINDOW_SEC;
     if (updateSec_ <= 0.0) updateSec_ = 1.0;
@@ -222,6 +412,8 @@ RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
     lastTs_ = 0.0;
     warmupStartTs_ = std::numeric_limits<double>::quiet_NaN();
     // Streaming filter design
+    bq_.clear();
+    bqD_.clear();
     if (opt_.lowHz > 0.0 || opt_.highHz > 0.0) {
         bool useD = opt_.highPrecision || opt_.deterministic;
         if (useD) bqD_ = designBandpassStreamD(fs_, opt_.lowHz, opt_.highHz, std::max(1, opt_.iirOrder));
@@ -245,6 +437,16 @@ RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
     }
 }
 
+void RealtimeAnalyzer::reserveSamples(size_t n) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    m_signal_buffer.reserve(n);
+    m_timestamps.reserve(n);
+    filt_.reserve(n);
+    pollWindow_.next().reserve(n);
+    pollTimestamps_.next().reserve(n);
+    pollWindowF_.next().reserve(n);
+}
+
 void RealtimeAnalyzer::setWindowSeconds(double sec) {
     std::lock_guard<std::mutex> lock(dataMutex_);
     double clamped = std::max(1.0, std::min(MAX_WINDOW_SEC, sec));
@@ -261,229 +463,26 @@ void RealtimeAnalyzer::setWindowSeconds(double sec) {
     }
     updateSec_ = std::clamp(windowSec_ * 0.08, 0.2, 0.5);
     trimToWindow();
+    if (recorder_) recorder_->recordSetting(CaptureSetting::WINDOW_SEC, sec);
 }
 
 void RealtimeAnalyzer::setUpdateIntervalSeconds(double sec) {
     std::lock_guard<std::mutex> lock(dataMutex_);
     updateSec_ = std::max(0.1, sec);
-    ++paramChangeEventsTotal_;
+    paramChangeEventsTotal_.inc();
+    if (recorder_) recorder_->recordSetting(CaptureSetting::UPDATE_INTERVAL_SEC, sec);
 }
 
-void RealtimeAnalyzer::append(const float* x, size_t n) {
-    if (!x || n == 0) return;
-    // Append and process new samples incrementally
-    const size_t prevLen = m_signal_buffer.size();
-    m_signal_buffer.insert(m_signal_buffer.end(), x, x + n);
-    const size_t newLen = m_signal_buffer.size();
-    if (filt_.size() < prevLen) filt_.resize(prevLen);
-    if (m_signal_buffer.size() > filt_.size()) filt_.resize(m_signal_buffer.size());
-    // timebase (nominal fs)
-    if (prevLen == 0) {
-        firstTsApprox_ = 0.0;
-        lastTs_ = static_cast<double>(n) / fs_;
-        if (!std::isfinite(warmupStartTs_)) warmupStartTs_ = 0.0;
-    } else {
-        lastTs_ += static_cast<double>(n) / fs_;
-    }
-    // Process new portion
-    for (size_t i = prevLen; i < newLen; ++i) {
-        float s = m_signal_buffer[i];
-        bool useD = opt_.highPrecision || opt_.deterministic;
-        float yout;
-        if (useD && !bqD_.empty()) {
-            double yd = static_cast<double>(s);
-            for (auto &bi : bqD_) yd = bi.process(yd);
-            yout = static_cast<float>(yd);
-        } else {
-            float y = s;
-            for (auto &bi : bq_) y = bi.process(y);
-            yout = y;
-        }
-        filt_[i] = yout;
-        // rolling window update
-        rollWin_.push_back(yout);
-        rollSum_ += yout;
-        rollSumSq_ += static_cast<double>(yout) * static_cast<double>(yout);
-        // rectified update for thresholding
-        {
-            float yr = std::max(0.0f, yout);
-            rollWinRect_.push_back(yr);
-            rollRectSum_ += yr;
-            rollRectSumSq_ += static_cast<double>(yr) * static_cast<double>(yr);
-            while (!rectMinQ_.empty() && rectMinQ_.back() > yr) rectMinQ_.pop_back();
-            rectMinQ_.push_back(yr);
-            while (!rectMaxQ_.empty() && rectMaxQ_.back() < yr) rectMaxQ_.pop_back();
-            rectMaxQ_.push_back(yr);
-        }
-        while ((int)rollWin_.size() > winSamples_) {
-            float u = rollWin_.front(); rollWin_.pop_front();
-            rollSum_ -= u; rollSumSq_ -= static_cast<double>(u) * static_cast<double>(u);
-        }
-        while ((int)rollWinRect_.size() > winSamples_) {
-            float u = rollWinRect_.front(); rollWinRect_.pop_front();
-            rollRectSum_ -= u; rollRectSumSq_ -= static_cast<double>(u) * static_cast<double>(u);
-            if (!rectMinQ_.empty() && rectMinQ_.front() == u) rectMinQ_.pop_front();
-            if (!rectMaxQ_.empty() && rectMaxQ_.front() == u) rectMaxQ_.pop_front();
-        }
-        // incremental local-max detection using 1-sample look-ahead
-        size_t k = i;
-        if (k >= 2) {
-            float y2 = filt_[k - 2];
-            float y1 = filt_[k - 1];
-            float y0 = filt_[k - 0];
-            if (y1 > y2 && y1 >= y0) {
-                int nwin = static_cast<int>(rollWin_.size());
-                double mean = (nwin > 0 ? (rollSum_ / nwin) : 0.0);
-                double var = (nwin > 0 ? (rollSumSq_ / nwin - mean * mean) : 0.0);
-                if (var < 0.0) var = 0.0; double sd = std::sqrt(var);
-                double thr;
-                double y1Cmp = y1;
-                if (hpThreshold_) {
-                    // Positive-baseline scaling over the rolling window [0..1024]
-                    double vmin = y1, vmax = y1;
-                    for (float vv : rollWin_) { if (vv < vmin) vmin = vv; if (vv > vmax) vmax = vv; }
-                    double den = std::max(1e-6, vmax - vmin);
-                    double scaledMean = (mean - vmin) / den * 1024.0;
-                    // temporary lift boost window (if applicable)
-                    const double effFsLocThr = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-                    size_t testAbs = firstAbs_ + (k - 1);
-                    double tnowThr = firstTsApprox_ + ((double)(testAbs - firstAbs_)) / effFsLocThr;
-                    double lift = baseLift_ + ((tnowThr < tempLiftUntil_) ? tempLiftBoost_ : 0.0);
-                    thr = scaledMean + lift;
-                    y1Cmp = (y1 - vmin) / den * 1024.0;
-                } else {
-                    thr = mean + (opt_.thresholdScale * sd);
-                }
-                // absolute sample index of y1
-                size_t absIdx = firstAbs_ + (k - 1);
-                if (y1Cmp > thr) {
-                    // RR-predicted gating
-                    const double effFsLoc = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-                    bool allowPeak = true;
-                    if (!peaksAbs_.empty()) {
-                        size_t lastAbs = peaksAbs_.back();
-                        double rr_new_ms = (double)(absIdx - lastAbs) / effFsLoc * 1000.0;
-                        double tnow = firstTsApprox_ + ((double)(absIdx - firstAbs_)) / effFsLoc;
-                        double bpm_prior = bpmEmaValid_ ? bpmEma_ : (0.5 * (opt_.bpmMin + opt_.bpmMax));
-                        bpm_prior = std::max(opt_.bpmMin, std::min(opt_.bpmMax, bpm_prior));
-                        double rr_prior_ms = std::max(opt_.minRRFloorRelaxed, std::min(opt_.minRRCeiling, 60000.0 / std::max(1e-6, bpm_prior)));
-                        int acceptedRR = std::max(0, (int)acceptedPeaksTotal_ - 1);
-                        bool gateRel = (tnow >= 15.0) && (acceptedRR >= 10) && (bpmEmaValid_ && bpmEma_ < 100.0);
-                        double floor_ms = gateRel ? opt_.minRRFloorRelaxed : opt_.minRRFloorStrict;
-                        double min_rr_ms = std::max(0.7 * rr_prior_ms, floor_ms);
-                        // Unified long-RR gating when soft/hard/hint is active
-                        if (softDoublingActive_ || doublingActive_ || doublingHintActive_) {
-                            double longEst = 0.0;
-                            if (doublingLongRRms_ > 0.0) longEst = std::max(longEst, doublingLongRRms_);
-                            if (!lastRR_.empty()) {
-                                double med = medianOfRR(lastRR_);
-                                longEst = std::max(longEst, 2.0 * med);
-                            }
-                            if (lastF0Hz_ > 1e-9) longEst = std::max(longEst, 1000.0 / lastF0Hz_);
-                            if (longEst > 0.0) {
-                                longEst = std::clamp(longEst, 600.0, opt_.minRRCeiling);
-                                double minSoft = std::clamp(opt_.minRRGateFactor * longEst, opt_.minRRFloorRelaxed, opt_.minRRCeiling);
-                                min_rr_ms = std::max(min_rr_ms, minSoft);
-                                // Hard doubling fallback bounds folded here for coherence
-                                if (doublingActive_ && (doublingLongRRms_ > 0.0)) {
-                                    if (tnow <= hardFallbackUntil_) {
-                                        min_rr_ms = std::max(min_rr_ms, 0.9 * doublingLongRRms_);
-                                    } else if (tnow < doublingHoldUntil_) {
-                                        min_rr_ms = std::max(min_rr_ms, 0.8 * doublingLongRRms_);
-                                    }
-                                }
-                            }
-                        }
-                        if (rr_new_ms < min_rr_ms) {
-                            // strongest exception
-                            size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                            float lastVal = (relLast < filt_.size() ? filt_[relLast] : y1);
-                            double lastCmp = lastVal;
-                            if (hpThreshold_) {
-                                double vmin2 = y1, vmax2 = y1; for (float vv : rollWin_) { if (vv < vmin2) vmin2 = vv; if (vv > vmax2) vmax2 = vv; }
-                                double den2 = std::max(1e-6, vmax2 - vmin2);
-                                lastCmp = (lastVal - vmin2) / den2 * 1024.0;
-                            }
-                            if (!(y1Cmp > lastCmp + 1.0 * sd)) allowPeak = false;
-                        }
-                        // Rejection tracking and temporary lift/refractory bias
-                        
-                        if (!allowPeak) {
-                            if ((tnow - shortRejectWindowStart_) > 3.0) { shortRejectWindowStart_ = tnow; shortRejectCount_ = 0; }
-                            ++shortRejectCount_;
-                            if (shortRejectCount_ > 3) {
-                                tempLiftBoost_ = std::max(tempLiftBoost_, 10.0);
-                                tempLiftUntil_ = tnow + 2.0;
-                                int capExtra = (int)std::lround(std::max(0.0, 0.35 - (opt_.refractoryMs * 0.001)) * effFsLoc);
-                                dynRefExtraSamples_ = std::min(std::max(dynRefExtraSamples_, (int)std::lround(0.05 * effFsLoc)), capExtra);
-                                dynRefUntil_ = tnow + 2.0;
-                            }
-                        }
-                        if (tnow > dynRefUntil_) dynRefExtraSamples_ = 0;
-                        // Diagnostics: track applied refractory and min-RR bound in this path
-                        int dynBaseRef = (int)std::lround(std::clamp(0.4 * rr_prior_ms, 280.0, 450.0) * 0.001 * effFsLoc);
-                        int appliedRef = dynBaseRef + dynRefExtraSamples_;
-                        double tcur = tnow;
-                        if (doublingActive_ && (tcur <= hardFallbackUntil_)) {
-                            int fallbackRef = (int)std::lround(std::min(450.0, 0.5 * rr_prior_ms) * 0.001 * effFsLoc);
-                            appliedRef = std::max(appliedRef, fallbackRef);
-                        }
-                        lastRefMsActive_ = appliedRef * 1000.0 / effFsLoc;
-                        lastMinRRBoundMs_ = min_rr_ms;
-                    }
-                    if (allowPeak) {
-                        if (peaksAbs_.empty()) {
-                            peaksAbs_.push_back(absIdx);
-                            lastAcceptedAmpCmp_ = y1Cmp;
-                            ++acceptedPeaksTotal_;
-                        } else {
-                            size_t lastAbs = peaksAbs_.back();
-                            // dynamic base refractory + temporary extras, with hard fallback boost
-                            double bpm_prior2 = bpmEmaValid_ ? bpmEma_ : (0.5 * (opt_.bpmMin + opt_.bpmMax));
-                            double rr_prior_ms2 = std::max(400.0, std::min(1200.0, 60000.0 / std::max(1e-6, bpm_prior2)));
-                            int baseRef2 = (int)std::lround(std::clamp(0.4 * rr_prior_ms2, 280.0, 450.0) * 0.001 * effFsLoc);
-                            int refractoryNow = std::max(1, baseRef2) + dynRefExtraSamples_;
-                            double tcur2 = firstTsApprox_ + ((double)(absIdx - firstAbs_)) / effFsLoc;
-                            if (doublingActive_ && (tcur2 <= hardFallbackUntil_)) {
-                                int fallbackRef = (int)std::lround(std::min(450.0, 0.5 * rr_prior_ms2) * 0.001 * effFsLoc);
-                                refractoryNow = std::max(refractoryNow, fallbackRef);
-                            }
-                            if ((absIdx - lastAbs) >= (size_t)std::max(1, refractoryNow)) {
-                                peaksAbs_.push_back(absIdx);
-                                lastAcceptedAmpCmp_ = y1Cmp;
-                                ++acceptedPeaksTotal_;
-                            } else {
-                                // strongest-within-refractory: replace if stronger
-                                size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                                float lastVal = (relLast < filt_.size() ? filt_[relLast] : y1);
-                                double lastCmp = lastVal;
-                                if (hpThreshold_) {
-                                    double vmin = y1, vmax = y1; for (float vv : rollWin_) { if (vv < vmin) vmin = vv; if (vv > vmax) vmax = vv; }
-                                    double den2 = std::max(1e-6, vmax - vmin);
-                                    lastCmp = (lastVal - vmin) / den2 * 1024.0;
-                                }
-                                if (y1Cmp > lastCmp) peaksAbs_.back() = absIdx;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        ++totalAbs_;
-    }
-    // Rebuild downsampled display buffer (simple decimation)
-    const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-    int stride = std::max(1, (int)std::lround(effFs / std::max(10.0, displayHz_)));
-    displayBuf_.clear();
-    if (useRing_) {
-        std::vector<float> tmp; ringFilt_.snapshot(tmp);
-        displayBuf_.reserve(tmp.size() / stride + 1);
-        for (size_t idx = 0; idx < tmp.size(); idx += (size_t)stride) displayBuf_.push_back(tmp[idx]);
-    } else {
-        displayBuf_.reserve(filt_.size() / stride + 1);
-        for (size_t idx = 0; idx < filt_.size(); idx += (size_t)stride) displayBuf_.push_back(filt_[idx]);
-    }
-    trimToWindow();
+void RealtimeAnalyzer::setPsdUpdateSeconds(double sec) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    psdUpdateSec_ = std::clamp(sec, 0.5, 5.0);
+    if (recorder_) recorder_->recordSetting(CaptureSetting::PSD_UPDATE_SEC, sec);
+}
+
+void RealtimeAnalyzer::setDisplayHz(double hz) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    displayHz_ = std::clamp(hz, 10.0, 120.0);
+    if (recorder_) recorder_->recordSetting(CaptureSetting::DISPLAY_HZ, hz);
 }
 
 void RealtimeAnalyzer::trimToWindow() {
@@ -514,7 +513,7 @@ void RealtimeAnalyzer::trimToWindow() {
             }
         }
         if (filt_.size() >= drop) filt_.erase(filt_.begin(), filt_.begin() + drop);
-        droppedSamplesLast_ += drop; droppedSamplesTotal_ += drop; ++dropConsecPolls_;
+        droppedSamplesLast_ += drop; droppedSamplesTotal_.inc(drop); ++dropConsecPolls_;
         // Approximate firstTs by backing off from lastTs
         firstTsApprox_ = lastTs_ - static_cast<double>(m_signal_buffer.size()) / effFs;
         firstAbs_ += drop;
@@ -538,35 +537,121 @@ void RealtimeAnalyzer::trimToWindow() {
     }
 }
 
-void RealtimeAnalyzer::push(const float* samples, size_t n, double /*t0*/) {
-    if (!samples || n == 0) return;
-    size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
-    if (n > maxBatch) {
-        n = maxBatch; // clamp oversized batch
-        ++clampedBatchesTotal_;
-        // optional: debug log (non-fatal)
-        // fprintf(stderr, "[heartpy] push(): batch clamped to %zu samples\n", n);
+size_t RealtimeAnalyzer::ingestSliceSamples() const {
+    // ~2 s of samples per lock hold (>= 64): keeps poll()/getters responsive
+    // while a long backlog is ingested, without shrinking per-slice work so far
+    // that the per-slice display rebuild dominates catch-up throughput.
+    return std::max<size_t>(64, (size_t)std::ceil(2.0 * fs_));
+}
+
+PushStatus RealtimeAnalyzer::pushStatusLocked(size_t accepted, size_t chunks) const {
+    PushStatus st;
+    st.accepted = accepted;
+    st.chunks = chunks;
+    st.pendingSamples = samplesSinceEmit_;
+    const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
+    st.windowSamples = safeSizeMul(std::min(windowSec_, MAX_WINDOW_SEC), effFs, SIZE_MAX / 4);
+    st.backpressure = st.windowSamples > 0 && st.pendingSamples > st.windowSamples;
+    return st;
+}
+
+// Untimestamped batches get nominal timestamps 1/fs apart, so the window and
+// its timestamps stay in step exactly as for a timestamped push
+template <class T>
+PushStatus RealtimeAnalyzer::ingest(SampleView<T> samples, double t0) {
+    AllocScope allocScope(AllocSite::RT_PUSH);
+    trace::Span traceSpan("push");
+    const size_t n = samples.size();
+    if (n == 0) return pushStatus();
+    const auto tPush = std::chrono::steady_clock::now();
+    const size_t slice = ingestSliceSamples();
+    const double dt = 1.0 / fs_;
+    size_t chunks = 0, accepted = 0;
+    for (size_t off = 0; off < n; off += slice) {
+        const size_t len = std::min(slice, n - off);
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        HP_LOCK_HOLD_BEGIN();
+        const bool started = useRing_ ? ringFilt_.size() > 0 : !m_signal_buffer.empty();
+        double base = lastTs_ + dt;
+        if (!started) base = std::isfinite(t0) ? t0 : 0.0;
+        else if (off == 0 && std::isfinite(t0) && t0 > lastTs_) base = t0;
+        if (nominalTs_.size() < len) nominalTs_.resize(len);
+        for (size_t i = 0; i < len; ++i) nominalTs_[i] = base + static_cast<double>(i) * dt;
+        const SampleView<double> timestamps(nominalTs_.data(), len);
+        if (recorder_) recorder_->recordPush(samples.subview(off, len), timestamps);
+        const size_t kept = appendTimestamped(samples.subview(off, len), timestamps);
+        samplesSinceEmit_ += kept;
+        accepted += kept;
+        ++chunks;
+        HP_LOCK_HOLD_END(LatencyMetric::LOCK_INGEST);
     }
     std::lock_guard<std::mutex> lock(dataMutex_);
-    append(samples, n);
+    if (chunks > 1) chunkedBatchesTotal_.inc();
+    PushStatus st = pushStatusLocked(accepted, chunks);
+    if (st.backpressure) backpressureEventsTotal_.inc();
+    pendingSamplesGauge_.set(static_cast<double>(st.pendingSamples));
+    trace::counter("pendingSamples", static_cast<double>(st.pendingSamples));
+    recordLatency(LatencyMetric::PUSH, tPush);
+    return st;
 }
 
-void RealtimeAnalyzer::push(const std::vector<double>& samples, double /*t0*/) {
-    if (samples.empty()) return;
-    size_t n = samples.size();
-    size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
-    if (n > maxBatch) { n = maxBatch; ++clampedBatchesTotal_; } // clamp
-    std::vector<float> tmp(n);
-    for (size_t i = 0; i < n; ++i) tmp[i] = static_cast<float>(samples[i]);
+template <class T>
+PushStatus RealtimeAnalyzer::ingestTimestamped(SampleView<T> samples, SampleView<double> timestamps) {
+    AllocScope allocScope(AllocSite::RT_PUSH);
+    trace::Span traceSpan("push");
+    const size_t n = std::min(samples.size(), timestamps.size());
+    if (n == 0) return pushStatus();
+    const auto tPush = std::chrono::steady_clock::now();
+    const size_t slice = ingestSliceSamples();
+    size_t chunks = 0, accepted = 0;
+    for (size_t off = 0; off < n; off += slice) {
+        const size_t len = std::min(slice, n - off);
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        HP_LOCK_HOLD_BEGIN();
+        if (recorder_) recorder_->recordPush(samples.subview(off, len), timestamps.subview(off, len));
+        const size_t kept = appendTimestamped(samples.subview(off, len), timestamps.subview(off, len));
+        samplesSinceEmit_ += kept;
+        accepted += kept;
+        ++chunks;
+        HP_LOCK_HOLD_END(LatencyMetric::LOCK_INGEST);
+    }
     std::lock_guard<std::mutex> lock(dataMutex_);
-    append(tmp.data(), tmp.size());
+    if (chunks > 1) chunkedBatchesTotal_.inc();
+    PushStatus st = pushStatusLocked(accepted, chunks);
+    if (st.backpressure) backpressureEventsTotal_.inc();
+    pendingSamplesGauge_.set(static_cast<double>(st.pendingSamples));
+    trace::counter("pendingSamples", static_cast<double>(st.pendingSamples));
+    recordLatency(LatencyMetric::PUSH, tPush);
+    return st;
 }
 
-void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size_t n) {
-    if (!samples || !timestamps || n == 0) return;
-    size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
-    if (n > maxBatch) { n = maxBatch; ++clampedBatchesTotal_; } // clamp
-    std::lock_guard<std::mutex> lock(dataMutex_);
+PushStatus RealtimeAnalyzer::push(const float* samples, size_t n, double t0) {
+    return ingest(SampleView<float>(samples, n), t0);
+}
+
+PushStatus RealtimeAnalyzer::push(const std::vector<double>& samples, double t0) {
+    return ingest(SampleView<double>(samples), t0);
+}
+
+PushStatus RealtimeAnalyzer::push(const float* samples, const double* timestamps, size_t n) {
+    return ingestTimestamped(SampleView<float>(samples, n), SampleView<double>(timestamps, n));
+}
+
+PushStatus RealtimeAnalyzer::push(SampleView<float> samples, double t0) { return ingest(samples, t0); }
+PushStatus RealtimeAnalyzer::push(SampleView<double> samples, double t0) { return ingest(samples, t0); }
+
+PushStatus RealtimeAnalyzer::push(SampleView<float> samples, SampleView<double> timestamps) {
+    return ingestTimestamped(samples, timestamps);
+}
+
+PushStatus RealtimeAnalyzer::push(SampleView<double> samples, SampleView<double> timestamps) {
+    return ingestTimestamped(samples, timestamps);
+}
+
+template <class T>
+size_t RealtimeAnalyzer::appendTimestamped(SampleView<T> samples, SampleView<double> timestamps) {
+    const size_t n = samples.size();
+    ++viewGen_;
     // Update effective Fs using timestamps
     double t0 = timestamps[0];
     double t1 = timestamps[n - 1];
@@ -584,12 +669,12 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
             if (!std::isfinite(warmupStartTs_)) warmupStartTs_ = t0;
         }
         double lastSeenTs = lastTs_;
+        size_t skipped = 0, jumps = 0;
         for (size_t i = 0; i < n; ++i) {
             double ts = timestamps[i];
-            if (ts < lastSeenTs) { ++timestampBacktrackEventsTotal_;
-                ++timestampsSkippedTotal_; continue; }
-            if ((ts - lastSeenTs) > 2.0) { ++timeJumpEventsTotal_; }
-            float s = samples[i];
+            if (ts < lastSeenTs) { ++skipped; continue; }
+            if ((ts - lastSeenTs) > 2.0) { ++jumps; }
+            float s = static_cast<float>(samples[i]);
             bool useD = opt_.highPrecision || opt_.deterministic;
             if (useD && !bqD_.empty()) {
                 double yd = static_cast<double>(s);
@@ -607,6 +692,9 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
             ++totalAbs_;
             lastSeenTs = ts;
         }
+        timestampBacktrackEventsTotal_.inc(skipped);
+        timestampsSkippedTotal_.inc(skipped);
+        timeJumpEventsTotal_.inc(jumps);
         lastTs_ = lastSeenTs;
         firstAbs_ = (totalAbs_ > ringFilt_.size()) ? (totalAbs_ - ringFilt_.size()) : 0;
         // Ensure timestamps mirror the current ring window length
@@ -615,23 +703,23 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
             size_t dropTs = m_timestamps.size() - curWin;
             m_timestamps.erase(m_timestamps.begin(), m_timestamps.begin() + dropTs);
         }
-        return;
+        return n - skipped;
     }
     if (m_signal_buffer.empty()) {
         firstTsApprox_ = t0;
         if (!std::isfinite(warmupStartTs_)) warmupStartTs_ = t0;
     }
     lastTs_ = t1;
-    // Process each incoming sample through the same path as append()
+    // Process each incoming sample
     const size_t prevLen = m_signal_buffer.size();
-    m_signal_buffer.insert(m_signal_buffer.end(), samples, samples + n);
+    appendSignal(m_signal_buffer, samples);
     // mirror timestamps for non-ring window
-    m_timestamps.insert(m_timestamps.end(), timestamps, timestamps + n);
+    appendView(m_timestamps, timestamps);
     if (filt_.size() < prevLen) filt_.resize(prevLen);
     if (m_signal_buffer.size() > filt_.size()) filt_.resize(m_signal_buffer.size());
     for (size_t i = 0; i < n; ++i) {
         size_t dst = prevLen + i;
-        float s = samples[i];
+        float s = static_cast<float>(samples[i]);
         bool useD = opt_.highPrecision || opt_.deterministic;
         float yout;
         if (useD && !bqD_.empty()) {
@@ -735,7 +823,7 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                         // Track diagnostics for logging (applied refractory and min RR)
                         int appliedRef = dynBaseRef + dynRefExtraSamples_;
                         double tcur = firstTsApprox_ + ((double)(absIdx - firstAbs_)) / effFsLoc;
-                        if (doublingActive_ && (tcur <= hardFallbackUntil_)) {
+                        if (peakGuard_.doublingActive && (tcur <= peakGuard_.hardFallbackUntil)) {
                             int fallbackRef = (int)std::lround(std::min(450.0, 0.5 * rr_prior_ms) * 0.001 * effFsLoc);
                             appliedRef = std::max(appliedRef, fallbackRef);
                         }
@@ -772,7 +860,7 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                             int baseRef2 = (int)std::lround(std::clamp(0.4 * rr_prior_ms2, 280.0, 450.0) * 0.001 * effFsLoc);
                             int refractoryNow = std::max(1, baseRef2) + dynRefExtraSamples_;
                             double tcur2 = firstTsApprox_ + ((double)(absIdx - firstAbs_)) / effFsLoc;
-                            if (doublingActive_ && (tcur2 <= hardFallbackUntil_)) {
+                            if (peakGuard_.doublingActive && (tcur2 <= peakGuard_.hardFallbackUntil)) {
                                 int fallbackRef = (int)std::lround(std::min(450.0, 0.5 * rr_prior_ms2) * 0.001 * effFsLoc);
                                 refractoryNow = std::max(refractoryNow, fallbackRef);
                             }
@@ -815,61 +903,204 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
     displayBuf_.clear(); displayBuf_.reserve(filt_.size() / stride + 1);
     for (size_t idx = 0; idx < filt_.size(); idx += (size_t)stride) displayBuf_.push_back(filt_[idx]);
     trimToWindow();
+    return n;
+}
+
+const LatencyHistogram& RealtimeAnalyzer::stageHistogram(int stage) const {
+    return stageHist_[static_cast<size_t>(std::clamp(stage, 0, StageTimings::COUNT - 1))];
+}
+
+void RealtimeAnalyzer::resetStageHistograms() {
+    for (auto& h : stageHist_) h.reset();
+}
+
+void RealtimeAnalyzer::prewarm() {
+    trace::Span traceSpan("prewarm");
+    // Grow to capacity and clear: the pages are touched, the contents untouched
+    auto touch = [](auto& v, size_t n) {
+        if (v.empty() && v.capacity() < n) v.reserve(n);
+        if (v.empty()) { v.resize(n); v.clear(); }
+    };
+    double fs = 0.0, windowSec = 0.0;
+    Options o;
+    size_t cap = 0;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        fs = effectiveFs_ > 0.0 ? effectiveFs_ : fs_;
+        windowSec = windowSec_;
+        o = opt_;
+        cap = safeSizeMul(windowSec_, fs, SIZE_MAX / 4) + 8 * static_cast<size_t>(std::ceil(fs));
+        if (useRing_) {
+            if (ringCapacity_ > 0) cap = std::max(cap, ringCapacity_);
+        } else {
+            touch(m_signal_buffer, cap);
+            touch(filt_, cap);
+        }
+        touch(m_timestamps, cap);
+        touch(pollWindow_.next(), cap);
+        touch(pollTimestamps_.next(), cap);
+        if (opt_.singlePrecision) touch(pollWindowF_.next(), cap);
+    }
+    touch(noiseScratch_, 1024 / 2 + 1);
+    touch(provisionalAcf_, static_cast<size_t>(std::ceil(kProvisionalMaxSec * fs)));
+
+    prewarmAnalysis(fs, windowSec, o, ctx_);
+    // The Welch size updateSNR runs on a full window, last so its plan and
+    // Hann window stay in this thread's slots. Sizes used while the window
+    // fills are small and built once per process.
+    const std::optional<WelchConfig> steady = welchConfigFor(safeSizeMul(windowSec, fs, SIZE_MAX / 4), o);
+    if (steady) prewarmFftPlans({steady->nfft}, ctx_);
 }
 
 bool RealtimeAnalyzer::poll(HeartMetrics& out) {
+    using Clock = std::chrono::steady_clock;
+    auto usBetween = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::micro>(b - a).count();
+    };
+    const bool profile = opt_.profileStages;
+    const Clock::time_point tStart = Clock::now();
     std::unique_lock<std::mutex> lock(dataMutex_);
 
     if ((lastTs_ - lastEmitTime_) < updateSec_) {
         return false;
     }
+    AllocScope allocScope(AllocSite::RT_POLL); // emitting polls only
+    trace::Span traceSpan("poll");
+    const uint64_t traceStart = trace::enabled() ? trace::nowNs() : 0;
+    const bool auditStages = profile && alloc_audit::kEnabled;
+    const AllocCounters aStart = auditStages ? alloc_audit::threadCounters() : AllocCounters{};
+    HP_LOCK_HOLD_BEGIN();
+    if (recorder_) recorder_->recordPoll();
     lastEmitTime_ = lastTs_;
-
-    // Step 1: copy the signal and timestamp windows in sync into reusable buffers
-    if (pollWindowBuffer_.capacity() < filt_.size()) {
-        pollWindowBuffer_.reserve(filt_.size());
+    samplesSinceEmit_ = 0;
+
+    // Step 1: copy the signal and timestamp windows in sync into snapshot
+    // storage. Dropping out's hold on the previous window first lets a caller
+    // that reuses out get that storage recycled instead of a new allocation.
+    // In single precision the window stays float; a double copy is made only
+    // for the waveform output.
+    out.waveform_values.reset();
+    out.waveform_timestamps.reset();
+    const bool f32 = opt_.singlePrecision;
+    SharedSamples<float> windowF;
+    SharedSamples<double> window;
+    if (f32) {
+        pollWindowF_.next().assign(filt_.begin(), filt_.end());
+        windowF = pollWindowF_.publish();
     }
-    if (pollTimestampBuffer_.capacity() < m_timestamps.size()) {
-        pollTimestampBuffer_.reserve(m_timestamps.size());
+    if (!f32 || opt_.wants(Options::OUTPUT_WAVEFORM)) {
+        pollWindow_.next().assign(filt_.begin(), filt_.end());
+        window = pollWindow_.publish();
     }
-    pollWindowBuffer_.assign(filt_.begin(), filt_.end());
-    pollTimestampBuffer_.assign(m_timestamps.begin(), m_timestamps.end());
+    std::vector<double>& windowTimestamps = pollTimestamps_.next();
+    windowTimestamps.assign(m_timestamps.begin(), m_timestamps.end());
+    const SharedSamples<double> timestamps = pollTimestamps_.publish();
 
     assert(
-        pollWindowBuffer_.size() == pollTimestampBuffer_.size() &&
+        (f32 ? windowF.size() : window.size()) == timestamps.size() &&
         "Signal and timestamp buffers must be in sync");
 
     double fsEff = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
+    const PollClock clk{lastTs_, firstTsApprox_, warmupStartTs_, effectiveFs_, acceptedPeaksTotal_, lastPeaks_.size()};
 
+    HP_LOCK_HOLD_END(LatencyMetric::LOCK_SNAPSHOT);
     lock.unlock();
+    if (traceStart) trace::complete("poll.snapshot", traceStart, trace::nowNs());
+    const Clock::time_point tCopied = profile ? Clock::now() : Clock::time_point{};
+    const AllocCounters aCopied = auditStages ? alloc_audit::threadCounters() : AllocCounters{};
 
-    // Step 2: analyze the signal window
+    // Step 2: analyze the signal window. SNR and harmonic tracking read the
+    // peaks and RR of every poll; unselected ones are dropped after that.
     Options o = opt_;
-    out = analyzeSignal(pollWindowBuffer_, fsEff, o);
-
-    // Capture the analyzed waveform snapshot for downstream consumers
-    out.waveform_values = pollWindowBuffer_;
-    out.waveform_timestamps = pollTimestampBuffer_;
+    o.outputs |= Options::OUTPUT_PEAKS | Options::OUTPUT_RR;
+    // peakTimestamps keeps the caller's capacity across the result
+    // assignment, so a reused out does not reallocate it
+    std::vector<double> keepPeakTs;
+    keepPeakTs.swap(out.peakTimestamps);
+    out = f32 ? analyzeSignal(windowF.vector(), fsEff, o, ctx_) : analyzeSignal(window.vector(), fsEff, o, ctx_);
+    out.peakTimestamps.swap(keepPeakTs);
+
+    // Hand the analyzed window to downstream consumers (shared, not copied)
+    if (opt_.wants(Options::OUTPUT_WAVEFORM)) {
+        out.waveform_values = window;
+        out.waveform_timestamps = timestamps;
+    }
 
     // Step 3: map peak indices directly to timestamps from the synchronized window
     out.peakTimestamps.clear();
-    if (!out.peakList.empty()) {
+    if (opt_.wants(Options::OUTPUT_PEAKS) && !out.peakList.empty()) {
         out.peakTimestamps.reserve(out.peakList.size());
         for (int peak_index : out.peakList) {
             if (peak_index >= 0 &&
-                static_cast<size_t>(peak_index) < pollTimestampBuffer_.size()) {
+                static_cast<size_t>(peak_index) < timestamps.size()) {
                 out.peakTimestamps.push_back(
-                    pollTimestampBuffer_[static_cast<size_t>(peak_index)]);
+                    timestamps[static_cast<size_t>(peak_index)]);
             }
         }
     }
 
     // Step 4: update SNR and quality
-    updateSNR(out);
+    Clock::time_point tSnr{};
+    AllocCounters aSnr{};
+    if (profile) { tSnr = Clock::now(); harmonicStart_ = Clock::time_point{}; }
+    if (auditStages) aSnr = alloc_audit::threadCounters();
+    if (f32) updateSNR(out, windowF.vector(), clk);
+    else updateSNR(out, window.vector(), clk);
+
+    if (profile) {
+        const Clock::time_point tEnd = Clock::now();
+        const Clock::time_point tHarm = (harmonicStart_ == Clock::time_point{}) ? tEnd : harmonicStart_;
+        StageTimings& st = out.timings;
+        st.valid = true;
+        // window snapshot under the lock plus the waveform/peak timestamp copies
+        st.us[StageTimings::POLL_COPY] = std::max(0.0, usBetween(tStart, tCopied) + usBetween(tCopied, tSnr) - st.us[StageTimings::TOTAL]);
+        st.us[StageTimings::SNR] = usBetween(tSnr, tHarm);
+        st.us[StageTimings::HARMONIC] = usBetween(tHarm, tEnd);
+        st.us[StageTimings::TOTAL] = usBetween(tStart, tEnd);
+        if (auditStages) {
+            // Same split as the timings; analyzeSignal filled its own stages
+            const AllocCounters aEnd = alloc_audit::threadCounters();
+            const AllocCounters aHarm = (harmonicStart_ == Clock::time_point{}) ? aEnd : harmonicAllocs_;
+            auto put = [&st](StageTimings::Stage stage, uint64_t allocs, uint64_t bytes, bool global) {
+                st.allocs[stage] = allocs; st.allocBytes[stage] = bytes;
+                if (global) { AllocCounters d; d.allocs = allocs; d.bytes = bytes; alloc_audit::addStage(stage, d); }
+            };
+            const uint64_t totalA = aEnd.allocs - aStart.allocs, totalB = aEnd.bytes - aStart.bytes;
+            const uint64_t snrA = aHarm.allocs - aSnr.allocs, snrB = aHarm.bytes - aSnr.bytes;
+            const uint64_t harmA = aEnd.allocs - aHarm.allocs, harmB = aEnd.bytes - aHarm.bytes;
+            const uint64_t innerA = (aSnr.allocs - aCopied.allocs), innerB = (aSnr.bytes - aCopied.bytes);
+            const uint64_t analyzeA = std::min(innerA, st.allocs[StageTimings::TOTAL]);
+            const uint64_t analyzeB = std::min(innerB, st.allocBytes[StageTimings::TOTAL]);
+            put(StageTimings::POLL_COPY, (aCopied.allocs - aStart.allocs) + innerA - analyzeA,
+                (aCopied.bytes - aStart.bytes) + innerB - analyzeB, true);
+            put(StageTimings::SNR, snrA, snrB, true);
+            put(StageTimings::HARMONIC, harmA, harmB, true);
+            put(StageTimings::TOTAL, totalA, totalB, false); // poll totals live under AllocSite::RT_POLL
+            st.allocsValid = true;
+        }
+    }
+
+    if (f32) applyProvisionalHR(out, windowF.vector(), fsEff, clk);
+    else applyProvisionalHR(out, window.vector(), fsEff, clk);
+    if (!opt_.wants(Options::OUTPUT_PEAKS)) out.peakList.clear();
+    if (!opt_.wants(Options::OUTPUT_RR)) { out.ibiMs.clear(); out.rrList.clear(); }
 
     lock.lock();
-    lastQuality_ = out.quality;
+    {
+        HP_LOCK_HOLD_BEGIN();
+        lastQuality_ = out.quality;
+        publishPeakGuard();
+        HP_LOCK_HOLD_END(LatencyMetric::LOCK_COMMIT);
+    }
     lock.unlock();
+    pendingSamplesGauge_.set(0.0);
+    effectiveFsGauge_.set(fsEff);
+    snrDbGauge_.set(out.quality.snrDb);
+    confidenceGauge_.set(out.quality.confidence);
+    if (profile) {
+        for (int i = 0; i < StageTimings::COUNT; ++i) stageHist_[i].recordUs(out.timings.us[i]);
+    }
+    recordLatency(LatencyMetric::POLL, tStart);
 
     return true;
 }
@@ -878,7 +1109,34 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
 } // namespace heartpy
 
 // Plain C bridge
-struct _hp_rt_handle { heartpy::RealtimeAnalyzer* p; };
+struct _hp_rt_handle {
+    heartpy::RealtimeAnalyzer* p;
+    heartpy::HeartMetrics last; // reused by hp_rt_poll_into
+};
+
+namespace {
+// Copies min(size, capacity) elements; returns false when truncated
+template <class Src, class Arr>
+bool copyToArray(const std::vector<Src>& src, Arr& dst) {
+    dst.size = src.size();
+    const size_t n = (dst.data && dst.capacity) ? std::min(dst.capacity, src.size()) : 0;
+    for (size_t i = 0; i < n; ++i) dst.data[i] = static_cast<typename std::remove_pointer<decltype(dst.data)>::type>(src[i]);
+    return n == src.size();
+}
+
+// Options::outputs for an HP_RT_FIELD_* mask. Quality, segments, rejected
+// indices and the warning come with every result and need no output bit.
+uint32_t outputsForFields(uint32_t fields) {
+    using O = heartpy::Options;
+    uint32_t out = 0;
+    if (fields & HP_RT_FIELD_METRICS) out |= O::OUTPUT_TIME_DOMAIN | O::OUTPUT_BREATHING | O::OUTPUT_FREQ_DOMAIN;
+    if (fields & HP_RT_FIELD_PEAKS) out |= O::OUTPUT_PEAKS;
+    if (fields & HP_RT_FIELD_PEAKS_RAW) out |= O::OUTPUT_PEAKS_RAW;
+    if (fields & HP_RT_FIELD_RR) out |= O::OUTPUT_RR;
+    if (fields & HP_RT_FIELD_WAVEFORM) out |= O::OUTPUT_WAVEFORM;
+    return out;
+}
+} // namespace
 
 void* hp_rt_create(double fs, const heartpy::Options* opt) {
     auto* h = new _hp_rt_handle();
@@ -887,6 +1145,12 @@ void* hp_rt_create(double fs, const heartpy::Options* opt) {
     return h;
 }
 
+void* hp_rt_create_fields(double fs, uint32_t fields) {
+    heartpy::Options o;
+    o.outputs = outputsForFields(fields);
+    return hp_rt_create(fs, &o);
+}
+
 void  hp_rt_set_window(void* h, double sec) {
     if (!h) return; auto* S = reinterpret_cast<_hp_rt_handle*>(h); S->p->setWindowSeconds(sec);
 }
@@ -898,7 +1162,7 @@ void  hp_rt_set_update_interval(void* h, double sec) {
 void  hp_rt_push(void* h, const float* x, size_t n, double t0) {
     if (!h || !x || n == 0) return;
     auto* S = reinterpret_cast<_hp_rt_handle*>(h);
-    S->p->push(x, n, t0); // push() clamps batch size internally
+    S->p->push(x, n, t0); // push() ingests large batches in bounded slices
 }
 
 void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n) {
@@ -907,16 +1171,236 @@ void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n) {
     S->p->push(x, ts, n);
 }
 
+void  hp_rt_push_f64(void* h, const double* x, size_t n, double t0) {
+    if (!h || !x || n == 0) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    S->p->push(heartpy::SampleView<double>(x, n), t0);
+}
+
+void  hp_rt_push_ts_f64(void* h, const double* x, const double* ts, size_t n) {
+    if (!h || !x || !ts || n == 0) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    S->p->push(heartpy::SampleView<double>(x, n), heartpy::SampleView<double>(ts, n));
+}
+
+void  hp_rt_push_strided(void* h, const float* x, size_t xStride,
+                         const double* ts, size_t tsStride, size_t n) {
+    if (!h || !x || !ts || n == 0 || xStride == 0 || tsStride == 0) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    S->p->push(heartpy::SampleView<float>(x, n, static_cast<std::ptrdiff_t>(xStride)),
+               heartpy::SampleView<double>(ts, n, static_cast<std::ptrdiff_t>(tsStride)));
+}
+
+int   hp_rt_backlog(void* h, size_t* pendingSamples, size_t* windowSamples) {
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    heartpy::PushStatus st = S->p->pushStatus();
+    if (pendingSamples) *pendingSamples = st.pendingSamples;
+    if (windowSamples) *windowSamples = st.windowSamples;
+    return st.backpressure ? 1 : 0;
+}
+
+void* hp_rt_pool_create(size_t maxIdlePerClass) {
+    return new heartpy::AnalyzerPool(maxIdlePerClass);
+}
+
+void  hp_rt_pool_destroy(void* pool) {
+    delete reinterpret_cast<heartpy::AnalyzerPool*>(pool);
+}
+
+void* hp_rt_pool_acquire(void* pool, double fs, const heartpy::Options* opt, double windowSec) {
+    heartpy::AnalyzerPool& P = pool ? *reinterpret_cast<heartpy::AnalyzerPool*>(pool) : heartpy::sharedAnalyzerPool();
+    auto* h = new _hp_rt_handle();
+    h->p = P.acquire(fs, opt ? *opt : heartpy::Options{}, windowSec).release();
+    return h;
+}
+
+void* hp_rt_pool_acquire_fields(void* pool, double fs, uint32_t fields, double windowSec) {
+    heartpy::Options o;
+    o.outputs = outputsForFields(fields);
+    return hp_rt_pool_acquire(pool, fs, &o, windowSec);
+}
+
+void  hp_rt_pool_release(void* pool, void* h) {
+    if (!h) return;
+    heartpy::AnalyzerPool& P = pool ? *reinterpret_cast<heartpy::AnalyzerPool*>(pool) : heartpy::sharedAnalyzerPool();
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    P.release(std::unique_ptr<heartpy::RealtimeAnalyzer>(S->p));
+    delete S;
+}
+
+void  hp_rt_prewarm(void* h) {
+    if (!h) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    S->p->prewarm();
+}
+
 int   hp_rt_poll(void* h, heartpy::HeartMetrics* out) {
     if (!h || !out) return 0; auto* S = reinterpret_cast<_hp_rt_handle*>(h); return S->p->poll(*out) ? 1 : 0;
 }
 
+size_t hp_rt_save_state(void* h, uint8_t* buf, size_t cap) {
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    const std::vector<uint8_t> state = S->p->saveState();
+    if (buf && cap >= state.size()) std::memcpy(buf, state.data(), state.size());
+    return state.size();
+}
+
+int   hp_rt_restore_state(void* h, const uint8_t* data, size_t size) {
+    if (!h || !data) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    return S->p->restoreState(data, size) ? 1 : 0;
+}
+
+int   hp_rt_capture_start(void* h, const char* path) {
+    if (!h || !path) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    try {
+        S->p->startCapture(path);
+        return 1;
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+void  hp_rt_capture_stop(void* h) {
+    if (!h) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    S->p->stopCapture();
+}
+
+int   hp_rt_poll_into(void* h, hp_rt_poll_buffers* b) {
+    if (!h || !b) return HP_RT_POLL_ERROR;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    heartpy::HeartMetrics& m = S->last;
+    if (!S->p->poll(m)) return HP_RT_POLL_NONE;
+    const uint32_t f = b->fields;
+    hp_rt_scalars& o = b->scalars;
+    if (f & HP_RT_FIELD_METRICS) {
+        o.bpm = m.bpm;
+        o.sdnn = m.sdnn; o.rmssd = m.rmssd; o.sdsd = m.sdsd; o.pnn20 = m.pnn20; o.pnn50 = m.pnn50;
+        o.nn20 = m.nn20; o.nn50 = m.nn50; o.mad = m.mad;
+        o.sd1 = m.sd1; o.sd2 = m.sd2; o.sd1sd2Ratio = m.sd1sd2Ratio; o.ellipseArea = m.ellipseArea;
+        o.vlf = m.vlf; o.lf = m.lf; o.hf = m.hf; o.lfhf = m.lfhf; o.totalPower = m.totalPower;
+        o.lfNorm = m.lfNorm; o.hfNorm = m.hfNorm;
+        o.breathingRate = m.breathingRate;
+    }
+    if (f & HP_RT_FIELD_QUALITY) {
+        const heartpy::QualityInfo& q = m.quality;
+        o.totalBeats = q.totalBeats; o.rejectedBeats = q.rejectedBeats; o.rejectionRate = q.rejectionRate;
+        o.goodQuality = q.goodQuality ? 1 : 0;
+        o.snrDb = q.snrDb; o.confidence = q.confidence; o.f0Hz = q.f0Hz; o.maPercActive = q.maPercActive;
+        o.doublingFlag = q.doublingFlag; o.softDoublingFlag = q.softDoublingFlag;
+        o.rrShortFrac = q.rrShortFrac; o.rrLongMs = q.rrLongMs; o.pHalfOverFund = q.pHalfOverFund; o.pairFrac = q.pairFrac;
+        o.refractoryMsActive = q.refractoryMsActive; o.minRRBoundMs = q.minRRBoundMs;
+        o.softStreak = q.softStreak; o.softSecs = q.softSecs;
+        o.hardFallbackActive = q.hardFallbackActive; o.doublingHintFlag = q.doublingHintFlag;
+        o.rrFallbackModeActive = q.rrFallbackModeActive; o.snrWarmupActive = q.snrWarmupActive;
+        o.snrSampleCount = q.snrSampleCount;
+        o.provisionalActive = q.provisionalActive; o.provisionalBpm = q.provisionalBpm;
+        o.provisionalConfidence = q.provisionalConfidence;
+    }
+    bool full = true;
+    if (f & HP_RT_FIELD_PEAKS) {
+        full &= copyToArray(m.peakList, b->peakList);
+        full &= copyToArray(m.peakTimestamps, b->peakTimestamps);
+    }
+    if (f & HP_RT_FIELD_PEAKS_RAW) {
+        full &= copyToArray(m.peakListRaw, b->peakListRaw);
+        full &= copyToArray(m.binaryPeakMask, b->binaryPeakMask);
+    }
+    if (f & HP_RT_FIELD_RR) {
+        full &= copyToArray(m.ibiMs, b->ibiMs);
+        full &= copyToArray(m.rrList, b->rrList);
+    }
+    if (f & HP_RT_FIELD_WAVEFORM) {
+        full &= copyToArray(m.waveform_values.vector(), b->waveformValues);
+        full &= copyToArray(m.waveform_timestamps.vector(), b->waveformTimestamps);
+    }
+    if (f & HP_RT_FIELD_SEGMENTS) {
+        hp_rt_segment_array& a = b->binarySegments;
+        a.size = m.binarySegments.size();
+        const size_t n = (a.data && a.capacity) ? std::min(a.capacity, a.size) : 0;
+        for (size_t i = 0; i < n; ++i) {
+            const auto& s = m.binarySegments[i];
+            a.data[i] = hp_rt_segment{s.index, s.startBeat, s.endBeat, s.totalBeats, s.rejectedBeats, s.accepted ? 1 : 0};
+        }
+        full &= (n == a.size);
+    }
+    if (f & HP_RT_FIELD_REJECTED) {
+        full &= copyToArray(m.quality.rejectedIndices, b->rejectedIndices);
+    }
+    if (f & HP_RT_FIELD_WARNING) {
+        const std::string& w = m.quality.qualityWarning;
+        b->warningSize = w.size();
+        if (b->warning && b->warningCapacity > 0) {
+            const size_t n = std::min(b->warningCapacity - 1, w.size());
+            std::memcpy(b->warning, w.data(), n);
+            b->warning[n] = '\0';
+            full &= (n == w.size());
+        } else {
+            full &= w.empty();
+        }
+    }
+    return full ? HP_RT_POLL_OK : HP_RT_POLL_TRUNCATED;
+}
+
 void  hp_rt_destroy(void* h) {
     if (!h) return; auto* S = reinterpret_cast<_hp_rt_handle*>(h); delete S->p; delete S;
 }
 
 namespace heartpy {
 
+// Reports an autocorrelation BPM while the full pipeline is still warming up.
+// The hand-off starts once updateSNR has left warm-up and the pipeline BPM
+// either agrees with the provisional one or carries high confidence; the
+// reported value then cross-fades over kProvisionalHandoffSec.
+template <class T>
+void RealtimeAnalyzer::applyProvisionalHR(HeartMetrics& out, const std::vector<T>& window, double fsEff,
+                                          const PollClock& clk) {
+    out.quality.provisionalActive = 0;
+    out.quality.provisionalBpm = 0.0;
+    out.quality.provisionalConfidence = 0.0;
+    if (!opt_.provisionalHR || fsEff <= 0.0) return;
+    if (out.quality.snrWarmupActive) provisionalDone_ = false;
+    if (provisionalDone_) return;
+    if (provisionalHandoffStart_ >= 0.0) {
+        const double w = (clk.lastTs - provisionalHandoffStart_) / kProvisionalHandoffSec;
+        if (w >= 1.0 || out.bpm <= 0.0) {
+            provisionalDone_ = true;
+            provisionalLastBpm_ = 0.0;
+            provisionalHandoffStart_ = -1.0;
+            return;
+        }
+        out.bpm = w * out.bpm + (1.0 - w) * provisionalLastBpm_;
+        return;
+    }
+    const double elapsed = std::isfinite(clk.warmupStartTs) ? (clk.lastTs - clk.warmupStartTs) : (clk.lastTs - clk.firstTsApprox);
+    if (elapsed < opt_.provisionalMinSec) return;
+    const size_t n = std::min(window.size(), static_cast<size_t>(std::ceil(kProvisionalMaxSec * fsEff)));
+    const ProvisionalHR est = estimateHRAutocorr(window.data() + (window.size() - n), n,
+                                                 fsEff, opt_.bpmMin, opt_.bpmMax, provisionalAcf_);
+    if (!est.ok) return;
+    out.quality.provisionalBpm = est.bpm;
+    out.quality.provisionalConfidence = est.confidence;
+    const bool pipelineReady = !out.quality.snrWarmupActive && out.bpm > 0.0 &&
+        (std::fabs(out.bpm - est.bpm) <= 0.1 * est.bpm || out.quality.confidence >= kProvisionalReadyConfidence);
+    if (pipelineReady) {
+        if (provisionalLastBpm_ > 0.0) {
+            provisionalHandoffStart_ = clk.lastTs;
+            out.bpm = provisionalLastBpm_;
+        } else {
+            provisionalDone_ = true;
+        }
+        return;
+    }
+    if (est.confidence < opt_.provisionalMinConfidence) return;
+    out.quality.provisionalActive = 1;
+    out.bpm = est.bpm;
+    provisionalLastBpm_ = est.bpm;
+}
+
 double RealtimeAnalyzer::medianOfRR(const std::vector<double>& rr) {
     if (rr.empty()) return 0.0;
     scratchRR_.assign(rr.begin(), rr.end());
@@ -925,23 +1409,25 @@ double RealtimeAnalyzer::medianOfRR(const std::vector<double>& rr) {
     return *mid;
 }
 
-void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
-    const double sinceLastPsd = lastTs_ - lastPsdTime_;
+template <class T>
+void RealtimeAnalyzer::updateSNR(HeartMetrics& out, const std::vector<T>& window, const PollClock& clk) {
+    trace::Span traceSpan("updateSNR");
+    const double sinceLastPsd = clk.lastTs - lastPsdTime_;
     if (sinceLastPsd < psdUpdateSec_) {
         out.quality = lastQuality_;
-        out.quality.snrSampleCount = static_cast<double>(filt_.size());
+        out.quality.snrSampleCount = static_cast<double>(window.size());
         LOGD("updateSNR cadence skip: dt=%.3f < %.3f, reuse previous quality (snr=%.3f)", sinceLastPsd, psdUpdateSec_, out.quality.snrDb);
         return;
     }
-    lastPsdTime_ = lastTs_;
+    lastPsdTime_ = clk.lastTs;
 
     // Use full-rate filtered window for PSD and derive SNR around HR
-    const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-    const size_t sampleCount = filt_.size();
-    LOGD("updateSNR: effFs=%.3f, filt_.size()=%zu, fs_=%.3f", effFs, sampleCount, fs_);
+    const double effFs = (clk.effectiveFs > 1e-6 ? clk.effectiveFs : fs_);
+    const size_t sampleCount = window.size();
+    LOGD("updateSNR: effFs=%.3f, window.size()=%zu, fs_=%.3f", effFs, sampleCount, fs_);
     out.quality.snrSampleCount = static_cast<double>(sampleCount);
     if (effFs <= 0.0 || sampleCount < 16) {
-        LOGD("Early return: effFs=%.3f <= 0.0 OR filt_.size()=%zu < 16", effFs, sampleCount);
+        LOGD("Early return: effFs=%.3f <= 0.0 OR window.size()=%zu < 16", effFs, sampleCount);
         double fallbackDb = snrEmaValid_ ? snrEmaDb_ : kSnrFallbackDb;
         if (!std::isfinite(fallbackDb)) fallbackDb = kSnrFallbackDb;
         out.quality.snrDb = fallbackDb;
@@ -971,151 +1457,40 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     }
     lastF0Hz_ = f0;
 
-    // Build analysis vector (copy of filt_) — reuse buffer to reduce reallocations
-    yBufferD_.resize(filt_.size());
-    for (size_t i = 0; i < filt_.size(); ++i) yBufferD_[i] = (double)filt_[i];
-    LOGD("yBufferD_.size(): %zu, filt_.size(): %zu", yBufferD_.size(), filt_.size());
-
+    // The PSD and time-domain SNR read the poll's window snapshot as is: no
+    // widened copy, and pushes landing in filt_ meanwhile cannot race it
     // Welch PSD on the full-rate filtered signal
-    struct WelchConfig {
-        int nfft;
-        double overlap;
-        int nseg;
-        bool adjusted;
-    };
-
-    auto largestPowerOfTwoLE = [](size_t value) -> int {
-        if (value < 1) return 0;
-        size_t pow2 = 1;
-        while ((pow2 << 1) <= value) {
-            pow2 <<= 1;
-        }
-        return static_cast<int>(pow2);
-    };
-
-    auto coerceNfft = [&](int n) -> int {
-        if (n <= 0) return 256;
-        int candidates[] = {1024, 512, 384, 256, 192, 128, 96, 64, 48, 32};
-        int best = candidates[sizeof(candidates)/sizeof(candidates[0]) - 1];
-        int bestd = std::numeric_limits<int>::max();
-        for (int cand : candidates) {
-            if (cand < 32) continue;
-            int d = std::abs(n - cand);
-            if (d < bestd) { bestd = d; best = cand; }
-        }
-        return best;
-    };
-
-    auto chooseWelchConfig = [&](size_t sampleCount) -> std::optional<WelchConfig> {
-        constexpr int kMinNfft = 32;
-        if (sampleCount < static_cast<size_t>(kMinNfft)) {
-            return std::nullopt;
-        }
-        double baseOverlap = std::clamp(opt_.overlap, 0.0, 0.90);
-        int desired = coerceNfft(opt_.nfft);
-        desired = std::min(desired, largestPowerOfTwoLE(sampleCount));
-        desired = std::max(desired, kMinNfft);
-
-        int workingNfft = desired;
-        double workingOverlap = baseOverlap;
-        bool adjusted = false;
-
-        while (workingNfft >= kMinNfft) {
-            if (workingNfft > static_cast<int>(sampleCount)) {
-                int next = largestPowerOfTwoLE(sampleCount);
-                if (next < kMinNfft) break;
-                workingNfft = next;
-                adjusted = true;
-                continue;
-            }
-            if (static_cast<size_t>(workingNfft) >= sampleCount) {
-                if (workingNfft == kMinNfft) break;
-                int next = largestPowerOfTwoLE(static_cast<size_t>(workingNfft - 1));
-                if (next < kMinNfft) break;
-                workingNfft = next;
-                adjusted = true;
-                continue;
-            }
-
-            double minOverlapForTwo = 1.0 - (static_cast<double>(sampleCount - workingNfft) / static_cast<double>(workingNfft));
-            minOverlapForTwo = std::clamp(minOverlapForTwo, 0.0, 0.93);
-            double overlapCandidate = std::max(workingOverlap, minOverlapForTwo + 0.02);
-            overlapCandidate = std::clamp(overlapCandidate, baseOverlap, 0.93);
-
-            double stepFloat = static_cast<double>(workingNfft) * (1.0 - overlapCandidate);
-            if (stepFloat < 1.0) stepFloat = 1.0;
-            int step = std::max(1, static_cast<int>(std::round(stepFloat)));
-            int nseg = 1 + static_cast<int>((sampleCount - workingNfft) / step);
-            if (nseg >= 2) {
-                if (std::fabs(overlapCandidate - baseOverlap) > 1e-6 || workingNfft != desired) {
-                    adjusted = true;
-                }
-                return WelchConfig{workingNfft, overlapCandidate, nseg, adjusted};
-            }
-
-            if (overlapCandidate < 0.93 - 1e-6) {
-                workingOverlap = std::min(0.93, overlapCandidate + 0.05);
-                adjusted = true;
-                continue;
-            }
-
-            if (workingNfft == kMinNfft) break;
-            int next = largestPowerOfTwoLE(static_cast<size_t>(workingNfft - 1));
-            if (next < kMinNfft) break;
-            workingNfft = next;
-            adjusted = true;
-        }
-
-        return std::nullopt;
-    };
-
     enum class SnrSource { FreshPsd, CachedPsd, TimeDomain };
     SnrSource snrSource = SnrSource::FreshPsd;
     bool harmonicEligible = false;
     const std::vector<double>* freqBins = nullptr;
     const std::vector<double>* powerBins = nullptr;
-    int nfft = coerceNfft(opt_.nfft);
+    int nfft = coerceWelchNfft(opt_.nfft);
     double overlapForCall = opt_.overlap;
 
-    std::optional<WelchConfig> welchConfig;
-    if (opt_.adaptivePsd) {
-        welchConfig = chooseWelchConfig(yBufferD_.size());
-    } else {
-        WelchConfig preset{
-            coerceNfft(opt_.nfft),
-            std::clamp(opt_.overlap, 0.0, 0.90),
-            0,
-            false,
-        };
-        if (preset.nfft > static_cast<int>(yBufferD_.size())) {
-            int fallbackNfft = largestPowerOfTwoLE(yBufferD_.size());
-            preset.nfft = (fallbackNfft >= 32) ? fallbackNfft : 0;
-        }
-        if (preset.nfft >= 32) {
-            welchConfig = preset;
-        }
-    }
+    const std::optional<WelchConfig> welchConfig = welchConfigFor(window.size(), opt_);
 
     if (!welchConfig.has_value()) {
-        ++psdInvalidFramesTotal_;
+        psdInvalidFramesTotal_.inc();
         if (opt_.adaptivePsd) {
-            LOGD("Insufficient data for Welch PSD (samples=%zu). Falling back to time-domain SNR", yBufferD_.size());
+            LOGD("Insufficient data for Welch PSD (samples=%zu). Falling back to time-domain SNR", window.size());
             snrSource = SnrSource::TimeDomain;
             lastPsdValid_ = false;
         } else {
-            LOGD("Insufficient data for Welch PSD (adaptive disabled, samples=%zu). Skipping SNR update", yBufferD_.size());
+            LOGD("Insufficient data for Welch PSD (adaptive disabled, samples=%zu). Skipping SNR update", window.size());
             return;
         }
     } else {
         if (welchConfig->adjusted) {
-            ++psdParamClampEventsTotal_;
+            psdParamClampEventsTotal_.inc();
             LOGD("Welch params adjusted: nfft=%d, overlap=%.3f, nseg=%d", welchConfig->nfft, welchConfig->overlap, welchConfig->nseg);
         }
         nfft = welchConfig->nfft;
         overlapForCall = welchConfig->overlap;
-        LOGD("WelchPSD input: signal.size()=%zu, fs=%.3f, nfft=%d, overlap=%.3f, nseg=%d", yBufferD_.size(), effFs, nfft, overlapForCall, welchConfig->nseg);
-        heartpy::setDeterministic(opt_.deterministic);
-        auto ps = welchPowerSpectrum(yBufferD_, effFs, nfft, overlapForCall);
+        LOGD("WelchPSD input: signal.size()=%zu, fs=%.3f, nfft=%d, overlap=%.3f, nseg=%d", window.size(), effFs, nfft, overlapForCall, welchConfig->nseg);
+        const auto tPsd = std::chrono::steady_clock::now();
+        auto ps = welchPowerSpectrum(window, effFs, nfft, overlapForCall, ctx_);
+        recordLatency(LatencyMetric::PSD, tPsd);
         const auto& frq = ps.first;
         const auto& P = ps.second;
         LOGD("PSD calculation: frq.size()=%zu, P.size()=%zu", frq.size(), P.size());
@@ -1130,7 +1505,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
             powerBins = &lastPsdPower_;
             harmonicEligible = true;
         } else {
-            ++psdInvalidFramesTotal_;
+            psdInvalidFramesTotal_.inc();
             LOGD("PSD validation failed (frq.size()=%zu, P.size()=%zu)", frq.size(), P.size());
             if (!opt_.adaptivePsd) {
                 LOGD("Adaptive PSD disabled; aborting SNR update after invalid PSD");
@@ -1140,7 +1515,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
                 freqBins = &lastPsdFreq_;
                 powerBins = &lastPsdPower_;
                 snrSource = SnrSource::CachedPsd;
-                ++psdReuseFallbackEventsTotal_;
+                psdReuseFallbackEventsTotal_.inc();
                 LOGD("Reusing cached PSD (bins=%zu, last nfft=%d, overlap=%.3f)", lastPsdFreq_.size(), lastPsdNfft_, lastPsdOverlap_);
             } else {
                 snrSource = SnrSource::TimeDomain;
@@ -1149,7 +1524,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
         }
     }
 
-    auto computeTimeDomainSnrDb = [](const std::vector<double>& samples) -> double {
+    auto computeTimeDomainSnrDb = [](const std::vector<T>& samples) -> double {
         if (samples.size() < 16) {
             return kSnrFallbackDb;
         }
@@ -1187,18 +1562,18 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     bool activeSnr = false;
     double baseBw = opt_.snrBandPassive;
     double warmupSec = std::clamp(windowSec_ * 0.6, 6.0, 18.0);
-    double warmupElapsed = std::isfinite(warmupStartTs_)
-        ? std::max(0.0, lastTs_ - warmupStartTs_)
-        : std::max(0.0, lastTs_ - firstTsApprox_);
+    double warmupElapsed = std::isfinite(clk.warmupStartTs)
+        ? std::max(0.0, clk.lastTs - clk.warmupStartTs)
+        : std::max(0.0, clk.lastTs - clk.firstTsApprox);
     size_t minSamplesForSNR = static_cast<size_t>(std::ceil(std::max(128.0, std::max(4.0, windowSec_ * 0.6) * effFs)));
     size_t minPeaksForSNR = std::max<size_t>(6, static_cast<size_t>(std::ceil(windowSec_ * 0.4)));
-    bool insufficientPeaks = acceptedPeaksTotal_ < minPeaksForSNR;
+    bool insufficientPeaks = clk.acceptedPeaksTotal < minPeaksForSNR;
     bool warmupActive = (warmupElapsed < warmupSec) || (sampleCount < minSamplesForSNR) || insufficientPeaks;
     LOGD("updateSNR warmup check: elapsed=%.3f sec, warmupSec=%.3f sec, windowSec=%.3f, sampleCount=%zu, minSamples=%zu, acceptedPeaks=%zu, warmupActive=%d",
-         warmupElapsed, warmupSec, windowSec_, sampleCount, minSamplesForSNR, acceptedPeaksTotal_, warmupActive ? 1 : 0);
+         warmupElapsed, warmupSec, windowSec_, sampleCount, minSamplesForSNR, clk.acceptedPeaksTotal, warmupActive ? 1 : 0);
 
     if (warmupActive) {
-        double warmSnr = snrEmaValid_ ? snrEmaDb_ : computeTimeDomainSnrDb(yBufferD_);
+        double warmSnr = snrEmaValid_ ? snrEmaDb_ : computeTimeDomainSnrDb(window);
         if (!std::isfinite(warmSnr) || warmSnr <= 0.0) warmSnr = 8.0;
         snrEmaDb_ = warmSnr;
         snrEmaValid_ = true;
@@ -1211,8 +1586,8 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     out.quality.snrWarmupActive = 0;
 
     if (snrSource == SnrSource::TimeDomain) {
-        snrDbInst = computeTimeDomainSnrDb(yBufferD_);
-        ++psdTimeDomainFallbackEventsTotal_;
+        snrDbInst = computeTimeDomainSnrDb(window);
+        psdTimeDomainFallbackEventsTotal_.inc();
         LOGD("Time-domain SNR fallback applied: %.3f dB", snrDbInst);
     } else {
         const auto& frq = *freqBins;
@@ -1228,7 +1603,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
         if (softLastTrueTs_ > 0.0) lastActiveTs = std::max(lastActiveTs, softLastTrueTs_);
         if (doublingLastTrueTs_ > 0.0) lastActiveTs = std::max(lastActiveTs, doublingLastTrueTs_);
         if (hintLastTrueTs_ > 0.0) lastActiveTs = std::max(lastActiveTs, hintLastTrueTs_);
-        bool persistMapLoc = (lastActiveTs > 0.0) && ((lastTs_ - lastActiveTs) <= 5.0);
+        bool persistMapLoc = (lastActiveTs > 0.0) && ((clk.lastTs - lastActiveTs) <= 5.0);
         activeSnr = doublingHintActive_ || softDoublingActive_ || doublingActive_ || persistMapLoc;
         baseBw = activeSnr ? opt_.snrBandActive : opt_.snrBandPassive;
         band = std::max(2.0 * df, baseBw);
@@ -1298,7 +1673,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     if (!std::isfinite(snrDbInst)) snrDbInst = kSnrFallbackDb;
     LOGD("snrDbInst (after clamp): %.3f", snrDbInst);
     // EMA smoothing over time (tau = 8s when active)
-    double now = lastTs_;
+    double now = clk.lastTs;
     double dt = (lastSnrUpdateTime_ > 0.0) ? (now - lastSnrUpdateTime_) : psdUpdateSec_;
     if (opt_.deterministic) dt = psdUpdateSec_;
     double tau = activeSnr ? opt_.snrActiveTauSec : snrTauSec_;
@@ -1319,14 +1694,10 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     out.quality.snrDb = snrEmaDb_;
     out.quality.f0Hz = lastF0Hz_;
 
-    // Debug: Log SNR calculation details (only when SNR changes significantly)
-    static double lastLoggedSnr = 999.0;
-    if (std::abs(snrEmaDb_ - lastLoggedSnr) > 1.0 || snrEmaDb_ > 5.0) {
-        // Note: In production, this could be replaced with proper logging
-        // For now, we rely on JS-side logging
-        lastLoggedSnr = snrEmaDb_;
+    if (opt_.profileStages) {
+        harmonicStart_ = std::chrono::steady_clock::now();
+        if (alloc_audit::kEnabled) harmonicAllocs_ = alloc_audit::threadCounters();
     }
-
     double f0Half = 0.5 * lastF0Hz_;
     double pFund = 0.0;
     double pHalf = 0.0;
@@ -1339,8 +1710,8 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     double ratioHalfFund = 0.0;
     bool halfStable = false;
 
-    int acceptedRR = std::max(0, (int)acceptedPeaksTotal_ - 1);
-    bool warmupPassed = ((lastTs_ - firstTsApprox_) >= 15.0) && (acceptedRR >= 10);
+    int acceptedRR = std::max(0, (int)clk.acceptedPeaksTotal - 1);
+    bool warmupPassed = ((clk.lastTs - clk.firstTsApprox) >= 15.0) && (acceptedRR >= 10);
 
     if (harmonicEligible && freqBins && powerBins) {
         const auto& frqForHarm = *freqBins;
@@ -1394,10 +1765,10 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     bool softPass = warmupPassed && (ratioHalfFund >= opt_.pHalfOverFundThresholdSoft) && halfStable && softGuards;
     if (softPass) {
         LOGD("softPass triggered");
-        if (!softDoublingActive_) softStartTs_ = lastTs_;
+        if (!softDoublingActive_) softStartTs_ = clk.lastTs;
         softDoublingActive_ = true;
         softConsecPass_ = 2; // for logging
-        softLastTrueTs_ = lastTs_;
+        softLastTrueTs_ = clk.lastTs;
     } else {
         softConsecPass_ = 0;
         // Only keep soft active if hard doubling is governing
@@ -1409,17 +1780,17 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
         LOGD("softDoublingActive_: %d, doublingActive_: %d, doublingHintActive_: %d", softDoublingActive_ ? 1 : 0, doublingActive_ ? 1 : 0, doublingHintActive_ ? 1 : 0);
         bool hardStable = (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.20);
         LOGD("psdPersists: %d, hardStable: %d", psdPersists ? 1 : 0, hardStable ? 1 : 0);
-    if (softDoublingActive_ && ((lastTs_ - softStartTs_) >= 8.0) && psdPersists && persistHighBpm && hardStable) {
+    if (softDoublingActive_ && ((clk.lastTs - softStartTs_) >= 8.0) && psdPersists && persistHighBpm && hardStable) {
         doublingActive_ = true;
-        doublingHoldUntil_ = std::max(doublingHoldUntil_, lastTs_ + 5.0);
-        doublingLastTrueTs_ = lastTs_;
+        doublingHoldUntil_ = std::max(doublingHoldUntil_, clk.lastTs + 5.0);
+        doublingLastTrueTs_ = clk.lastTs;
         if (longRR > 0.0) doublingLongRRms_ = longRR;
         // Bound hard fallback window to ≤3s and within hold window
-        double hardRemain = std::max(0.0, doublingHoldUntil_ - lastTs_);
-        hardFallbackUntil_ = lastTs_ + std::min(3.0, hardRemain);
+        double hardRemain = std::max(0.0, doublingHoldUntil_ - clk.lastTs);
+        hardFallbackUntil_ = clk.lastTs + std::min(3.0, hardRemain);
     }
     bool hardGuardsOk = (ratioHalfFund >= 1.5) && halfStable && (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.20);
-    if (doublingActive_) { if (hardGuardsOk) doublingLastTrueTs_ = lastTs_; if ((lastTs_ - doublingLastTrueTs_) >= 5.0 && lastTs_ >= doublingHoldUntil_) doublingActive_ = false; }
+    if (doublingActive_) { if (hardGuardsOk) doublingLastTrueTs_ = clk.lastTs; if ((clk.lastTs - doublingLastTrueTs_) >= 5.0 && clk.lastTs >= doublingHoldUntil_) doublingActive_ = false; }
     // Oversuppression (choke) protection: if active doubling and BPM (from RR median) < 40 for >3s after 20s
     {
         double bpmEst = 0.0;
@@ -1428,11 +1799,11 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
             double med = tmp[tmp.size()/2]; if (med > 1e-6) bpmEst = 60000.0 / med;
         }
         bool dblActive = (doublingHintActive_ || softDoublingActive_ || doublingActive_);
-        if (dblActive && (lastTs_ >= 20.0) && (bpmEst > 0.0 && bpmEst < opt_.chokeBpmThreshold)) {
-            if (chokeStartTs_ <= 0.0) chokeStartTs_ = lastTs_;
-            if ((lastTs_ - chokeStartTs_) >= 3.0) {
+        if (dblActive && (clk.lastTs >= 20.0) && (bpmEst > 0.0 && bpmEst < opt_.chokeBpmThreshold)) {
+            if (chokeStartTs_ <= 0.0) chokeStartTs_ = clk.lastTs;
+            if ((clk.lastTs - chokeStartTs_) >= 3.0) {
                 double recoveryTime = (bpmEst < opt_.chokeBpmThreshold) ? opt_.chokeRelaxLowBpmSec : opt_.chokeRelaxBaseSec;
-                chokeRelaxUntil_ = lastTs_ + recoveryTime; // adaptive relax
+                chokeRelaxUntil_ = clk.lastTs + recoveryTime; // adaptive relax
             }
         } else {
             chokeStartTs_ = 0.0;
@@ -1442,15 +1813,14 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     bool psdHintPass = warmupPassed && (ratioHalfFund >= opt_.pHalfOverFundThresholdSoft) && halfStable && (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.30);
     // Optional subdominant PSD fallback (>=1.6 for ~6s, slightly looser drift)
     bool halfStableLoose = false; if (halfF0Hist_.size() >= 2) { double fmin2 = *std::min_element(halfF0Hist_.begin(), halfF0Hist_.end()); double fmax2 = *std::max_element(halfF0Hist_.begin(), halfF0Hist_.end()); halfStableLoose = ((fmax2 - fmin2) <= 0.08); }
-    static double psdLoStart = 0.0;
     bool psdLoNow = warmupPassed && (ratioHalfFund >= opt_.pHalfOverFundThresholdLow) && halfStableLoose && (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.20);
     bool psdLoHold = false;
-    if (psdLoNow) { if (psdLoStart <= 0.0) psdLoStart = lastTs_; if ((lastTs_ - psdLoStart) >= 6.0) psdLoHold = true; }
-    else { psdLoStart = 0.0; }
+    if (psdLoNow) { if (psdLoStart_ <= 0.0) psdLoStart_ = clk.lastTs; if ((clk.lastTs - psdLoStart_) >= 6.0) psdLoHold = true; }
+    else { psdLoStart_ = 0.0; }
     // RR-centric fallback: sustained high BPM, clean & stable RR around ~150 BPM (short mode)
     double medRR = 0.0; if (!out.rrList.empty()) { std::vector<double> tmp=out.rrList; std::nth_element(tmp.begin(), tmp.begin()+tmp.size()/2, tmp.end()); medRR = tmp[tmp.size()/2]; }
     bool rrBand = (medRR >= 370.0 && medRR <= 450.0);
-    bool highBpmPersist = bpmHighActive_ && ((lastTs_ - std::max(0.0, bpmHighStartTs_)) >= 8.0);
+    bool highBpmPersist = bpmHighActive_ && ((clk.lastTs - std::max(0.0, bpmHighStartTs_)) >= 8.0);
     bool rrClean = (rrCV <= 0.10) && (out.quality.rejectionRate <= 0.03);
     bool rrFallbackNow = warmupPassed && highBpmPersist && rrClean && rrBand;
     if (rrFallbackNow) ++rrFallbackConsec_; else rrFallbackConsec_ = 0;
@@ -1459,9 +1829,9 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     rrFallbackActive_ = rrHintPass; // mark whether RR path triggered this poll
     if (psdHintPass || psdLoHold || rrHintPass) {
         double hold = psdHintPass ? 12.0 : 8.0;
-        if (!doublingHintActive_) { hintHoldUntil_ = lastTs_ + hold; hintStartTs_ = lastTs_; }
+        if (!doublingHintActive_) { hintHoldUntil_ = clk.lastTs + hold; hintStartTs_ = clk.lastTs; }
         doublingHintActive_ = true;
-        hintLastTrueTs_ = lastTs_;
+        hintLastTrueTs_ = clk.lastTs;
         lastHintBadStart_ = 0.0;
         // Track whether hint is driven by RR fallback only (not PSD)
         bool rrOnly = rrHintPass && !(psdHintPass || psdLoHold);
@@ -1469,8 +1839,8 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     } else {
         // violation tracking similar to auto-clear: close after 2s of violations (but not before hold)
         if (doublingHintActive_) {
-            if (lastHintBadStart_ <= 0.0) lastHintBadStart_ = lastTs_;
-            if ((lastTs_ - lastHintBadStart_) >= 2.0 && lastTs_ >= hintHoldUntil_) doublingHintActive_ = false;
+            if (lastHintBadStart_ <= 0.0) lastHintBadStart_ = clk.lastTs;
+            if ((clk.lastTs - lastHintBadStart_) >= 2.0 && clk.lastTs >= hintHoldUntil_) doublingHintActive_ = false;
         }
     }
         if (!doublingHintActive_) rrFallbackDrivingHint_ = false;
@@ -1484,8 +1854,8 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     // Auto-clear: if violation persists ≥5s, drop both flags
     bool clearViolate = (ratioHalfFund < 1.5) || (!halfStable) || (rrCV > 0.20) || (out.quality.rejectionRate > 0.05);
     if (clearViolate) {
-        if (lastClearBadStart_ <= 0.0) lastClearBadStart_ = lastTs_;
-        if ((lastTs_ - lastClearBadStart_) >= 5.0) { softDoublingActive_ = false; doublingActive_ = false; }
+        if (lastClearBadStart_ <= 0.0) lastClearBadStart_ = clk.lastTs;
+        if ((clk.lastTs - lastClearBadStart_) >= 5.0) { softDoublingActive_ = false; doublingActive_ = false; }
     } else {
         lastClearBadStart_ = 0.0;
     }
@@ -1495,7 +1865,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     if (softLastTrueTs_ > 0.0) lastActiveTs_map = std::max(lastActiveTs_map, softLastTrueTs_);
     if (doublingLastTrueTs_ > 0.0) lastActiveTs_map = std::max(lastActiveTs_map, doublingLastTrueTs_);
     if (hintLastTrueTs_ > 0.0) lastActiveTs_map = std::max(lastActiveTs_map, hintLastTrueTs_);
-    bool persistMap = (lastActiveTs_map > 0.0) && ((lastTs_ - lastActiveTs_map) <= 5.0);
+    bool persistMap = (lastActiveTs_map > 0.0) && ((clk.lastTs - lastActiveTs_map) <= 5.0);
     bool useHalfForSNR = softDoublingActive_ || doublingActive_ || doublingHintActive_ || halfDominant || persistMap;
     double f0Used = f0;
     if (useHalfForSNR && f0 > 0.0) {
@@ -1524,21 +1894,30 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     lastF0Hz_ = f0Used; out.quality.f0Hz = lastF0Hz_; out.quality.snrDb = snrEmaDb_;
     out.quality.softDoublingFlag = softDoublingActive_ ? 1 : 0;
     out.quality.doublingFlag = doublingActive_ ? 1 : 0;
-    out.quality.hardFallbackActive = (doublingActive_ && (lastTs_ <= hardFallbackUntil_)) ? 1 : 0;
+    out.quality.hardFallbackActive = (doublingActive_ && (clk.lastTs <= hardFallbackUntil_)) ? 1 : 0;
     out.quality.doublingHintFlag = doublingHintActive_ ? 1 : 0;
+    if (trace::enabled()) {
+        const int state = (softDoublingActive_ ? 1 : 0) | (doublingActive_ ? 2 : 0) | (doublingHintActive_ ? 4 : 0);
+        if (state != tracedDoublingState_) {
+            trace::counter("softDoublingActive", softDoublingActive_ ? 1.0 : 0.0);
+            trace::counter("doublingActive", doublingActive_ ? 1.0 : 0.0);
+            trace::counter("doublingHintActive", doublingHintActive_ ? 1.0 : 0.0);
+            tracedDoublingState_ = state;
+        }
+    }
     out.quality.rrFallbackModeActive = rrFallbackModeActive_ ? 1 : 0;
     out.quality.pHalfOverFund = ratioHalfFund;
     out.quality.pairFrac = pairFrac;
     out.quality.rrShortFrac = shortFrac;
     out.quality.rrLongMs = longRR;
     out.quality.softStreak = softConsecPass_;
-    out.quality.softSecs = softDoublingActive_ ? (lastTs_ - softStartTs_) : 0.0;
+    out.quality.softSecs = softDoublingActive_ ? (clk.lastTs - softStartTs_) : 0.0;
     // Logistic mapping for confidence (mirror active mapping used after updateSNR)
     double lastActiveTs3 = 0.0;
     if (softLastTrueTs_ > 0.0) lastActiveTs3 = std::max(lastActiveTs3, softLastTrueTs_);
     if (doublingLastTrueTs_ > 0.0) lastActiveTs3 = std::max(lastActiveTs3, doublingLastTrueTs_);
     if (hintLastTrueTs_ > 0.0) lastActiveTs3 = std::max(lastActiveTs3, hintLastTrueTs_);
-    bool persistMap3 = (lastActiveTs3 > 0.0) && ((lastTs_ - lastActiveTs3) <= 5.0);
+    bool persistMap3 = (lastActiveTs3 > 0.0) && ((clk.lastTs - lastActiveTs3) <= 5.0);
     bool activeConf3 = doublingHintActive_ || softDoublingActive_ || doublingActive_ || persistMap3;
     double x0 = activeConf3 ? 5.2 : 6.0; // center (dB)
     double k = activeConf3 ? (1.0/1.2) : 0.8;  // slope
@@ -1558,18 +1937,18 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     }
     if (activeConf3) {
         double activeSecs = 0.0;
-        if (softDoublingActive_) activeSecs = std::max(activeSecs, lastTs_ - softStartTs_);
-        if (doublingHintActive_ && hintStartTs_ > 0.0) activeSecs = std::max(activeSecs, lastTs_ - hintStartTs_);
+        if (softDoublingActive_) activeSecs = std::max(activeSecs, clk.lastTs - softStartTs_);
+        if (doublingHintActive_ && hintStartTs_ > 0.0) activeSecs = std::max(activeSecs, clk.lastTs - hintStartTs_);
         if (out.quality.rejectionRate < 0.03 && cv < 0.12 && activeSecs >= 8.0) conf = std::min(1.0, conf * 1.1);
     }
     // Warm-up gate: require >=15s or >=15 beats before trusting confidence
     double warmupSecTarget = std::clamp(windowSec_ * 2.0, 4.0, 10.0);
     size_t warmupBeatsTarget = std::max<size_t>(4, static_cast<size_t>(std::ceil(windowSec_ * 1.5)));
-    double elapsed = std::isfinite(warmupStartTs_) ? std::max(0.0, lastTs_ - warmupStartTs_) : std::max(0.0, lastTs_ - firstTsApprox_);
+    double elapsed = std::isfinite(clk.warmupStartTs) ? std::max(0.0, clk.lastTs - clk.warmupStartTs) : std::max(0.0, clk.lastTs - clk.firstTsApprox);
     double timeProgress = warmupSecTarget > 0.0 ? elapsed / warmupSecTarget : 1.0;
     size_t beatsInWindow = 0;
     if (!out.peakList.empty()) beatsInWindow = out.peakList.size();
-    else if (!lastPeaks_.empty()) beatsInWindow = lastPeaks_.size();
+    else if (clk.lastPeakCount) beatsInWindow = clk.lastPeakCount;
     else if (!out.rrList.empty()) beatsInWindow = out.rrList.size() + 1;
     double beatProgress = (warmupBeatsTarget > 0)
         ? static_cast<double>(beatsInWindow) / static_cast<double>(warmupBeatsTarget)
@@ -7,10 +7,20 @@
 #include <mutex>
 #include <algorithm>
 #include <limits>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
 #include "heartpy_core.h"
+#include "heartpy_histogram.h"
+#include "heartpy_alloc_audit.h"
+#include "heartpy_metrics.h"
+#include "heartpy_c.h"
 
 namespace heartpy {
 
+class CaptureRecorder; // heartpy_capture.h
+
 // Simple fixed-capacity ring buffer for POD types
 template <typename T>
 class RingBuffer {
@@ -93,6 +103,28 @@ struct SBiquadD {
     }
 };
 
+// Result of a push(). Batches of any length are accepted; oversized ones are
+// ingested in bounded slices (the data lock is released between slices) so
+// catch-up/backfill never truncates samples nor blocks poll() for long.
+struct PushStatus {
+    size_t accepted {0};         // samples consumed from this batch (timestamp backtracks excluded)
+    size_t chunks {0};           // lock acquisitions used to ingest this batch
+    size_t pendingSamples {0};   // samples ingested since the last emitted poll
+    size_t windowSamples {0};    // analysis window length in samples
+    bool   backpressure {false}; // pending > window: samples scrolled out before a poll analyzed them
+};
+
+// Latency series tracked per analyzer and process-wide (LatencyHistogram)
+enum class LatencyMetric {
+    PUSH = 0,       // push() call, all slices
+    POLL,           // poll() that emitted a result
+    PSD,            // Welch PSD inside the SNR update
+    LOCK_SNAPSHOT,  // poll(): data lock held while snapshotting the window
+    LOCK_COMMIT,    // poll(): data lock held while committing quality
+    LOCK_INGEST,    // push(): data lock held per ingest slice
+    COUNT
+};
+
 // A minimal, non-breaking streaming API skeleton.
 // Internally uses a batch fallback on the sliding window until
 // fully incremental path (peaks/filters) is implemented in later phases.
@@ -100,18 +132,45 @@ class RealtimeAnalyzer {
 public:
     explicit RealtimeAnalyzer(double fs, const Options& opt = {});
 
+    // Reinitialises the analyzer in place as if it had been constructed with
+    // (fs, opt): stream state, window (back to the default length), filters
+    // and per-analyzer telemetry. Buffer capacity, the execution context
+    // (plans, scratch, log sink) and id() are kept, so no large allocation
+    // happens. Not safe against a concurrent push/poll.
+    void reset(double fs, const Options& opt = {});
+    // Reserves the window buffers for n samples (e.g. a pool capacity class)
+    void reserveSamples(size_t n);
+    // Samples the window buffers hold without reallocating
+    size_t reservedSamples() const {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        return std::min({m_signal_buffer.capacity(), m_timestamps.capacity(), filt_.capacity()});
+    }
+
     void setWindowSeconds(double sec);              // 10–60 seconds typical
     void setUpdateIntervalSeconds(double sec);      // default 1.0 second
-    void setPsdUpdateSeconds(double sec) { std::lock_guard<std::mutex> lock(dataMutex_); psdUpdateSec_ = std::clamp(sec, 0.5, 5.0); }
-    void setDisplayHz(double hz) { std::lock_guard<std::mutex> lock(dataMutex_); displayHz_ = std::clamp(hz, 10.0, 120.0); }
+    void setPsdUpdateSeconds(double sec);
+    void setDisplayHz(double hz);
     // Convenience presets (may adjust filter/threshold defaults)
     void applyPresetTorch() { opt_.lowHz = 0.7; opt_.highHz = 3.0; opt_.refractoryMs = std::max(300.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc)); }
     void applyPresetAmbient() { opt_.lowHz = 0.5; opt_.highHz = 3.5; opt_.thresholdScale = std::max(0.5, opt_.thresholdScale); opt_.refractoryMs = std::max(320.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc)); }
 
-    void push(const float* samples, size_t n, double t0 = 0.0);
-    void push(const std::vector<double>& samples, double t0 = 0.0);
+    // Samples 1/fs apart from t0 (seconds, first sample). A t0 that is not
+    // after the previous sample, such as the default 0, continues the stream
+    // 1/fs after it.
+    PushStatus push(const float* samples, size_t n, double t0 = 0.0);
+    PushStatus push(const std::vector<double>& samples, double t0 = 0.0);
     // Optional: per-sample timestamps in seconds for variable-fps sources
-    void push(const float* samples, const double* timestamps, size_t n);
+    PushStatus push(const float* samples, const double* timestamps, size_t n);
+    // Views (heartpy_view.h) of packed, strided or interleaved sources, e.g.
+    // push(fieldView(frames, n, &Frame::green), fieldView(frames, n, &Frame::t)).
+    // Samples are read in place and stored at float precision; with
+    // timestamps, the shorter of the two views sets the count.
+    PushStatus push(SampleView<float> samples, double t0 = 0.0);
+    PushStatus push(SampleView<double> samples, double t0 = 0.0);
+    PushStatus push(SampleView<float> samples, SampleView<double> timestamps);
+    PushStatus push(SampleView<double> samples, SampleView<double> timestamps);
+    // Ingest backlog state as of the last push/poll (see PushStatus)
+    PushStatus pushStatus() const { std::lock_guard<std::mutex> lock(dataMutex_); return pushStatusLocked(0, 0); }
 
     // If a new update is ready (>= update interval), fills out and returns true
     bool poll(HeartMetrics& out);
@@ -120,25 +179,124 @@ public:
     std::vector<int> latestPeaks() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastPeaks_; }
     std::vector<double> latestRR() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastRR_; }
     std::vector<float> displayBuffer() const { std::lock_guard<std::mutex> lock(dataMutex_); return displayBuf_; }
+    // Shared, immutable views of the same buffers: copied at most once per
+    // push and shared by every caller until the next one (no copy per call)
+    SharedSamples<int> latestPeaksSnapshot() const { std::lock_guard<std::mutex> lock(dataMutex_); return peaksView_.get(lastPeaks_, viewGen_); }
+    SharedSamples<double> latestRRSnapshot() const { std::lock_guard<std::mutex> lock(dataMutex_); return rrView_.get(lastRR_, viewGen_); }
+    SharedSamples<float> displaySnapshot() const { std::lock_guard<std::mutex> lock(dataMutex_); return displayView_.get(displayBuf_, viewGen_); }
+
+    // Execution context used by poll() (analysis + Welch/SNR). Owned by this
+    // analyzer; configure it (log sink, plan cache) before streaming or from
+    // the polling thread only.
+    ExecutionContext& executionContext() { return ctx_; }
+
+    // Pays the first poll's one-off costs up front. This means the FFT plan
+    // and scratch for the Welch size the SNR update uses on a full window,
+    // first-touch of the window, poll and scratch buffers, and one dummy
+    // analysis over a full synthetic window. Call it after setting the window
+    // and options, on the polling thread (scratch and plan slots are per
+    // thread). Streaming state is unchanged.
+    void prewarm();
+
+    // Process-unique id, exported as the analyzer="<id>" label of this
+    // analyzer's series in metrics::registry()
+    uint64_t id() const { return id_; }
+    // Hides this analyzer's series from metrics::registry() (on by default);
+    // AnalyzerPool turns it off while the analyzer sits idle
+    void setMetricsExported(bool on) { metrics_.setExported(on); }
+
+    // Checkpoint of the full streaming state: options, window buffers, filter
+    // state, rolling threshold stats, BPM/SNR EMAs, ma_perc tuning, harmonic
+    // suppression and provisional-HR state, and the last quality. A restored
+    // analyzer continues exactly where the saved one stopped, without warm-up.
+    // Telemetry (latency histograms, metrics counters, id()) is not included.
+    // The blob is versioned and checksummed; restoreState() returns false and
+    // leaves the analyzer untouched when it is truncated, corrupt or from an
+    // incompatible build. Call both from the polling thread or while no poll
+    // is in flight. Timestamped pushes after a restore must continue the saved
+    // timebase (see streamTime()).
+    std::vector<uint8_t> saveState() const;
+    bool restoreState(const uint8_t* data, size_t size);
+    // Version of the saveState() format, including the Options layout
+    static uint16_t stateFormatVersion();
+    // Session capture (heartpy_capture.h): writes a checkpoint of the current
+    // state, then every push, emitting poll and setting change, so
+    // replayCapture() feeds a fresh analyzer bit-identical inputs. Each poll
+    // is replayed between the same two pushes it ran between here. Starting
+    // again replaces the running capture; reset() stops it. Throws
+    // std::runtime_error if the file cannot be created. The returned recorder
+    // reports stats and may outlive the capture. Like saveState(), call
+    // startCapture() from the polling thread or while no poll is in flight:
+    // the checkpoint includes state poll() updates outside dataMutex_ (SNR
+    // EMAs, provisional HR). stopCapture() may be called from any thread.
+    std::shared_ptr<CaptureRecorder> startCapture(const std::string& path, size_t bufferBytes = 1u << 20);
+    void stopCapture();
+    // Timestamp (seconds) of the last ingested sample
+    double streamTime() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastTs_; }
+
+    // Per-stage latency aggregated over polls (requires Options::profileStages)
+    const LatencyHistogram& stageHistogram(int stage) const;
+    void resetStageHistograms();
+
+    // Push/poll/PSD latency of this analyzer (always on). Lock-hold series are
+    // filled only in builds with HEARTPY_LOCK_TIMING. Safe to read while
+    // streaming; every sample is also folded into globalLatencyHistogram().
+    const LatencyHistogram& latencyHistogram(LatencyMetric m) const { return latency_[static_cast<int>(m)]; }
+    static LatencyHistogram& globalLatencyHistogram(LatencyMetric m);
+
+    // Legacy lock timing view over the global histograms.
+    // which: 1 = snapshot lock, 2 = commit lock
+    static void lockStatsGet(int which, double& avg_us, double& p95_us, bool reset);
+    static void recordLockHold(int which, double us);
 
 private:
-    void append(const float* x, size_t n);
+    void configure();
+    template <class T> PushStatus ingest(SampleView<T> samples, double t0);
+    template <class T> PushStatus ingestTimestamped(SampleView<T> samples, SampleView<double> timestamps);
+    template <class T> size_t appendTimestamped(SampleView<T> x, SampleView<double> ts); // returns samples kept
+    size_t ingestSliceSamples() const;
+    PushStatus pushStatusLocked(size_t accepted, size_t chunks) const;
     void trimToWindow();
-    void updateSNR(HeartMetrics& out);
+    // Push-written stream state as of a poll's snapshot. The poll stages that
+    // run after the lock is released read this copy, never the members.
+    struct PollClock {
+        double lastTs;
+        double firstTsApprox;
+        double warmupStartTs;
+        double effectiveFs;
+        size_t acceptedPeaksTotal;
+        size_t lastPeakCount;
+    };
+    // window: this poll's snapshot of filt_ (float or widened double)
+    template <class T> void updateSNR(HeartMetrics& out, const std::vector<T>& window, const PollClock& clk);
+    template <class T> void applyProvisionalHR(HeartMetrics& out, const std::vector<T>& window, double fsEff,
+                                               const PollClock& clk);
+    // Visits every checkpointed member in format order (heartpy_stream_state.cpp)
+    template <class Archive> void transferState(Archive& ar);
+    // saveState() payload under dataMutex_; sealState() adds the header
+    void writeStateLocked(std::vector<uint8_t>& blob) const;
+    static void sealState(std::vector<uint8_t>& blob);
     // Thread safety
     mutable std::mutex dataMutex_;
 
     // Performance scratch buffers (reused to avoid frequent reallocations)
     double medianOfRR(const std::vector<double>& rr);
     std::vector<double> scratchRR_;
-    std::vector<double> yBufferD_;
     std::vector<double> noiseScratch_;
+    std::vector<double> nominalTs_;      // push() without timestamps: one slice of t0 + i/fs (dataMutex_)
     std::vector<char> keepScratch_;
     std::vector<double> lastPsdFreq_;
     std::vector<double> lastPsdPower_;
 
     double fs_ {0.0};              // nominal fs from constructor
     Options opt_ {};
+    ExecutionContext ctx_ {};      // per-analyzer determinism/FFT/scratch/log state
+    // Stage profiling (opt_.profileStages)
+    std::array<LatencyHistogram, StageTimings::COUNT> stageHist_ {};
+    std::array<LatencyHistogram, static_cast<int>(LatencyMetric::COUNT)> latency_ {};
+    void recordLatency(LatencyMetric m, std::chrono::steady_clock::time_point t0);
+    std::chrono::steady_clock::time_point harmonicStart_ {}; // set by updateSNR when profiling
+    AllocCounters harmonicAllocs_ {};                         // thread allocations at harmonicStart_ (audit builds)
     double windowSec_ {60.0};
     double updateSec_ {1.0};
 
@@ -158,8 +316,17 @@ private:
     std::vector<double> m_timestamps;
     std::vector<float> filt_;
     std::vector<float> displayBuf_; // downsampled view for UI
-    std::vector<double> pollWindowBuffer_;
-    std::vector<double> pollTimestampBuffer_;
+    // Per-poll window snapshots: analyzed in place and handed out as
+    // HeartMetrics::waveform_values/waveform_timestamps without another copy
+    SnapshotWriter<double> pollWindow_;
+    SnapshotWriter<double> pollTimestamps_;
+    SnapshotWriter<float> pollWindowF_; // Options::singlePrecision windows
+    // Accessor views of lastPeaks_/lastRR_/displayBuf_; viewGen_ moves on
+    // every push and restore
+    uint64_t viewGen_ {0};
+    mutable SnapshotCache<int> peaksView_;
+    mutable SnapshotCache<double> rrView_;
+    mutable SnapshotCache<float> displayView_;
     std::vector<SBiquad> bq_;
     std::vector<SBiquadD> bqD_;
     // Optional ring storage (when opt_.useRingBuffer == true)
@@ -191,30 +358,25 @@ private:
     std::vector<size_t> peaksAbs_;
     size_t acceptedPeaksTotal_ {0};
 
-    // Audit/telemetry counters
-    unsigned long long droppedSamplesTotal_ {0};
-    unsigned long long clampedBatchesTotal_ {0};
-    unsigned long long oomPreventedTotal_ {0};
-    unsigned long long paramChangeEventsTotal_ {0};
-    int lastMergeBudgetExhausted_ {0};
-    unsigned long long mergeBudgetExhaustedTotal_ {0};
+    // Audit/telemetry counters (exported through metrics_, see registerMetrics)
+    metrics::Counter droppedSamplesTotal_;
+    metrics::Counter chunkedBatchesTotal_;           // batches split into >1 ingest slice
+    metrics::Counter backpressureEventsTotal_;       // pushes that left more than a window pending
+    size_t samplesSinceEmit_ {0};                    // ingested since last emitted poll
+    metrics::Counter paramChangeEventsTotal_;
     unsigned long long droppedSamplesLast_ {0};
-    unsigned long long clampedBatchesLast_ {0};
     int dropConsecPolls_ {0};
-    unsigned long long timestampBacktrackEventsTotal_ {0};
-    unsigned long long timestampsSkippedTotal_ {0};
-    unsigned long long timeJumpEventsTotal_ {0};
-    unsigned long long psdParamClampEventsTotal_ {0};
-    unsigned long long psdReuseFallbackEventsTotal_ {0};
-    unsigned long long psdTimeDomainFallbackEventsTotal_ {0};
-    unsigned long long psdInvalidFramesTotal_ {0};
-
-#ifdef HEARTPY_LOCK_TIMING
-public:
-    // which: 1 = snapshot lock, 2 = commit lock
-    static void lockStatsGet(int which, double& avg_us, double& p95_us, bool reset);
-    static void recordLockHold(int which, double us);
-#endif
+    metrics::Counter timestampBacktrackEventsTotal_;
+    metrics::Counter timestampsSkippedTotal_;
+    metrics::Counter timeJumpEventsTotal_;
+    metrics::Counter psdParamClampEventsTotal_;
+    metrics::Counter psdReuseFallbackEventsTotal_;
+    metrics::Counter psdTimeDomainFallbackEventsTotal_;
+    metrics::Counter psdInvalidFramesTotal_;
+    metrics::Gauge pendingSamplesGauge_;
+    metrics::Gauge effectiveFsGauge_;
+    metrics::Gauge snrDbGauge_;
+    metrics::Gauge confidenceGauge_;
 
     // HP-style thresholding state
     double baseLift_ {0.0};         // mn = mean(rolling_mean)/100 * maPerc_
@@ -283,9 +445,28 @@ public:
     double hintStartTs_ {0.0};
     double hintHoldUntil_ {0.0};
     double lastHintBadStart_ {0.0};
+    int    tracedDoublingState_ {-1}; // soft|hard|hint bits last written to the trace
+    // The harmonic state above as the peak detector in push() sees it. poll()
+    // updates the members without the lock and republishes this copy under
+    // dataMutex_ when it commits (restoreState and reset do the same).
+    struct PeakGuard {
+        bool   softDoublingActive {false};
+        bool   doublingActive {false};
+        bool   doublingHintActive {false};
+        double doublingLongRRms {0.0};
+        double doublingHoldUntil {0.0};
+        double hardFallbackUntil {0.0};
+        double lastF0Hz {0.0};
+    };
+    PeakGuard peakGuard_ {};
+    void publishPeakGuard() {
+        peakGuard_ = {softDoublingActive_, doublingActive_, doublingHintActive_, doublingLongRRms_,
+                      doublingHoldUntil_, hardFallbackUntil_, lastF0Hz_};
+    }
     // Temporary relaxation when oversuppression detected
     double chokeRelaxUntil_ {0.0};
     double chokeStartTs_ {0.0};
+    double psdLoStart_ {0.0};      // start of sustained low-ratio PSD doubling evidence
 
     bool   lastPsdValid_ {false};
     double lastPsdFs_ {0.0};
@@ -297,18 +478,28 @@ public:
     bool   rrFallbackDrivingHint_ {false};
     double lastPollBpmEst_ {0.0};
     bool   rrFallbackModeActive_ {false};
+    // Provisional HR during warm-up (opt_.provisionalHR)
+    std::vector<double> provisionalAcf_;
+    double provisionalLastBpm_ {0.0};        // last reported provisional BPM (0 = none pending hand-off)
+    double provisionalHandoffStart_ {-1.0};  // stream time the hand-off cross-fade started
+    bool   provisionalDone_ {false};         // handed off; re-armed when warm-up restarts
+
+    // Session capture (startCapture); guarded by dataMutex_
+    std::shared_ptr<CaptureRecorder> recorder_;
+
+    // Registry entry for this analyzer's counters/gauges/latency; declared
+    // last so it unregisters before the objects it references are destroyed
+    uint64_t id_ {0};
+    metrics::MetricGroup metrics_;
+    void registerMetrics();
 };
 
 } // namespace heartpy
 
-// Optional plain C bridge (symbols have C linkage; still compiled as C++)
+// Plain C bridge, C++ half: entry points that take heartpy types. The C-typed
+// lifecycle (create by field mask, push, poll_into, destroy) is in heartpy_c.h.
 extern "C" {
     void* hp_rt_create(double fs, const heartpy::Options* opt);
-    void  hp_rt_set_window(void* h, double sec);
-    void  hp_rt_set_update_interval(void* h, double sec);
-    void  hp_rt_push(void* h, const float* x, size_t n, double t0);
-    // Per-sample timestamped push (seconds)
-    void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n);
+    void* hp_rt_pool_acquire(void* pool, double fs, const heartpy::Options* opt, double windowSec);
     int   hp_rt_poll(void* h, heartpy::HeartMetrics* out);
-    void  hp_rt_destroy(void* h);
 }
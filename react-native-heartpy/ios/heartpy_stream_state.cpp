@@ -0,0 +1,369 @@
+// RealtimeAnalyzer checkpoint/restore and in-place reset
+#include "heartpy_stream.h"
+#include "heartpy_capture.h"
+#include "heartpy_trace.h"
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+
+namespace heartpy {
+
+namespace {
+
+// Blob layout: StateHeader, then the payload written by transferState() in
+// member order. Values are raw native-endian; the header rejects blobs from
+// builds with a different byte order or Options layout. Bump kStateVersion
+// whenever transferState() changes, or Options fields move without changing
+// sizeof(Options) (v2: Options::singlePrecision).
+constexpr char kStateMagic[4] = {'H', 'P', 'R', 'S'};
+constexpr uint16_t kStateVersion = 2;
+constexpr uint16_t kStateByteOrder = 0x0102;
+
+struct StateHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t byteOrder;
+    uint32_t optionsSize;
+    uint32_t reserved;
+    uint64_t payloadSize;
+    uint64_t checksum; // FNV-1a over the payload
+};
+
+static_assert(std::is_trivially_copyable<Options>::value, "Options is checkpointed as raw bytes");
+
+uint64_t fnv1a(const uint8_t* p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+class StateWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    template <class T> void pod(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw field");
+        raw(&v, sizeof(T));
+    }
+    template <class T> void seq(std::vector<T>& v) { count(v.size()); if (!v.empty()) raw(v.data(), v.size() * sizeof(T)); }
+    template <class T> void seq(std::deque<T>& d) { count(d.size()); for (T& x : d) pod(x); }
+    // The raw window holds float input widened to double; stored losslessly as float
+    void floats(std::vector<double>& v) {
+        count(v.size());
+        for (double x : v) { float f = static_cast<float>(x); pod(f); }
+    }
+    void ring(RingBuffer<float>& r) {
+        uint64_t cap = r.capacity();
+        pod(cap);
+        std::vector<float> tmp;
+        r.snapshot(tmp);
+        seq(tmp);
+    }
+    void str(std::string& s) { count(s.size()); raw(s.data(), s.size()); }
+    bool ok() const { return true; }
+
+private:
+    void count(size_t n) { uint64_t c = n; pod(c); }
+    void raw(const void* p, size_t n) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        bytes.insert(bytes.end(), b, b + n);
+    }
+};
+
+// Bounds-checked reader. With Apply = false it only walks the payload, so a
+// malformed blob is rejected before any member is overwritten.
+template <bool Apply>
+class StateReader {
+public:
+    StateReader(const uint8_t* p, size_t n) : p_(p), end_(p + n) {}
+
+    template <class T> void pod(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw field");
+        T tmp;
+        if (!take(&tmp, sizeof(T))) return;
+        if (Apply) v = tmp;
+    }
+    template <class T> void seq(std::vector<T>& v) {
+        const size_t n = count(sizeof(T));
+        if (!ok_) return;
+        if (Apply) { v.resize(n); if (n) std::memcpy(v.data(), p_, n * sizeof(T)); }
+        p_ += n * sizeof(T);
+    }
+    template <class T> void seq(std::deque<T>& d) {
+        const size_t n = count(sizeof(T));
+        if (!ok_) return;
+        if (Apply) {
+            d.clear();
+            for (size_t i = 0; i < n; ++i) { T x; std::memcpy(&x, p_ + i * sizeof(T), sizeof(T)); d.push_back(x); }
+        }
+        p_ += n * sizeof(T);
+    }
+    void floats(std::vector<double>& v) {
+        const size_t n = count(sizeof(float));
+        if (!ok_) return;
+        if (Apply) {
+            v.resize(n);
+            for (size_t i = 0; i < n; ++i) { float f; std::memcpy(&f, p_ + i * sizeof(float), sizeof(float)); v[i] = f; }
+        }
+        p_ += n * sizeof(float);
+    }
+    void ring(RingBuffer<float>& r) {
+        uint64_t cap = 0;
+        pod(cap);
+        std::vector<float> tmp;
+        const size_t n = count(sizeof(float));
+        if (!ok_) return;
+        if (n > cap) { ok_ = false; return; }
+        if (Apply) {
+            tmp.resize(n);
+            if (n) std::memcpy(tmp.data(), p_, n * sizeof(float));
+            r = cap ? RingBuffer<float>(static_cast<size_t>(cap)) : RingBuffer<float>(); // 0: never configured
+            r.push_back_many(tmp.data(), tmp.size());
+        }
+        p_ += n * sizeof(float);
+    }
+    void str(std::string& s) {
+        const size_t n = count(1);
+        if (!ok_) return;
+        if (Apply) s.assign(reinterpret_cast<const char*>(p_), n);
+        p_ += n;
+    }
+    bool ok() const { return ok_; }
+    bool atEnd() const { return ok_ && p_ == end_; }
+
+private:
+    bool take(void* dst, size_t n) {
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) { ok_ = false; return false; }
+        std::memcpy(dst, p_, n);
+        p_ += n;
+        return true;
+    }
+    // Element count, validated against the remaining payload
+    size_t count(size_t elemSize) {
+        uint64_t c = 0;
+        if (!take(&c, sizeof(c))) return 0;
+        if (c > static_cast<uint64_t>(end_ - p_) / elemSize) { ok_ = false; return 0; }
+        return static_cast<size_t>(c);
+    }
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ {true};
+};
+
+template <class Archive>
+void transferQuality(Archive& ar, QualityInfo& q) {
+    ar.pod(q.totalBeats); ar.pod(q.rejectedBeats); ar.pod(q.rejectionRate);
+    ar.seq(q.rejectedIndices);
+    ar.pod(q.goodQuality);
+    ar.str(q.qualityWarning);
+    ar.pod(q.snrDb); ar.pod(q.confidence); ar.pod(q.f0Hz); ar.pod(q.maPercActive);
+    ar.pod(q.doublingFlag); ar.pod(q.softDoublingFlag); ar.pod(q.rrShortFrac); ar.pod(q.rrLongMs);
+    ar.pod(q.pHalfOverFund); ar.pod(q.pairFrac);
+    ar.pod(q.refractoryMsActive); ar.pod(q.minRRBoundMs); ar.pod(q.softStreak); ar.pod(q.softSecs);
+    ar.pod(q.hardFallbackActive); ar.pod(q.doublingHintFlag); ar.pod(q.rrFallbackModeActive);
+    ar.pod(q.snrWarmupActive); ar.pod(q.snrSampleCount);
+    ar.pod(q.provisionalActive); ar.pod(q.provisionalBpm); ar.pod(q.provisionalConfidence);
+}
+
+} // namespace
+
+template <class Archive>
+void RealtimeAnalyzer::transferState(Archive& ar) {
+    // Configuration
+    ar.pod(fs_); ar.pod(opt_);
+    ar.pod(windowSec_); ar.pod(updateSec_); ar.pod(psdUpdateSec_); ar.pod(displayHz_);
+    // Timebase
+    ar.pod(lastEmitTime_); ar.pod(lastTs_); ar.pod(firstTsApprox_); ar.pod(warmupStartTs_);
+    ar.pod(effectiveFs_); ar.pod(emaAlpha_); ar.pod(lastPsdTime_);
+    // Window buffers and streaming filter state
+    ar.floats(m_signal_buffer);
+    ar.seq(m_timestamps);
+    ar.seq(filt_);
+    ar.seq(displayBuf_);
+    ar.seq(bq_);
+    ar.seq(bqD_);
+    ar.pod(useRing_); ar.pod(ringCapacity_);
+    ar.ring(ringSignal_);
+    ar.ring(ringFilt_);
+    ar.seq(lastPsdFreq_);
+    ar.seq(lastPsdPower_);
+    // Cached outputs
+    transferQuality(ar, lastQuality_);
+    ar.seq(lastPeaks_);
+    ar.seq(lastRR_);
+    // Rolling threshold stats and peak bookkeeping
+    ar.seq(rollWin_); ar.pod(rollSum_); ar.pod(rollSumSq_);
+    ar.seq(rollWinRect_); ar.pod(rollRectSum_); ar.pod(rollRectSumSq_);
+    ar.seq(rectMinQ_); ar.seq(rectMaxQ_);
+    ar.pod(winSamples_); ar.pod(refractorySamples_);
+    ar.pod(firstAbs_); ar.pod(totalAbs_);
+    ar.seq(peaksAbs_);
+    ar.pod(acceptedPeaksTotal_);
+    ar.pod(samplesSinceEmit_); ar.pod(droppedSamplesLast_); ar.pod(dropConsecPolls_);
+    // Thresholding and ma_perc tuning
+    ar.pod(baseLift_); ar.pod(maPerc_); ar.pod(hpThreshold_);
+    ar.pod(lastMaUpdateTime_); ar.pod(lastMaChangeTime_); ar.pod(maUpdateSec_); ar.pod(maPercScore_);
+    // SNR and BPM EMAs
+    ar.pod(snrEmaDb_); ar.pod(snrEmaValid_); ar.pod(snrTauSec_); ar.pod(lastSnrUpdateTime_);
+    ar.pod(lastSnrActiveMode_); ar.pod(lastSnrBaseBw_);
+    ar.pod(bpmEma_); ar.pod(bpmEmaValid_); ar.pod(bpmTauSec_); ar.pod(lastBpmUpdateTime_);
+    ar.pod(lastF0Hz_); ar.pod(lastRefMsActive_); ar.pod(lastMinRRBoundMs_);
+    ar.pod(warmupWasPassed_); ar.pod(hardFallbackUntil_);
+    // RR gating
+    ar.pod(shortRejectCount_); ar.pod(shortRejectWindowStart_);
+    ar.pod(tempLiftBoost_); ar.pod(tempLiftUntil_);
+    ar.pod(dynRefExtraSamples_); ar.pod(dynRefUntil_); ar.pod(lastAcceptedAmpCmp_);
+    ar.pod(cvHighStartTs_); ar.pod(cvHighActive_);
+    ar.pod(bpmHighStartTs_); ar.pod(bpmHighActive_);
+    // Harmonic suppression
+    ar.pod(softDoublingActive_); ar.pod(softConsecPass_); ar.pod(softStartTs_); ar.pod(softLastTrueTs_);
+    ar.seq(halfF0Hist_);
+    ar.pod(doublingActive_); ar.pod(doublingLastTrueTs_); ar.pod(doublingHoldUntil_); ar.pod(doublingLongRRms_);
+    ar.pod(lastClearBadStart_);
+    ar.pod(doublingHintActive_); ar.pod(hintLastTrueTs_); ar.pod(hintStartTs_); ar.pod(hintHoldUntil_);
+    ar.pod(lastHintBadStart_);
+    ar.pod(chokeRelaxUntil_); ar.pod(chokeStartTs_); ar.pod(psdLoStart_);
+    ar.pod(lastPsdValid_); ar.pod(lastPsdFs_); ar.pod(lastPsdNfft_); ar.pod(lastPsdOverlap_);
+    ar.pod(rrFallbackConsec_); ar.pod(rrFallbackActive_); ar.pod(rrFallbackDrivingHint_);
+    ar.pod(lastPollBpmEst_); ar.pod(rrFallbackModeActive_);
+    // Provisional HR
+    ar.pod(provisionalLastBpm_); ar.pod(provisionalHandoffStart_); ar.pod(provisionalDone_);
+}
+
+void RealtimeAnalyzer::writeStateLocked(std::vector<uint8_t>& blob) const {
+    StateWriter w;
+    w.bytes.swap(blob);
+    w.bytes.clear();
+    w.bytes.reserve(sizeof(StateHeader) + 4096 + 16 * (m_signal_buffer.size() + ringFilt_.size()) + 4 * displayBuf_.size());
+    w.bytes.resize(sizeof(StateHeader));
+    // transferState() is shared with restore; the writer only reads members
+    const_cast<RealtimeAnalyzer*>(this)->transferState(w);
+    w.bytes.swap(blob);
+}
+
+void RealtimeAnalyzer::sealState(std::vector<uint8_t>& blob) {
+    StateHeader hdr {};
+    std::memcpy(hdr.magic, kStateMagic, sizeof(hdr.magic));
+    hdr.version = kStateVersion;
+    hdr.byteOrder = kStateByteOrder;
+    hdr.optionsSize = static_cast<uint32_t>(sizeof(Options));
+    hdr.payloadSize = blob.size() - sizeof(StateHeader);
+    hdr.checksum = fnv1a(blob.data() + sizeof(StateHeader), static_cast<size_t>(hdr.payloadSize));
+    std::memcpy(blob.data(), &hdr, sizeof(hdr));
+}
+
+uint16_t RealtimeAnalyzer::stateFormatVersion() { return kStateVersion; }
+
+std::vector<uint8_t> RealtimeAnalyzer::saveState() const {
+    trace::Span span("saveState");
+    std::vector<uint8_t> blob;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        writeStateLocked(blob);
+    }
+    sealState(blob);
+    return blob;
+}
+
+bool RealtimeAnalyzer::restoreState(const uint8_t* data, size_t size) {
+    trace::Span span("restoreState");
+    if (!data || size < sizeof(StateHeader)) return false;
+    StateHeader hdr;
+    std::memcpy(&hdr, data, sizeof(hdr));
+    if (std::memcmp(hdr.magic, kStateMagic, sizeof(hdr.magic)) != 0) return false;
+    if (hdr.version != kStateVersion || hdr.byteOrder != kStateByteOrder) return false;
+    if (hdr.optionsSize != sizeof(Options)) return false;
+    if (hdr.payloadSize != size - sizeof(StateHeader)) return false;
+    const uint8_t* payload = data + sizeof(StateHeader);
+    const size_t payloadSize = static_cast<size_t>(hdr.payloadSize);
+    if (fnv1a(payload, payloadSize) != hdr.checksum) return false;
+    {
+        StateReader<false> check(payload, payloadSize);
+        transferState(check);
+        if (!check.atEnd()) return false;
+    }
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    StateReader<true> r(payload, payloadSize);
+    transferState(r);
+    publishPeakGuard();
+    if (recorder_) recorder_->recordState(data, size);
+    ++viewGen_;
+    ctx_.deterministic = opt_.deterministic;
+    tracedDoublingState_ = -1;
+    pendingSamplesGauge_.set(static_cast<double>(samplesSinceEmit_));
+    effectiveFsGauge_.set(effectiveFs_);
+    snrDbGauge_.set(lastQuality_.snrDb);
+    confidenceGauge_.set(lastQuality_.confidence);
+    return r.atEnd();
+}
+
+void RealtimeAnalyzer::reset(double fs, const Options& opt) {
+    trace::Span span("reset");
+    // Defaults of every checkpointed member, captured once from a blank analyzer
+    static const std::vector<uint8_t> blank = RealtimeAnalyzer(50.0).saveState();
+    std::shared_ptr<CaptureRecorder> capture; // a new session is not part of the capture
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        capture.swap(recorder_);
+        StateReader<true> r(blank.data() + sizeof(StateHeader), blank.size() - sizeof(StateHeader));
+        transferState(r); // vectors are resized, not freed
+        fs_ = fs;
+        opt_ = opt;
+        configure();
+        publishPeakGuard();
+        ++viewGen_;
+        tracedDoublingState_ = -1;
+    }
+    for (auto& h : stageHist_) h.reset();
+    for (auto& h : latency_) h.reset();
+    for (metrics::Counter* c : {&droppedSamplesTotal_, &chunkedBatchesTotal_, &backpressureEventsTotal_,
+                                &paramChangeEventsTotal_, &timestampBacktrackEventsTotal_, &timestampsSkippedTotal_,
+                                &timeJumpEventsTotal_, &psdParamClampEventsTotal_, &psdReuseFallbackEventsTotal_,
+                                &psdTimeDomainFallbackEventsTotal_, &psdInvalidFramesTotal_}) {
+        c->reset();
+    }
+    pendingSamplesGauge_.set(0.0);
+    effectiveFsGauge_.set(effectiveFs_);
+    snrDbGauge_.set(0.0);
+    confidenceGauge_.set(0.0);
+}
+
+std::shared_ptr<CaptureRecorder> RealtimeAnalyzer::startCapture(const std::string& path, size_t bufferBytes) {
+    trace::Span span("startCapture");
+    // Room for the opening checkpoint on top of the streaming buffer
+    const size_t stateBytes = saveState().size();
+    double fs;
+    Options opt;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        fs = fs_;
+        opt = opt_;
+    }
+    auto rec = std::make_shared<CaptureRecorder>(path, fs, opt, bufferBytes + 2 * stateBytes);
+    std::shared_ptr<CaptureRecorder> previous;
+    {
+        // The checkpoint and the first recorded push are taken under the
+        // same lock, so no sample falls between them. Poll-owned state is
+        // read unlocked; callers keep polls out (see the header)
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        std::vector<uint8_t> blob;
+        writeStateLocked(blob);
+        sealState(blob);
+        rec->recordState(blob.data(), blob.size());
+        previous.swap(recorder_);
+        recorder_ = rec;
+    }
+    return rec;
+}
+
+void RealtimeAnalyzer::stopCapture() {
+    std::shared_ptr<CaptureRecorder> rec;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        rec.swap(recorder_);
+    }
+    if (rec) rec->stop();
+}
+
+} // namespace heartpy
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+// Non-owning, read-only views of sample arrays for the analysis and push
+// entry points. A view is a pointer, a length and a byte stride, so it can
+// cover a plain array, a std::vector, one field of an array of capture
+// records (interleaved sample/timestamp structs) or a column of a memory-
+// mapped file. The caller keeps the memory alive for the duration of the
+// call; nothing is copied until the data enters the analyzer's own buffers.
+//
+//   struct Frame { double t; float green; uint32_t flags; };
+//   analyzer.push(fieldView(frames, n, &Frame::green), fieldView(frames, n, &Frame::t));
+
+namespace heartpy {
+
+template <class T>
+class SampleView {
+public:
+    using value_type = T;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const char* p, std::ptrdiff_t stride) : p_(p), stride_(stride) {}
+        reference operator*() const { return *reinterpret_cast<const T*>(p_); }
+        reference operator[](difference_type i) const { return *reinterpret_cast<const T*>(p_ + i * stride_); }
+        const_iterator& operator++() { p_ += stride_; return *this; }
+        const_iterator operator++(int) { const_iterator t = *this; p_ += stride_; return t; }
+        const_iterator& operator--() { p_ -= stride_; return *this; }
+        const_iterator operator--(int) { const_iterator t = *this; p_ -= stride_; return t; }
+        const_iterator& operator+=(difference_type d) { p_ += d * stride_; return *this; }
+        const_iterator& operator-=(difference_type d) { p_ -= d * stride_; return *this; }
+        const_iterator operator+(difference_type d) const { return const_iterator(p_ + d * stride_, stride_); }
+        const_iterator operator-(difference_type d) const { return const_iterator(p_ - d * stride_, stride_); }
+        difference_type operator-(const const_iterator& o) const { return (p_ - o.p_) / stride_; }
+        bool operator==(const const_iterator& o) const { return p_ == o.p_; }
+        bool operator!=(const const_iterator& o) const { return p_ != o.p_; }
+        bool operator<(const const_iterator& o) const { return p_ < o.p_; }
+
+    private:
+        const char* p_ {nullptr};
+        std::ptrdiff_t stride_ {static_cast<std::ptrdiff_t>(sizeof(T))};
+    };
+
+    SampleView() = default;
+    // strideBytes: distance between consecutive samples (sizeof(T) when packed)
+    SampleView(const T* data, size_t size, std::ptrdiff_t strideBytes = sizeof(T))
+        : data_(reinterpret_cast<const char*>(data)), size_(data ? size : 0), stride_(strideBytes) {}
+    SampleView(const std::vector<T>& v) : SampleView(v.data(), v.size()) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::ptrdiff_t strideBytes() const { return stride_; }
+    bool contiguous() const { return stride_ == static_cast<std::ptrdiff_t>(sizeof(T)); }
+    // Packed storage (valid only when contiguous())
+    const T* data() const { return reinterpret_cast<const T*>(data_); }
+    const T& operator[](size_t i) const {
+        return *reinterpret_cast<const T*>(data_ + static_cast<std::ptrdiff_t>(i) * stride_);
+    }
+    const_iterator begin() const { return const_iterator(data_, stride_); }
+    const_iterator end() const { return const_iterator(data_ + static_cast<std::ptrdiff_t>(size_) * stride_, stride_); }
+    SampleView subview(size_t offset, size_t count) const {
+        SampleView v;
+        v.data_ = data_ + static_cast<std::ptrdiff_t>(offset) * stride_;
+        v.size_ = count;
+        v.stride_ = stride_;
+        return v;
+    }
+
+private:
+    const char* data_ {nullptr};
+    size_t size_ {0};
+    std::ptrdiff_t stride_ {static_cast<std::ptrdiff_t>(sizeof(T))};
+};
+
+// One field of an array of records, e.g. fieldView(frames, n, &Frame::green)
+template <class Record, class T>
+SampleView<T> fieldView(const Record* records, size_t n, T Record::*field) {
+    if (!records || n == 0) return {};
+    return SampleView<T>(&(records->*field), n, static_cast<std::ptrdiff_t>(sizeof(Record)));
+}
+
+} // namespace heartpy
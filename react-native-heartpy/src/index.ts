@@ -2,6 +2,7 @@ import {Platform} from 'react-native';
 
 import {getNativeModule} from './NativeHeartPy';
 import type {HeartPyModule} from './NativeHeartPy';
+import {decodeResultBuffer} from './resultBuffer';
 import {
 	HeartPyMetrics,
 	HeartPyOptions,
@@ -24,6 +25,8 @@ export type {
 
 export type QualityInfo = HeartPyResult['quality'];
 
+export {decodeResultBuffer} from './resultBuffer';
+
 type NumericInput = number[] | Float32Array | Float64Array;
 
 type ModuleFunction<T extends keyof HeartPyModule> = HeartPyModule[T] extends (...args: infer P) => infer R
@@ -34,7 +37,7 @@ const DEFAULT_CFG: RuntimeConfig = {
 	jsiEnabled: true,
 	zeroCopyEnabled: true,
 	debug: false,
-	maxSamplesPerPush: 5000,
+	maxSamplesPerPush: 0,
 };
 
 let cfg: RuntimeConfig = {...DEFAULT_CFG};
@@ -266,7 +269,7 @@ export async function rtPush(handle: RealtimeHandle, samples: NumericInput, t0?:
 		e.code = 'HEARTPY_E102';
 		throw e;
 	}
-	if (len > cfg.maxSamplesPerPush) {
+	if (cfg.maxSamplesPerPush > 0 && len > cfg.maxSamplesPerPush) {
 		const e: any = new Error(`Invalid data buffer: too large (max ${cfg.maxSamplesPerPush})`);
 		e.code = 'HEARTPY_E102';
 		throw e;
@@ -346,10 +349,34 @@ const HeartPyConfig = {
 	},
 };
 
+// Analyzer HostObject from __hpRtCreateObject. Its methods are taken off the
+// object once; each holds the native analyzer directly, and the analyzer is
+// released by destroy() or when these functions are garbage collected.
+type JsiAnalyzer = {
+	push(samples: Float32Array, t0: number): unknown;
+	pushTs(samples: Float32Array | Float64Array, timestamps: Float64Array): unknown;
+	poll(): unknown;
+	pollBinary(): ArrayBuffer | null;
+	setWindow(windowSeconds: number): void;
+	destroy(): void;
+};
+
+function bindJsiAnalyzer(obj: any): JsiAnalyzer {
+	return {
+		push: obj.push,
+		pushTs: obj.pushTs,
+		poll: obj.poll,
+		pollBinary: obj.pollBinary,
+		setWindow: obj.setWindow,
+		destroy: obj.destroy,
+	};
+}
+
 export class RealtimeAnalyzer {
 	private handle: RealtimeHandle = 0;
 	private mode: 'nm' | 'jsi' = 'nm';
 	private jsiId = 0;
+	private jsiRt: JsiAnalyzer | null = null;
 
 	private constructor(h: RealtimeHandle) {
 		this.handle = h;
@@ -362,7 +389,9 @@ export class RealtimeAnalyzer {
 				const native = getNativeModule();
 				const ok = typeof native.installJSI === 'function' ? !!native.installJSI() : false;
 				const g: any = global;
-				if (
+				if (ok && typeof g.__hpRtCreateObject === 'function') {
+					useJSI = true;
+				} else if (
 					ok &&
 					typeof g.__hpRtCreate === 'function' &&
 					typeof g.__hpRtPush === 'function' &&
@@ -388,10 +417,13 @@ export class RealtimeAnalyzer {
 					err.code = 'HEARTPY_E001';
 					throw err;
 				}
-				const id = g.__hpRtCreate(fs, ensureOptions(options));
 				const inst = new RealtimeAnalyzer(0);
 				inst.mode = 'jsi';
-				inst.jsiId = id | 0;
+				if (typeof g.__hpRtCreateObject === 'function') {
+					inst.jsiRt = bindJsiAnalyzer(g.__hpRtCreateObject(fs, ensureOptions(options)));
+				} else {
+					inst.jsiId = g.__hpRtCreate(fs, ensureOptions(options)) | 0;
+				}
 				if (options?.windowSeconds != null) {
 					try {
 						await inst.setWindow(options.windowSeconds);
@@ -437,6 +469,10 @@ export class RealtimeAnalyzer {
 			throw e;
 		}
 		if (this.mode === 'jsi') {
+			if (this.jsiRt) {
+				this.jsiRt.setWindow(windowSeconds);
+				return;
+			}
 			if (!this.jsiId) {
 				throw new Error('RealtimeAnalyzer destroyed');
 			}
@@ -453,14 +489,18 @@ export class RealtimeAnalyzer {
 
 	async push(samples: NumericInput, t0?: number): Promise<void> {
 		if (this.mode === 'jsi') {
-			if (!this.jsiId) {
+			if (!this.jsiId && !this.jsiRt) {
 				throw new Error('RealtimeAnalyzer destroyed');
 			}
 			const g: any = global;
 			jsiCalls++;
 			const buf = samples instanceof Float32Array ? samples : new Float32Array(asNumberArray(samples));
 			const t1 = Date.now();
-			g.__hpRtPush(this.jsiId, buf, t0 ?? 0);
+			if (this.jsiRt) {
+				this.jsiRt.push(buf, t0 ?? 0);
+			} else {
+				g.__hpRtPush(this.jsiId, buf, t0 ?? 0);
+			}
 			recordDuration(pushDurationsMs, Date.now() - t1);
 			return;
 		}
@@ -470,17 +510,27 @@ export class RealtimeAnalyzer {
 
 	async pushWithTimestamps(samples: NumericInput, timestamps: NumericInput): Promise<void> {
 		if (this.mode === 'jsi') {
-			if (!this.jsiId) {
+			if (!this.jsiId && !this.jsiRt) {
 				throw new Error('RealtimeAnalyzer destroyed');
 			}
 			const g: any = global;
-			const samplesBuf = samples instanceof Float32Array ? samples : new Float32Array(asNumberArray(samples));
+			// Typed arrays go through as-is: native reads Float32Array/Float64Array
+			// samples and Float64Array timestamps in place
+			const samplesBuf =
+				samples instanceof Float32Array || samples instanceof Float64Array ? samples : new Float32Array(asNumberArray(samples));
 			const timestampsBuf = timestamps instanceof Float64Array ? timestamps : new Float64Array(asNumberArray(timestamps));
 			if (!samplesBuf.length || samplesBuf.length !== timestampsBuf.length) {
 				const err: any = new Error('Invalid buffers');
 				err.code = 'HEARTPY_E102';
 				throw err;
 			}
+			if (this.jsiRt) {
+				jsiCalls++;
+				const t1 = Date.now();
+				this.jsiRt.pushTs(samplesBuf, timestampsBuf);
+				recordDuration(pushDurationsMs, Date.now() - t1);
+				return;
+			}
 			const pushTs = typeof g.__hpRtPushTs === 'function' ? g.__hpRtPushTs : null;
 			if (!pushTs) {
 				if (cfg.debug) {
@@ -501,14 +551,25 @@ export class RealtimeAnalyzer {
 
 	async poll(): Promise<HeartPyMetrics | null> {
 		if (this.mode === 'jsi') {
-			if (!this.jsiId) {
+			if (!this.jsiId && !this.jsiRt) {
 				throw new Error('RealtimeAnalyzer destroyed');
 			}
 			const g: any = global;
 			jsiCalls++;
+			if (this.jsiRt) {
+				const t0 = Date.now();
+				const buf = this.jsiRt.pollBinary();
+				recordDuration(pollDurationsMs, Date.now() - t0);
+				return buf ? decodeResultBuffer(buf) : null;
+			}
+			// Prefer the columnar buffer (one copy across JSI) over per-field objects
+			const pollBinary = typeof g.__hpRtPollBinary === 'function' ? g.__hpRtPollBinary : null;
 			const t1 = Date.now();
-			const res = g.__hpRtPoll(this.jsiId);
+			const res = pollBinary ? pollBinary(this.jsiId) : g.__hpRtPoll(this.jsiId);
 			recordDuration(pollDurationsMs, Date.now() - t1);
+			if (pollBinary) {
+				return res ? decodeResultBuffer(res) : null;
+			}
 			return res ?? null;
 		}
 		ensureHandle(this.handle);
@@ -517,6 +578,16 @@ export class RealtimeAnalyzer {
 
 	async destroy(): Promise<void> {
 		if (this.mode === 'jsi') {
+			if (this.jsiRt) {
+				const rt = this.jsiRt;
+				this.jsiRt = null;
+				try {
+					rt.destroy();
+				} catch {
+					// ignore
+				}
+				return;
+			}
 			if (!this.jsiId) {
 				return;
 			}
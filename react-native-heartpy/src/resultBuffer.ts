@@ -0,0 +1,168 @@
+import type {HeartPyResult} from './types/heartpy';
+
+// Decoder for the columnar result buffer written by the native
+// encodeMetrics() (cpp/heartpy_columnar.h). The layout constants below must
+// match that header: a 16-byte header, float64 scalars, int32 quality flags,
+// a directory of {type, count, offset, reserved} uint32 entries and 8-byte
+// aligned columns, all little-endian.
+
+const MAGIC = 0x42525048; // "HPRB"
+const VERSION = 2;
+const SCALARS_OFFSET = 16;
+const SCALAR_COUNT = 36;
+const INT_COUNT = 10;
+const INTS_OFFSET = SCALARS_OFFSET + 8 * SCALAR_COUNT;
+const DIRECTORY_OFFSET = INTS_OFFSET + ((4 * INT_COUNT + 7) & ~7);
+const COLUMN_COUNT = 12;
+
+enum Scalar {
+	BPM, SDNN, RMSSD, SDSD, PNN20, PNN50, NN20, NN50, MAD,
+	SD1, SD2, SD1SD2_RATIO, ELLIPSE_AREA,
+	VLF, LF, HF, LFHF, TOTAL_POWER, LF_NORM, HF_NORM, BREATHING_RATE,
+	REJECTION_RATE, SNR_DB, CONFIDENCE, F0_HZ, MA_PERC_ACTIVE, SNR_SAMPLE_COUNT,
+	REFRACTORY_MS_ACTIVE, MIN_RR_BOUND_MS, PAIR_FRAC, RR_SHORT_FRAC, RR_LONG_MS, P_HALF_OVER_FUND,
+	PROVISIONAL_BPM, PROVISIONAL_CONFIDENCE,
+	WAVEFORM_T0,
+}
+
+enum Int {
+	TOTAL_BEATS, REJECTED_BEATS, GOOD_QUALITY, DOUBLING_FLAG, SOFT_DOUBLING_FLAG, DOUBLING_HINT_FLAG,
+	HARD_FALLBACK_ACTIVE, RR_FALLBACK_MODE_ACTIVE, SNR_WARMUP_ACTIVE, PROVISIONAL_ACTIVE,
+}
+
+enum Column {
+	IBI_MS, RR_LIST, PEAK_LIST, PEAK_TIMESTAMPS, PEAK_LIST_RAW, BINARY_PEAK_MASK,
+	WAVEFORM_VALUES, WAVEFORM_TIMESTAMPS, BINARY_SEGMENTS, TIMINGS_US, QUALITY_WARNING,
+	STAGE_ALLOCS,
+}
+
+enum ColumnType { F64 = 1, F32 = 2, I32 = 3, U8 = 4 }
+
+const STAGE_NAMES = [
+	'preprocess', 'detrend', 'filter', 'peakFit', 'rrClean', 'timeDomain',
+	'spline', 'welch', 'pollCopy', 'snr', 'harmonic', 'total',
+] as const;
+
+/**
+ * Decodes a result buffer (e.g. from the JSI `__hpRtPollBinary`). Columns are
+ * read through typed-array views on `buf`; only the final number[] copies
+ * touch each element. Throws on a buffer that is not an encoding of this
+ * version.
+ */
+export function decodeResultBuffer(buf: ArrayBuffer): HeartPyResult {
+	const dv = new DataView(buf);
+	if (
+		buf.byteLength < DIRECTORY_OFFSET + 16 * COLUMN_COUNT ||
+		dv.getUint32(0, true) !== MAGIC ||
+		dv.getUint16(4, true) !== VERSION ||
+		dv.getUint32(8, true) > buf.byteLength ||
+		dv.getUint32(12, true) < COLUMN_COUNT
+	) {
+		const err: any = new Error('Invalid HeartPy result buffer');
+		err.code = 'HEARTPY_E112';
+		throw err;
+	}
+	const s = (i: Scalar) => dv.getFloat64(SCALARS_OFFSET + 8 * i, true);
+	const n = (i: Int) => dv.getInt32(INTS_OFFSET + 4 * i, true);
+	const col = (c: Column, type: ColumnType): {offset: number; count: number} => {
+		const e = DIRECTORY_OFFSET + 16 * c;
+		const count = dv.getUint32(e + 4, true);
+		return dv.getUint32(e, true) === type ? {offset: dv.getUint32(e + 8, true), count} : {offset: 0, count: 0};
+	};
+	const f64 = (c: Column) => {
+		const {offset, count} = col(c, ColumnType.F64);
+		return Array.from(new Float64Array(buf, offset, count));
+	};
+	const i32 = (c: Column) => {
+		const {offset, count} = col(c, ColumnType.I32);
+		return Array.from(new Int32Array(buf, offset, count));
+	};
+	const f32 = (c: Column) => {
+		const {offset, count} = col(c, ColumnType.F32);
+		return new Float32Array(buf, offset, count);
+	};
+
+	const t0 = s(Scalar.WAVEFORM_T0);
+	const result: HeartPyResult = {
+		bpm: s(Scalar.BPM),
+		ibiMs: f64(Column.IBI_MS),
+		rrList: f64(Column.RR_LIST),
+		peakList: i32(Column.PEAK_LIST),
+		peakTimestamps: f64(Column.PEAK_TIMESTAMPS),
+		peakListRaw: i32(Column.PEAK_LIST_RAW),
+		binaryPeakMask: i32(Column.BINARY_PEAK_MASK),
+		waveform_values: Array.from(f32(Column.WAVEFORM_VALUES)),
+		waveform_timestamps: Array.from(f32(Column.WAVEFORM_TIMESTAMPS), t => t0 + t),
+		sdnn: s(Scalar.SDNN),
+		rmssd: s(Scalar.RMSSD),
+		sdsd: s(Scalar.SDSD),
+		pnn20: s(Scalar.PNN20),
+		pnn50: s(Scalar.PNN50),
+		nn20: s(Scalar.NN20),
+		nn50: s(Scalar.NN50),
+		mad: s(Scalar.MAD),
+		sd1: s(Scalar.SD1),
+		sd2: s(Scalar.SD2),
+		sd1sd2Ratio: s(Scalar.SD1SD2_RATIO),
+		ellipseArea: s(Scalar.ELLIPSE_AREA),
+		vlf: s(Scalar.VLF),
+		lf: s(Scalar.LF),
+		hf: s(Scalar.HF),
+		lfhf: s(Scalar.LFHF),
+		totalPower: s(Scalar.TOTAL_POWER),
+		lfNorm: s(Scalar.LF_NORM),
+		hfNorm: s(Scalar.HF_NORM),
+		breathingRate: s(Scalar.BREATHING_RATE),
+		quality: {
+			totalBeats: n(Int.TOTAL_BEATS),
+			rejectedBeats: n(Int.REJECTED_BEATS),
+			rejectionRate: s(Scalar.REJECTION_RATE),
+			goodQuality: n(Int.GOOD_QUALITY) !== 0,
+			snrDb: s(Scalar.SNR_DB),
+			confidence: s(Scalar.CONFIDENCE),
+			f0Hz: s(Scalar.F0_HZ),
+			maPercActive: s(Scalar.MA_PERC_ACTIVE),
+			doublingFlag: n(Int.DOUBLING_FLAG) !== 0,
+			softDoublingFlag: n(Int.SOFT_DOUBLING_FLAG) !== 0,
+			doublingHintFlag: n(Int.DOUBLING_HINT_FLAG) !== 0,
+			hardFallbackActive: n(Int.HARD_FALLBACK_ACTIVE) !== 0,
+			rrFallbackModeActive: n(Int.RR_FALLBACK_MODE_ACTIVE) !== 0,
+			snrWarmupActive: n(Int.SNR_WARMUP_ACTIVE),
+			snrSampleCount: s(Scalar.SNR_SAMPLE_COUNT),
+			refractoryMsActive: s(Scalar.REFRACTORY_MS_ACTIVE),
+			minRRBoundMs: s(Scalar.MIN_RR_BOUND_MS),
+			pairFrac: s(Scalar.PAIR_FRAC),
+			rrShortFrac: s(Scalar.RR_SHORT_FRAC),
+			rrLongMs: s(Scalar.RR_LONG_MS),
+			pHalfOverFund: s(Scalar.P_HALF_OVER_FUND),
+			provisionalActive: n(Int.PROVISIONAL_ACTIVE),
+			provisionalBpm: s(Scalar.PROVISIONAL_BPM),
+			provisionalConfidence: s(Scalar.PROVISIONAL_CONFIDENCE),
+		},
+	};
+	const warning = col(Column.QUALITY_WARNING, ColumnType.U8);
+	if (warning.count) {
+		const bytes = new Uint8Array(buf, warning.offset, warning.count);
+		// Native warnings are ASCII
+		result.quality.qualityWarning = String.fromCharCode(...Array.from(bytes));
+	}
+	const timings = col(Column.TIMINGS_US, ColumnType.F64);
+	if (timings.count === STAGE_NAMES.length) {
+		const us = new Float64Array(buf, timings.offset, timings.count);
+		const out: NonNullable<HeartPyResult['timingsUs']> = {};
+		STAGE_NAMES.forEach((name, i) => {
+			out[name] = us[i];
+		});
+		result.timingsUs = out;
+	}
+	const allocs = col(Column.STAGE_ALLOCS, ColumnType.F64);
+	if (allocs.count === STAGE_NAMES.length) {
+		const counts = new Float64Array(buf, allocs.offset, allocs.count);
+		const out: NonNullable<HeartPyResult['stageAllocs']> = {};
+		STAGE_NAMES.forEach((name, i) => {
+			out[name] = counts[i];
+		});
+		result.stageAllocs = out;
+	}
+	return result;
+}
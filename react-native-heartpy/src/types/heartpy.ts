@@ -53,6 +53,20 @@ export type HeartPyOptions = {
 	snrTauSec?: number;
 	snrActiveTauSec?: number;
 	adaptivePsd?: boolean;
+	/** Record per-stage latency (µs) into result.timingsUs */
+	profileStages?: boolean;
+	/** Streaming: analyze windows in float32 instead of widening to double (default false) */
+	singlePrecision?: boolean;
+	/** Streaming: autocorrelation BPM during warm-up (default true) */
+	provisionalHR?: boolean;
+	provisionalMinSec?: number;
+	provisionalMinConfidence?: number;
+	/**
+	 * Metric groups to compute (default 'full'). 'hrOnly': bpm + quality;
+	 * 'timeDomainHrv': adds rrList/ibiMs and time-domain HRV. Skipped
+	 * vectors come back empty, frequency-domain values NaN.
+	 */
+	profile?: 'full' | 'hrOnly' | 'timeDomainHrv';
 };
 
 export type QualityInfo = {
@@ -78,6 +92,10 @@ export type QualityInfo = {
 	pHalfOverFund?: number;
 	snrWarmupActive?: number;
 	snrSampleCount?: number;
+	/** 1 while bpm is the warm-up provisional estimate */
+	provisionalActive?: number;
+	provisionalBpm?: number;
+	provisionalConfidence?: number;
 };
 
 export type HeartPyResult = {
@@ -112,13 +130,19 @@ export type HeartPyResult = {
 	breathingRate: number;
 	quality: QualityInfo;
 	segments?: HeartPyResult[];
+	/** Per-stage latency in microseconds (only with options.profileStages) */
+	timingsUs?: Partial<Record<
+		'preprocess' | 'detrend' | 'filter' | 'peakFit' | 'rrClean' | 'timeDomain' |
+		'spline' | 'welch' | 'pollCopy' | 'snr' | 'harmonic' | 'total', number>>;
+	/** Per-stage heap allocation count (profileStages in a native HEARTPY_ALLOC_AUDIT build) */
+	stageAllocs?: Partial<Record<keyof NonNullable<HeartPyResult['timingsUs']>, number>>;
 };
 
 export type RuntimeConfig = {
 	jsiEnabled: boolean;
 	zeroCopyEnabled: boolean;
 	debug: boolean;
-	maxSamplesPerPush: number;
+	maxSamplesPerPush: number; // 0 = unlimited (native ingests large batches in bounded slices)
 };
 
 export type RuntimeConfigPatch = Partial<RuntimeConfig>;